@@ -180,6 +180,12 @@ using std::unordered_map;
 # define nullptr NULL
 #endif
 
+// Rvalue references (move construction and assignment). Visual Studio 2010
+// and above, and GCC 4.3 and above with -std=c++0x.
+#if (_MSC_VER >= 1600) || defined(__GXX_EXPERIMENTAL_CXX0X__) || (__cplusplus >= 201103L)
+# define ESAPI_CPLUSPLUS_RVALUE_REFS 1
+#endif
+
 // A debug assert which should be sprinkled liberally. This assert fires and then continues rather
 // than calling abort(). Useful when examining negative test cases from the command line.
 #if (defined(ESAPI_BUILD_DEBUG) && defined(ESAPI_OS_STARNIX)) && !defined(ESAPI_NO_ASSERT)
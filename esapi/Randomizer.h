@@ -0,0 +1,161 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) for C++ project. For details, please see
+ * <a href="http://www.owasp.org/index.php/ESAPI">http://www.owasp.org/index.php/ESAPI</a>.
+ *
+ * Copyright &copy; 2011 - The OWASP Foundation
+ *
+ * Derived from org.owasp.esapi.Randomizer class in ESAPI 2.0 for JavaEE.
+ *
+ * The ESAPI is published by OWASP under the new BSD license. You should read
+ * and accept the LICENSE before you use, modify, and/or redistribute this
+ * software.
+ *
+ * @author kevin.w.wall@gmail.com
+ * @author Jeff Walton (noloader .at. gmail.com)
+ * @author Jeff Williams (jeff.williams .at. aspectsecurity.com) [Java version]
+ *
+ * @created 2011
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "EsapiTypes.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
+
+#include <string>
+#include <vector>
+
+namespace esapi
+{
+  /**
+   * The Randomizer interface defines a set of methods for creating
+   * cryptographically random strings, tokens and identifiers. Implementations
+   * should draw from a cryptographically strong generator, such as SecureRandom,
+   * and must not introduce a bias when mapping random bytes onto a character set.
+   *
+   * @author Jeff Williams (jeff.williams .at. aspectsecurity.com) [Java version]
+   * @since 1.0
+   */
+  class ESAPI_EXPORT Randomizer
+  {
+  public:
+    /**
+     * Encodings for the tokens returned by getRandomToken() and getRandomTokens().
+     * Hex is lowercase; Base64Url is the URL and filename safe alphabet of RFC 4648,
+     * section 5, without padding.
+     */
+    enum TokenEncoding { TokenHex, TokenBase64Url };
+
+    /**
+     * Gets a random string of a desired length and character set. Every character
+     * of the set is equally likely at every position. The character set is treated
+     * as a multiset, so a character which appears twice is twice as likely.
+     *
+     * @param length
+     *      the length of the string
+     * @param characterSet
+     *      the set of characters to include in the created random string
+     *
+     * @return
+     *      the random string of the desired length and character set
+     *
+     * @throws IllegalArgumentException
+     *      if the character set is empty or holds more than 256 characters
+     */
+    virtual NarrowString getRandomString(size_t length, const NarrowString& characterSet) = 0;
+
+    /**
+     * Gets a batch of random strings of the same length and character set. The
+     * random bytes for the whole batch are drawn at once.
+     *
+     * @param count
+     *      the number of strings
+     * @param length
+     *      the length of each string
+     * @param characterSet
+     *      the set of characters to include in the created random strings
+     *
+     * @return
+     *      the random strings
+     *
+     * @throws IllegalArgumentException
+     *      if the character set is empty or holds more than 256 characters
+     */
+    virtual StringArray getRandomStrings(size_t count, size_t length, const NarrowString& characterSet) = 0;
+
+    /**
+     * Returns an unguessable random filename with the specified extension.
+     *
+     * @param extension
+     *      extension to add to the random filename
+     *
+     * @return
+     *      a random unguessable filename ending with the specified extension
+     */
+    virtual NarrowString getRandomFilename(const NarrowString& extension) = 0;
+
+    /**
+     * Generates a random GUID. This method uses the version 4 (random) layout of
+     * RFC 4122 and returns it in the canonical, lowercase form, for example
+     * "f81d4fae-7dec-41d0-a765-00a0c91e6bf6".
+     *
+     * @return
+     *      the GUID
+     */
+    virtual NarrowString getRandomGUID() = 0;
+
+    /**
+     * Generates a batch of random GUIDs.
+     *
+     * @param count
+     *      the number of GUIDs
+     *
+     * @return
+     *      the GUIDs
+     */
+    virtual StringArray getRandomGUIDs(size_t count) = 0;
+
+    /**
+     * Generates a random token of the specified number of bytes, encoded as
+     * requested. Suitable for session identifiers and CSRF tokens.
+     *
+     * @param size
+     *      the number of random bytes in the token
+     * @param encoding
+     *      the encoding of the token
+     *
+     * @return
+     *      the encoded token
+     */
+    virtual NarrowString getRandomToken(size_t size, TokenEncoding encoding = TokenBase64Url) = 0;
+
+    /**
+     * Generates a batch of random tokens. The random bytes for the whole batch are
+     * drawn at once.
+     *
+     * @param count
+     *      the number of tokens
+     * @param size
+     *      the number of random bytes in each token
+     * @param encoding
+     *      the encoding of the tokens
+     *
+     * @return
+     *      the encoded tokens
+     */
+    virtual StringArray getRandomTokens(size_t count, size_t size, TokenEncoding encoding = TokenBase64Url) = 0;
+
+    virtual ~Randomizer() { }
+  };
+
+  /**
+   * Returns the process-wide Randomizer.
+   */
+  ESAPI_EXPORT Randomizer& randomizer();
+
+} // NAMESPACE esapi
@@ -0,0 +1,63 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "crypto/CryptoppCommon.h"
+
+/**
+ * Drop-in replacements for Crypto++'s SHA224 and SHA256 whose compression function is
+ * selected at runtime. Crypto++ supplies the padding, buffering and finalization through
+ * IteratedHashWithStaticTransform; we only swap the per-block Transform. When the processor
+ * has the SHA extensions (and the compiler can emit them) the block is processed with
+ * SHA-NI. Otherwise the call is forwarded to CryptoPP::SHA256::Transform, so the output is
+ * bit-for-bit the same either way.
+ *
+ * The classes are usable anywhere a Crypto++ hash is, including CryptoPP::HMAC<>, so
+ * MessageDigest, the Hash and HMAC DRBGs and KDFs built on them all pick up the backend.
+ * SHA-384 and SHA-512 have no SHA-NI instructions and remain on the Crypto++ code path.
+ */
+
+namespace esapi
+{
+  class ESAPI_PRIVATE AcceleratedSHA256
+    : public CryptoPP::IteratedHashWithStaticTransform<CryptoPP::word32, CryptoPP::BigEndian, 64, 32, AcceleratedSHA256, 32, true>
+  {
+  public:
+    static void CRYPTOPP_API InitState(HashWordType *state) { CryptoPP::SHA256::InitState(state); }
+    static void CRYPTOPP_API Transform(CryptoPP::word32 *digest, const CryptoPP::word32 *data);
+    static const char * CRYPTOPP_API StaticAlgorithmName() { return "SHA-256"; }
+
+    /**
+     * Returns the name of the compression function in use: "SHA-NI" or "Portable".
+     */
+    static const char* Backend();
+  };
+
+  class ESAPI_PRIVATE AcceleratedSHA224
+    : public CryptoPP::IteratedHashWithStaticTransform<CryptoPP::word32, CryptoPP::BigEndian, 64, 32, AcceleratedSHA224, 28, true>
+  {
+  public:
+    static void CRYPTOPP_API InitState(HashWordType *state) { CryptoPP::SHA224::InitState(state); }
+    static void CRYPTOPP_API Transform(CryptoPP::word32 *digest, const CryptoPP::word32 *data) { AcceleratedSHA256::Transform(digest, data); }
+    static const char * CRYPTOPP_API StaticAlgorithmName() { return "SHA-224"; }
+
+    /**
+     * Returns the name of the compression function in use: "SHA-NI" or "Portable".
+     */
+    static const char* Backend() { return AcceleratedSHA256::Backend(); }
+  };
+
+} // NAMESPACE esapi
@@ -19,6 +19,9 @@ namespace esapi
 {
   class ESAPI_EXPORT AlgorithmParameterSpec
   {
+  public:
+    // Polymorphic so that Cipher can recover the concrete spec
+    virtual ~AlgorithmParameterSpec() { }
   };
 } // NAMESPACE
 
@@ -0,0 +1,130 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "util/Mutex.h"
+#include "crypto/SecureRandom.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
+
+#include <string>
+
+namespace esapi
+{
+    /**
+     * BufferedSecureRandom keeps a block of pre-generated DRBG output so that small
+     * requests (nonces, salts, session tokens) are satisfied with a memcpy rather than
+     * a full generate cycle of the underlying SecureRandom. The buffer is refilled in
+     * bulk when it falls below its low water mark, or on demand by calling refill() (for
+     * example, from an idle or housekeeping thread). Bytes are zeroized as soon as they
+     * are handed out, and the buffer is discarded and the generator reseeded if the
+     * process forks so that parent and child never share output.
+     *
+     * Requests larger than half the capacity bypass the buffer. Copies share the buffer
+     * and the lock (like SecureRandom); create one object per thread for a sharded layout.
+     */
+
+    class BufferedSecureRandomImpl;
+
+    class ESAPI_EXPORT BufferedSecureRandom
+    {
+    public:
+        /**
+         * The default capacity of the buffer, in bytes.
+         */
+        enum { DefaultCapacity = 4096 };
+
+        /**
+         * Constructs a buffered generator over the default random number algorithm.
+         */
+        explicit BufferedSecureRandom(size_t capacity = DefaultCapacity);
+
+        /**
+         * Constructs a buffered generator over the named random number algorithm.
+         */
+        explicit BufferedSecureRandom(const NarrowString& algorithm, size_t capacity = DefaultCapacity);
+
+        /**
+         * Constructs a buffered generator over an existing SecureRandom object.
+         */
+        explicit BufferedSecureRandom(const SecureRandom& random, size_t capacity = DefaultCapacity);
+
+        /**
+         * Destroy this buffered random number generator (RNG).
+         */
+        ~BufferedSecureRandom() { };
+
+        /**
+         * Copy this buffered random number generator (RNG).
+         */
+        BufferedSecureRandom(const BufferedSecureRandom& rhs);
+
+        /**
+         * Assign this buffered random number generator (RNG).
+         */
+        BufferedSecureRandom& operator=(const BufferedSecureRandom& rhs);
+
+        /**
+         * Returns the name of the algorithm implemented by the underlying SecureRandom object.
+         */
+        NarrowString getAlgorithm() const;
+
+        /**
+         * Returns the capacity of the buffer, in bytes.
+         */
+        size_t getCapacity() const;
+
+        /**
+         * Returns the number of pre-generated bytes currently available.
+         */
+        size_t getAvailable() const;
+
+        /**
+         * Generates a user-specified number of random bytes.
+         */
+        void nextBytes(byte bytes[], size_t size);
+
+        /**
+         * Tops up the consumed portion of the buffer from the underlying generator.
+         */
+        void refill();
+
+        /**
+         * Zeroizes and discards all pre-generated bytes.
+         */
+        void clear();
+
+    protected:
+
+        /**
+         * Retrieves the object level lock
+         */
+        ESAPI_PRIVATE inline Mutex& getObjectLock() const;
+
+    private:
+
+        /**
+         * Object level lock for concurrent access
+         */
+        mutable shared_ptr<Mutex> m_lock;
+
+        /**
+         * Reference counted PIMPL.
+         */
+        shared_ptr<BufferedSecureRandomImpl> m_impl;
+    };
+
+} // NAMESPACE esapi
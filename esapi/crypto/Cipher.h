@@ -24,8 +24,27 @@ namespace esapi
   class Key;
   class CipherImpl;
   class SecureRandom;
-  class AlgorithmParameters;
-
+  class AlgorithmParameterSpec;
+
+  /**
+  * A symmetric cipher in the style of javax.crypto.Cipher. The transformation is
+  * "cipher[/mode[/padding]]", for example "AES/CBC/PKCS5Padding" or "AES/GCM/NoPadding".
+  * ECB, CBC, CFB, OFB and CTR are supported for AES, Camellia, Blowfish, DESede and
+  * DES, and GCM and EAX for AES and Camellia (with a 16 byte tag appended to the
+  * ciphertext). Only ECB and CBC take a padding.
+  *
+  * init expands the key schedule. Initializing again with the same key and direction
+  * only loads the new IV, so one Cipher can process any number of messages under a
+  * key without repeating the key expansion. As in the JCE, doFinal returns the cipher
+  * to the state following init (the same IV), except that GCM and EAX encryption
+  * require a new IV before the next message.
+  *
+  * The update and doFinal overloads which take an output buffer write directly into
+  * it and do not allocate. The overloads which return a SecureByteArray allocate the
+  * result. Decryption under GCM or EAX holds the ciphertext until doFinal so that no
+  * unauthenticated plain text is released; a single doFinal over the whole message
+  * avoids that buffer.
+  */
   class ESAPI_EXPORT Cipher
   {
   public:
@@ -90,7 +109,7 @@ namespace esapi
     * Finishes a multiple-part encryption or decryption operation,
     * depending on how this cipher was initialized.
     */
-    size_t doFinal(const byte output[], size_t size, size_t outputOffset);
+    size_t doFinal(byte output[], size_t size, size_t outputOffset);
 
     /**
     * Finishes a multiple-part encryption or decryption operation,
@@ -141,10 +160,15 @@ namespace esapi
     */
     void init(size_t opmode, const Key& key);
 
+    /**
+    * Initializes this cipher with a key and a set of algorithm parameters (an IvParameterSpec).
+    */
+    void init(int opmode, const Key& key, const AlgorithmParameterSpec& params);
+
     /**
     * Initializes this cipher with a key, a set of algorithm parameters, and a source of randomness.
     */
-    void init(int opmode, const Key& key, AlgorithmParameters& params, SecureRandom& random);
+    void init(int opmode, const Key& key, const AlgorithmParameterSpec& params, SecureRandom& random);
 
     /**
     * Initializes this cipher with a key and a source of randomness.
@@ -15,23 +15,202 @@
 #pragma once
 
 #include "EsapiCommon.h"
-#include "util/SecureString.h"
+#include "util/SecureArray.h"
+#include "crypto/CipherSpec.h"
 #include "crypto/CryptoppCommon.h"
 #include "errors/EncryptionException.h"
 #include "errors/IllegalArgumentException.h"
 
 namespace esapi
 {
-  class CipherText
+  /**
+   * The result of a symmetric encryption: the CipherSpec used (transformation, key
+   * size, block size and IV) and the raw ciphertext. For the combined modes, such
+   * as GCM, the authentication tag is appended to the raw ciphertext.
+   *
+   * Copies are deep. Accessors which return a SecureByteArray return a copy, so a
+   * CipherText can be reused as the destination of DefaultEncryptor::encrypt()
+   * without disturbing bytes handed out earlier.
+   */
+  class CipherTextView;
+
+  class ESAPI_EXPORT CipherText
   {
+    // DefaultEncryptor encrypts directly into the raw ciphertext buffer
+    friend class DefaultEncryptor;
+    // CipherTextView builds a CipherText from the serialized fields
+    friend class CipherTextView;
+
   public:
     explicit CipherText();
+    explicit CipherText(const CipherSpec& cipherSpec);
+    CipherText(const CipherSpec& cipherSpec, const SecureByteArray& cipherText);
+    CipherText(const CipherText& rhs);
     virtual ~CipherText();
 
+    CipherText& operator=(const CipherText& rhs);
+
     bool empty() const;
+
+    CipherSpec getCipherSpec() const;
+    String getCipherTransformation() const;
+    String getCipherAlgorithm() const;
+    unsigned int getKeySize() const;
+    unsigned int getBlockSize() const;
     String getCipherMode() const;
-  
+    String getPaddingScheme() const;
+    SecureByteArray getIV() const;
+    bool requiresIV() const;
+
+    /**
+     * Returns a copy of the raw ciphertext (including the tag for a combined mode).
+     */
+    SecureByteArray getRawCipherText() const;
+
+    /**
+     * Returns the size of the raw ciphertext in bytes.
+     */
+    size_t getRawCipherTextByteLength() const;
+
+    /**
+     * Sets the raw ciphertext and the encryption timestamp. The bytes are copied.
+     */
+    void setCiphertext(const SecureByteArray& cipherText);
+
+    /**
+     * Returns the time of encryption, in milliseconds since the epoch.
+     */
+    long long getEncryptionTimestamp() const;
+
+    /**
+     * Returns the version of the KDF used to derive the authenticity key.
+     */
+    unsigned int getKDFVersion() const;
+
+    /**
+     * Returns the PRF selection of the KDF (KeyDerivationFunction::PRF_ALGORITHMS).
+     */
+    unsigned int getKDF_PRF() const;
+
+    /**
+     * Returns a copy of the separate MAC, which is empty for the combined modes.
+     */
+    SecureByteArray getSeparateMAC() const;
+
+    /**
+     * Stores the separate MAC over the IV and raw ciphertext. The bytes are copied.
+     */
+    void storeSeparateMAC(const SecureByteArray& mac);
+
+    /**
+     * Returns the size of the portable serialization in bytes.
+     */
+    size_t getSerializedSize() const;
+
+    /**
+     * Writes the portable serialization into the caller's buffer, which must hold
+     * getSerializedSize() bytes. The layout is that of the Java CipherTextSerializer,
+     * with all integers big endian:
+     *
+     *   KDF info (4) | timestamp (8) | transformation length (2) | transformation (UTF-8) |
+     *   key size in bits (2) | block size (2) | IV length (2) | IV |
+     *   ciphertext length (4) | ciphertext | MAC length (2) | MAC
+     *
+     * The KDF info holds the PRF selection in its top four bits and the KDF version
+     * (a date, which also serves as the format version) in its low 27 bits.
+     *
+     * @return  the number of bytes written.
+     *
+     * @throws  throws an IllegalArgumentException if the buffer is too small, or an
+     *          EncryptionException if a field does not fit the layout.
+     */
+    size_t serialize(byte output[], size_t size) const;
+
+    /**
+     * Returns the portable serialization in a new buffer.
+     */
+    SecureByteArray asPortableSerializedByteArray() const;
+
+    /**
+     * Creates a CipherText from its portable serialization. The fields are copied;
+     * use a CipherTextView to read them in place.
+     *
+     * @throws  throws an EncryptionException if the serialization is not valid.
+     */
+    static CipherText fromPortableSerializedBytes(const byte bytes[], size_t size);
+
+  private:
+    void setEncryptionTimestamp();
+
+  private:
+    CipherSpec m_spec;
+    SecureByteArray m_raw;
+    SecureByteArray m_mac;
+    long long m_timestamp;
+    unsigned int m_kdfInfo;
+  };
+
+  /**
+   * A parsed, non-owning view of a serialized CipherText. The accessors point into
+   * the caller's buffer, so nothing is copied and the buffer must outlive the view.
+   * The buffer may continue past the serialization; getSerializedSize() reports
+   * where it ended.
+   */
+  class ESAPI_EXPORT CipherTextView
+  {
+  public:
+    /**
+     * Parses a serialized CipherText in place.
+     *
+     * @throws  throws an EncryptionException if the serialization is truncated, has
+     *          an unknown KDF version, or a field is not valid.
+     */
+    CipherTextView(const byte bytes[], size_t size);
+
+    unsigned int getKDFVersion() const { return m_kdfInfo & 0x07ffffff; }
+    unsigned int getKDF_PRF() const { return m_kdfInfo >> 28; }
+    long long getEncryptionTimestamp() const { return m_timestamp; }
+
+    /**
+     * Returns the transformation, such as "AES/GCM/NoPadding".
+     */
+    String getCipherTransformation() const;
+
+    unsigned int getKeySize() const { return m_keySize; }
+    unsigned int getBlockSize() const { return m_blockSize; }
+
+    const byte* getIV() const { return m_iv; }
+    size_t getIVLength() const { return m_ivLen; }
+
+    const byte* getRawCipherText() const { return m_raw; }
+    size_t getRawCipherTextByteLength() const { return m_rawLen; }
+
+    const byte* getSeparateMAC() const { return m_mac; }
+    size_t getSeparateMACLength() const { return m_macLen; }
+
+    /**
+     * Returns the number of bytes the serialization occupies.
+     */
+    size_t getSerializedSize() const { return m_size; }
+
+    /**
+     * Returns an owning CipherText with copies of the fields.
+     */
+    CipherText toCipherText() const;
+
   private:
-    SecureString m_text;
+    unsigned int m_kdfInfo;
+    long long m_timestamp;
+    const char* m_xform;
+    size_t m_xformLen;
+    unsigned int m_keySize;
+    unsigned int m_blockSize;
+    const byte* m_iv;
+    size_t m_ivLen;
+    const byte* m_raw;
+    size_t m_rawLen;
+    const byte* m_mac;
+    size_t m_macLen;
+    size_t m_size;
   };
 } // NAMESPACE esapi
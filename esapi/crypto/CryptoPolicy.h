@@ -0,0 +1,128 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "EsapiTypes.h"
+#include "SecurityConfiguration.h"
+#include "util/NotCopyable.h"
+#include "util/SecureArray.h"
+#include "util/AlgorithmName.h"
+#include "crypto/SecretKey.h"
+
+namespace esapi
+{
+  /**
+   * The crypto settings of a SecurityConfiguration, read once and pre-parsed. The
+   * cipher transformation is held as an AlgorithmName, the combined and allowed
+   * cipher modes as bitmasks of AlgorithmName::ModeId, and the master key and salt
+   * in zeroizing memory.
+   *
+   * A policy is immutable. getInstance() returns the process-wide policy, built from
+   * the default configuration on first use; setInstance() or reload() replace it.
+   * Callers holding the old policy keep using it until they release it, so an
+   * operation never sees half of one policy and half of another.
+   */
+  class ESAPI_EXPORT CryptoPolicy : private NotCopyable
+  {
+  public:
+    /**
+     * Returns the process-wide policy.
+     */
+    static shared_ptr<const CryptoPolicy> getInstance();
+
+    /**
+     * Replaces the process-wide policy.
+     */
+    static void setInstance(const shared_ptr<const CryptoPolicy>& policy);
+
+    /**
+     * Builds a policy from the configuration and makes it the process-wide policy.
+     *
+     * @throws  throws an EncryptionException if the cipher transformation is not
+     *          valid.
+     */
+    static shared_ptr<const CryptoPolicy> reload(SecurityConfiguration& config);
+
+    /**
+     * Builds a policy from the configuration.
+     *
+     * @throws  throws an EncryptionException if the cipher transformation is not
+     *          valid.
+     */
+    explicit CryptoPolicy(SecurityConfiguration& config);
+
+    virtual ~CryptoPolicy() { }
+
+    /**
+     * Returns the configured cipher transformation.
+     */
+    const AlgorithmName& getCipherTransformation() const { return m_xform; }
+
+    /**
+     * Returns true if a MAC is computed for ciphertext under a mode which is not a
+     * combined mode.
+     */
+    bool useMACforCipherText() const { return m_useMac; }
+
+    /**
+     * Returns true if the mode provides both confidentiality and authenticity.
+     */
+    bool isCombinedCipherMode(AlgorithmName::ModeId mode) const { return 0 != (m_combined & ModeBit(mode)); }
+
+    /**
+     * Returns true if the mode is a combined mode or an additional allowed mode.
+     */
+    bool isAllowedCipherMode(AlgorithmName::ModeId mode) const { return 0 != (m_allowed & ModeBit(mode)); }
+
+    /**
+     * As above, by name (for example, "GCM").
+     */
+    bool isCombinedCipherMode(const NarrowString& mode) const;
+
+    /**
+     * As above, by name (for example, "CBC").
+     */
+    bool isAllowedCipherMode(const NarrowString& mode) const;
+
+    /**
+     * Returns the master key.
+     */
+    const SecretKey& getMasterKey() const { return m_masterKey; }
+
+    /**
+     * Returns the master salt.
+     */
+    const SecureByteArray& getMasterSalt() const { return m_masterSalt; }
+
+  private:
+    static unsigned int ModeBit(AlgorithmName::ModeId mode) { return 1u << (unsigned int)mode; }
+
+    AlgorithmName m_xform;
+    bool m_useMac;
+
+    // Bits of the modes known to AlgorithmName
+    unsigned int m_combined;
+    unsigned int m_allowed;
+
+    // Names from the configuration which AlgorithmName does not know
+    StringList m_otherCombined;
+    StringList m_otherAllowed;
+
+    SecretKey m_masterKey;
+    SecureByteArray m_masterSalt;
+  };
+
+} // NAMESPACE esapi
@@ -0,0 +1,110 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "util/SecureArray.h"
+#include "crypto/Cipher.h"
+#include "crypto/SecretKey.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
+
+namespace esapi
+{
+  class EncryptThenMacImpl;
+
+  /**
+   * Encrypt-then-MAC for the cipher modes which do not authenticate (CBC, CFB, OFB
+   * and CTR). The MAC is the one JavaEncryptor stores in a CipherText: HmacSHA1 over
+   * the IV and the raw ciphertext, under the "authenticity" key derived from the
+   * SecretKey by the KeyDerivationFunction.
+   *
+   * encrypt() and decrypt() work through the message a chunk at a time, and each
+   * chunk of ciphertext is MACed while it is still in cache, so the message is read
+   * from memory once rather than once for the cipher and again for the MAC. The HMAC
+   * keyed with the derived key is cached per SecretKey, so neither the KDF nor the
+   * HMAC key setup is repeated for a key which has been seen recently. The cache is
+   * filed under the key's fingerprint and does not keep a copy of the key.
+   */
+  class ESAPI_EXPORT EncryptThenMac
+  {
+  public:
+    enum { MacSize = 20, ChunkSize = 4096 };
+
+    /**
+     * Prepares the MAC for the key. The authenticity key is derived on first use of
+     * the key and cached.
+     *
+     * @throws  throws an EncryptionException if the key is not valid.
+     */
+    explicit EncryptThenMac(const SecretKey& key);
+
+    virtual ~EncryptThenMac() { }
+
+    /**
+     * Encrypts with a Cipher initialized for encryption, and MACs the IV and the
+     * ciphertext as it is written. The output buffer must hold
+     * cipher.getOutputSize(size) bytes and the MAC buffer MacSize bytes.
+     *
+     * @return  the number of bytes of ciphertext written.
+     *
+     * @throws  throws an IllegalArgumentException if a buffer is not valid, or an
+     *          EncryptionException if the encryption fails.
+     */
+    size_t encrypt(Cipher& cipher, const byte input[], size_t size, byte output[], size_t outSize,
+                   byte mac[], size_t macSize) const;
+
+    /**
+     * Decrypts with a Cipher initialized for decryption, MACing the ciphertext as
+     * it is read. The MAC is compared before a padding error is reported, and any
+     * failure wipes the output and throws the same exception. The output buffer
+     * must hold size bytes.
+     *
+     * @return  the number of bytes of plain text written.
+     *
+     * @throws  throws an EncryptionException if the MAC or padding is not valid.
+     */
+    size_t decrypt(Cipher& cipher, const byte input[], size_t size, const byte mac[], size_t macSize,
+                   byte output[], size_t outSize) const;
+
+    /**
+     * Computes the MAC over an IV and ciphertext which already exist.
+     */
+    SecureByteArray computeMAC(const byte iv[], size_t ivSize, const byte input[], size_t size) const;
+
+    /**
+     * Computes the MAC over an IV and ciphertext and compares it to the expected
+     * MAC in constant time.
+     */
+    bool verifyMAC(const byte iv[], size_t ivSize, const byte input[], size_t size,
+                   const byte mac[], size_t macSize) const;
+
+    /**
+     * Drops the cached HMACs. Call after a key rotation so that retired keys do not
+     * linger in memory.
+     */
+    static void clearCache();
+
+    /**
+     * Drops the cached HMAC for one key. KeyDerivationFunction::invalidateDerivedKeys()
+     * calls this for the KDK it invalidates.
+     */
+    static void invalidate(const SecretKey& key);
+
+  private:
+    shared_ptr<EncryptThenMacImpl> m_impl;
+  };
+
+} // NAMESPACE esapi
@@ -52,9 +52,10 @@ namespace esapi
   private:
 
     /**
-     * Private helper to create the SecureByteArray.
+     * Private helper to validate the IV and copy it into m_iv. IVs fit the
+     * SecureByteArray's inline storage, so nothing is allocated.
      */
-    SecureByteArray create_secure_array(const byte iv[], size_t size, size_t offset, size_t len);
+    void assign_iv(const byte iv[], size_t size, size_t offset, size_t len);
 
   private:
 
@@ -16,6 +16,9 @@
 
 #include "crypto/CryptoppCommon.h"
 #include "crypto/SecretKey.h"
+#include "util/SecureArray.h"
+
+#include <vector>
 
 /**
  * This class implements a Key Derivation Function (KDF) and supporting methods.
@@ -42,6 +45,23 @@ namespace esapi
   class ESAPI_EXPORT KeyDerivationFunction
   {
   public:
+    /**
+     * Version of the KDF, as a date (YYYYMMDD). It is recorded in each serialized
+     * CipherText and must match JavaEncryptor's.
+     */
+    enum { kdfVersion = 20110203 };
+
+    /**
+     * PRF selections, as recorded in the top four bits of a serialized CipherText's
+     * KDF information. The values are those of the Java PRF_ALGORITHMS.
+     */
+    enum PRF_ALGORITHMS { HmacSHA1 = 0, HmacSHA256 = 1, HmacSHA384 = 2, HmacSHA512 = 3 };
+
+    /**
+     * Size of a KDK fingerprint (HMAC-SHA256). See fingerprintKey().
+     */
+    enum { FingerprintSize = 32 };
+
     /**
      * The method is ESAPI's Key Derivation Function (KDF) that computes a
      * derived key from the {@code keyDerivationKey} for either
@@ -89,6 +109,89 @@ namespace esapi
      */
     static SecretKey computeDerivedKey(const SecretKey& keyDerivationKey, unsigned int keyBits, const NarrowString& purpose);
 
+    /**
+     * As above, with the "Context" of section 5.1 of NIST SP 800-108. An empty
+     * context derives the same key as the three argument overload.
+     *
+     * Block i of the key is HmacSHA1(KDK, [i]_2 || Label || 0x00 || Context || [L]_2),
+     * with i and L (the key size in bits) as 32-bit big-endian integers. The keys are
+     * not byte-compatible with Java ESAPI's KDF.
+     *
+     * Derived keys are cached, keyed by a fingerprint of the KDK together with the
+     * purpose, size and context, so repeated derivations from one KDK do not run the
+     * HMAC again. The cache is bounded and held in locked memory which is wiped when
+     * entries are evicted or invalidated.
+     */
+    static SecretKey computeDerivedKey(const SecretKey& keyDerivationKey, unsigned int keyBits, const NarrowString& purpose,
+                                       const NarrowString& context);
+
+    /**
+     * One key to derive in a batch: the label ("purpose"), the context and the key
+     * size in bits.
+     */
+    struct DerivationRequest
+    {
+      DerivationRequest(const NarrowString& p = NarrowString(), const NarrowString& c = NarrowString(), unsigned int bits = 128)
+        : purpose(p), context(c), keyBits(bits) { }
+
+      NarrowString purpose;
+      NarrowString context;
+      unsigned int keyBits;
+    };
+
+    /**
+     * Derives a key for each request, in order. Key i is the same as
+     * computeDerivedKey(keyDerivationKey, requests[i].keyBits, requests[i].purpose,
+     * requests[i].context), but the HMAC is keyed once for the whole batch and its
+     * precomputed state is reused for every key. Large batches are spread over
+     * threads; a thread count of 0 uses one thread per online processor. Batch keys
+     * do not go through the derived key cache.
+     *
+     * @throws  throws an IllegalArgumentException if a request is not valid.
+     */
+    static std::vector<SecretKey> computeDerivedKeys(const SecretKey& keyDerivationKey,
+                                                     const std::vector<DerivationRequest>& requests,
+                                                     unsigned int threads = 1);
+
+    /**
+     * HKDF with HMAC-SHA256 (RFC 5869). An empty salt is treated as HashLen zeros.
+     * This is not the KDF JavaEncryptor uses, so do not use it for keys which must
+     * interoperate with ESAPI for Java; it is intended for new deployments.
+     *
+     * @throws  throws an IllegalArgumentException if keyBits is 0, not a multiple of
+     *          8, or longer than 255 * 32 bytes.
+     */
+    static SecretKey computeHkdfKey(const SecretKey& inputKey, const SecureByteArray& salt,
+                                    unsigned int keyBits, const SecureByteArray& info);
+
+    /**
+     * HKDF for a batch. The extract step runs once, and the expand HMAC is keyed
+     * once. The info for each request is its purpose, a 0x00 octet and its context.
+     *
+     * @throws  throws an IllegalArgumentException if a request is not valid.
+     */
+    static std::vector<SecretKey> computeHkdfKeys(const SecretKey& inputKey, const SecureByteArray& salt,
+                                                  const std::vector<DerivationRequest>& requests,
+                                                  unsigned int threads = 1);
+
+    /**
+     * Wipes the cached keys derived from the KDK, and the HMAC EncryptThenMac keyed
+     * with them. Call when the KDK is rotated or retired.
+     */
+    static void invalidateDerivedKeys(const SecretKey& keyDerivationKey);
+
+    /**
+     * Wipes all cached derived keys, and EncryptThenMac's cached HMACs.
+     */
+    static void clearDerivedKeyCache();
+
+    /**
+     * Computes the fingerprint the derived key cache files a KDK under: an HMAC of
+     * the KDK under a random per-process key. Other caches of per-KDK state use it
+     * so they need not hold a copy of the KDK.
+     */
+    static void fingerprintKey(const SecretKey& keyDerivationKey, byte fp[FingerprintSize]);
+
     /**
      * Check if specified algorithm name is a valid PRF that can be used.
      * @param prfAlgNameName of the PRF algorithm; e.g., "HmacSHA1", "HmacSHA384", etc.
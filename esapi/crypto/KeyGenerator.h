@@ -22,6 +22,7 @@
 #include "errors/IllegalArgumentException.h"
 
 #include <string>
+#include <vector>
 
 namespace esapi
 {
@@ -81,6 +82,15 @@ namespace esapi
      */
     virtual SecretKey generateKey();
 
+    /**
+     * Generates count secret keys. The key material is drawn from the generator
+     * in a few large requests (each no more than a DRBG produces per call) rather
+     * than one request per key. With more than one thread, very large batches are
+     * split and each worker draws from its own SecureRandom of the same algorithm,
+     * seeded independently; a thread count of 0 uses one thread per processor.
+     */
+    virtual std::vector<SecretKey> generateKeys(size_t count, unsigned int threads = 1);
+
     /**
      * Destroys a KeyGenerator object.
      */
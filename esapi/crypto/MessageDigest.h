@@ -17,6 +17,8 @@
 #include "errors/IllegalArgumentException.h"
 #include "errors/NoSuchAlgorithmException.h"
 
+#include <vector>
+
 namespace esapi
 {
   // Forward declaration
@@ -76,6 +78,14 @@ namespace esapi
      */
     size_t getDigestLength() const;
 
+    /**
+     * Returns the name of the compression function selected for this digest on the
+     * current processor, for example "SHA-NI" or "Portable". SHA-224 and SHA-256 use
+     * the SHA extensions when available; the HMAC and Hash DRBGs over those digests
+     * use the same backend.
+     */
+    NarrowString getBackend() const;
+
     /**
      * Resets the digest for further use.
      */
@@ -204,6 +214,33 @@ namespace esapi
      */
     size_t digest(byte buf[], size_t size, size_t offset, size_t len);
 
+    /**
+     * Computes the digests of a batch of independent messages. Each message is hashed
+     * from a fresh state, so the digest's in-progress state (from update) is not disturbed.
+     *
+     * @param inputs  the messages to digest.
+     * @param outputs receives one digest per message, in the same order.
+     *
+     * @throws        throws an EncryptionException if a cryptographic failure occurs.
+     */
+    void digestMany(const std::vector<SecureByteArray>& inputs, std::vector<SecureByteArray>& outputs);
+
+    /**
+     * Computes the digests of a batch of independent messages. Each message is hashed
+     * from a fresh state, so the digest's in-progress state (from update) is not disturbed.
+     * A message may be null if its size is 0.
+     *
+     * @param inputs  array of count message pointers.
+     * @param sizes   array of count message sizes.
+     * @param outputs array of count output buffers, each at least getDigestLength() bytes.
+     * @param count   the number of messages.
+     *
+     * @throws        throws an IllegalArgumentException if an array, message or output
+     *                buffer is not valid, and an EncryptionException if a cryptographic
+     *                failure occurs.
+     */
+    void digestMany(const byte* const inputs[], const size_t sizes[], byte* const outputs[], size_t count);
+
   protected:
 
     /**
@@ -15,6 +15,7 @@
 #include "util/SecureArray.h"
 #include "util/AlgorithmName.h"
 #include "crypto/CryptoppCommon.h"
+#include "crypto/AcceleratedHash.h"
 #include "errors/EncryptionException.h"
 #include "errors/IllegalArgumentException.h"
 #include "errors/NoSuchAlgorithmException.h"
@@ -29,13 +30,15 @@ namespace esapi
 
   public:
 
-    explicit MessageDigestBase(const NarrowString& algorithm)
+    explicit MessageDigestBase(const AlgorithmName& algorithm)
       : m_algorithm(algorithm) { }
 
     virtual NarrowString getAlgorithmImpl() const { return m_algorithm.algorithm(); };
 
     virtual size_t getDigestLengthImpl() const = 0;
 
+    virtual NarrowString getBackendImpl() const = 0;
+
     virtual void resetImpl() = 0;
 
     virtual void updateImpl(byte input) = 0;
@@ -62,9 +65,11 @@ namespace esapi
 
     virtual size_t digestImpl(SecureByteArray& buf, size_t offset, size_t len) = 0;
 
+    virtual void digestManyImpl(const byte* const inputs[], const size_t sizes[], byte* const outputs[], size_t count) = 0;
+
   protected:
 
-    static MessageDigestBase* createInstance(const NarrowString& algorithm);
+    static MessageDigestBase* createInstance(const AlgorithmName& algorithm);
 
   private:
 
@@ -78,12 +83,14 @@ namespace esapi
   {
   public:
 
-    explicit MessageDigestImpl(const NarrowString& algorithm);
+    explicit MessageDigestImpl(const AlgorithmName& algorithm);
 
     virtual NarrowString getAlgorithmImpl() const;
 
     virtual size_t getDigestLengthImpl() const;
 
+    virtual NarrowString getBackendImpl() const;
+
     virtual void resetImpl();
 
     virtual void updateImpl(byte input);
@@ -110,6 +117,8 @@ namespace esapi
 
     virtual size_t digestImpl(SecureByteArray& buf, size_t offset, size_t len);
 
+    virtual void digestManyImpl(const byte* const inputs[], const size_t sizes[], byte* const outputs[], size_t count);
+
   private:
 
     HASH m_hash;
@@ -0,0 +1,87 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "crypto/SecretKey.h"
+#include "util/SecureArray.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
+
+namespace esapi
+{
+  /**
+   * AES/GCM over large buffers using several threads. The output (ciphertext and
+   * tag) is identical to a serial GCM encryption with the same key and nonce.
+   *
+   * The buffer is cut into chunks which are multiples of the block size. The
+   * counter blocks of each chunk are known from its offset, so the chunks are
+   * encrypted independently. Each worker also computes the GHASH of its chunk, and
+   * the partial products are combined at the end by multiplying each by the power
+   * of H for the number of blocks which follow it.
+   *
+   * Only a 96-bit nonce is supported (the counter is then nonce || i), and there is
+   * no additional authenticated data.
+   */
+  class ESAPI_EXPORT ParallelGcm
+  {
+  public:
+    enum { NonceSize = 12, TagSize = 16, DefaultChunkSize = 1024 * 1024 };
+
+    /**
+     * Creates a parallel GCM under the key. A thread count of 0 uses one thread per
+     * online processor. Messages shorter than two chunks are processed on the
+     * calling thread.
+     *
+     * @throws  throws an IllegalArgumentException if the key is not an AES key or the
+     *          chunk size is not a non-zero multiple of 16.
+     */
+    explicit ParallelGcm(const SecretKey& key, unsigned int threads = 0, size_t chunkSize = DefaultChunkSize);
+
+    virtual ~ParallelGcm() { }
+
+    /**
+     * Returns the number of threads used for large messages.
+     */
+    unsigned int getThreadCount() const;
+
+    /**
+     * Encrypts size bytes of input into output (which may be the same buffer) and
+     * writes the TagSize byte tag.
+     *
+     * @throws  throws an IllegalArgumentException if a buffer is not valid or the
+     *          message is longer than GCM allows, or an EncryptionException if a
+     *          cryptographic failure occurs.
+     */
+    void encrypt(const byte nonce[], size_t nsize, const byte input[], size_t size, byte output[], byte tag[]) const;
+
+    /**
+     * Decrypts size bytes of input into output (which may be the same buffer) and
+     * verifies the tag. If verification fails the output is wiped.
+     *
+     * @return  true if the tag verified.
+     *
+     * @throws  throws an IllegalArgumentException if a buffer is not valid, or an
+     *          EncryptionException if a cryptographic failure occurs.
+     */
+    bool decrypt(const byte nonce[], size_t nsize, const byte input[], size_t size, const byte tag[], byte output[]) const;
+
+  private:
+    SecureByteArray m_key;
+    unsigned int m_threads;
+    size_t m_chunkSize;
+  };
+
+} // NAMESPACE esapi
@@ -0,0 +1,86 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "util/SecureArray.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
+#include "errors/NoSuchAlgorithmException.h"
+
+#include <string>
+
+namespace esapi
+{
+  /**
+   * Iterated hashing engine for password storage and key stretching. The work is
+   * done directly on the compression function state of the hash: the SHA family
+   * rehashes a digest with a single block transform per round (the padding and
+   * length words of the block are fixed), and PBKDF2 precomputes the inner and outer
+   * HMAC pad states once so each round is exactly two transforms. Nothing is
+   * allocated inside the loop and all intermediate state is zeroized.
+   *
+   * MD5 and Whirlpool are supported through the regular Crypto++ objects.
+   */
+  class ESAPI_EXPORT PasswordHash
+  {
+  public:
+    /**
+     * Computes the ESAPI iterated digest: H = HASH(parts[0] || ... || parts[count-1]),
+     * followed by H = HASH(H) for the specified number of iterations. This is the
+     * format produced by DefaultEncryptor::hash().
+     *
+     * @param algorithm  the name of the digest, for example "SHA-512".
+     * @param parts      the data to digest. Parts with a size of 0 may be null.
+     * @param sizes      the size of each part.
+     * @param count      the number of parts.
+     * @param iterations the number of times to rehash the digest.
+     *
+     * @return           the digest.
+     *
+     * @throws           throws an IllegalArgumentException if a part is not valid,
+     *                   a NoSuchAlgorithmException if the algorithm is not a digest,
+     *                   or an EncryptionException if a cryptographic failure occurs.
+     */
+    static SecureByteArray iteratedDigest(const NarrowString& algorithm, const byte* const parts[],
+                                          const size_t sizes[], size_t count, unsigned int iterations);
+
+    /**
+     * Derives a key using PBKDF2 with HMAC over the specified digest (PKCS #5 v2.0,
+     * RFC 2898).
+     *
+     * @param algorithm  the name of the digest used by the HMAC, for example "SHA-256".
+     * @param password   the password. May be null if psize is 0.
+     * @param psize      the size of the password.
+     * @param salt       the salt. May be null if ssize is 0.
+     * @param ssize      the size of the salt.
+     * @param iterations the iteration count. Must be at least 1.
+     * @param derived    the buffer which receives the derived key.
+     * @param dsize      the size of the derived key.
+     *
+     * @throws           throws an IllegalArgumentException if a buffer, size or
+     *                   the iteration count is not valid, a NoSuchAlgorithmException
+     *                   if the algorithm is not a digest, or an EncryptionException if
+     *                   a cryptographic failure occurs.
+     */
+    static void pbkdf2(const NarrowString& algorithm, const byte password[], size_t psize,
+                       const byte salt[], size_t ssize, unsigned int iterations,
+                       byte derived[], size_t dsize);
+
+  private:
+    PasswordHash();
+  };
+
+} // NAMESPACE esapi
@@ -44,6 +44,7 @@ namespace esapi
     NarrowString toString() const; //:Converts object to UTF-8 encoded {@code String}.
 
     SecureByteArray asBytes() const; //:Converts object to a byte array.
+    const SecureByteArray& getBytes() const; //:Returns the byte array without copying it. Valid for the life of the object.
     bool equals(const PlainText& obj) const;
     size_t length() const;
     void overwrite(); //:Overwrites contents of rawBytes member with '*' character.
@@ -20,8 +20,12 @@
 #include "errors/EncryptionException.h"
 #include "errors/IllegalArgumentException.h"
 
+#include <vector>
+
 namespace esapi
 {
+  class RandomPoolShard;
+
   /**
    * This class has no corresponding Java implementation. It is used to fetch
    * entropy from the Operating System for use in/by SecureRandom.
@@ -47,6 +51,27 @@ namespace esapi
    * entropy bits retrieved from the operating system. That is, generating a stream
    * using AES-256/OFB (keyed with /dev/[u]random) is *not* less secure than using
    * /dev/[u]random or CryptGenRandom directly.
+   *
+   * The single instance is a facade over a set of shards, one per processor (up to
+   * MaxShards). Each shard has its own lock and its own AES-256/OFB cipher keyed
+   * independently from the operating system. A request goes to the shard of the
+   * processor the caller runs on (or, where the processor is not known, a shard
+   * picked from the thread id), so threads on different cores do not contend on one
+   * lock or share cache lines. A shard is keyed on first use and rekeys itself after
+   * ShardRekeyBytes of output.
+   *
+   * A child process must not reuse its parent's state. On Unix a pthread_atfork()
+   * handler bumps a fork generation in the child (see GetForkGeneration()); a shard
+   * keyed under an earlier generation rekeys itself from the operating system before
+   * serving the child, and SecureRandom reseeds its DRBG the same way. Only the state
+   * the child actually uses is rekeyed, and nothing is locked at fork time.
+   *
+   * On x86 and x64 processors with RDSEED or RDRAND (detected with CPUID), output of
+   * the instruction is hashed into each rekey together with the operating system's
+   * bits. It is an additional input and never replaces the operating system source.
+   * Each draw is retried a bounded number of times, and output that fails the health
+   * check (a repeated word) is discarded. After MaxHardwareFailures consecutive
+   * failed draws the instruction is no longer used.
    */
 
   class ESAPI_TEST_EXPORT RandomPool : private NotCopyable
@@ -63,18 +88,51 @@ namespace esapi
     void GenerateBlock(byte* bytes, size_t size);
 
     /**
-     * Reseed the random pool. The pool will re-key and re-sync itself
-     * using bits acquired from the Operating System provided pool.
+     * Reseed the random pool. The shard serving the caller re-keys and re-syncs
+     * itself immediately using bits acquired from the Operating System provided
+     * pool; every other shard does so before it next serves a request.
      * Internally, Reseed() calls Rekey().
      */
     void Reseed();
 
+    /**
+     * Returns the number of shards.
+     */
+    size_t GetShardCount() const;
+
+    /**
+     * Returns the number of fork()s between the first call and the calling process.
+     * The value changes in a child process and nowhere else. It is always 0 on
+     * Windows.
+     */
+    static unsigned int GetForkGeneration();
+
+    /**
+     * Enables or disables the RDSEED/RDRAND contribution to rekeys. Enabled by
+     * default; a no-op where the instructions are not available.
+     */
+    static void SetHardwareEntropy(bool enable);
+
+    /**
+     * Returns true if rekeys mix in RDSEED or RDRAND output: the processor has
+     * the instruction, it is enabled, and it has not failed its health check.
+     */
+    static bool UsesHardwareEntropy();
+
+    /**
+     * Returns the number of hardware draws which failed (retries exhausted or a
+     * repeated word) since the process started.
+     */
+    static unsigned int GetHardwareEntropyFailures();
+
     /**
      * Destroy the random pool.
      */
     ~RandomPool(); 
 
   private:
+    enum { MaxShards = 128, ShardRekeyBytes = (1 << 20), MaxHardwareFailures = 8 };
+
     /**
      * Create a random pool. The *only* users of this class should be
      * SecureRandom, and SecureRandom must call GetSharedInstance().
@@ -88,10 +146,23 @@ namespace esapi
     void Init();
 
     /**
-     * Rekey the random pool. The pool will re-key and re-sync itself
-     * using bits acquired from the Operating System provided pool.
+     * Returns the shard serving the calling thread.
      */
-    bool Rekey();
+    RandomPoolShard& SelectShard() const;
+
+    /**
+     * Rekey a shard. The shard will re-key and re-sync itself using bits
+     * acquired from the Operating System provided pool. The caller holds
+     * the shard's lock.
+     */
+    bool Rekey(RandomPoolShard& shard);
+
+    /**
+     * Returns a hint for the calling thread's shard: the current processor
+     * number if the platform provides it, otherwise a value derived from the
+     * thread id.
+     */
+    static unsigned int GetShardHint();
 
     /**
      * Fetches bytes from the Operating System provided pool and uses
@@ -109,6 +180,12 @@ namespace esapi
      */
     bool GetTimeData(byte* data, size_t dsize);
 
+    /**
+     * Fills data with RDSEED (preferred) or RDRAND output. Returns false if the
+     * instructions are unavailable, disabled, or the draw failed.
+     */
+    static bool GetHardwareEntropy(byte* data, size_t dsize);
+
   private:
     /**
      * A lock for the internal operations. Its static because GetSharedIntstance()
@@ -118,14 +195,15 @@ namespace esapi
     static Mutex& GetSharedLock();
 
     /**
-     * Keying status.
+     * The shards. Each is allocated on its own so shards do not share cache lines.
      */
-    bool m_keyed;
+    std::vector< shared_ptr<RandomPoolShard> > m_shards;
 
     /**
-     * Crypto++ cipher.
+     * Incremented by Reseed(). A shard keyed under an older epoch rekeys before
+     * serving its next request.
      */
-    CryptoPP::OFB_Mode<CryptoPP::AES>::Encryption m_cipher;
+    volatile unsigned int m_epoch;
   };
 } // NAMESPACE
 
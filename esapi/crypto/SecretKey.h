@@ -38,6 +38,12 @@ namespace esapi
     friend class KeyDerivationFunction;
     // From KeyGeneration.cpp, which couphs up a SecretKey
     friend class KeyGenerator;
+    // From DefaultEncryptor.cpp, which keys ciphers without copying the key
+    friend class DefaultEncryptor;
+    // From Cipher.cpp, which keys ciphers without copying the key
+    friend class CipherImpl;
+    // From EncryptThenMac.cpp, which looks up the cached MAC key without copying the key
+    friend class EncryptThenMac;
 
   public:
     /**
@@ -68,7 +74,7 @@ namespace esapi
 
 
     // TODO: testing - remove me
-    SecretKey() : m_algorithm(), m_secBlock(), m_format() { }
+    SecretKey() : m_algorithm(), m_key(), m_format() { }
 
   /**
    * Not for general consumption. To derive a SecretKey from a secret value, use KeyDerivationFunction.
@@ -115,7 +121,7 @@ namespace esapi
 
   private:    
     NarrowString m_algorithm;            // Standard name for crypto algorithm
-    CryptoPP::SecByteBlock m_secBlock;   // The actual secret key
+    SecureByteArray m_key;               // The actual secret key, inline up to 64 bytes
     NarrowString m_format;               // Encoding format
 
   };
@@ -27,6 +27,7 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <stdexcept>
 #include <cassert>
 
@@ -60,6 +61,12 @@ namespace esapi
          */
         static NarrowString DefaultAlgorithm();
 
+        /**
+         * The default percentage of the reseed interval after which a generator
+         * automatically reseeds itself. Currently returns 75.
+         */
+        static unsigned int DefaultAutoReseed();
+
         /**
          * Returns a SecureRandom object that implements the specified Random Number Generator (RNG) algorithm.
          */
@@ -117,6 +124,60 @@ namespace esapi
          */
         void nextBytes(byte* bytes, size_t size);
 
+        /**
+         * Returns a uniformly distributed int.
+         */
+        int nextInt();
+
+        /**
+         * Returns a uniformly distributed int in [0, bound). Values are drawn without
+         * modulo bias, and are served from a block of generator output so that a
+         * generate call covers many values.
+         */
+        int nextInt(int bound);
+
+        /**
+         * Fills values with uniformly distributed ints in [0, bound), taking the object
+         * lock once for the whole array.
+         */
+        void nextInts(int values[], size_t count, int bound);
+
+        /**
+         * Returns a uniformly distributed long long.
+         */
+        long long nextLong();
+
+        /**
+         * Returns a uniformly distributed double in [0.0, 1.0), with 53 bits of randomness.
+         */
+        double nextDouble();
+
+        /**
+         * Returns a uniformly distributed bool.
+         */
+        bool nextBoolean();
+
+        /**
+         * Shuffles [first, last) with Fisher-Yates. Every permutation is equally likely.
+         * The swap indices are drawn in chunks, so the object lock is taken once per
+         * chunk rather than once per element.
+         */
+        template <class RandomAccessIterator>
+        void shuffle(RandomAccessIterator first, RandomAccessIterator last)
+        {
+            size_t n = (size_t)(last - first);
+            size_t indices[ShuffleChunk];
+
+            while(n > 1)
+            {
+                const size_t count = std::min(n - 1, (size_t)ShuffleChunk);
+                nextShuffleIndices(n, indices, count);
+
+                for(size_t i = 0; i < count; i++, n--)
+                    std::iter_swap(first + (n - 1), first + indices[i]);
+            }
+        }
+
         /**
          * Reseeds this random object.
          */
@@ -127,8 +188,30 @@ namespace esapi
          */
         void setSeed(int seed);
 
+        /**
+         * Sets the percentage of the reseed interval after which this random object
+         * automatically reseeds itself from the RandomPool. A value of 0 disables
+         * automatic reseeding, and nextBytes() throws once a reseed is required.
+         */
+        void setAutoReseed(unsigned int percent);
+
+        /**
+         * Returns the percentage of the reseed interval after which this random
+         * object automatically reseeds itself.
+         */
+        unsigned int getAutoReseed() const;
+
     protected:
 
+        enum { ShuffleChunk = 256 };
+
+        /**
+         * Fills indices[i] with a uniformly distributed value in [0, bound - i), for
+         * the swaps of shuffle(). Not hidden, since shuffle() is instantiated in the
+         * caller's module.
+         */
+        void nextShuffleIndices(size_t bound, size_t indices[], size_t count);
+
         /**
          * Constructs a secure random number generator (RNG) from a SecureRandomBase implementation.
          */
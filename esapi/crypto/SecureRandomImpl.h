@@ -14,6 +14,7 @@
 
 #include "EsapiCommon.h"
 #include "util/SecureArray.h"
+#include "util/AlgorithmName.h"
 #include "errors/EncryptionException.h"
 #include "errors/NoSuchAlgorithmException.h"
 #include "errors/IllegalArgumentException.h"
@@ -42,13 +43,13 @@ namespace esapi
          * Factory method to cough up an implementation.
          * Java offers a SecureRandom(byte[]), and this overload handles it.
          */
-        static SecureRandomBase* createInstance(const NarrowString& algorithm, const byte* seed, size_t size);
+        static SecureRandomBase* createInstance(const AlgorithmName& algorithm, const byte* seed, size_t size);
 
         /**
          * Constructs a secure random number generator (RNG) implementing the named
          * random number algorithm.
          */
-        explicit SecureRandomBase(const NarrowString& algorithm, const byte* seed, size_t size);
+        explicit SecureRandomBase(const AlgorithmName& algorithm, const byte* seed, size_t size);
 
         /**
          * Returns the given number of seed bytes, computed using the seed generation algorithm that this class uses to seed itself.
@@ -81,6 +82,76 @@ namespace esapi
          */
         virtual void setSeedImpl(int seed) = 0;
 
+        /**
+         * Sets the percentage of the reseed interval after which the generator
+         * reseeds itself. A value of 0 disables automatic reseeding.
+         */
+        void setAutoReseedImpl(unsigned int percent);
+
+        /**
+         * Returns the percentage of the reseed interval after which the generator
+         * reseeds itself.
+         */
+        unsigned int getAutoReseedImpl() const;
+
+        /**
+         * Determines if an automatic reseed is due. Entropy for the reseed is drawn from
+         * the RandomPool ahead of time (once half the threshold is reached), so the
+         * reseed itself does not wait on the shared pool.
+         */
+        bool autoReseedDue(size_t rctr, size_t maxReseed, size_t seedLength);
+
+        /**
+         * Retrieves entropy for a reseed. Material drawn ahead of time by autoReseedDue()
+         * is used if available, otherwise the bytes come from the RandomPool.
+         */
+        void fetchEntropy(byte* entropy, size_t size);
+
+        /**
+         * Returns a uniformly distributed 32-bit value.
+         */
+        CryptoPP::word32 nextWord32Impl();
+
+        /**
+         * Returns a uniformly distributed 64-bit value.
+         */
+        CryptoPP::word64 nextWord64Impl();
+
+        /**
+         * Returns a uniformly distributed value in [0, bound). Uses Lemire's
+         * multiply-shift with rejection, so there is no modulo bias and a division
+         * is only needed on the rare path where a rejection is possible.
+         */
+        CryptoPP::word32 nextBoundedImpl(CryptoPP::word32 bound);
+
+        /**
+         * Returns a uniformly distributed value in [0, bound) for bounds beyond 32 bits.
+         */
+        CryptoPP::word64 nextBounded64Impl(CryptoPP::word64 bound);
+
+        /**
+         * Zeroizes and discards the unused bytes of the block that serves the typed
+         * values. Called on reseed so no value predates the new seed.
+         */
+        void discardBlockImpl();
+
+        /**
+         * If the process forked since the generator was last used, discards the state
+         * shared with the parent (the typed block and any entropy drawn ahead) and
+         * reseeds from the child's RandomPool. Costs one comparison otherwise.
+         */
+        void checkForkImpl();
+
+    private:
+
+        /**
+         * Serves bytes for the typed values from a block of generator output, so one
+         * generate call covers many values. nextBytesImpl() does not use the block.
+         */
+        void nextBlockBytesImpl(byte bytes[], size_t size);
+
+        enum { TypedBlockSize = 1024 };
+
     protected:
 
         /**
@@ -95,6 +166,27 @@ namespace esapi
          * The standard algorithm name.
          */
         AlgorithmName m_algorithm;
+
+        /**
+         * Percentage of the reseed interval after which the generator reseeds itself.
+         */
+        unsigned int m_reseedPercent;
+
+        /**
+         * Entropy drawn ahead of time for the next automatic reseed.
+         */
+        CryptoPP::SecByteBlock m_pending;
+
+        /**
+         * Generator output for the typed values, and the number of bytes used.
+         */
+        CryptoPP::SecByteBlock m_block;
+        size_t m_blockUsed;
+
+        /**
+         * The RandomPool fork generation the generator was last used under.
+         */
+        unsigned int m_forkGeneration;
     };
 
     ///////////////////////////////////////////////////////////////////////////////////////
@@ -109,7 +201,7 @@ namespace esapi
         class BlockCipherImpl : public SecureRandomBase
     {
         // createInstance() needs to call new on the class
-        friend SecureRandomBase* SecureRandomBase::createInstance(const NarrowString&, const byte*, size_t);
+        friend SecureRandomBase* SecureRandomBase::createInstance(const AlgorithmName&, const byte*, size_t);
 
         // Security levels are 80, 112, 128, ... The enum specifies bytes.
         // Seed length is 440 0r 888 bits, depending on the security level. The enum specifies bytes.
@@ -119,7 +211,7 @@ namespace esapi
         enum { MaxReseed = (1 << 12), MaxRequest = (1 << 16) };
 
     protected:
-        explicit BlockCipherImpl(const NarrowString& algorithm, const byte* seed = nullptr, size_t size = 0);
+        explicit BlockCipherImpl(const AlgorithmName& algorithm, const byte* seed = nullptr, size_t size = 0);
         virtual ~BlockCipherImpl() { };
         virtual SecureByteArray generateSeedImpl(unsigned int numBytes);
         virtual NarrowString getAlgorithmImpl() const;
@@ -140,7 +232,7 @@ namespace esapi
         class HashImpl : public SecureRandomBase
     {
         // createInstance() needs to call new on the class
-        friend SecureRandomBase* SecureRandomBase::createInstance(const NarrowString&, const byte*, size_t);
+        friend SecureRandomBase* SecureRandomBase::createInstance(const AlgorithmName&, const byte*, size_t);
 
         // Security levels are 80, 112, 128, ... The enum specifies bytes.
         // Seed length is 440 0r 888 bits, depending on the security level. The enum specifies bytes.
@@ -150,7 +242,7 @@ namespace esapi
         enum { MaxReseed = (1 << 12), MaxRequest = (1 << 16) };
 
     protected:
-        explicit HashImpl(const NarrowString& algorithm, const byte* seed = nullptr, size_t size = 0);
+        explicit HashImpl(const AlgorithmName& algorithm, const byte* seed = nullptr, size_t size = 0);
         virtual ~HashImpl() { };
         virtual SecureByteArray generateSeedImpl(unsigned int numBytes);
         virtual NarrowString getAlgorithmImpl() const;
@@ -180,7 +272,7 @@ namespace esapi
         class HmacImpl : public SecureRandomBase
     {
         // createInstance() needs to call new on the class
-        friend SecureRandomBase* SecureRandomBase::createInstance(const NarrowString&, const byte*, size_t);
+        friend SecureRandomBase* SecureRandomBase::createInstance(const AlgorithmName&, const byte*, size_t);
 
         // Security levels are 80, 112, 128, ... The enum specifies bytes.
         // Seed length is 440 0r 888 bits, depending on the security level. The enum specifies bytes.
@@ -191,7 +283,7 @@ namespace esapi
         enum { MaxReseed = (1 << 12), MaxRequest = (1 << 16) };
 
     protected:
-        HmacImpl(const NarrowString& algorithm, const byte* seed = nullptr, size_t size = 0);
+        HmacImpl(const AlgorithmName& algorithm, const byte* seed = nullptr, size_t size = 0);
         virtual ~HmacImpl() { };
         virtual SecureByteArray generateSeedImpl(unsigned int numBytes);
         virtual NarrowString getAlgorithmImpl() const;
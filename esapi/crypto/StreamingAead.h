@@ -0,0 +1,200 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "util/Mutex.h"
+#include "util/SecureArray.h"
+#include "crypto/SecretKey.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
+
+#include <iosfwd>
+
+namespace esapi
+{
+  class StreamEncryptorImpl;
+  class StreamDecryptorImpl;
+
+  /**
+   * Segmented AES/GCM for files and streams which are too large to hold in memory,
+   * following the STREAM construction of Hoang, Reyhanitabar, Rogaway and Vizar
+   * ("Online Authenticated-Encryption and its Nonce-Reuse Misuse-Resistance").
+   * The plain text is cut into fixed size segments, and each segment is sealed on
+   * its own, so memory use is one segment regardless of the size of the stream and
+   * any segment can be decrypted without touching the others.
+   *
+   * The layout is a header followed by the segments:
+   *
+   *   header:  version (1) | algorithm (1) | segment size (4, big endian) | salt (16) | nonce prefix (7)
+   *   segment: ciphertext (segment size bytes, or 0 to segment size for the last) | tag (16)
+   *
+   * Segment i is sealed under the nonce prefix || i (4 bytes, big endian) || last (1 byte),
+   * with the header as additional authenticated data. The position and the final
+   * flag are therefore part of each tag: a reordered, duplicated, dropped or
+   * truncated segment fails authentication, as does a stream cut at a segment
+   * boundary. Each stream is encrypted under its own key, HMAC-SHA256(key, salt ||
+   * "ESAPI AES-GCM stream"), so the 7-byte nonce prefix only has to be unique within a
+   * stream and not across every stream ever written with the key.
+   */
+  class ESAPI_EXPORT StreamingAead
+  {
+  public:
+    enum {
+      HeaderSize = 29, TagSize = 16,
+      MinSegmentSize = 256, DefaultSegmentSize = 64 * 1024, MaxSegmentSize = 16 * 1024 * 1024
+    };
+
+    /**
+     * Returns the size of the encrypted stream (header included) for a plain text of
+     * the specified size.
+     */
+    static size_t getCipherTextSize(size_t plainTextSize, size_t segmentSize = DefaultSegmentSize);
+
+    /**
+     * Encrypts the input stream to the output stream, one segment at a time.
+     *
+     * @throws  throws an IllegalArgumentException if the key or segment size is not
+     *          valid, or an EncryptionException if a stream or cryptographic failure occurs.
+     */
+    static void encrypt(const SecretKey& key, std::istream& in, std::ostream& out, size_t segmentSize = DefaultSegmentSize);
+
+    /**
+     * Encrypts a buffer (for example a memory mapped file) to the output stream. The
+     * input is read in place.
+     */
+    static void encrypt(const SecretKey& key, const byte input[], size_t size, std::ostream& out, size_t segmentSize = DefaultSegmentSize);
+
+    /**
+     * Decrypts the input stream to the output stream. Each segment is authenticated
+     * before it is written, and a stream which is truncated, reordered or modified is
+     * rejected at the first bad segment. The output written up to that point should
+     * be discarded.
+     *
+     * @throws  throws an EncryptionException if the stream is not valid or fails
+     *          authentication.
+     */
+    static void decrypt(const SecretKey& key, std::istream& in, std::ostream& out);
+
+  private:
+    StreamingAead();
+  };
+
+  /**
+   * Incremental encryption of a segmented stream. Write getHeader() first, then the
+   * output of encryptSegment() for each segment in order.
+   */
+  class ESAPI_EXPORT StreamEncryptor
+  {
+  public:
+    /**
+     * Creates a new stream (a new salt and nonce prefix) under the key.
+     *
+     * @throws  throws an IllegalArgumentException if the key is not an AES key or the
+     *          segment size is not valid.
+     */
+    explicit StreamEncryptor(const SecretKey& key, size_t segmentSize = StreamingAead::DefaultSegmentSize);
+
+    virtual ~StreamEncryptor() { }
+
+    /**
+     * Returns the stream header.
+     */
+    SecureByteArray getHeader() const;
+
+    /**
+     * Returns the size of a plain text segment.
+     */
+    size_t getSegmentSize() const;
+
+    /**
+     * Encrypts the next segment into the caller's buffer. Every segment except the
+     * last must be exactly getSegmentSize() bytes; the last may be 0 to
+     * getSegmentSize() bytes. The output buffer must hold size + TagSize bytes.
+     *
+     * @return  the number of bytes written.
+     *
+     * @throws  throws an IllegalArgumentException if a size is not valid, or an
+     *          EncryptionException if the stream is finished or too long.
+     */
+    size_t encryptSegment(const byte input[], size_t size, bool last, byte output[], size_t outSize);
+
+  private:
+    ESAPI_PRIVATE inline Mutex& getObjectLock() const;
+
+    mutable shared_ptr<Mutex> m_lock;
+    shared_ptr<StreamEncryptorImpl> m_impl;
+  };
+
+  /**
+   * Decryption of a segmented stream. Segments may be decrypted in any order, so a
+   * reader can seek into a large file (or a memory mapped one) and decrypt only the
+   * segments it needs.
+   */
+  class ESAPI_EXPORT StreamDecryptor
+  {
+  public:
+    /**
+     * Parses the stream header and derives the stream key.
+     *
+     * @throws  throws an EncryptionException if the header is not valid.
+     */
+    StreamDecryptor(const SecretKey& key, const byte header[], size_t size);
+
+    virtual ~StreamDecryptor() { }
+
+    /**
+     * Returns the size of a plain text segment.
+     */
+    size_t getSegmentSize() const;
+
+    /**
+     * Returns the number of segments in an encrypted stream of the specified size
+     * (header included).
+     *
+     * @throws  throws an EncryptionException if no stream has that size.
+     */
+    size_t getSegmentCount(size_t streamSize) const;
+
+    /**
+     * Decrypts one segment. The input is the segment's ciphertext and tag, and last
+     * must be true only for the final segment of the stream. The output buffer must
+     * hold size - TagSize bytes.
+     *
+     * @return  the number of bytes written.
+     *
+     * @throws  throws an EncryptionException if the segment fails authentication.
+     */
+    size_t decryptSegment(size_t index, bool last, const byte input[], size_t size, byte output[], size_t outSize);
+
+    /**
+     * Decrypts one segment of a complete stream held in memory, such as a memory
+     * mapped file. The stream includes the header.
+     *
+     * @return  the number of bytes written.
+     *
+     * @throws  throws an IllegalArgumentException if the index is out of range, or an
+     *          EncryptionException if the segment fails authentication.
+     */
+    size_t decryptSegment(const byte stream[], size_t streamSize, size_t index, byte output[], size_t outSize);
+
+  private:
+    ESAPI_PRIVATE inline Mutex& getObjectLock() const;
+
+    mutable shared_ptr<Mutex> m_lock;
+    shared_ptr<StreamDecryptorImpl> m_impl;
+  };
+
+} // NAMESPACE esapi
@@ -23,11 +23,11 @@ namespace esapi {
   class ESAPI_EXPORT IllegalStateException : public EnterpriseSecurityException
   {
   public:
-    explicit IllegalStateException(const String &message)
+    explicit IllegalStateException(const WideString &message)
       : EnterpriseSecurityException(message, message)
       {
       }
-    explicit IllegalStateException(const String &userMessage, const String &logMessage)
+    explicit IllegalStateException(const WideString &userMessage, const WideString &logMessage)
       : EnterpriseSecurityException(userMessage, logMessage)
       {
       }
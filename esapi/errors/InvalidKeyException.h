@@ -23,11 +23,11 @@ namespace esapi {
   class ESAPI_EXPORT InvalidKeyException : public EnterpriseSecurityException
   {
   public:
-    explicit InvalidKeyException(const String &message)
+    explicit InvalidKeyException(const WideString &message)
       : EnterpriseSecurityException(message, message)
       {
       }
-    explicit InvalidKeyException(const String &userMessage, const String &logMessage)
+    explicit InvalidKeyException(const WideString &userMessage, const WideString &logMessage)
       : EnterpriseSecurityException(userMessage, logMessage)
       {
       }
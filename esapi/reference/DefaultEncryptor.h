@@ -21,6 +21,9 @@
 
 namespace esapi
 {
+  class AlgorithmName;
+  class CryptoPolicy;
+  class DefaultEncryptorImpl;
 
   class ESAPI_EXPORT DefaultEncryptor : public Encryptor
   {
@@ -44,17 +47,45 @@ namespace esapi
 
     virtual CipherText encrypt(const PlainText& plainText) const;
 
+    /**
+     * {@inheritDoc}
+     *
+     * Encrypts with AES/GCM (the default Encryptor.CipherTransformation) and a random
+     * 96-bit nonce. The 128-bit authentication tag is appended to the raw ciphertext.
+     * Crypto++ uses AES-NI and PCLMULQDQ when the processor provides them. The
+     * expanded key schedule and GHASH table are cached per key, so repeated calls
+     * with the same key only pay for the new nonce.
+     */
     virtual CipherText encrypt(const SecretKey& secretKey, const PlainText& plainText) const;
 
-    virtual PlainText decrypt(const CipherText& /*cipherText*/) const
-    {
-      return PlainText();
-    }
+    /**
+     * Encrypts into an existing CipherText in a single pass. The ciphertext buffer of
+     * cipherText is reused, so a caller encrypting many records with one CipherText
+     * does not allocate once its buffer has grown to the largest record.
+     *
+     * @throws  throws an EncryptionException if the transformation or key is not
+     *          supported, or a cryptographic failure occurs.
+     */
+    virtual void encrypt(const SecretKey& secretKey, const PlainText& plainText, CipherText& cipherText) const;
 
-    virtual PlainText decrypt(const SecretKey& secretKey, const CipherText& /*cipherText*/) const
-    {
-      return PlainText();
-    }
+    virtual PlainText decrypt(const CipherText& cipherText) const;
+
+    /**
+     * {@inheritDoc}
+     *
+     * The authentication tag is verified before any plain text is released. A
+     * ciphertext which fails verification throws an EncryptionException.
+     */
+    virtual PlainText decrypt(const SecretKey& secretKey, const CipherText& cipherText) const;
+
+    /**
+     * Decrypts a serialized CipherText in place, straight from the received bytes.
+     * Nothing but the plain text is allocated.
+     *
+     * @throws  throws an EncryptionException if the ciphertext is not supported or
+     *          fails authentication.
+     */
+    virtual PlainText decrypt(const SecretKey& secretKey, const CipherTextView& cipherText) const;
 
     virtual NarrowString sign(const NarrowString & /*message*/) const
     {
@@ -95,13 +126,51 @@ namespace esapi
       return 0;
     }
 
+    enum { DefaultParallelMinimum = 8 * 1024 * 1024 };
+
+    /**
+     * Enables multi-threaded encryption and decryption of large messages. Messages of
+     * at least minimumSize bytes are split across the specified number of threads (0
+     * uses one per processor, 1 disables threading, which is the default). The output
+     * is identical to the single threaded path. See ParallelGcm.
+     */
+    void setParallelism(unsigned int threads, size_t minimumSize = DefaultParallelMinimum);
+
   public:
-    explicit DefaultEncryptor() { }
-    virtual ~DefaultEncryptor() { }
+    explicit DefaultEncryptor();
+    virtual ~DefaultEncryptor();
 
   private:
     // Follow the lead of the base class
     DefaultEncryptor& operator=(const DefaultEncryptor& rhs);
+
+    /**
+     * Authenticates and decrypts a raw ciphertext, wherever its bytes live. policy is
+     * the caller's snapshot, and is used for every check in the operation.
+     */
+    PlainText decryptRaw(const CryptoPolicy& policy, const SecretKey& secretKey,
+                         const NarrowString& xform, unsigned int keyBits,
+                         const byte* nonce, size_t nsize, const byte* input, size_t isize,
+                         const byte* mac, size_t msize) const;
+
+    /**
+     * Encrypts under a mode which does not authenticate (CBC, CFB, OFB or CTR), and
+     * computes the CipherText's separate MAC in the same pass.
+     */
+    void encryptWithMac(const SecretKey& secretKey, const NarrowString& xform, bool useMac,
+                        const PlainText& plainText, CipherText& cipherText) const;
+
+    /**
+     * Verifies the separate MAC and decrypts under a mode which does not authenticate.
+     */
+    PlainText decryptWithMac(const SecretKey& secretKey, const AlgorithmName& xform, bool useMac,
+                             const byte* iv, size_t ivSize, const byte* input, size_t isize,
+                             const byte* mac, size_t msize) const;
+
+    /**
+     * Cached key schedules. Copies of the encryptor share the cache.
+     */
+    shared_ptr<DefaultEncryptorImpl> m_impl;
   };
 } // NAMESPACE
 
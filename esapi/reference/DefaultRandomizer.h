@@ -0,0 +1,77 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "Randomizer.h"
+#include "crypto/BufferedSecureRandom.h"
+
+namespace esapi
+{
+  /**
+   * Reference implementation of the Randomizer interface over a BufferedSecureRandom.
+   *
+   * Each call (or batch) draws its random bytes in one request to the generator.
+   * Bytes are mapped onto a character set of n characters with Lemire's
+   * multiply-and-shift: the byte b selects character (b * n) >> 8, and the byte is
+   * rejected when (b * n) & 0xff falls below 256 mod n, which removes the modulo
+   * bias. The mapping loop is branch-free, so the compiler can vectorize it. Copies
+   * share the generator, and the object may be used from several threads.
+   */
+  class ESAPI_EXPORT DefaultRandomizer : public Randomizer
+  {
+  public:
+    /**
+     * Constructs a randomizer over the default random number algorithm.
+     */
+    DefaultRandomizer();
+
+    /**
+     * Constructs a randomizer over an existing buffered generator.
+     */
+    explicit DefaultRandomizer(const BufferedSecureRandom& random);
+
+    virtual ~DefaultRandomizer() { }
+
+    virtual NarrowString getRandomString(size_t length, const NarrowString& characterSet);
+
+    virtual StringArray getRandomStrings(size_t count, size_t length, const NarrowString& characterSet);
+
+    /**
+     * {@inheritDoc}
+     *
+     * The name is 20 alphanumeric characters (about 119 bits), followed by a dot and
+     * the extension. The dot is omitted if the extension is empty.
+     */
+    virtual NarrowString getRandomFilename(const NarrowString& extension);
+
+    virtual NarrowString getRandomGUID();
+
+    virtual StringArray getRandomGUIDs(size_t count);
+
+    virtual NarrowString getRandomToken(size_t size, TokenEncoding encoding = TokenBase64Url);
+
+    virtual StringArray getRandomTokens(size_t count, size_t size, TokenEncoding encoding = TokenBase64Url);
+
+  private:
+    /**
+     * Fills output with size characters drawn from characterSet.
+     */
+    void fillFromCharset(Char output[], size_t size, const NarrowString& characterSet);
+
+    BufferedSecureRandom m_random;
+  };
+
+} // NAMESPACE esapi
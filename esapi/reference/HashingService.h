@@ -0,0 +1,148 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "util/NotCopyable.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
+#include "errors/IllegalStateException.h"
+
+#include <string>
+#include <vector>
+
+namespace esapi
+{
+  class HashJob;
+  class HashingServiceImpl;
+
+  /**
+   * The pending result of a hash submitted to a HashingService. Copies refer to the
+   * same result. A future remains valid after the service is destroyed.
+   */
+  class ESAPI_EXPORT HashFuture
+  {
+    // HashingService creates the futures
+    friend class HashingService;
+
+  public:
+    /**
+     * Returns true if the hash has been computed (or failed).
+     */
+    bool isDone() const;
+
+    /**
+     * Waits for the hash and returns it, encoded as DefaultEncryptor::hash() encodes it.
+     *
+     * @throws  throws an EncryptionException if the hash could not be computed.
+     */
+    NarrowString get() const;
+
+  private:
+    explicit HashFuture(const shared_ptr<HashJob>& job);
+
+    shared_ptr<HashJob> m_job;
+  };
+
+  /**
+   * A password and the stored hash it should match, for batch verification.
+   */
+  struct ESAPI_EXPORT PasswordCheck
+  {
+    NarrowString plainText;
+    NarrowString salt;
+    NarrowString expected;
+    unsigned int iterations;
+
+    PasswordCheck() : iterations(4096) { }
+    PasswordCheck(const NarrowString& p, const NarrowString& s, const NarrowString& e, unsigned int i = 4096)
+      : plainText(p), salt(s), expected(e), iterations(i) { }
+  };
+
+  /**
+   * A snapshot of the service's counters. Latencies are measured from submission to
+   * completion (so they include the time spent waiting in the queue), in microseconds.
+   */
+  struct ESAPI_EXPORT HashingMetrics
+  {
+    size_t workers;
+    size_t queueDepth;
+    size_t peakQueueDepth;
+    unsigned long long submitted;
+    unsigned long long completed;
+    unsigned long long failed;
+    unsigned long long rejected;
+    unsigned long long averageLatency;
+    unsigned long long maxLatency;
+  };
+
+  /**
+   * Runs DefaultEncryptor::hash() on a fixed pool of worker threads so request threads
+   * are not tied up by the hash iterations. The number of workers caps the CPU spent on
+   * hashing, and the queue in front of them is bounded: when it is full, submit() fails
+   * fast with an IllegalStateException rather than letting a burst of logins pile up.
+   * verify() is for bulk work (such as credential migrations) and instead waits for
+   * room in the queue.
+   *
+   * Destroying the service stops new submissions, finishes the queued work and joins
+   * the workers.
+   */
+  class ESAPI_EXPORT HashingService : private NotCopyable
+  {
+  public:
+    /**
+     * The default bound on the number of queued (not yet running) hashes.
+     */
+    enum { DefaultQueueCapacity = 1024 };
+
+    /**
+     * Starts the worker threads. A worker count of 0 uses one worker per online processor.
+     *
+     * @throws  throws an IllegalArgumentException if the queue capacity is 0, or an
+     *          IllegalStateException if the threads cannot be started.
+     */
+    explicit HashingService(unsigned int workers = 0, size_t queueCapacity = DefaultQueueCapacity);
+
+    /**
+     * Finishes the queued work and joins the worker threads.
+     */
+    ~HashingService();
+
+    /**
+     * Queues a hash of the plain text and salt.
+     *
+     * @throws  throws an IllegalStateException if the queue is full or the service is
+     *          shutting down.
+     */
+    HashFuture submit(const NarrowString& plainText, const NarrowString& salt, unsigned int iterations = 4096);
+
+    /**
+     * Hashes each password on the pool and compares it with the expected hash. The
+     * comparison is constant time. results[i] is true if checks[i] matched, and false
+     * if it did not or its hash could not be computed. Blocks the caller until every
+     * check is complete.
+     */
+    void verify(const std::vector<PasswordCheck>& checks, std::vector<bool>& results);
+
+    /**
+     * Returns a snapshot of the queue and latency counters.
+     */
+    HashingMetrics getMetrics() const;
+
+  private:
+    shared_ptr<HashingServiceImpl> m_impl;
+  };
+
+} // NAMESPACE esapi
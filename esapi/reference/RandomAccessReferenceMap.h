@@ -17,6 +17,8 @@
 
 #include "EsapiCommon.h"
 #include "EsapiTypes.h"
+#include "Randomizer.h"
+#include "EncoderConstants.h"
 #include "reference/GenericAccessReferenceMap.h"
 
 namespace esapi
@@ -34,16 +36,14 @@ namespace esapi
          * CTOR
          */
         RandomAccessGenericReferenceMap()
+            : characterSet( EncoderConstants::ALPHANUMERICS.begin(), EncoderConstants::ALPHANUMERICS.end() )
         {
-            // !WORKAROUND!  2012.03.01 jAHOLMES
-            // replace this with the appropriate call when esapi::randomize() is available
-            srand( (unsigned)time( NULL ) );
         }
 
         /**
-         * gets a string of randomw letters, 
+         * gets a string of random letters and digits,
          * makes sure it doesn't match ones already in use in this instance
-         * @return  a string of random letters
+         * @return  a string of random letters and digits
          */
         virtual String getUniqueReference()
         {
@@ -72,26 +72,14 @@ namespace esapi
          */
         String FetchRandomString()
         {
-            // !WORKAROUND!  2012.03.01 jAHOLMES
-            // the commented line is what we are suppose to be using, but
-            // as of 2012.03.01 someone else is still working on writing the random functions
-
-#pragma message( "Need to install correct randomizer() when it is ready" )
-            // return esapi::randomizer().getRandomString( 6, EncoderConstants.CHAR_ALPHANUMERICS );
-
-            // temporary
-            String letters = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-            String sb;
-
-            for ( int i = 0; i < 6; i++ )
-            {
-                int r = rand() % 26;
-                sb +=  letters.substr( r, 1 );
-            }
-
-            return sb;
+            return esapi::randomizer().getRandomString( 6, characterSet );
         }
 
+        /**
+         *  the characters a reference is drawn from
+         */
+        const String  characterSet;
+
         /**
          *  synchronize string generation
          */
@@ -22,6 +22,65 @@ namespace esapi
   {
   public:
 
+    /**
+     * Interned identifiers for the algorithms known to the library. The factories
+     * (SecureRandom, MessageDigest, KeyGenerator) switch on these rather than
+     * comparing strings. Keep in sync with the registry in AlgorithmName.cpp.
+     */
+    enum AlgorithmId
+    {
+      AlgUnknown = 0,
+
+      // Symmetric ciphers
+      AlgAES, AlgCamellia, AlgBlowfish, AlgDES_ede, AlgDES,
+
+      // Hashes
+      AlgMD5, AlgSHA1, AlgSHA224, AlgSHA256, AlgSHA384, AlgSHA512, AlgWhirlpoo,
+
+      // HMACs
+      AlgHmacSHA1, AlgHmacSHA224, AlgHmacSHA256, AlgHmacSHA384, AlgHmacSHA512, AlgHmacWhirlpoo,
+
+      // PBE HMACs
+      AlgPBEWithSHA1, AlgPBEWithSHA224, AlgPBEWithSHA256, AlgPBEWithSHA384, AlgPBEWithSHA512, AlgPBEWithWhirlpoo,
+
+      // Key agreement
+      AlgDiffieHellman,
+
+      // SecureRandom
+      AlgSHA1PRNG,
+
+      AlgCount
+    };
+
+    /**
+     * The family an algorithm belongs to.
+     */
+    enum AlgorithmFamily
+    {
+      FamilyUnknown = 0, FamilyCipher, FamilyHash, FamilyHmac, FamilyPBE, FamilyKeyAgreement, FamilyRandom
+    };
+
+    /**
+     * Interned identifiers for the cipher modes. ModeAbsent means no mode was specified.
+     */
+    enum ModeId
+    {
+      ModeAbsent = 0, ModeNONE, ModeECB, ModeCBC, ModeOFB, ModeCFB, ModeCTR, ModeCCM, ModeEAX, ModeGCM
+    };
+
+    /**
+     * Interned identifiers for the paddings. PaddingAbsent means no padding was specified.
+     */
+    enum PaddingId
+    {
+      PaddingAbsent = 0, PaddingNone, PaddingPKCS5, PaddingSSL3
+    };
+
+    /**
+     * Returns the family of the algorithm identifier.
+     */
+    static AlgorithmFamily getFamily(AlgorithmId id);
+
     /**
      * Normailize the algorithm name. If the algorithm is recognized, it is
      * returned conformant to JCE, Appendix A naming. If the algorithm is
@@ -120,7 +179,42 @@ namespace esapi
      */
     bool getPadding(WideString& padding) const;
 
+    /**
+     * Returns the interned identifier of the cipher portion of the algorithm name.
+     */
+    AlgorithmId getAlgorithmId() const { return m_id; }
+
+    /**
+     * Returns the interned identifier of the mode portion of the algorithm name.
+     */
+    ModeId getModeId() const { return m_mode; }
+
+    /**
+     * Returns the interned identifier of the padding portion of the algorithm name.
+     */
+    PaddingId getPaddingId() const { return m_padding; }
+
+    /**
+     * Returns the family of the cipher portion of the algorithm name.
+     */
+    AlgorithmFamily getFamily() const { return getFamily(m_id); }
+
+  protected:
+
+    /**
+     * Parses the algorithm name into its interned identifiers. Throws on failure.
+     */
+    static void parse(const NarrowString& algorithm, AlgorithmId& id, ModeId& mode, PaddingId& padding);
+
+    /**
+     * Formats the interned identifiers into a name per JCE, Appendix A.
+     */
+    static NarrowString format(AlgorithmId id, ModeId mode, PaddingId padding);
+
   private:
     NarrowString m_normal;
+    AlgorithmId m_id;
+    ModeId m_mode;
+    PaddingId m_padding;
   };
 } // NAMESPACE
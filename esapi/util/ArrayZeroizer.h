@@ -13,6 +13,10 @@
 
 #pragma once
 
+#include "EsapiCommon.h"
+
+#include <cstring>
+
 namespace esapi
 {
   // Used for arrays which need zeroizing. E.g.,
@@ -0,0 +1,80 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+
+namespace esapi
+{
+  /**
+   * Runtime detection of processor features. On x86 and x64 the features are read
+   * with CPUID (and XGETBV for the AVX family, since the OS must also save the YMM
+   * registers). On other architectures every query returns false, which selects the
+   * portable code paths. Detection runs once; the results are cached for the life
+   * of the process.
+   */
+  class ESAPI_EXPORT CpuFeatures
+  {
+  public:
+    /**
+     * SSE2 instructions.
+     */
+    static bool HasSSE2();
+
+    /**
+     * Supplemental SSE3 instructions (PSHUFB).
+     */
+    static bool HasSSSE3();
+
+    /**
+     * SSE4.1 instructions.
+     */
+    static bool HasSSE41();
+
+    /**
+     * AVX2 instructions, with operating system support for the YMM state.
+     */
+    static bool HasAVX2();
+
+    /**
+     * AES-NI instructions.
+     */
+    static bool HasAESNI();
+
+    /**
+     * Intel SHA extensions (SHA-1 and SHA-256).
+     */
+    static bool HasSHA();
+
+    /**
+     * The RDRAND instruction.
+     */
+    static bool HasRDRAND();
+
+    /**
+     * The RDSEED instruction.
+     */
+    static bool HasRDSEED();
+
+    /**
+     * The number of online processors, or 1 if it cannot be determined.
+     */
+    static unsigned int ProcessorCount();
+
+  private:
+    CpuFeatures();
+  };
+
+} // NAMESPACE esapi
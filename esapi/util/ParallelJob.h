@@ -0,0 +1,123 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+#include "util/Mutex.h"
+#include "util/NotCopyable.h"
+
+#include <cstddef>
+
+namespace esapi
+{
+  /**
+   * Fork/join for the batch operations (parallel GCM, batch key generation and
+   * batch key derivation). A job is split into a number of work items. execute()
+   * runs the job on the calling thread plus up to (threads - 1) short lived
+   * workers, and each thread claims items with nextItem() until none are left.
+   * A worker which cannot be started is not an error, since the threads which did
+   * start (and the calling thread) finish the work.
+   *
+   * The first exception thrown by any thread stops the other threads at their next
+   * claim, and is reported by execute() once every thread has been joined.
+   *
+   * StartThread() and JoinThread() are the platform thread calls behind execute(),
+   * for code which keeps its own long lived threads (HashingService).
+   */
+  class ESAPI_EXPORT ParallelJob : private NotCopyable
+  {
+  public:
+    // Upper bound on the thread count, whatever the processor count says
+    enum { MaxThreads = 64 };
+
+    /**
+     * Returns the number of threads to use for a request of threads. 0 uses one
+     * thread per online processor. The result is between 1 and MaxThreads.
+     */
+    static unsigned int ThreadCount(unsigned int threads);
+
+#if defined(ESAPI_OS_WINDOWS)
+    typedef HANDLE ThreadHandle;
+    typedef unsigned (__stdcall *ThreadFunction)(void* param);
+#elif defined(ESAPI_OS_STARNIX)
+    typedef pthread_t ThreadHandle;
+    typedef void* (*ThreadFunction)(void* param);
+#endif
+
+#if defined(ESAPI_OS_WINDOWS) || defined(ESAPI_OS_STARNIX)
+    /**
+     * Starts a thread running proc(param). Returns false if the thread could not be
+     * started, in which case handle is not valid.
+     */
+    static bool StartThread(ThreadFunction proc, void* param, ThreadHandle& handle);
+
+    /**
+     * Waits for a thread from StartThread() to exit and releases its handle.
+     */
+    static void JoinThread(ThreadHandle handle);
+#endif
+
+    /**
+     * Runs the job and joins the workers.
+     *
+     * @throws  EncryptionException if a thread failed. The message is the job's
+     *          failure prefix followed by the failure.
+     */
+    void execute(unsigned int threads);
+
+  protected:
+    /**
+     * items is the number of work items. failure prefixes the message of the
+     * exception thrown by execute() if a thread fails.
+     */
+    ParallelJob(size_t items, const NarrowString& failure);
+    virtual ~ParallelJob();
+
+    /**
+     * Processes items on the calling thread.
+     */
+    virtual void run() = 0;
+
+    /**
+     * Processes items on a worker. The default calls run().
+     */
+    virtual void runWorker();
+
+    /**
+     * Claims the next work item. Returns false when the items are exhausted or a
+     * thread has failed.
+     */
+    bool nextItem(size_t& item);
+
+  private:
+    void fail(const char* what);
+
+#if defined(ESAPI_OS_WINDOWS)
+    static unsigned __stdcall ThreadProc(void* param);
+#elif defined(ESAPI_OS_STARNIX)
+    static void* ThreadProc(void* param);
+#endif
+
+    size_t m_items;
+    NarrowString m_failure;
+
+    // Guarded by m_lock
+    Mutex m_lock;
+    size_t m_next;
+    bool m_failed;
+    NarrowString m_error;
+  };
+
+} // NAMESPACE esapi
@@ -15,162 +15,192 @@
 #pragma once
 
 #include "EsapiCommon.h"
-#include "util/zAllocator.h"
+#include "util/SecurePool.h"
 #include "errors/IllegalArgumentException.h"
 #include "safeint/SafeInt3.hpp"
 
 #include <new>
-#include <vector>
+#include <limits>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
 
 namespace esapi
 {
+  // Arrays of up to InlineBytes are stored in the object itself, so IVs, keys and
+  // digests do not touch the heap. Larger arrays come from the SecurePool. Copies
+  // are deep; swap exchanges storage without copying.
+  //
+  // SecureArray tracks the largest size it has reached. Elements past that mark
+  // were never written, so only the marked extent is wiped when storage is
+  // released, inline or not. A large reservation which held a few bytes costs a
+  // few bytes to wipe.
+  //
+  // T must be a plain old data type (byte, int, wchar_t). Elements are assigned
+  // into raw storage and are never destroyed.
   template <typename T>
   class ESAPI_EXPORT SecureArray
   {
   public:
 
-    typedef typename std::vector< T, zallocator<T> > SecureVector;
-    typedef typename zallocator<T>::size_type size_type;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
 
-    typedef typename SecureVector::value_type value_type;
-    typedef typename SecureVector::pointer pointer;
-    typedef typename SecureVector::const_pointer const_pointer;
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
 
-    typedef typename SecureVector::iterator iterator;
-    typedef typename SecureVector::const_iterator const_iterator;
-    typedef typename SecureVector::reverse_iterator reverse_iterator;
-    typedef typename SecureVector::const_reverse_iterator const_reverse_iterator;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef std::reverse_iterator<iterator> reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
 
-    typedef typename SecureVector::reference reference;
-    typedef typename SecureVector::const_reference const_reference;
+    typedef T& reference;
+    typedef const T& const_reference;
+
+    enum { InlineBytes = 64 };
 
   public:
 
     // Construction
     explicit SecureArray(size_type cnt = 0, const T& value = T())
-      : m_vector(create_secure_array(cnt,value))
+      : m_ptr(m_inline), m_size(0), m_capacity(InlineCount), m_mark(0)
     {
-      // Parameters are validated in create_secure_array
-      ASSERT(m_vector.get());
-      ASSERT(m_vector->size() == cnt);
+      create_secure_array(cnt, value);
+      ASSERT(m_size == cnt);
     }
 
     explicit SecureArray(const T* ptr, size_t cnt)
-      : m_vector(create_secure_array(ptr, cnt))
+      : m_ptr(m_inline), m_size(0), m_capacity(InlineCount), m_mark(0)
     {
-      // Parameters are validated in create_secure_array
-      ASSERT(m_vector.get());
-      ASSERT(m_vector->size() == cnt);
+      create_secure_array(ptr, cnt);
+      ASSERT(m_size == cnt);
     }
 
     template <typename InputIterator>
     SecureArray(InputIterator first, InputIterator last)
-      : m_vector(create_secure_array(first, last))
+      : m_ptr(m_inline), m_size(0), m_capacity(InlineCount), m_mark(0)
     {
-      // Parameters are validated in create_secure_array
-      ASSERT(m_vector.get());
+      create_secure_array(first, last);
     }
 
     // Destruction
-    ~SecureArray() { }
+    ~SecureArray()
+    {
+      release();
+    }
 
     // Iterators
     iterator begin()
     {
-      ASSERT(m_vector.get());
-      return m_vector->begin();
+      return m_ptr;
     }
 
     const_iterator begin() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->begin();
+      return m_ptr;
     }
 
     iterator end()
     {
-      ASSERT(m_vector.get());
-      return m_vector->end();
+      return m_ptr + m_size;
     }
 
     const_iterator end() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->end();
+      return m_ptr + m_size;
     }
 
     reference front()
     {
-      ASSERT(m_vector.get());
-      return m_vector->front();
+      ASSERT(m_size);
+      return m_ptr[0];
     }
 
     const_reference front() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->front();
+      ASSERT(m_size);
+      return m_ptr[0];
     }
 
     reference back()
     {
-      ASSERT(m_vector.get());
-      return m_vector->back();
+      ASSERT(m_size);
+      return m_ptr[m_size-1];
     }
 
     const_reference back() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->back();
+      ASSERT(m_size);
+      return m_ptr[m_size-1];
     }
 
     reverse_iterator rbegin()
     {
-      ASSERT(m_vector.get());
-      return m_vector->rbegin();
+      return reverse_iterator(end());
     }
 
     const_reverse_iterator rbegin() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->rbegin();
+      return const_reverse_iterator(end());
     }
 
     reverse_iterator rend()
     {
-      ASSERT(m_vector.get());
-      return m_vector->rend();
+      return reverse_iterator(begin());
     }
 
     const_reverse_iterator rend() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->rend();
+      return const_reverse_iterator(begin());
     }
 
     // Copy and assignment
     SecureArray(const SecureArray& sa)
-      : m_vector(sa.m_vector)
+      : m_ptr(m_inline), m_size(0), m_capacity(InlineCount), m_mark(0)
     {
-      ASSERT(m_vector.get());
-      ASSERT(m_vector->size() == sa.m_vector->size());
+      append(sa.m_ptr, sa.m_size);
+      ASSERT(m_size == sa.m_size);
     }
 
     SecureArray& operator=(const SecureArray& sa)
     {
       if(this != &sa)
       {
-        m_vector = sa.m_vector;
-      }    
-      ASSERT(m_vector.get());
-      ASSERT(m_vector->size() == sa.m_vector->size());
+        m_size = 0;
+        append(sa.m_ptr, sa.m_size);
+      }
+      ASSERT(m_size == sa.m_size);
+
+      return *this;
+    }
+
+#if defined(ESAPI_CPLUSPLUS_RVALUE_REFS)
+    // Move. Heap storage changes hands; inline elements are copied and then wiped
+    // in the source.
+    SecureArray(SecureArray&& sa)
+      : m_ptr(m_inline), m_size(0), m_capacity(InlineCount), m_mark(0)
+    {
+      take(sa);
+    }
+
+    SecureArray& operator=(SecureArray&& sa)
+    {
+      if(this != &sa)
+      {
+        release();
+        m_size = 0;
+        take(sa);
+      }
 
       return *this;
     }
+#endif
 
     // Clone
     SecureArray clone() const
     {
-      ASSERT(m_vector.get());
       if( !size() )
         return SecureArray<T>();
 
@@ -180,15 +210,12 @@ namespace esapi
     // Size and capacity
     size_t max_size() const
     {
-      // Can't use m_vector->max_size() here. It might be called before
-      // the m_vector is constructed (eg, in create_secure_array).
       return std::numeric_limits<size_t>::max() / sizeof(T);
     }
 
     size_t capacity() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->capacity();
+      return m_capacity;
     }
 
     void reserve(size_t cnt)
@@ -197,26 +224,23 @@ namespace esapi
       if(cnt > max_size())
         throw std::bad_alloc();
 
-      ASSERT(m_vector.get());
-      m_vector->reserve(cnt);
+      if(cnt > m_capacity)
+        grow(cnt);
     }
 
     bool empty() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->empty();
+      return m_size == 0;
     }
 
     size_type size() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->size();
+      return m_size;
     }
 
     size_type length() const
     {
-      ASSERT(m_vector.get());
-      return m_vector->size();
+      return m_size;
     }
 
     void resize(size_type cnt, T t)
@@ -225,60 +249,70 @@ namespace esapi
       if(cnt > max_size())
         throw std::bad_alloc();
 
-      ASSERT(m_vector.get());
-      m_vector->resize(cnt, t);
+      if(cnt > m_size)
+      {
+        reserve_more(cnt - m_size);
+        std::fill(m_ptr + m_size, m_ptr + cnt, t);
+      }
+
+      set_size(cnt);
     }
 
     void clear()
     {
-      ASSERT(m_vector.get());
-      return m_vector->clear();
+      m_size = 0;
     }
 
     // Member functions
     const T& operator[](size_t pos) const
     {
-      ASSERT(m_vector.get());
-      return m_vector->operator[](pos);
+      ASSERT(pos < m_size);
+      return m_ptr[pos];
     }
 
     T& operator[](size_t pos)
     {
-      ASSERT(m_vector.get());
-      return m_vector->operator[](pos);
+      ASSERT(pos < m_size);
+      return m_ptr[pos];
     }
 
     const T& at(size_t pos) const
     {
-      ASSERT(m_vector.get());
-      return m_vector->at(pos);
+      if(!(pos < m_size))
+        throw std::out_of_range("SecureArray::at");
+      return m_ptr[pos];
     }
 
     T& at(size_t pos)
     {
-      ASSERT(m_vector.get());
-      return m_vector->at(pos);
+      if(!(pos < m_size))
+        throw std::out_of_range("SecureArray::at");
+      return m_ptr[pos];
     }
 
     // Value added
     T* data()
     {
-      ASSERT(m_vector.get());
-      return (m_vector->size() != 0 ? &(m_vector->operator[](0)) : nullptr);
+      return (m_size != 0 ? m_ptr : nullptr);
     }
 
     const T* data() const
     {
-      ASSERT(m_vector.get());
-      return (m_vector->size() != 0 ? &(m_vector->operator[](0)) : nullptr);
+      return (m_size != 0 ? m_ptr : nullptr);
     }
 
     void assign(size_type n, const T& u)
     {
       ASSERT(n <= max_size());
+      if(!(n <= max_size()))
+        throw std::bad_alloc();
 
-      ASSERT(m_vector.get());
-      m_vector->assign(n, u);
+      const T value = u;
+      m_size = 0;
+      reserve_more(n);
+
+      std::fill(m_ptr, m_ptr + n, value);
+      set_size(n);
     }
 
     void assign(const T* ptr, size_t cnt)
@@ -303,8 +337,7 @@ namespace esapi
         throw IllegalArgumentException("Array pointer wrap");
       }
 
-      ASSERT(m_vector.get());
-      m_vector->assign(ptr /*first*/, ptr+cnt /*last*/);
+      copy_to_front(ptr, ptr + cnt, cnt);
     }
 
     template <typename InputIterator>
@@ -319,14 +352,18 @@ namespace esapi
       if(!(last >= first))
         throw IllegalArgumentException("Bad input iterators");
 
-      ASSERT(m_vector.get());
-      return m_vector->assign(first, last);
+      assign_range(first, last, IntegralTag<std::numeric_limits<InputIterator>::is_integer>());
     }
 
     iterator insert(iterator pos, const T& x)
     {
-      ASSERT(m_vector.get());
-      return m_vector->insert(pos, x);
+      const size_type idx = index_of(pos);
+      const T value = x;
+
+      open_gap(idx, 1);
+      m_ptr[idx] = value;
+
+      return m_ptr + idx;
     }
 
     void insert(iterator pos, size_type n, const T& x)
@@ -337,8 +374,11 @@ namespace esapi
       if(!(n <= max_size() - size()))
         throw IllegalArgumentException("Too many elements in the resulting array");
 
-      ASSERT(m_vector.get());
-      m_vector->insert(pos, n, x);
+      const size_type idx = index_of(pos);
+      const T value = x;
+
+      open_gap(idx, n);
+      std::fill(m_ptr + idx, m_ptr + idx + n, value);
     }
 
     void insert(iterator pos, const T* ptr, size_t cnt)
@@ -364,8 +404,20 @@ namespace esapi
         throw IllegalArgumentException("Array pointer wrap");
       }
 
-      ASSERT(m_vector.get());
-      m_vector->insert(pos, ptr /*first*/, ptr+cnt /*last*/);
+      const size_type idx = index_of(pos);
+
+      // Opening the gap moves (or frees) a source inside this array
+      const std::less<const T*> less;
+      if(!less(ptr, m_ptr) && less(ptr, m_ptr + m_capacity))
+      {
+        const SecureArray temp(ptr, cnt);
+        open_gap(idx, cnt);
+        std::copy(temp.m_ptr, temp.m_ptr + cnt, m_ptr + idx);
+        return;
+      }
+
+      open_gap(idx, cnt);
+      std::copy(ptr, ptr + cnt, m_ptr + idx);
     }
 
     template <typename InputIterator>
@@ -380,14 +432,16 @@ namespace esapi
       if(!(last >= first))
         throw IllegalArgumentException("Bad input iterators");
 
-      ASSERT(m_vector.get());
-      m_vector->insert(pos, first, last);
+      insert_range(pos, first, last, IntegralTag<std::numeric_limits<InputIterator>::is_integer>());
     }
 
     iterator erase(iterator pos)
     {
-      ASSERT(m_vector.get());
-      return m_vector->erase(pos);
+      ASSERT(pos >= begin() && pos < end());
+      std::copy(pos + 1, end(), pos);
+      m_size--;
+
+      return pos;
     }
 
     iterator erase(iterator first, iterator last)
@@ -401,32 +455,216 @@ namespace esapi
       if(!(last >= first))
         throw IllegalArgumentException("Bad input iterators");
 
-      ASSERT(m_vector.get());
-      return m_vector->erase(first, last);
+      std::copy(last, end(), first);
+      m_size -= (size_type)(last - first);
+
+      return first;
     }
 
+    // Heap storage is exchanged. Inline elements go through a temporary, and each
+    // inline buffer is wiped as it is emptied.
     void swap(SecureArray& sa)
     {
-      ASSERT(m_vector.get());
-      m_vector.swap(sa.m_vector);
+      if(this == &sa)
+        return;
+
+      if(!is_inline() && !sa.is_inline())
+      {
+        std::swap(m_ptr, sa.m_ptr);
+        std::swap(m_size, sa.m_size);
+        std::swap(m_capacity, sa.m_capacity);
+        std::swap(m_mark, sa.m_mark);
+        return;
+      }
+
+      SecureArray temp;
+      temp.take(*this);
+      take(sa);
+      sa.take(temp);
     }
 
     void pop_back()
     {
-      ASSERT(m_vector.get());
-      m_vector->pop_back();
+      ASSERT(m_size);
+      m_size--;
     }
 
     void push_back(const T& x)
     {
-      ASSERT(m_vector.get());
-      m_vector->push_back(x);
+      const T value = x;
+      reserve_more(1);
+
+      m_ptr[m_size] = value;
+      set_size(m_size + 1);
     }
 
   private:
 
+    enum { InlineCount = (InlineBytes / sizeof(T)) ? (InlineBytes / sizeof(T)) : 1 };
+
+    template <bool B>
+    struct IntegralTag { };
+
+    bool is_inline() const
+    {
+      return m_ptr == m_inline;
+    }
+
+    size_type index_of(const_iterator pos) const
+    {
+      ASSERT(pos >= begin() && pos <= end());
+      return (size_type)(pos - begin());
+    }
+
+    // Sets the size and raises the mark to it
+    void set_size(size_type cnt)
+    {
+      ASSERT(cnt <= m_capacity);
+      m_size = cnt;
+      m_mark = std::max(m_mark, cnt);
+    }
+
+    // Makes room for n more elements
+    void reserve_more(size_type n)
+    {
+      ASSERT(n <= max_size() - m_size);
+      if(n > m_capacity - m_size)
+        grow(m_size + n);
+    }
+
+    // Shifts the tail up by n elements, leaving [idx, idx+n) to be written
+    void open_gap(size_type idx, size_type n)
+    {
+      reserve_more(n);
+      std::copy_backward(m_ptr + idx, m_ptr + m_size, m_ptr + m_size + n);
+      set_size(m_size + n);
+    }
+
+    void append(const T* ptr, size_type cnt)
+    {
+      reserve_more(cnt);
+      std::copy(ptr, ptr + cnt, m_ptr + m_size);
+      set_size(m_size + cnt);
+    }
+
+    // Replaces the elements with cnt elements from [first, last). A source inside
+    // this array survives: it fits the current capacity, so nothing is freed, and
+    // the copy runs towards the front.
+    template <typename InputIterator>
+    void copy_to_front(InputIterator first, InputIterator last, size_type cnt)
+    {
+      m_size = 0;
+      reserve_more(cnt);
+
+      std::copy(first, last, m_ptr);
+      set_size(cnt);
+    }
+
+    // Moves the elements to a SecurePool block of at least cnt elements. Capacity
+    // doubles so repeated appends stay linear.
+    void grow(size_type cnt)
+    {
+      ASSERT(cnt > m_capacity);
+      ASSERT(cnt <= max_size());
+
+      size_type cap = (m_capacity > max_size() / 2) ? max_size() : m_capacity * 2;
+      cap = std::max(cap, cnt);
+
+      T* ptr = static_cast<T*>(SecurePool::Allocate(cap * sizeof(T)));
+      std::copy(m_ptr, m_ptr + m_size, ptr);
+
+      const size_type size = m_size;
+      release();
+
+      m_ptr = ptr;
+      m_capacity = cap;
+      m_size = size;
+      m_mark = size;
+    }
+
+    // Wipes the marked extent and returns to the empty inline buffer. The size is
+    // left to the caller.
+    void release()
+    {
+      if(is_inline())
+        SecurePool::Wipe(m_inline, m_mark * sizeof(T));
+      else
+        SecurePool::Deallocate(m_ptr, m_capacity * sizeof(T), m_mark * sizeof(T));
+
+      m_ptr = m_inline;
+      m_capacity = InlineCount;
+      m_mark = 0;
+    }
+
+    // Takes the elements of sa, which is left empty. *this must be empty and inline.
+    void take(SecureArray& sa)
+    {
+      ASSERT(is_inline() && m_size == 0 && m_mark == 0);
+
+      if(sa.is_inline())
+      {
+        std::copy(sa.m_inline, sa.m_inline + sa.m_size, m_inline);
+        set_size(sa.m_size);
+
+        sa.release();
+        sa.m_size = 0;
+        return;
+      }
+
+      m_ptr = sa.m_ptr;
+      m_size = sa.m_size;
+      m_capacity = sa.m_capacity;
+      m_mark = sa.m_mark;
+
+      sa.m_ptr = sa.m_inline;
+      sa.m_size = 0;
+      sa.m_capacity = InlineCount;
+      sa.m_mark = 0;
+    }
+
+    // Integral "iterators" are a count and a value, as with std::vector
+    template <typename Integer>
+    void assign_range(Integer n, Integer value, IntegralTag<true>)
+    {
+      assign((size_type)n, (T)value);
+    }
+
+    template <typename InputIterator>
+    void assign_range(InputIterator first, InputIterator last, IntegralTag<false>)
+    {
+      copy_to_front(first, last, (size_type)(last - first));
+    }
+
+    template <typename Integer>
+    void insert_range(iterator pos, Integer n, Integer value, IntegralTag<true>)
+    {
+      insert(pos, (size_type)n, (T)value);
+    }
+
+    template <typename InputIterator>
+    void insert_range(iterator pos, InputIterator first, InputIterator last, IntegralTag<false>)
+    {
+      const size_type idx = index_of(pos);
+      const size_type cnt = (size_type)(last - first);
+
+      open_gap(idx, cnt);
+      std::copy(first, last, m_ptr + idx);
+    }
+
+    template <typename Integer>
+    void create_range(Integer n, Integer value, IntegralTag<true>)
+    {
+      create_secure_array((size_type)n, (T)value);
+    }
+
+    template <typename InputIterator>
+    void create_range(InputIterator first, InputIterator last, IntegralTag<false>)
+    {
+      copy_to_front(first, last, (size_type)(last - first));
+    }
+
     // Helpers to validate parameters in constructors
-    SecureVector* create_secure_array(size_type cnt, const T& value)
+    void create_secure_array(size_type cnt, const T& value)
     {
       // Array size 0 is OK.
       // ESAPI_ASSERT2(cnt != 0, "Array size is 0");
@@ -434,11 +672,13 @@ namespace esapi
       if(!(cnt <= max_size()))
         throw IllegalArgumentException("Too many elements in the array");
 
-      return new SecureVector(cnt, value);
+      reserve_more(cnt);
+      std::fill(m_ptr, m_ptr + cnt, value);
+      set_size(cnt);
     }
 
     // Helpers to validate parameters in constructors
-    SecureVector* create_secure_array(const T* ptr, size_t cnt)
+    void create_secure_array(const T* ptr, size_t cnt)
     {
       ESAPI_ASSERT2(ptr, "Array pointer is not valid");
       if(ptr == nullptr)
@@ -448,6 +688,8 @@ namespace esapi
       ESAPI_ASSERT2(cnt != 0, "Array size is 0");
       // Allocator will throw below
       ESAPI_ASSERT2(cnt <= max_size(), "Too many elements in the array");
+      if(!(cnt <= max_size()))
+        throw std::bad_alloc();
 
       try
       {
@@ -459,12 +701,12 @@ namespace esapi
         throw IllegalArgumentException("Array pointer wrap");
       }
 
-      return new SecureVector(ptr /*first*/, ptr+cnt /*last*/);
+      append(ptr, cnt);
     }
 
     // Helpers to validate parameters in constructors
     template <typename InputIterator>
-    SecureVector* create_secure_array(InputIterator first, InputIterator last)
+    void create_secure_array(InputIterator first, InputIterator last)
     {
       // We're walking a tight rope here. There's nothing that says InputIterators need
       // to compare. However, our use of them are as pointers, which will compare.
@@ -475,12 +717,16 @@ namespace esapi
       if(!(last >= first))
         throw IllegalArgumentException("Bad input iterators");
 
-      return new SecureVector(first, last);
+      create_range(first, last, IntegralTag<std::numeric_limits<InputIterator>::is_integer>());
     }
 
   private:
 
-    shared_ptr<SecureVector> m_vector;
+    T* m_ptr;               // m_inline or a SecurePool block
+    size_type m_size;
+    size_type m_capacity;
+    size_type m_mark;       // Largest size reached in the current storage
+    T m_inline[InlineCount];
   };
 
   // Non-member swap
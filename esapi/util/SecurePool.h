@@ -0,0 +1,88 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#pragma once
+
+#include "EsapiCommon.h"
+
+#include <cstddef>
+
+namespace esapi
+{
+  /**
+   * The memory behind zallocator. Requests of up to MaxPooledSize bytes are served
+   * from size classes (16, 32, 48, 64, 128 and 256 bytes, which cover keys, IVs and
+   * digests). Blocks are carved from page-granular slabs which are locked into
+   * memory (mlock or VirtualLock) and, where the OS supports it, excluded from core
+   * dumps. Freed blocks go back on a free list rather than to the heap.
+   *
+   * Free lists are sharded per processor, like the RandomPool, so threads on
+   * different cores rarely share a lock. Larger requests go to the global heap.
+   * Every block is zeroized when it is freed, pooled or not. A caller which knows
+   * how much of a block was ever written may pass that extent to Deallocate, and
+   * only the extent is wiped.
+   *
+   * Slabs are never returned to the OS, and the pool is never destroyed, so
+   * containers with static storage duration can still free their memory during
+   * static destruction.
+   */
+  class ESAPI_EXPORT SecurePool
+  {
+  public:
+    enum { MaxPooledSize = 256, SlabSize = 16 * 1024, NonTemporalSize = 256 * 1024 };
+
+    /**
+     * Allocates size bytes.
+     *
+     * @throws  throws std::bad_alloc if the memory is not available.
+     */
+    static void* Allocate(size_t size);
+
+    /**
+     * Zeroizes and frees memory from Allocate(). size must be the size passed to
+     * Allocate().
+     */
+    static void Deallocate(void* ptr, size_t size);
+
+    /**
+     * Zeroizes the first used bytes of memory from Allocate() and frees it. The
+     * caller asserts the bytes from used through size were never written. used is
+     * clamped to size.
+     */
+    static void Deallocate(void* ptr, size_t size, size_t used);
+
+    /**
+     * Zeroizes size bytes. The stores are not optimized away. Buffers of at least
+     * NonTemporalSize bytes are cleared with non-temporal stores where the processor
+     * has SSE2, so the wipe does not pull the buffer into cache. Smaller buffers
+     * use explicit_bzero or SecureZeroMemory where available.
+     */
+    static void Wipe(void* ptr, size_t size);
+
+    /**
+     * Returns the number of bytes held in slabs.
+     */
+    static size_t GetSlabBytes();
+
+    /**
+     * Returns the number of slab bytes which could not be locked into memory (for
+     * example, because RLIMIT_MEMLOCK was reached). Such slabs are still used.
+     */
+    static size_t GetUnlockedBytes();
+
+  private:
+    SecurePool();
+  };
+
+} // NAMESPACE esapi
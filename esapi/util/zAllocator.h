@@ -15,6 +15,7 @@
 #pragma once
 
 #include "EsapiCommon.h"
+#include "util/SecurePool.h"
 
 #include <memory>
 #include <cstring>
@@ -47,9 +48,6 @@ namespace esapi
         
     public:
         
-        // tame the optimizer
-        static volatile void* g_dummy;
-        
         template<typename U>
 	    struct rebind {
             typedef zallocator<U> other;
@@ -79,7 +77,7 @@ namespace esapi
             if(cnt > max_size())
                 throw std::bad_alloc();
             
-            return reinterpret_cast<pointer>(::operator new(cnt * sizeof (T)));
+            return reinterpret_cast<pointer>(SecurePool::Allocate(cnt * sizeof (T)));
         }
         
         inline void deallocate(pointer p, size_type cnt)
@@ -91,13 +89,9 @@ namespace esapi
             ASSERT(cnt);
             ASSERT(!(cnt > max_size()));
             
-            // Because 'p' is assigned to a static volatile pointer, the
-            // optimizer currently does not optimize out the ::memset as dead
-            // code. Set a breakpoint on the assignment to g_dummy in the
-            // assembled code for verification.
-            ::memset(static_cast<void*>(p), 0x00, cnt * sizeof (T));
-            g_dummy = p;
-            ::operator delete(p);
+            // SecurePool zeroizes the block before it goes back on a free list
+            // or to the heap. Small blocks live in locked pages.
+            SecurePool::Deallocate(static_cast<void*>(p), cnt * sizeof (T));
         }
         
         // size
@@ -135,10 +129,6 @@ namespace esapi
         
     };
     
-    // Storage and intialization
-    template <class T>
-    volatile void* zallocator<T>::g_dummy = nullptr;
-    
 #if defined(ESAPI_CXX_MSVC)
 # pragma warning(default:4100)
 # pragma warning(pop)
@@ -126,7 +126,7 @@ namespace esapi
   }
   String DummyConfiguration::getCipherTransformation()
   {
-    return "AES/CBC/PKCS5";
+    return "AES/GCM/NoPadding";
   }
   String DummyConfiguration::setCipherTransformation(const NarrowString &)
   {
@@ -0,0 +1,176 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/CpuFeatures.h"
+#include "crypto/AcceleratedHash.h"
+
+// SHA-NI needs compiler support for the intrinsics. GCC 4.9 and Clang 3.8 can emit them
+// from a function with a target attribute, so the rest of the library is still built for
+// the baseline processor. Visual Studio 2015 is the first to provide the intrinsics.
+#if defined(ESAPI_ARCH_X86) || defined(ESAPI_ARCH_X64)
+# if defined(ESAPI_CXX_GCC) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define ESAPI_SHANI_AVAILABLE 1
+# elif defined(ESAPI_CXX_CLANG) && ((__clang_major__ > 3) || (__clang_major__ == 3 && __clang_minor__ >= 8))
+#  define ESAPI_SHANI_AVAILABLE 1
+# elif defined(ESAPI_CXX_MSVC) && (_MSC_VER >= 1900)
+#  define ESAPI_SHANI_AVAILABLE 1
+# endif
+#endif
+
+#if defined(ESAPI_SHANI_AVAILABLE)
+# include <immintrin.h>
+# if defined(ESAPI_CXX_MSVC)
+#  define ESAPI_SHANI_TARGET
+# else
+#  define ESAPI_SHANI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+# endif
+#endif
+
+namespace esapi
+{
+  typedef void (*Sha256TransformFn)(CryptoPP::word32 *digest, const CryptoPP::word32 *data);
+
+#if defined(ESAPI_SHANI_AVAILABLE)
+
+  // SHA-256 round constants, FIPS 180-4, section 4.2.2
+  static const CryptoPP::word32 g_sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+
+  /**
+   * One SHA-256 block using the SHA extensions. IteratedHash hands us the block already
+   * converted to native word order, so unlike most SHA-NI code there is no byte shuffle
+   * on the message.
+   */
+  ESAPI_SHANI_TARGET
+  static void Sha256TransformSHANI(CryptoPP::word32 *digest, const CryptoPP::word32 *data)
+  {
+    __m128i state0, state1, msg, tmp, abefSave, cdghSave;
+    __m128i w[4];
+
+    // The instructions want the state as ABEF and CDGH
+    tmp    = _mm_loadu_si128((const __m128i*)&digest[0]);
+    state1 = _mm_loadu_si128((const __m128i*)&digest[4]);
+
+    tmp    = _mm_shuffle_epi32(tmp, 0xB1);          // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);       // EFGH
+    state0 = _mm_alignr_epi8(tmp, state1, 8);       // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);    // CDGH
+
+    abefSave = state0;
+    cdghSave = state1;
+
+    w[0] = _mm_loadu_si128((const __m128i*)&data[0]);
+    w[1] = _mm_loadu_si128((const __m128i*)&data[4]);
+    w[2] = _mm_loadu_si128((const __m128i*)&data[8]);
+    w[3] = _mm_loadu_si128((const __m128i*)&data[12]);
+
+    // 16 groups of 4 rounds. Group i consumes w[i%4]; the schedule for group i+1 is
+    // finished (msg2) in groups 3 through 14, and started (msg1) in groups 1 through 12.
+    for(unsigned int i = 0; i < 16; i++)
+    {
+      __m128i& cur = w[i & 3];
+
+      msg = _mm_add_epi32(cur, _mm_loadu_si128((const __m128i*)&g_sha256K[i * 4]));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+
+      if(i >= 3 && i <= 14)
+      {
+        __m128i& next = w[(i + 1) & 3];
+        tmp = _mm_alignr_epi8(cur, w[(i + 3) & 3], 4);
+        next = _mm_add_epi32(next, tmp);
+        next = _mm_sha256msg2_epu32(next, cur);
+      }
+
+      msg = _mm_shuffle_epi32(msg, 0x0E);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+      if(i >= 1 && i <= 12)
+      {
+        __m128i& prev = w[(i + 3) & 3];
+        prev = _mm_sha256msg1_epu32(prev, cur);
+      }
+    }
+
+    state0 = _mm_add_epi32(state0, abefSave);
+    state1 = _mm_add_epi32(state1, cdghSave);
+
+    // Back to ABCD and EFGH
+    tmp    = _mm_shuffle_epi32(state0, 0x1B);       // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);       // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);    // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);       // ABEF
+
+    _mm_storeu_si128((__m128i*)&digest[0], state0);
+    _mm_storeu_si128((__m128i*)&digest[4], state1);
+  }
+
+#endif
+
+  static void Sha256TransformPortable(CryptoPP::word32 *digest, const CryptoPP::word32 *data)
+  {
+    CryptoPP::SHA256::Transform(digest, data);
+  }
+
+  /**
+   * Picks the compression function once per process. SSE4.1 and SSSE3 are checked too
+   * since the state shuffles use them; every SHA-NI part has both.
+   */
+  static Sha256TransformFn SelectSha256Transform()
+  {
+#if defined(ESAPI_SHANI_AVAILABLE)
+    if(CpuFeatures::HasSHA() && CpuFeatures::HasSSE41() && CpuFeatures::HasSSSE3())
+      return &Sha256TransformSHANI;
+#endif
+
+    return &Sha256TransformPortable;
+  }
+
+  /**
+   * Selected once, on the first transform. SelectSha256Transform() only reads the
+   * cached CpuFeatures (see GetCpuInfo), so every thread selects the same function.
+   */
+  static Sha256TransformFn GetSha256Transform()
+  {
+    static const Sha256TransformFn s_transform = SelectSha256Transform();
+    return s_transform;
+  }
+
+  void AcceleratedSHA256::Transform(CryptoPP::word32 *digest, const CryptoPP::word32 *data)
+  {
+    ASSERT(digest);
+    ASSERT(data);
+
+    GetSha256Transform()(digest, data);
+  }
+
+  const char* AcceleratedSHA256::Backend()
+  {
+#if defined(ESAPI_SHANI_AVAILABLE)
+    if(GetSha256Transform() == &Sha256TransformSHANI)
+      return "SHA-NI";
+#endif
+
+    return "Portable";
+  }
+
+} // NAMESPACE esapi
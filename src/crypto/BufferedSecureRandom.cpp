@@ -0,0 +1,296 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "crypto/BufferedSecureRandom.h"
+#include "crypto/CryptoppCommon.h"
+#include "crypto/RandomPool.h"
+#include "util/NotCopyable.h"
+
+namespace esapi
+{
+    // The smallest buffer we will manage. Anything smaller is not worth the bookkeeping.
+    static const size_t MinCapacity = 64;
+
+    // The largest buffer we will manage. This is the MaxRequest of the DRBGs, so a
+    // refill is always a single generate call on the underlying SecureRandom.
+    static const size_t MaxCapacity = (1 << 16);
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    /////////////////////// Buffered Secure Random Implmentation //////////////////////
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    class BufferedSecureRandomImpl : private NotCopyable
+    {
+    public:
+        /**
+         * Constructs the buffer state. The buffer is filled lazily on first use.
+         */
+        BufferedSecureRandomImpl(const SecureRandom& random, size_t capacity)
+            : m_random(random), m_buffer(capacity), m_pos(capacity), m_forkGeneration(RandomPool::GetForkGeneration())
+        {
+            // Nothing is available until the first refill. SecByteBlock does not zero on construction.
+            ::memset(m_buffer.data(), 0x00, m_buffer.size());
+        }
+
+        /**
+         * Returns the number of pre-generated bytes currently available.
+         */
+        size_t available() const
+        {
+            ASSERT(m_pos <= m_buffer.size());
+            return m_buffer.size() - m_pos;
+        }
+
+        /**
+         * If the process forked, discard the inherited bytes. The generator reseeds
+         * itself from the OS (through the RandomPool) on its next use in the child.
+         */
+        void checkFork()
+        {
+            const unsigned int generation = RandomPool::GetForkGeneration();
+            if(generation == m_forkGeneration)
+                return;
+
+            discard();
+            m_forkGeneration = generation;
+        }
+
+        /**
+         * Regenerates the consumed (and zeroized) front of the buffer. Consumed bytes
+         * are always [0, m_pos), so a refill makes the entire buffer available again.
+         */
+        void refill()
+        {
+            if(!m_pos)
+                return;
+
+            m_random.nextBytes(m_buffer.data(), m_pos);
+            m_pos = 0;
+        }
+
+        /**
+         * Copies bytes out of the buffer and zeroizes the region that was handed out.
+         */
+        void take(byte bytes[], size_t size)
+        {
+            ASSERT(size <= available());
+
+            byte* ptr = m_buffer.data() + m_pos;
+            ::memcpy(bytes, ptr, size);
+            ::memset(ptr, 0x00, size);
+            m_pos += size;
+        }
+
+        /**
+         * Zeroizes and discards all pre-generated bytes.
+         */
+        void discard()
+        {
+            ::memset(m_buffer.data(), 0x00, m_buffer.size());
+            m_pos = m_buffer.size();
+        }
+
+    public:
+        SecureRandom m_random;
+        CryptoPP::SecByteBlock m_buffer;
+        size_t m_pos;
+        unsigned int m_forkGeneration;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    //////////////////////////// Buffered Secure Random ///////////////////////////////
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    /**
+     * Validates the requested capacity of the buffer.
+     */
+    static size_t ValidateCapacity(size_t capacity)
+    {
+        ASSERT(capacity >= MinCapacity);
+        ASSERT(capacity <= MaxCapacity);
+        if(capacity < MinCapacity || capacity > MaxCapacity)
+            throw IllegalArgumentException("The buffer capacity is not valid");
+
+        return capacity;
+    }
+
+    /**
+     * Constructs a buffered generator over the default random number algorithm.
+     */
+    BufferedSecureRandom::BufferedSecureRandom(size_t capacity)
+        : m_lock(new Mutex),
+          m_impl(new BufferedSecureRandomImpl(SecureRandom::getInstance(), ValidateCapacity(capacity)))
+    {
+        ASSERT(m_lock.get() != nullptr);
+        ASSERT(m_impl.get() != nullptr);
+    }
+
+    /**
+     * Constructs a buffered generator over the named random number algorithm.
+     */
+    BufferedSecureRandom::BufferedSecureRandom(const NarrowString& algorithm, size_t capacity)
+        : m_lock(new Mutex),
+          m_impl(new BufferedSecureRandomImpl(SecureRandom::getInstance(algorithm), ValidateCapacity(capacity)))
+    {
+        ASSERT( !algorithm.empty() );
+        ASSERT(m_lock.get() != nullptr);
+        ASSERT(m_impl.get() != nullptr);
+    }
+
+    /**
+     * Constructs a buffered generator over an existing SecureRandom object.
+     */
+    BufferedSecureRandom::BufferedSecureRandom(const SecureRandom& random, size_t capacity)
+        : m_lock(new Mutex),
+          m_impl(new BufferedSecureRandomImpl(random, ValidateCapacity(capacity)))
+    {
+        ASSERT(m_lock.get() != nullptr);
+        ASSERT(m_impl.get() != nullptr);
+    }
+
+    /**
+     * Copy this buffered random number generator (RNG).
+     */
+    BufferedSecureRandom::BufferedSecureRandom(const BufferedSecureRandom& rhs)
+        : m_lock(rhs.m_lock), m_impl(rhs.m_impl)
+    {
+        ASSERT(m_lock.get() != nullptr);
+        ASSERT(m_impl.get() != nullptr);
+    }
+
+    /**
+     * Assign this buffered random number generator (RNG).
+     */
+    BufferedSecureRandom& BufferedSecureRandom::operator=(const BufferedSecureRandom& rhs)
+    {
+        // See the comments in SecureRandom::operator= regarding the object lock.
+        if(this != &rhs)
+        {
+            m_lock = rhs.m_lock;
+            m_impl = rhs.m_impl;
+        }
+
+        ASSERT(m_lock.get() != nullptr);
+        ASSERT(m_impl.get() != nullptr);
+
+        return *this;
+    }
+
+    /**
+     * Retrieves the object level lock
+     */
+    Mutex& BufferedSecureRandom::getObjectLock() const
+    {
+        ASSERT(m_lock.get());
+        return *m_lock.get();
+    }
+
+    /**
+     * Returns the name of the algorithm implemented by the underlying SecureRandom object.
+     */
+    NarrowString BufferedSecureRandom::getAlgorithm() const
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        return m_impl->m_random.getAlgorithm();
+    }
+
+    /**
+     * Returns the capacity of the buffer, in bytes.
+     */
+    size_t BufferedSecureRandom::getCapacity() const
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        return m_impl->m_buffer.size();
+    }
+
+    /**
+     * Returns the number of pre-generated bytes currently available.
+     */
+    size_t BufferedSecureRandom::getAvailable() const
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        return m_impl->available();
+    }
+
+    /**
+     * Generates a user-specified number of random bytes.
+     */
+    void BufferedSecureRandom::nextBytes(byte bytes[], size_t size)
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        BufferedSecureRandomImpl& impl = *m_impl.get();
+
+        ASSERT(bytes && size);
+        if( !(bytes && size) )
+            throw IllegalArgumentException("Unable to generate bytes from buffered generator. The buffer or size is not valid");
+
+        impl.checkFork();
+
+        // Large requests gain nothing from the buffer. Go straight to the generator.
+        const size_t capacity = impl.m_buffer.size();
+        if(size > capacity / 2)
+        {
+            impl.m_random.nextBytes(bytes, size);
+            return;
+        }
+
+        if(impl.available() < size)
+            impl.refill();
+
+        impl.take(bytes, size);
+
+        // Low water mark is a quarter of the buffer. Refilling here (rather than
+        // on the next short read) keeps most requests to a single memcpy.
+        if(impl.available() < capacity / 4)
+            impl.refill();
+    }
+
+    /**
+     * Tops up the consumed portion of the buffer from the underlying generator.
+     */
+    void BufferedSecureRandom::refill()
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->checkFork();
+        m_impl->refill();
+    }
+
+    /**
+     * Zeroizes and discards all pre-generated bytes.
+     */
+    void BufferedSecureRandom::clear()
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->discard();
+    }
+
+} // esapi
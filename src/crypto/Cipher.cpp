@@ -0,0 +1,984 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "crypto/Cipher.h"
+#include "crypto/Key.h"
+#include "crypto/SecretKey.h"
+#include "crypto/SecureRandom.h"
+#include "crypto/IvParameterSpec.h"
+#include "crypto/CryptoppCommon.h"
+#include "util/NotCopyable.h"
+#include "util/TextConvert.h"
+#include "util/AlgorithmName.h"
+#include "errors/EncryptionException.h"
+#include "errors/InvalidKeyException.h"
+#include "errors/IllegalStateException.h"
+#include "errors/IllegalArgumentException.h"
+#include "errors/NoSuchAlgorithmException.h"
+#include "errors/UnsupportedOperationException.h"
+
+#include "safeint/SafeInt3.hpp"
+
+#include <string.h>
+
+// GCM and EAX arrived in Crypto++ 5.6.
+#if CRYPTOPP_VERSION >= 560
+# include <cryptopp/gcm.h>
+# include <cryptopp/eax.h>
+# define ESAPI_AEAD_AVAILABLE 1
+#endif
+
+namespace esapi
+{
+  // Largest block size of the supported ciphers (AES and Camellia)
+  static const size_t MaxBlockSize = 16;
+  // Tag size of the authenticated modes
+  static const size_t AeadTagSize = 16;
+  // 96-bit nonces use the fast path of GCM, SP 800-38D, 8.2.2
+  static const size_t GcmNonceSize = 12;
+
+  // Private to this module
+  static void checkBuffer(const byte* buffer, size_t size, size_t offset, size_t len);
+
+  /**
+   * Creates the Crypto++ object for one of the unauthenticated modes. Padding is
+   * handled by CipherImpl, so ECB and CBC only ever see whole blocks.
+   */
+  template <class BC>
+  static CryptoPP::StreamTransformation* CreateMode(AlgorithmName::ModeId mode, bool encrypt)
+  {
+    switch(mode)
+      {
+      case AlgorithmName::ModeECB:
+        if(encrypt) return new typename CryptoPP::ECB_Mode<BC>::Encryption;
+        return new typename CryptoPP::ECB_Mode<BC>::Decryption;
+      case AlgorithmName::ModeCBC:
+        if(encrypt) return new typename CryptoPP::CBC_Mode<BC>::Encryption;
+        return new typename CryptoPP::CBC_Mode<BC>::Decryption;
+      case AlgorithmName::ModeCFB:
+        if(encrypt) return new typename CryptoPP::CFB_Mode<BC>::Encryption;
+        return new typename CryptoPP::CFB_Mode<BC>::Decryption;
+      case AlgorithmName::ModeOFB:
+        if(encrypt) return new typename CryptoPP::OFB_Mode<BC>::Encryption;
+        return new typename CryptoPP::OFB_Mode<BC>::Decryption;
+      case AlgorithmName::ModeCTR:
+        if(encrypt) return new typename CryptoPP::CTR_Mode<BC>::Encryption;
+        return new typename CryptoPP::CTR_Mode<BC>::Decryption;
+      default:
+        return nullptr;
+      }
+  }
+
+#if defined(ESAPI_AEAD_AVAILABLE)
+  /**
+   * Creates the Crypto++ object for one of the authenticated modes. Only
+   * instantiated for the 128-bit block ciphers.
+   */
+  template <class BC>
+  static CryptoPP::StreamTransformation* CreateAeadMode(AlgorithmName::ModeId mode, bool encrypt)
+  {
+    switch(mode)
+      {
+      case AlgorithmName::ModeGCM:
+        if(encrypt) return new typename CryptoPP::GCM<BC>::Encryption;
+        return new typename CryptoPP::GCM<BC>::Decryption;
+      case AlgorithmName::ModeEAX:
+        if(encrypt) return new typename CryptoPP::EAX<BC>::Encryption;
+        return new typename CryptoPP::EAX<BC>::Decryption;
+      default:
+        return nullptr;
+      }
+  }
+#endif
+
+  /**
+   * The state behind a Cipher. The Crypto++ mode object is keyed once and kept;
+   * re-initializing with the same key and direction only resynchronizes it on the
+   * new IV. A partial block (or, for padded decryption, the final block) is held in
+   * a fixed buffer, so update and doFinal write straight into the caller's output.
+   */
+  class CipherImpl : private NotCopyable
+  {
+  public:
+    explicit CipherImpl(const AlgorithmName& xform);
+
+    NarrowString getAlgorithm() const { return m_algorithm; }
+
+    SecureByteArray getIV() const;
+
+    size_t getOutputSize(size_t inputLen) const;
+
+    void init(int opmode, const Key& key, const byte* iv, size_t ivLen, SecureRandom* random);
+
+    size_t update(const byte* input, size_t len, byte* output, size_t outSize);
+
+    size_t doFinal(const byte* input, size_t len, byte* output, size_t outSize);
+
+  private:
+    bool isBlockMode() const { return m_mode == AlgorithmName::ModeECB || m_mode == AlgorithmName::ModeCBC; }
+
+    bool isAeadMode() const { return m_mode == AlgorithmName::ModeGCM || m_mode == AlgorithmName::ModeEAX; }
+
+    bool requiresIV() const { return m_mode != AlgorithmName::ModeECB; }
+
+    CryptoPP::StreamTransformation* createMode(bool encrypt) const;
+
+    void checkReady() const;
+
+    size_t updateBlocks(const byte* input, size_t len, byte* output, size_t outSize);
+
+    size_t sealFinal(const byte* input, size_t len, byte* output, size_t outSize);
+
+    size_t openFinal(const byte* input, size_t len, byte* output, size_t outSize);
+
+    void restart();
+
+  private:
+    NarrowString m_algorithm;
+    AlgorithmName::AlgorithmId m_id;
+    AlgorithmName::ModeId m_mode;
+    bool m_padded;
+    size_t m_blockSize;
+
+    // Zero until init succeeds
+    int m_opmode;
+    bool m_encrypt;
+    // An authenticated encryption finished, and the IV may not be used again
+    bool m_spent;
+
+    shared_ptr<CryptoPP::StreamTransformation> m_cipher;
+    CryptoPP::SimpleKeyingInterface* m_keying;
+    CryptoPP::AuthenticatedSymmetricCipher* m_aead;
+
+    // The key the cipher is keyed with, to recognize it on the next init
+    CryptoPP::SecByteBlock m_key;
+    CryptoPP::SecByteBlock m_iv;
+
+    CryptoPP::FixedSizeSecBlock<byte, MaxBlockSize> m_partial;
+    size_t m_count;
+
+    // Authenticated decryption holds the ciphertext until doFinal. The block is
+    // only ever grown, so a Cipher reused for similar messages stops allocating.
+    CryptoPP::SecByteBlock m_pending;
+    size_t m_pendingSize;
+  };
+
+  CipherImpl::CipherImpl(const AlgorithmName& xform)
+    : m_algorithm(xform.algorithm()), m_id(xform.getAlgorithmId()), m_mode(xform.getModeId()),
+      m_padded(false), m_blockSize(0), m_opmode(0), m_encrypt(false), m_spent(false),
+      m_keying(nullptr), m_aead(nullptr), m_count(0), m_pendingSize(0)
+  {
+    switch(m_id)
+      {
+      case AlgorithmName::AlgAES:
+      case AlgorithmName::AlgCamellia:
+        m_blockSize = 16;
+        break;
+      case AlgorithmName::AlgBlowfish:
+      case AlgorithmName::AlgDES_ede:
+      case AlgorithmName::AlgDES:
+        m_blockSize = 8;
+        break;
+      default:
+        throw NoSuchAlgorithmException(m_algorithm + " Cipher not available");
+      }
+
+    // The JCE default: "AES" is "AES/ECB/PKCS5Padding"
+    if(m_mode == AlgorithmName::ModeAbsent)
+      m_mode = AlgorithmName::ModeECB;
+
+    if(m_mode == AlgorithmName::ModeNONE || m_mode == AlgorithmName::ModeCCM)
+      throw NoSuchAlgorithmException(m_algorithm + " Cipher not available");
+
+    const AlgorithmName::PaddingId padding = xform.getPaddingId();
+    if(isBlockMode())
+      m_padded = (padding != AlgorithmName::PaddingNone);
+    else if(padding != AlgorithmName::PaddingAbsent && padding != AlgorithmName::PaddingNone)
+      throw NoSuchAlgorithmException(m_algorithm + " Cipher not available (padding requires ECB or CBC)");
+
+    if(isAeadMode())
+      {
+#if defined(ESAPI_AEAD_AVAILABLE)
+        if(m_blockSize != 16)
+          throw NoSuchAlgorithmException(m_algorithm + " Cipher not available (mode requires a 128-bit block cipher)");
+#else
+        throw NoSuchAlgorithmException(m_algorithm + " Cipher not available");
+#endif
+      }
+  }
+
+  CryptoPP::StreamTransformation* CipherImpl::createMode(bool encrypt) const
+  {
+#if defined(ESAPI_AEAD_AVAILABLE)
+    if(isAeadMode())
+      {
+        if(m_id == AlgorithmName::AlgAES)
+          return CreateAeadMode<CryptoPP::AES>(m_mode, encrypt);
+        return CreateAeadMode<CryptoPP::Camellia>(m_mode, encrypt);
+      }
+#endif
+
+    switch(m_id)
+      {
+      case AlgorithmName::AlgAES:
+        return CreateMode<CryptoPP::AES>(m_mode, encrypt);
+      case AlgorithmName::AlgCamellia:
+        return CreateMode<CryptoPP::Camellia>(m_mode, encrypt);
+      case AlgorithmName::AlgBlowfish:
+        return CreateMode<CryptoPP::Blowfish>(m_mode, encrypt);
+      case AlgorithmName::AlgDES_ede:
+        return CreateMode<CryptoPP::DES_EDE3>(m_mode, encrypt);
+      case AlgorithmName::AlgDES:
+        return CreateMode<CryptoPP::DES>(m_mode, encrypt);
+      default:
+        return nullptr;
+      }
+  }
+
+  SecureByteArray CipherImpl::getIV() const
+  {
+    if(!m_opmode || !requiresIV())
+      return SecureByteArray();
+
+    return SecureByteArray(m_iv.data(), m_iv.size());
+  }
+
+  size_t CipherImpl::getOutputSize(size_t inputLen) const
+  {
+    try
+      {
+        if(isAeadMode())
+          {
+            if(m_encrypt)
+              return SafeInt<size_t>(inputLen) + AeadTagSize;
+
+            const size_t total = SafeInt<size_t>(m_pendingSize) + inputLen;
+            return total > AeadTagSize ? total - AeadTagSize : 0;
+          }
+
+        if(!isBlockMode())
+          return inputLen;
+
+        const size_t total = SafeInt<size_t>(m_count) + inputLen;
+        if(m_encrypt && m_padded)
+          return SafeInt<size_t>(total / m_blockSize + 1) * m_blockSize;
+
+        return total;
+      }
+    catch(const SafeIntException&)
+      {
+        throw IllegalArgumentException("Input length is not valid");
+      }
+  }
+
+  void CipherImpl::init(int opmode, const Key& key, const byte* iv, size_t ivLen, SecureRandom* random)
+  {
+    if(opmode == Cipher::WrapMode || opmode == Cipher::UnwrapMode)
+      throw UnsupportedOperationException("Cipher does not support key wrapping");
+
+    ESAPI_ASSERT2(opmode == Cipher::EncryptMode || opmode == Cipher::DecryptMode, "Cipher mode is not valid");
+    if(opmode != Cipher::EncryptMode && opmode != Cipher::DecryptMode)
+      throw IllegalArgumentException("Cipher mode is not valid");
+
+    const bool encrypt = (opmode == Cipher::EncryptMode);
+
+    // A SecretKey lends us its bytes. Other keys hand over a copy.
+    SecureByteArray encoded;
+    const byte* kptr = nullptr;
+    size_t ksize = 0;
+
+    const SecretKey* skey = dynamic_cast<const SecretKey*>(&key);
+    if(skey)
+      {
+        kptr = skey->BytePtr();
+        ksize = skey->sizeInBytes();
+      }
+    else
+      {
+        encoded = key.getEncoded();
+        kptr = encoded.data();
+        ksize = encoded.size();
+      }
+
+    ESAPI_ASSERT2(kptr && ksize, "Key is not valid");
+    if(!kptr || !ksize)
+      throw InvalidKeyException("Key is not valid");
+
+    const bool rekey = (m_cipher.get() == nullptr || m_encrypt != encrypt || m_key.size() != ksize ||
+      !CryptoPP::VerifyBufsEqual(m_key.data(), kptr, ksize));
+
+    // Not usable until this init succeeds
+    m_opmode = 0;
+
+    if(!requiresIV())
+      {
+        if(iv)
+          throw IllegalArgumentException(m_algorithm + " does not use an IV");
+      }
+    else if(!iv)
+      {
+        if(!encrypt)
+          throw IllegalArgumentException(m_algorithm + " decryption requires an IV");
+
+        // As in the JCE, encryption without parameters gets a random IV
+        m_iv.New(m_mode == AlgorithmName::ModeGCM ? GcmNonceSize : m_blockSize);
+        if(random)
+          random->nextBytes(m_iv.data(), m_iv.size());
+        else
+          SecureRandom::getInstance().nextBytes(m_iv.data(), m_iv.size());
+      }
+    else
+      {
+        const bool valid = isAeadMode() ? ivLen != 0 : ivLen == m_blockSize;
+        ESAPI_ASSERT2(valid, "IV size is not valid");
+        if(!valid)
+          throw IllegalArgumentException("IV size is not valid for " + m_algorithm);
+
+        // The JCE refuses the same key and IV twice in a row for GCM encryption
+        if(encrypt && isAeadMode() && !rekey && m_iv.size() == ivLen && CryptoPP::VerifyBufsEqual(m_iv.data(), iv, ivLen))
+          throw IllegalArgumentException("The IV may not be reused for " + m_algorithm + " encryption");
+
+        m_iv.Assign(iv, ivLen);
+      }
+
+    try
+      {
+        if(rekey)
+          {
+            m_key.New(0);
+            m_cipher.reset(createMode(encrypt));
+            ASSERT(m_cipher.get() != nullptr);
+            if(m_cipher.get() == nullptr)
+              throw EncryptionException("Failed to create " + m_algorithm + " Cipher");
+
+            m_keying = dynamic_cast<CryptoPP::SimpleKeyingInterface*>(m_cipher.get());
+            m_aead = dynamic_cast<CryptoPP::AuthenticatedSymmetricCipher*>(m_cipher.get());
+            ASSERT(m_keying != nullptr);
+            ASSERT(!isAeadMode() || m_aead != nullptr);
+
+            if(!m_keying->IsValidKeyLength(ksize))
+              throw InvalidKeyException("Key size is not valid for " + m_algorithm);
+
+            // The expensive part: the key schedule (and for GCM, the GHASH table)
+            if(requiresIV())
+              m_keying->SetKeyWithIV(kptr, ksize, m_iv.data(), m_iv.size());
+            else
+              m_keying->SetKey(kptr, ksize);
+
+            m_key.Assign(kptr, ksize);
+          }
+        else if(requiresIV())
+          {
+            m_keying->Resynchronize(m_iv.data(), (int)m_iv.size());
+          }
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        m_cipher.reset();
+        m_key.New(0);
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    m_encrypt = encrypt;
+    m_spent = false;
+    m_count = 0;
+    if(m_pendingSize)
+      {
+        CryptoPP::SecureWipeBuffer(m_pending.data(), m_pendingSize);
+        m_pendingSize = 0;
+      }
+
+    m_opmode = opmode;
+  }
+
+  void CipherImpl::checkReady() const
+  {
+    if(!m_opmode)
+      throw IllegalStateException("Cipher not initialized");
+
+    if(m_spent)
+      throw IllegalStateException("Cipher must be initialized with a new IV for " + m_algorithm + " encryption");
+  }
+
+  // Returns the cipher to the state following init. The IV is reloaded, as in the
+  // JCE, except for authenticated encryption where reuse would be fatal.
+  void CipherImpl::restart()
+  {
+    m_count = 0;
+    CryptoPP::SecureWipeBuffer(m_partial.data(), m_partial.size());
+
+    if(m_pendingSize)
+      {
+        CryptoPP::SecureWipeBuffer(m_pending.data(), m_pendingSize);
+        m_pendingSize = 0;
+      }
+
+    if(isAeadMode() && m_encrypt)
+      {
+        m_spent = true;
+        return;
+      }
+
+    if(requiresIV())
+      m_keying->Resynchronize(m_iv.data(), (int)m_iv.size());
+  }
+
+  size_t CipherImpl::update(const byte* input, size_t len, byte* output, size_t outSize)
+  {
+    checkReady();
+
+    try
+      {
+        if(isAeadMode() && !m_encrypt)
+          {
+            // Hold the ciphertext so no unauthenticated plain text is released
+            if(len)
+              {
+                const size_t total = SafeInt<size_t>(m_pendingSize) + len;
+                if(total > m_pending.size())
+                  m_pending.CleanGrow(SafeInt<size_t>(total) * 2);
+
+                ::memcpy(m_pending.data() + m_pendingSize, input, len);
+                m_pendingSize = total;
+              }
+
+            return 0;
+          }
+
+        if(isBlockMode())
+          return updateBlocks(input, len, output, outSize);
+
+        ESAPI_ASSERT2(len <= outSize, "Output buffer is too small");
+        if(!(len <= outSize))
+          throw IllegalArgumentException("Output buffer is too small");
+
+        if(len)
+          m_cipher->ProcessData(output, input, len);
+
+        return len;
+      }
+    catch(const SafeIntException&)
+      {
+        throw IllegalArgumentException("Input length is not valid");
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        restart();
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+  }
+
+  // Processes whole blocks into the output and keeps the remainder in m_partial. A
+  // padded decryption keeps the last whole block back for doFinal to unpad.
+  size_t CipherImpl::updateBlocks(const byte* input, size_t len, byte* output, size_t outSize)
+  {
+    const size_t bs = m_blockSize;
+    const size_t total = SafeInt<size_t>(m_count) + len;
+
+    size_t keep = total % bs;
+    if(keep == 0 && total != 0 && m_padded && !m_encrypt)
+      keep = bs;
+
+    const size_t produce = total - keep;
+
+    ESAPI_ASSERT2(produce <= outSize, "Output buffer is too small");
+    if(!(produce <= outSize))
+      throw IllegalArgumentException("Output buffer is too small");
+
+    size_t written = 0;
+    if(produce && m_count)
+      {
+        // The first block is part buffered, part input. The output would run
+        // ahead of the unread input if the two are the same memory.
+        if(output < input + len && input < output + produce)
+          throw IllegalArgumentException("Output buffer overlaps the input while a partial block is buffered");
+
+        const size_t fill = bs - m_count;
+        ::memcpy(m_partial.data() + m_count, input, fill);
+        m_cipher->ProcessData(output, m_partial.data(), bs);
+
+        input += fill;
+        len -= fill;
+        written = bs;
+        m_count = 0;
+      }
+
+    // The bulk goes straight from the input to the output
+    const size_t direct = produce - written;
+    if(direct)
+      {
+        m_cipher->ProcessData(output + written, input, direct);
+        input += direct;
+        len -= direct;
+        written += direct;
+      }
+
+    ASSERT(m_count + len == keep);
+    if(len)
+      {
+        ::memcpy(m_partial.data() + m_count, input, len);
+        m_count += len;
+      }
+
+    return written;
+  }
+
+  size_t CipherImpl::doFinal(const byte* input, size_t len, byte* output, size_t outSize)
+  {
+    checkReady();
+
+    size_t written = 0;
+
+    try
+      {
+        if(isAeadMode())
+          {
+            written = m_encrypt ? sealFinal(input, len, output, outSize) : openFinal(input, len, output, outSize);
+          }
+        else if(!isBlockMode())
+          {
+            written = update(input, len, output, outSize);
+          }
+        else
+          {
+            const size_t bs = m_blockSize;
+            const size_t total = SafeInt<size_t>(m_count) + len;
+
+            if(!m_padded && total % bs != 0)
+              {
+                restart();
+                throw EncryptionException("Input length is not a multiple of the block size");
+              }
+
+            if(m_encrypt)
+              {
+                const size_t need = m_padded ? (size_t)(SafeInt<size_t>(total / bs + 1) * bs) : total;
+                ESAPI_ASSERT2(need <= outSize, "Output buffer is too small");
+                if(!(need <= outSize))
+                  throw IllegalArgumentException("Output buffer is too small");
+
+                written = updateBlocks(input, len, output, outSize);
+
+                if(m_padded)
+                  {
+                    // PKCS #5: n bytes of value n complete the final block
+                    const byte pad = (byte)(bs - m_count);
+                    ::memset(m_partial.data() + m_count, pad, pad);
+                    m_cipher->ProcessData(output + written, m_partial.data(), bs);
+                    written += bs;
+                  }
+              }
+            else
+              {
+                if(m_padded && (total == 0 || total % bs != 0))
+                  {
+                    restart();
+                    throw EncryptionException("Input length is not a multiple of the block size");
+                  }
+
+                // At least one byte of padding
+                const size_t need = m_padded ? total - 1 : total;
+                ESAPI_ASSERT2(need <= outSize, "Output buffer is too small");
+                if(!(need <= outSize))
+                  throw IllegalArgumentException("Output buffer is too small");
+
+                written = updateBlocks(input, len, output, outSize);
+
+                if(m_padded)
+                  {
+                    ASSERT(m_count == bs);
+                    CryptoPP::FixedSizeSecBlock<byte, MaxBlockSize> last;
+                    m_cipher->ProcessData(last.data(), m_partial.data(), bs);
+
+                    // Examine every pad byte regardless of the pad value
+                    const size_t pad = last[bs - 1];
+                    byte bad = (byte)(pad == 0 || pad > bs);
+                    for(size_t i = 0; i < bs; i++)
+                      {
+                        const byte mask = (byte)(0 - (byte)(i >= bs - pad));
+                        bad |= (byte)((last[i] ^ pad) & mask);
+                      }
+
+                    if(bad)
+                      {
+                        CryptoPP::SecureWipeBuffer(output, written);
+                        restart();
+                        throw EncryptionException("Decryption failed", "PKCS #5 padding is not valid");
+                      }
+
+                    ::memcpy(output + written, last.data(), bs - pad);
+                    written += bs - pad;
+                  }
+              }
+          }
+      }
+    catch(const SafeIntException&)
+      {
+        throw IllegalArgumentException("Input length is not valid");
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        restart();
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    restart();
+    return written;
+  }
+
+  size_t CipherImpl::sealFinal(const byte* input, size_t len, byte* output, size_t outSize)
+  {
+    ASSERT(m_aead != nullptr);
+
+    const size_t need = SafeInt<size_t>(len) + AeadTagSize;
+    ESAPI_ASSERT2(need <= outSize, "Output buffer is too small");
+    if(!(need <= outSize))
+      throw IllegalArgumentException("Output buffer is too small");
+
+    if(len)
+      m_cipher->ProcessData(output, input, len);
+
+    m_aead->TruncatedFinal(output + len, AeadTagSize);
+
+    return need;
+  }
+
+  size_t CipherImpl::openFinal(const byte* input, size_t len, byte* output, size_t outSize)
+  {
+    ASSERT(m_aead != nullptr);
+
+    const size_t total = SafeInt<size_t>(m_pendingSize) + len;
+    if(total < AeadTagSize)
+      {
+        restart();
+        throw EncryptionException("Decryption failed", "Ciphertext is shorter than the authentication tag");
+      }
+
+    const size_t ptsize = total - AeadTagSize;
+    ESAPI_ASSERT2(ptsize <= outSize, "Output buffer is too small");
+    if(!(ptsize <= outSize))
+      throw IllegalArgumentException("Output buffer is too small");
+
+    // A single-part decryption reads the input in place
+    const byte* data = input;
+    if(m_pendingSize)
+      {
+        update(input, len, nullptr, 0);
+        data = m_pending.data();
+      }
+
+    if(ptsize)
+      m_cipher->ProcessData(output, data, ptsize);
+
+    if(!m_aead->TruncatedVerify(data + ptsize, AeadTagSize))
+      {
+        CryptoPP::SecureWipeBuffer(output, ptsize);
+        restart();
+        throw EncryptionException("Decryption failed", "Authentication tag is not valid");
+      }
+
+    return ptsize;
+  }
+
+  /**
+   * Generates a Cipher object that implements the specified transformation.
+   */
+  Cipher Cipher::getInstance(const NarrowString& algorithm)
+  {
+    ASSERT(!algorithm.empty());
+
+    CipherImpl* impl = new CipherImpl(AlgorithmName(algorithm));
+    MEMORY_BARRIER();
+
+    ASSERT(impl != nullptr);
+    return Cipher(impl);
+  }
+
+  /**
+   * Generates a Cipher object that implements the specified transformation.
+   */
+  Cipher Cipher::getInstance(const WideString& algorithm)
+  {
+    ASSERT(!algorithm.empty());
+    return getInstance(TextConvert::WideToNarrow(algorithm));
+  }
+
+  /**
+   * Creates a cipher with the specified algorithm name.
+   */
+  Cipher::Cipher(const NarrowString& algorithm)
+    : m_lock(new Mutex), m_impl(new CipherImpl(AlgorithmName(algorithm)))
+  {
+    ASSERT(m_lock.get() != nullptr);
+    ASSERT(m_impl.get() != nullptr);
+  }
+
+  /**
+   * Creates a Cipher from an implmentation.
+   */
+  Cipher::Cipher(CipherImpl* impl)
+    : m_lock(new Mutex), m_impl(impl)
+  {
+    ASSERT(m_lock.get() != nullptr);
+    ASSERT(m_impl.get() != nullptr);
+  }
+
+  /**
+   * Copies a cipher. The copy shares the state of the original.
+   */
+  Cipher::Cipher(const Cipher& rhs)
+    : m_lock(rhs.m_lock), m_impl(rhs.m_impl)
+  {
+    ASSERT(m_lock.get() != nullptr);
+    ASSERT(m_impl.get() != nullptr);
+  }
+
+  /**
+   * Assigns a cipher.
+   */
+  Cipher& Cipher::operator=(const Cipher& rhs)
+  {
+    if(this != &rhs)
+      {
+        m_lock = rhs.m_lock;
+        m_impl = rhs.m_impl;
+      }
+
+    ASSERT(m_lock.get() != nullptr);
+    ASSERT(m_impl.get() != nullptr);
+
+    return *this;
+  }
+
+  Mutex& Cipher::getObjectLock() const
+  {
+    ASSERT(m_lock.get());
+    return *m_lock.get();
+  }
+
+  String Cipher::getAlgorithm() const
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->getAlgorithm();
+  }
+
+  SecureByteArray Cipher::getIV() const
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->getIV();
+  }
+
+  size_t Cipher::getOutputSize(size_t inputLen) const
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->getOutputSize(inputLen);
+  }
+
+  void Cipher::init(size_t opmode, const Key& key)
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    m_impl->init((int)opmode, key, nullptr, 0, nullptr);
+  }
+
+  void Cipher::init(int opmode, const Key& key, SecureRandom& random)
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    m_impl->init(opmode, key, nullptr, 0, &random);
+  }
+
+  void Cipher::init(int opmode, const Key& key, const AlgorithmParameterSpec& params)
+  {
+    const IvParameterSpec* spec = dynamic_cast<const IvParameterSpec*>(&params);
+    ESAPI_ASSERT2(spec, "Parameters are not an IvParameterSpec");
+    if(!spec)
+      throw IllegalArgumentException("Parameters are not an IvParameterSpec");
+
+    const SecureByteArray iv = spec->getIV();
+
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    m_impl->init(opmode, key, iv.data(), iv.size(), nullptr);
+  }
+
+  void Cipher::init(int opmode, const Key& key, const AlgorithmParameterSpec& params, SecureRandom& random)
+  {
+    const IvParameterSpec* spec = dynamic_cast<const IvParameterSpec*>(&params);
+    ESAPI_ASSERT2(spec, "Parameters are not an IvParameterSpec");
+    if(!spec)
+      throw IllegalArgumentException("Parameters are not an IvParameterSpec");
+
+    const SecureByteArray iv = spec->getIV();
+
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    m_impl->init(opmode, key, iv.data(), iv.size(), &random);
+  }
+
+  SecureByteArray Cipher::update(const byte input[], size_t size)
+  {
+    return update(input, size, 0, size);
+  }
+
+  SecureByteArray Cipher::update(const SecureByteArray& input)
+  {
+    return update(input.data(), input.size(), 0, input.size());
+  }
+
+  SecureByteArray Cipher::update(const SecureByteArray& input, size_t inputOffset, size_t inputLen)
+  {
+    return update(input.data(), input.size(), inputOffset, inputLen);
+  }
+
+  SecureByteArray Cipher::update(const byte input[], size_t size, size_t inputOffset, size_t inputLen)
+  {
+    checkBuffer(input, size, inputOffset, inputLen);
+
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    SecureByteArray output(m_impl->getOutputSize(inputLen));
+    const size_t written = m_impl->update(input + inputOffset, inputLen, output.data(), output.size());
+    output.resize(written, 0);
+
+    return output;
+  }
+
+  size_t Cipher::update(const byte input[], size_t inSize, size_t inputOffset, size_t inputLen, byte output[], size_t outSize)
+  {
+    return update(input, inSize, inputOffset, inputLen, output, outSize, 0);
+  }
+
+  size_t Cipher::update(const SecureByteArray& input, size_t inputOffset, size_t inputLen, SecureByteArray& output)
+  {
+    return update(input.data(), input.size(), inputOffset, inputLen, output.data(), output.size(), 0);
+  }
+
+  size_t Cipher::update(const SecureByteArray& input, size_t inputOffset, size_t inputLen, SecureByteArray& output, size_t outputOffset)
+  {
+    return update(input.data(), input.size(), inputOffset, inputLen, output.data(), output.size(), outputOffset);
+  }
+
+  size_t Cipher::update(const byte input[], size_t inSize, size_t inputOffset, size_t inputLen, byte output[], size_t outSize, size_t outputOffset)
+  {
+    checkBuffer(input, inSize, inputOffset, inputLen);
+    checkBuffer(output, outSize, outputOffset, 0);
+
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->update(input + inputOffset, inputLen, output + outputOffset, outSize - outputOffset);
+  }
+
+  SecureByteArray Cipher::doFinal()
+  {
+    return doFinal(nullptr, 0, 0, 0);
+  }
+
+  SecureByteArray Cipher::doFinal(const byte input[], size_t size)
+  {
+    return doFinal(input, size, 0, size);
+  }
+
+  SecureByteArray Cipher::doFinal(const SecureByteArray& input)
+  {
+    return doFinal(input.data(), input.size(), 0, input.size());
+  }
+
+  SecureByteArray Cipher::doFinal(const SecureByteArray& input, size_t inputOffset, size_t inputLen)
+  {
+    return doFinal(input.data(), input.size(), inputOffset, inputLen);
+  }
+
+  SecureByteArray Cipher::doFinal(const byte input[], size_t size, size_t inputOffset, size_t inputLen)
+  {
+    checkBuffer(input, size, inputOffset, inputLen);
+
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    SecureByteArray output(m_impl->getOutputSize(inputLen));
+    const size_t written = m_impl->doFinal(input ? input + inputOffset : nullptr, inputLen, output.data(), output.size());
+    output.resize(written, 0);
+
+    return output;
+  }
+
+  size_t Cipher::doFinal(byte output[], size_t size, size_t outputOffset)
+  {
+    checkBuffer(output, size, outputOffset, 0);
+    return doFinal(nullptr, 0, 0, 0, output + outputOffset, size - outputOffset);
+  }
+
+  size_t Cipher::doFinal(SecureByteArray& output, size_t outputOffset)
+  {
+    checkBuffer(output.data(), output.size(), outputOffset, 0);
+    return doFinal(nullptr, 0, 0, 0, output.data() + outputOffset, output.size() - outputOffset);
+  }
+
+  size_t Cipher::doFinal(const SecureByteArray& input, size_t inputOffset, size_t inputLen, SecureByteArray& output)
+  {
+    return doFinal(input.data(), input.size(), inputOffset, inputLen, output.data(), output.size());
+  }
+
+  size_t Cipher::doFinal(const byte input[], size_t inSize, size_t inputOffset, size_t inputLen, byte output[], size_t outSize)
+  {
+    checkBuffer(input, inSize, inputOffset, inputLen);
+    checkBuffer(output, outSize, 0, 0);
+
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->doFinal(input ? input + inputOffset : nullptr, inputLen, output, outSize);
+  }
+
+  /**
+   * Validates a caller's buffer and the span [offset, offset + len) within it. An
+   * empty span may have a null buffer.
+   */
+  static void checkBuffer(const byte* buffer, size_t size, size_t offset, size_t len)
+  {
+    ESAPI_ASSERT2(buffer || !size, "Buffer is not valid");
+    if(!buffer && size)
+      throw IllegalArgumentException("Buffer is not valid");
+
+    ESAPI_ASSERT2(offset <= size && len <= size - offset, "Offset and length exceed the buffer size");
+    if(!(offset <= size && len <= size - offset))
+      throw IllegalArgumentException("Offset and length exceed the buffer size");
+  }
+
+} // NAMESPACE esapi
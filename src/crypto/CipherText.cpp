@@ -14,17 +14,58 @@
 
 #include "EsapiCommon.h"
 #include "crypto/CipherText.h"
+#include "crypto/KeyDerivationFunction.h"
 
 #include "safeint/SafeInt3.hpp"
 
+#include <ctime>
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
 
+#include <string.h>
+
 namespace esapi
 {
+  // Fixed fields of the serialization: KDF info, timestamp, the four short lengths
+  // and sizes, and the ciphertext length.
+  static const size_t SerializedFixedSize = 4 + 8 + 2 + 2 + 2 + 2 + 4 + 2;
+
+  // Largest KDF version accepted when parsing (the Java check is the same)
+  static const unsigned int MaxKDFVersion = 99991231;
+
+  // Java writes shorts and ints, which are signed
+  static const size_t MaxShortField = 0x7fff;
+  static const size_t MaxIntField = 0x7fffffff;
+
+  static const unsigned int DefaultKDFInfo =
+    ((unsigned int)KeyDerivationFunction::HmacSHA1 << 28) | KeyDerivationFunction::kdfVersion;
+
+  // Private to this module
+  static byte* PutBE(byte* p, unsigned long long v, size_t n);
+  static unsigned long long GetBE(const byte* p, size_t n);
+
   CipherText::CipherText()
-    : m_text()
+    : m_spec(), m_raw(), m_mac(), m_timestamp(0), m_kdfInfo(DefaultKDFInfo)
+  {
+  }
+
+  CipherText::CipherText(const CipherSpec& cipherSpec)
+    : m_spec(cipherSpec), m_raw(), m_mac(), m_timestamp(0), m_kdfInfo(DefaultKDFInfo)
+  {
+  }
+
+  CipherText::CipherText(const CipherSpec& cipherSpec, const SecureByteArray& cipherText)
+    : m_spec(cipherSpec), m_raw(cipherText), m_mac(), m_timestamp(0), m_kdfInfo(DefaultKDFInfo)
+  {
+    setEncryptionTimestamp();
+  }
+
+  // SecureArray copies are deep, so encrypting into one CipherText does not
+  // disturb its copies.
+  CipherText::CipherText(const CipherText& rhs)
+    : m_spec(rhs.m_spec), m_raw(rhs.m_raw), m_mac(rhs.m_mac),
+      m_timestamp(rhs.m_timestamp), m_kdfInfo(rhs.m_kdfInfo)
   {
   }
 
@@ -32,14 +73,299 @@ namespace esapi
   {
   }
 
+  CipherText& CipherText::operator=(const CipherText& rhs)
+  {
+    if(this != &rhs)
+      {
+        m_spec = rhs.m_spec;
+        m_raw = rhs.m_raw;
+        m_mac = rhs.m_mac;
+        m_timestamp = rhs.m_timestamp;
+        m_kdfInfo = rhs.m_kdfInfo;
+      }
+
+    return *this;
+  }
+
   bool CipherText::empty() const
   {
-    return m_text.empty();
+    return m_raw.empty();
+  }
+
+  CipherSpec CipherText::getCipherSpec() const
+  {
+    return m_spec;
+  }
+
+  String CipherText::getCipherTransformation() const
+  {
+    return m_spec.getCipherTransformation();
+  }
+
+  String CipherText::getCipherAlgorithm() const
+  {
+    return m_spec.getCipherAlgorithm();
+  }
+
+  unsigned int CipherText::getKeySize() const
+  {
+    return m_spec.getKeySize();
+  }
+
+  unsigned int CipherText::getBlockSize() const
+  {
+    return m_spec.getBlockSize();
   }
 
   String CipherText::getCipherMode() const
   {
-    return "CBC";
+    return m_spec.getCipherMode();
+  }
+
+  String CipherText::getPaddingScheme() const
+  {
+    return m_spec.getPaddingScheme();
+  }
+
+  SecureByteArray CipherText::getIV() const
+  {
+    return m_spec.getIV();
+  }
+
+  bool CipherText::requiresIV() const
+  {
+    return m_spec.requiresIV();
+  }
+
+  SecureByteArray CipherText::getRawCipherText() const
+  {
+    return m_raw;
+  }
+
+  size_t CipherText::getRawCipherTextByteLength() const
+  {
+    return m_raw.size();
+  }
+
+  void CipherText::setCiphertext(const SecureByteArray& cipherText)
+  {
+    m_raw = cipherText;
+    setEncryptionTimestamp();
+  }
+
+  // Milliseconds since the epoch, as Java's System.currentTimeMillis(). Second
+  // resolution is all that is needed.
+  void CipherText::setEncryptionTimestamp()
+  {
+    m_timestamp = (long long)std::time(nullptr) * 1000LL;
+  }
+
+  long long CipherText::getEncryptionTimestamp() const
+  {
+    return m_timestamp;
+  }
+
+  unsigned int CipherText::getKDFVersion() const
+  {
+    return m_kdfInfo & 0x07ffffff;
   }
-}
 
+  unsigned int CipherText::getKDF_PRF() const
+  {
+    return m_kdfInfo >> 28;
+  }
+
+  SecureByteArray CipherText::getSeparateMAC() const
+  {
+    return m_mac;
+  }
+
+  void CipherText::storeSeparateMAC(const SecureByteArray& mac)
+  {
+    m_mac = mac;
+  }
+
+  size_t CipherText::getSerializedSize() const
+  {
+    try
+      {
+        SafeInt<size_t> size(SerializedFixedSize);
+        size += m_spec.getCipherTransformation().size();
+        size += m_spec.getIV().size();
+        size += m_raw.size();
+        size += m_mac.size();
+
+        return size;
+      }
+    catch(const SafeIntException&)
+      {
+        throw EncryptionException("Integer overflow detected");
+      }
+  }
+
+  size_t CipherText::serialize(byte output[], size_t size) const
+  {
+    const NarrowString xform = m_spec.getCipherTransformation();
+    const SecureByteArray iv = m_spec.getIV();
+
+    // The Java layout has short and int length fields
+    if(xform.empty() || xform.size() > MaxShortField || iv.size() > MaxShortField ||
+       m_raw.size() > MaxIntField || m_mac.size() > MaxShortField ||
+       m_spec.getKeySize() > MaxShortField || m_spec.getBlockSize() > MaxShortField)
+      throw EncryptionException("Serialization failed", "CipherText field exceeds the serialization limits");
+
+    const size_t need = getSerializedSize();
+    ESAPI_ASSERT2(output, "Output buffer is not valid");
+    ESAPI_ASSERT2(need <= size, "Output buffer is too small");
+    if(!output || !(need <= size))
+      throw IllegalArgumentException("Output buffer is too small");
+
+    byte* p = output;
+    p = PutBE(p, m_kdfInfo, 4);
+    p = PutBE(p, (unsigned long long)m_timestamp, 8);
+
+    p = PutBE(p, xform.size(), 2);
+    ::memcpy(p, xform.data(), xform.size());
+    p += xform.size();
+
+    p = PutBE(p, m_spec.getKeySize(), 2);
+    p = PutBE(p, m_spec.getBlockSize(), 2);
+
+    p = PutBE(p, iv.size(), 2);
+    if(iv.size())
+      ::memcpy(p, iv.data(), iv.size());
+    p += iv.size();
+
+    p = PutBE(p, m_raw.size(), 4);
+    if(m_raw.size())
+      ::memcpy(p, m_raw.data(), m_raw.size());
+    p += m_raw.size();
+
+    p = PutBE(p, m_mac.size(), 2);
+    if(m_mac.size())
+      ::memcpy(p, m_mac.data(), m_mac.size());
+    p += m_mac.size();
+
+    ASSERT((size_t)(p - output) == need);
+    return need;
+  }
+
+  SecureByteArray CipherText::asPortableSerializedByteArray() const
+  {
+    SecureByteArray bytes(getSerializedSize());
+    serialize(bytes.data(), bytes.size());
+
+    return bytes;
+  }
+
+  CipherText CipherText::fromPortableSerializedBytes(const byte bytes[], size_t size)
+  {
+    return CipherTextView(bytes, size).toCipherText();
+  }
+
+  CipherTextView::CipherTextView(const byte bytes[], size_t size)
+    : m_kdfInfo(0), m_timestamp(0), m_xform(nullptr), m_xformLen(0), m_keySize(0), m_blockSize(0),
+      m_iv(nullptr), m_ivLen(0), m_raw(nullptr), m_rawLen(0), m_mac(nullptr), m_macLen(0), m_size(0)
+  {
+    ESAPI_ASSERT2(bytes, "Serialized CipherText is not valid");
+    if(!bytes || size < SerializedFixedSize)
+      throw EncryptionException("Decryption failed", "Serialized CipherText is truncated");
+
+    const byte* p = bytes;
+    size_t left = size;
+
+    m_kdfInfo = (unsigned int)GetBE(p, 4);
+    m_timestamp = (long long)GetBE(p + 4, 8);
+    p += 12; left -= 12;
+
+    const unsigned int version = getKDFVersion();
+    if(version < KeyDerivationFunction::kdfVersion || version > MaxKDFVersion)
+      throw EncryptionException("Decryption failed", "Serialized CipherText has an unknown KDF version");
+
+    if(getKDF_PRF() > KeyDerivationFunction::HmacSHA512)
+      throw EncryptionException("Decryption failed", "Serialized CipherText has an unknown KDF PRF");
+
+    // Every variable length field is checked against what is left, so a hostile
+    // length cannot walk off the end of the buffer.
+    m_xformLen = (size_t)GetBE(p, 2);
+    p += 2; left -= 2;
+    if(m_xformLen == 0 || m_xformLen > MaxShortField || m_xformLen > left)
+      throw EncryptionException("Decryption failed", "Serialized CipherText transformation is not valid");
+    m_xform = reinterpret_cast<const char*>(p);
+    p += m_xformLen; left -= m_xformLen;
+
+    if(std::count(m_xform, m_xform + m_xformLen, '/') != 2)
+      throw EncryptionException("Decryption failed", "Serialized CipherText transformation is not valid");
+
+    if(left < 6)
+      throw EncryptionException("Decryption failed", "Serialized CipherText is truncated");
+    m_keySize = (unsigned int)GetBE(p, 2);
+    m_blockSize = (unsigned int)GetBE(p + 2, 2);
+    m_ivLen = (size_t)GetBE(p + 4, 2);
+    p += 6; left -= 6;
+
+    if(m_keySize == 0 || m_keySize > MaxShortField || m_blockSize == 0 || m_blockSize > MaxShortField)
+      throw EncryptionException("Decryption failed", "Serialized CipherText key or block size is not valid");
+
+    if(m_ivLen > MaxShortField || m_ivLen > left)
+      throw EncryptionException("Decryption failed", "Serialized CipherText IV is not valid");
+    m_iv = m_ivLen ? p : nullptr;
+    p += m_ivLen; left -= m_ivLen;
+
+    if(left < 4)
+      throw EncryptionException("Decryption failed", "Serialized CipherText is truncated");
+    m_rawLen = (size_t)GetBE(p, 4);
+    p += 4; left -= 4;
+    if(m_rawLen == 0 || m_rawLen > MaxIntField || m_rawLen > left)
+      throw EncryptionException("Decryption failed", "Serialized CipherText ciphertext is not valid");
+    m_raw = p;
+    p += m_rawLen; left -= m_rawLen;
+
+    if(left < 2)
+      throw EncryptionException("Decryption failed", "Serialized CipherText is truncated");
+    m_macLen = (size_t)GetBE(p, 2);
+    p += 2; left -= 2;
+    if(m_macLen > MaxShortField || m_macLen > left)
+      throw EncryptionException("Decryption failed", "Serialized CipherText MAC is not valid");
+    m_mac = m_macLen ? p : nullptr;
+    p += m_macLen; left -= m_macLen;
+
+    m_size = size - left;
+  }
+
+  String CipherTextView::getCipherTransformation() const
+  {
+    return String(m_xform, m_xformLen);
+  }
+
+  CipherText CipherTextView::toCipherText() const
+  {
+    CipherText cipherText(m_ivLen ?
+      CipherSpec(getCipherTransformation(), m_keySize, m_blockSize, SecureByteArray(m_iv, m_ivLen)) :
+      CipherSpec(getCipherTransformation(), m_keySize, m_blockSize));
+    cipherText.m_raw = SecureByteArray(m_raw, m_rawLen);
+    if(m_macLen)
+      cipherText.m_mac = SecureByteArray(m_mac, m_macLen);
+    cipherText.m_timestamp = m_timestamp;
+    cipherText.m_kdfInfo = m_kdfInfo;
+
+    return cipherText;
+  }
+
+  static byte* PutBE(byte* p, unsigned long long v, size_t n)
+  {
+    for(size_t i = 0; i < n; i++)
+      p[i] = (byte)(v >> (8 * (n - 1 - i)));
+
+    return p + n;
+  }
+
+  static unsigned long long GetBE(const byte* p, size_t n)
+  {
+    unsigned long long v = 0;
+    for(size_t i = 0; i < n; i++)
+      v = (v << 8) | p[i];
+
+    return v;
+  }
+}
@@ -16,13 +16,13 @@
 #include "crypto/SecretKey.h"
 #include "crypto/KeyGenerator.h"
 #include "crypto/CryptoHelper.h"
+#include "crypto/CryptoPolicy.h"
 #include "crypto/CryptoppCommon.h"
+#include "crypto/EncryptThenMac.h"
 #include "crypto/KeyDerivationFunction.h"
 #include "errors/EncryptionException.h"
 #include "errors/IllegalArgumentException.h"
 
-#include "DummyConfiguration.h"
-
 #include "safeint/SafeInt3.hpp"
 
 /**
@@ -121,11 +121,8 @@ namespace esapi
     if(cipherMode.empty())
       throw IllegalArgumentException("Cipher mode is not valid");
         
-    DummyConfiguration config;
-    const StringList& cipherModes = config.getCombinedCipherModes();
-    
-    StringList::const_iterator it = std::find(cipherModes.begin(), cipherModes.end(), cipherMode);
-    return it != cipherModes.end();
+    // Pre-parsed into a bitmask when the policy was built
+    return CryptoPolicy::getInstance()->isCombinedCipherMode(cipherMode);
   }
 
   /**
@@ -146,15 +143,8 @@ namespace esapi
     if(cipherMode.empty())
       throw IllegalArgumentException("Cipher mode is not valid");
 
-    if ( isCombinedCipherMode(cipherMode) ) { 
-      return true; 
-    } 
-
-    DummyConfiguration config;
-    const StringList& extraModes = config.getAdditionalAllowedCipherModes();
-        
-    StringList::const_iterator it = std::find(extraModes.begin(), extraModes.end(), cipherMode);
-    return it != extraModes.end(); 
+    // The policy's allowed modes include the combined modes
+    return CryptoPolicy::getInstance()->isAllowedCipherMode(cipherMode);
   }
 
   /**
@@ -179,8 +169,12 @@ namespace esapi
   {
     ASSERT(!cipherText.empty());
 
-    ASSERT(0);
-    return false;
+    const shared_ptr<const CryptoPolicy> policy = CryptoPolicy::getInstance();
+    const bool preferredCipherMode = policy->isCombinedCipherMode( cipherText.getCipherMode() );
+    const bool wantsMAC = policy->useMACforCipherText();
+
+    // The MAC is required for authenticity only if the cipher mode does not provide it
+    return ( !preferredCipherMode && wantsMAC );
   }
 
   /**
@@ -204,8 +198,20 @@ namespace esapi
     ASSERT(secretKey.getEncoded().length() > 0);
     ASSERT(!cipherText.empty());
 
-    ASSERT(0);
-    return false;
+    if ( !isMACRequired(cipherText) ) {
+      return true;
+    }
+
+    const SecureByteArray mac = cipherText.getSeparateMAC();
+    if ( mac.empty() ) {
+      return false;
+    }
+
+    const SecureByteArray iv = cipherText.getIV();
+    const SecureByteArray raw = cipherText.getRawCipherText();
+
+    // The authenticity key is derived from secretKey (and cached) by EncryptThenMac
+    return EncryptThenMac(secretKey).verifyMAC(iv.data(), iv.size(), raw.data(), raw.size(), mac.data(), mac.size());
   }
 
   /**
@@ -373,11 +379,20 @@ namespace esapi
     
     // Make sure to go through ALL the bytes. We use the fact that if
     // you XOR any bit stream with itself the result will be all 0 bits,
-    // which in turn yields 0 for the result.
-    int result = 0;
-    for(size_t i = 0; i < s2; i++) {
+    // which in turn yields 0 for the result. The bulk of the array is
+    // XORed a word at a time (memcpy avoids unaligned loads), which the
+    // compiler is free to vectorize since there is no early out.
+    unsigned long long result = 0;
+    size_t i = 0;
+    for( ; i + sizeof(result) <= s2; i += sizeof(result)) {
+      unsigned long long w1, w2;
+      memcpy(&w1, b1 + i, sizeof(w1));
+      memcpy(&w2, b2 + i, sizeof(w2));
+      result |= (w1 ^ w2);
+    }
+    for( ; i < s2; i++) {
       // XOR the 2 current bytes and then OR with the outstanding result.
-      result |= (b1[i] ^ b2[i]);
+      result |= (unsigned long long)(b1[i] ^ b2[i]);
     }
     return (result == 0) ? true : false;
   }
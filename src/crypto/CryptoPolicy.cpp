@@ -0,0 +1,155 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/Mutex.h"
+#include "crypto/CryptoPolicy.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
+#include "errors/NoSuchAlgorithmException.h"
+
+#include "DummyConfiguration.h"
+
+#include <algorithm>
+
+namespace esapi
+{
+  // Private to this module
+  static Mutex& GetPolicyLock();
+  static shared_ptr<const CryptoPolicy>& GetPolicy();
+  static AlgorithmName ParseTransformation(SecurityConfiguration& config);
+  static void ParseModes(const StringList& names, unsigned int& bits, StringList& others);
+
+  // Mode names as written in the configuration, and their identifiers
+  static const struct { const char* name; AlgorithmName::ModeId id; } g_modes[] = {
+    { "NONE", AlgorithmName::ModeNONE }, { "ECB", AlgorithmName::ModeECB }, { "CBC", AlgorithmName::ModeCBC },
+    { "OFB", AlgorithmName::ModeOFB }, { "CFB", AlgorithmName::ModeCFB }, { "CTR", AlgorithmName::ModeCTR },
+    { "CCM", AlgorithmName::ModeCCM }, { "EAX", AlgorithmName::ModeEAX }, { "GCM", AlgorithmName::ModeGCM }
+  };
+
+  shared_ptr<const CryptoPolicy> CryptoPolicy::getInstance()
+  {
+    MutexLock lock(GetPolicyLock());
+
+    shared_ptr<const CryptoPolicy>& policy = GetPolicy();
+    if(!policy.get())
+      {
+        DummyConfiguration config;
+        policy.reset(new CryptoPolicy(config));
+      }
+
+    return policy;
+  }
+
+  void CryptoPolicy::setInstance(const shared_ptr<const CryptoPolicy>& policy)
+  {
+    ESAPI_ASSERT2(policy.get(), "Policy is not valid");
+    if(!policy.get())
+      throw IllegalArgumentException("Policy is not valid");
+
+    MutexLock lock(GetPolicyLock());
+    GetPolicy() = policy;
+  }
+
+  shared_ptr<const CryptoPolicy> CryptoPolicy::reload(SecurityConfiguration& config)
+  {
+    // Built outside the lock; only the swap is guarded
+    shared_ptr<const CryptoPolicy> policy(new CryptoPolicy(config));
+    setInstance(policy);
+
+    return policy;
+  }
+
+  CryptoPolicy::CryptoPolicy(SecurityConfiguration& config)
+    : m_xform(ParseTransformation(config)), m_useMac(config.useMACforCipherText()),
+      m_combined(0), m_allowed(0), m_otherCombined(), m_otherAllowed(),
+      m_masterKey("Unknown", config.getMasterKey()), m_masterSalt(config.getMasterSalt())
+  {
+    ParseModes(config.getCombinedCipherModes(), m_combined, m_otherCombined);
+    ParseModes(config.getAdditionalAllowedCipherModes(), m_allowed, m_otherAllowed);
+
+    // Combined modes are always allowed
+    m_allowed |= m_combined;
+    m_otherAllowed.insert(m_otherAllowed.end(), m_otherCombined.begin(), m_otherCombined.end());
+  }
+
+  bool CryptoPolicy::isCombinedCipherMode(const NarrowString& mode) const
+  {
+    for(size_t i = 0; i < COUNTOF(g_modes); i++)
+      {
+        if(mode == g_modes[i].name)
+          return isCombinedCipherMode(g_modes[i].id);
+      }
+
+    return std::find(m_otherCombined.begin(), m_otherCombined.end(), mode) != m_otherCombined.end();
+  }
+
+  bool CryptoPolicy::isAllowedCipherMode(const NarrowString& mode) const
+  {
+    for(size_t i = 0; i < COUNTOF(g_modes); i++)
+      {
+        if(mode == g_modes[i].name)
+          return isAllowedCipherMode(g_modes[i].id);
+      }
+
+    return std::find(m_otherAllowed.begin(), m_otherAllowed.end(), mode) != m_otherAllowed.end();
+  }
+
+  static AlgorithmName ParseTransformation(SecurityConfiguration& config)
+  {
+    const NarrowString xform = config.getCipherTransformation();
+
+    try
+      {
+        return AlgorithmName(xform);
+      }
+    catch(const NoSuchAlgorithmException&)
+      {
+        throw EncryptionException("Malformed cipher transformation: " + xform);
+      }
+  }
+
+  static void ParseModes(const StringList& names, unsigned int& bits, StringList& others)
+  {
+    for(StringList::const_iterator it = names.begin(); it != names.end(); ++it)
+      {
+        bool known = false;
+        for(size_t i = 0; i < COUNTOF(g_modes); i++)
+          {
+            if(*it == g_modes[i].name)
+              {
+                bits |= 1u << (unsigned int)g_modes[i].id;
+                known = true;
+                break;
+              }
+          }
+
+        if(!known)
+          others.push_back(*it);
+      }
+  }
+
+  static Mutex& GetPolicyLock()
+  {
+    static Mutex s_lock;
+    return s_lock;
+  }
+
+  static shared_ptr<const CryptoPolicy>& GetPolicy()
+  {
+    static shared_ptr<const CryptoPolicy> s_policy;
+    return s_policy;
+  }
+
+} // NAMESPACE esapi
@@ -0,0 +1,316 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/Mutex.h"
+#include "util/NotCopyable.h"
+#include "crypto/Cipher.h"
+#include "crypto/SecretKey.h"
+#include "crypto/CryptoHelper.h"
+#include "crypto/EncryptThenMac.h"
+#include "crypto/CryptoppCommon.h"
+#include "crypto/KeyDerivationFunction.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
+
+#include <list>
+
+namespace esapi
+{
+  typedef CryptoPP::HMAC<CryptoPP::SHA1> HmacSha1;
+
+  // Number of keys whose keyed HMAC is kept
+  static const size_t MacCacheSize = 16;
+
+  typedef CryptoPP::FixedSizeSecBlock<byte, KeyDerivationFunction::FingerprintSize> Fingerprint;
+
+  /**
+   * The HMAC keyed with the authenticity key derived from a key derivation key. The
+   * entry is filed under the KDK's fingerprint (see KeyDerivationFunction::
+   * fingerprintKey), so the cache never holds the KDK itself. Both are wiped when
+   * the entry is dropped.
+   */
+  struct MacCacheEntry : private NotCopyable
+  {
+    Fingerprint fp;
+    HmacSha1 hmac;
+  };
+
+  typedef std::list< shared_ptr<MacCacheEntry> > MacCache;
+
+  // Private to this module
+  static Mutex& GetMacCacheLock();
+  static MacCache& GetMacCache();
+
+  /**
+   * A private copy of the keyed HMAC. Copying a keyed HMAC skips both the KDF and
+   * the HMAC key setup.
+   */
+  class EncryptThenMacImpl : private NotCopyable
+  {
+  public:
+    explicit EncryptThenMacImpl(const HmacSha1& keyed)
+      : hmac(keyed)
+    {
+    }
+
+    HmacSha1 hmac;
+  };
+
+  EncryptThenMac::EncryptThenMac(const SecretKey& key)
+    : m_impl()
+  {
+    const byte* kptr = key.BytePtr();
+    const size_t ksize = key.sizeInBytes();
+
+    ESAPI_ASSERT2(kptr && ksize, "Key is not valid");
+    if(!kptr || !ksize)
+      throw EncryptionException("Key is not valid");
+
+    Fingerprint fp;
+    KeyDerivationFunction::fingerprintKey(key, fp.data());
+
+    {
+      MutexLock lock(GetMacCacheLock());
+      MacCache& cache = GetMacCache();
+
+      for(MacCache::iterator it = cache.begin(); it != cache.end(); ++it)
+        {
+          const MacCacheEntry& entry = **it;
+          if(CryptoPP::VerifyBufsEqual(entry.fp.data(), fp.data(), fp.size()))
+            {
+              m_impl.reset(new EncryptThenMacImpl(entry.hmac));
+
+              // Most recently used at the front
+              cache.splice(cache.begin(), cache, it);
+              return;
+            }
+        }
+    }
+
+    // Derive outside the lock. Two threads may race to insert the same key, which
+    // only costs an extra derivation.
+    const SecretKey authKey = KeyDerivationFunction::computeDerivedKey(key, (unsigned int)ksize * 8, "authenticity");
+    const SecureByteArray authBytes = authKey.getEncoded();
+
+    shared_ptr<MacCacheEntry> entry(new MacCacheEntry);
+    try
+      {
+        entry->fp = fp;
+        entry->hmac.SetKey(authBytes.data(), authBytes.size());
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    m_impl.reset(new EncryptThenMacImpl(entry->hmac));
+
+    MutexLock lock(GetMacCacheLock());
+    MacCache& cache = GetMacCache();
+
+    cache.push_front(entry);
+    while(cache.size() > MacCacheSize)
+      cache.pop_back();
+  }
+
+  size_t EncryptThenMac::encrypt(Cipher& cipher, const byte input[], size_t size, byte output[], size_t outSize,
+                                 byte mac[], size_t macSize) const
+  {
+    ASSERT(m_impl.get());
+
+    ESAPI_ASSERT2(input || !size, "Input buffer is not valid");
+    if(!input && size)
+      throw IllegalArgumentException("Input buffer is not valid");
+
+    ESAPI_ASSERT2(mac && macSize >= (size_t)MacSize, "MAC buffer is not valid");
+    if(!mac || macSize < (size_t)MacSize)
+      throw IllegalArgumentException("MAC buffer is not valid");
+
+    HmacSha1& hmac = m_impl->hmac;
+    const SecureByteArray iv = cipher.getIV();
+
+    try
+      {
+        hmac.Restart();
+        if(iv.size())
+          hmac.Update(iv.data(), iv.size());
+
+        // Each chunk is MACed right after the cipher writes it
+        size_t pos = 0, written = 0;
+        while(size - pos > (size_t)ChunkSize)
+          {
+            const size_t n = cipher.update(input, size, pos, ChunkSize, output, outSize, written);
+            hmac.Update(output + written, n);
+
+            written += n;
+            pos += ChunkSize;
+          }
+
+        const size_t n = cipher.doFinal(input, size, pos, size - pos, output ? output + written : nullptr, outSize - written);
+        hmac.Update(output + written, n);
+        written += n;
+
+        hmac.Final(mac);
+        return written;
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        hmac.Restart();
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+  }
+
+  size_t EncryptThenMac::decrypt(Cipher& cipher, const byte input[], size_t size, const byte mac[], size_t macSize,
+                                 byte output[], size_t outSize) const
+  {
+    ASSERT(m_impl.get());
+
+    ESAPI_ASSERT2(input || !size, "Input buffer is not valid");
+    if(!input && size)
+      throw IllegalArgumentException("Input buffer is not valid");
+
+    ESAPI_ASSERT2(output || !outSize, "Output buffer is not valid");
+    ESAPI_ASSERT2(size <= outSize, "Output buffer is too small");
+    if((!output && outSize) || size > outSize)
+      throw IllegalArgumentException("Output buffer is too small");
+
+    HmacSha1& hmac = m_impl->hmac;
+    const SecureByteArray iv = cipher.getIV();
+
+    size_t written = 0;
+    bool valid = false;
+
+    try
+      {
+        hmac.Restart();
+        if(iv.size())
+          hmac.Update(iv.data(), iv.size());
+
+        // Each chunk is MACed right before the cipher reads it
+        size_t pos = 0;
+        while(size - pos > (size_t)ChunkSize)
+          {
+            hmac.Update(input + pos, ChunkSize);
+            written += cipher.update(input, size, pos, ChunkSize, output, outSize, written);
+            pos += ChunkSize;
+          }
+
+        hmac.Update(input + pos, size - pos);
+
+        CryptoPP::FixedSizeSecBlock<byte, MacSize> computed;
+        hmac.Final(computed.data());
+        valid = (macSize == (size_t)MacSize) && CryptoHelper::arrayCompare(computed.data(), MacSize, mac, macSize);
+
+        // Finish the cipher whatever the MAC said, so a padding failure can never be
+        // told apart from a MAC failure.
+        try
+          {
+            written += cipher.doFinal(input, size, pos, size - pos, output ? output + written : nullptr, outSize - written);
+          }
+        catch(const EncryptionException&)
+          {
+            valid = false;
+          }
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        hmac.Restart();
+        CryptoPP::SecureWipeBuffer(output, written);
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    if(!valid)
+      {
+        CryptoPP::SecureWipeBuffer(output, outSize);
+        throw EncryptionException("Decryption failed", "Ciphertext failed authentication");
+      }
+
+    return written;
+  }
+
+  SecureByteArray EncryptThenMac::computeMAC(const byte iv[], size_t ivSize, const byte input[], size_t size) const
+  {
+    ASSERT(m_impl.get());
+
+    ESAPI_ASSERT2((iv || !ivSize) && (input || !size), "Buffer is not valid");
+    if((!iv && ivSize) || (!input && size))
+      throw IllegalArgumentException("Buffer is not valid");
+
+    SecureByteArray mac(MacSize);
+    HmacSha1& hmac = m_impl->hmac;
+
+    try
+      {
+        hmac.Restart();
+        if(ivSize)
+          hmac.Update(iv, ivSize);
+        if(size)
+          hmac.Update(input, size);
+        hmac.Final(mac.data());
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        hmac.Restart();
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    return mac;
+  }
+
+  bool EncryptThenMac::verifyMAC(const byte iv[], size_t ivSize, const byte input[], size_t size,
+                                 const byte mac[], size_t macSize) const
+  {
+    const SecureByteArray computed = computeMAC(iv, ivSize, input, size);
+    return CryptoHelper::arrayCompare(computed.data(), computed.size(), mac, macSize);
+  }
+
+  void EncryptThenMac::clearCache()
+  {
+    MutexLock lock(GetMacCacheLock());
+
+    // The SecBlocks in each entry wipe themselves
+    GetMacCache().clear();
+  }
+
+  void EncryptThenMac::invalidate(const SecretKey& key)
+  {
+    Fingerprint fp;
+    KeyDerivationFunction::fingerprintKey(key, fp.data());
+
+    MutexLock lock(GetMacCacheLock());
+    MacCache& cache = GetMacCache();
+
+    for(MacCache::iterator it = cache.begin(); it != cache.end(); )
+      {
+        if(CryptoPP::VerifyBufsEqual((*it)->fp.data(), fp.data(), fp.size()))
+          it = cache.erase(it);
+        else
+          ++it;
+      }
+  }
+
+  static Mutex& GetMacCacheLock()
+  {
+    static Mutex s_lock;
+    return s_lock;
+  }
+
+  static MacCache& GetMacCache()
+  {
+    static MacCache s_cache;
+    return s_cache;
+  }
+
+} // NAMESPACE esapi
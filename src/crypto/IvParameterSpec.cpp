@@ -22,8 +22,9 @@ namespace esapi
    * Creates an IvParameterSpec object using the bytes in iv as the IV.
    */
   IvParameterSpec::IvParameterSpec(const byte iv[], size_t size)
-    : m_iv(create_secure_array(iv, size, 0, size))
+    : m_iv()
   {
+    assign_iv(iv, size, 0, size);
     ASSERT(m_iv.data());
     ASSERT(m_iv.size());
   }
@@ -32,8 +33,9 @@ namespace esapi
    * Creates an IvParameterSpec object using the bytes in iv as the IV.
    */
   IvParameterSpec::IvParameterSpec(const SecureByteArray& iv)
-    : m_iv(create_secure_array(iv.data(), iv.size(), 0, iv.size()))
+    : m_iv()
   {
+    assign_iv(iv.data(), iv.size(), 0, iv.size());
     ASSERT(m_iv.data());
     ASSERT(m_iv.size());
   }
@@ -43,8 +45,9 @@ namespace esapi
    * beginning at offset inclusive, as the IV.
    */
   IvParameterSpec::IvParameterSpec(const byte iv[], size_t size, size_t offset, size_t len)
-    : m_iv(create_secure_array(iv, size, offset, len))
+    : m_iv()
   {
+    assign_iv(iv, size, offset, len);
     ASSERT(m_iv.data());
     ASSERT(m_iv.size());
   }
@@ -54,16 +57,17 @@ namespace esapi
    * beginning at offset inclusive, as the IV.
    */
   IvParameterSpec::IvParameterSpec(const SecureByteArray& iv, size_t offset, size_t len)
-    : m_iv(create_secure_array(iv.data(), iv.size(), offset, len))
+    : m_iv()
   {
+    assign_iv(iv.data(), iv.size(), offset, len);
     ASSERT(m_iv.data());
     ASSERT(m_iv.size());
   }
 
   /**
-   * Private helper to create the SecureByteArray.
+   * Private helper to validate the IV and copy it into m_iv.
    */
-  SecureByteArray IvParameterSpec::create_secure_array(const byte iv[], size_t size, size_t offset, size_t len)
+  void IvParameterSpec::assign_iv(const byte iv[], size_t size, size_t offset, size_t len)
   {
     ESAPI_ASSERT2(iv, "Iv is not valid");
     ESAPI_ASSERT2(size, "Iv size is 0");
@@ -90,7 +94,7 @@ namespace esapi
         const byte* ptr = iv;
         ptr += si;
 
-        return SecureByteArray(&(iv[offset]), len);
+        m_iv.assign(&(iv[offset]), len);
       }
     catch(const SafeIntException&)
       {
@@ -15,15 +15,28 @@
 #include "EsapiCommon.h"
 #include "crypto/KeyDerivationFunction.h"
 #include "crypto/SecretKey.h"
+#include "crypto/SecureRandom.h"
+#include "crypto/EncryptThenMac.h"
+#include "crypto/CryptoppCommon.h"
+#include "util/Mutex.h"
+#include "util/NotCopyable.h"
+#include "util/ParallelJob.h"
 #include "util/SecureArray.h"
 #include "util/TextConvert.h"
+#include "errors/EncryptionException.h"
+#include "errors/IllegalArgumentException.h"
 
 #include "safeint/SafeInt3.hpp"
 
 #include <sstream>
+#include <vector>
 #include <algorithm>
 #include <stdexcept>
 
+#if defined(ESAPI_OS_STARNIX)
+# include <sys/mman.h>
+#endif
+
 /**
  * This class implements a Key Derivation Function (KDF) and supporting methods.
  * A KDF is a function with which an input key (called the Key Derivation Key,
@@ -44,32 +57,472 @@
 
 namespace esapi
 {
-  // Keep behavior consistent with the existing Java implementation
-  // http://code.google.com/p/owasp-esapi-java/source/browse/trunk/src/main/java/org/owasp/esapi/crypto/KeyDerivationFunction.java
-  SecretKey KeyDerivationFunction::computeDerivedKey(const SecretKey& keyDerivationKey, unsigned int keySize, const NarrowString& purpose)
+  // RFC 5869: L <= 255 * HashLen
+  static const unsigned int HkdfMaxBlocks = 255;
+
+  /**
+   * A bounded cache of derived keys. The key material lives in one fixed arena
+   * which is locked into memory (best effort) and wiped on eviction, invalidation
+   * and destruction. The KDK itself is not stored: entries are found by an HMAC of
+   * the KDK under a random per-process key, so the fingerprints say nothing useful
+   * about the KDK outside this process.
+   *
+   * The cache is split into shards by the first byte of the fingerprint, each with
+   * its own lock and LRU, so threads deriving from different KDKs rarely contend.
+   * The fingerprint key is set in the constructor and only read afterwards, so
+   * fingerprint() takes no lock at all.
+   */
+  class DerivedKeyCache : private NotCopyable
   {
-    // We would choose a larger minimum key size, but we want to be
-    // able to accept DES for legacy encryption needs.
-    ASSERT( keyDerivationKey.getEncoded().length() > 0 );
-    ASSERT( keySize >= 56 );
-    ASSERT( (keySize % 8) == 0 );
-    ASSERT( !purpose.empty());
-    ASSERT( purpose == "authenticity" || purpose == "encryption" );
+  public:
+    enum { Shards = 4, SlotsPerShard = 8, MaxKeySize = 64, FingerprintSize = KeyDerivationFunction::FingerprintSize };
+
+    static DerivedKeyCache& GetSharedInstance();
+
+    void fingerprint(const byte kdk[], size_t size, byte fp[FingerprintSize]) const;
+
+    bool lookup(const byte fp[FingerprintSize], const NarrowString& purpose, const NarrowString& context,
+                unsigned int keySize, byte key[]);
+
+    void insert(const byte fp[FingerprintSize], const NarrowString& purpose, const NarrowString& context,
+                unsigned int keySize, const byte key[]);
+
+    void invalidate(const byte fp[FingerprintSize]);
+
+    void clear();
+
+  private:
+    struct Entry
+    {
+      byte fingerprint[FingerprintSize];
+      NarrowString purpose;
+      NarrowString context;
+      unsigned int keySize;
+      unsigned long long lastUse;
+      bool valid;
+    };
+
+    struct Shard
+    {
+      // Guards the entries and clock, and the shard's part of the key arena
+      Mutex lock;
+      Entry entries[SlotsPerShard];
+      unsigned long long clock;
+    };
+
+    DerivedKeyCache();
+    ~DerivedKeyCache();
+
+    static size_t ShardOf(const byte fp[FingerprintSize]) { return fp[0] % (size_t)Shards; }
+
+    byte* keyOf(size_t shard, size_t slot) { return m_keys + (shard * SlotsPerShard + slot) * MaxKeySize; }
+
+    Entry* find(Shard& shard, const byte fp[FingerprintSize], const NarrowString& purpose,
+                const NarrowString& context, unsigned int keySize);
+
+    void wipe(size_t shard, size_t slot);
+
+    byte m_keys[Shards * SlotsPerShard * MaxKeySize];
+    Shard m_shards[Shards];
+    CryptoPP::HMAC<CryptoPP::SHA256> m_fingerprint;
+    bool m_locked;
+  };
+
+  DerivedKeyCache& DerivedKeyCache::GetSharedInstance()
+  {
+    static DerivedKeyCache s_cache;
+    return s_cache;
+  }
+
+  DerivedKeyCache::DerivedKeyCache()
+    : m_fingerprint(), m_locked(false)
+  {
+    ::memset(m_keys, 0x00, sizeof(m_keys));
+    for(size_t i = 0; i < (size_t)Shards; i++)
+      {
+        m_shards[i].clock = 0;
+        for(size_t j = 0; j < (size_t)SlotsPerShard; j++)
+          {
+            m_shards[i].entries[j].keySize = 0;
+            m_shards[i].entries[j].lastUse = 0;
+            m_shards[i].entries[j].valid = false;
+          }
+      }
+
+    // Keep the derived keys out of swap. Failure (for example, RLIMIT_MEMLOCK) is
+    // not fatal; the keys are still wiped.
+#if defined(ESAPI_OS_WINDOWS)
+    m_locked = !!::VirtualLock(m_keys, sizeof(m_keys));
+#elif defined(ESAPI_OS_STARNIX)
+    m_locked = (0 == ::mlock(m_keys, sizeof(m_keys)));
+#endif
+
+    CryptoPP::FixedSizeSecBlock<byte, FingerprintSize> salt;
+    SecureRandom::getInstance().nextBytes(salt.data(), salt.size());
+    m_fingerprint.SetKey(salt.data(), salt.size());
+  }
+
+  DerivedKeyCache::~DerivedKeyCache()
+  {
+    clear();
+
+#if defined(ESAPI_OS_WINDOWS)
+    if(m_locked)
+      ::VirtualUnlock(m_keys, sizeof(m_keys));
+#elif defined(ESAPI_OS_STARNIX)
+    if(m_locked)
+      ::munlock(m_keys, sizeof(m_keys));
+#endif
+  }
+
+  // No lock. m_fingerprint is never updated, only copied.
+  void DerivedKeyCache::fingerprint(const byte kdk[], size_t size, byte fp[FingerprintSize]) const
+  {
+    CryptoPP::HMAC<CryptoPP::SHA256> hmac(m_fingerprint);
+    hmac.CalculateDigest(fp, kdk, size);
+  }
+
+  // Caller holds the shard's lock
+  DerivedKeyCache::Entry* DerivedKeyCache::find(Shard& shard, const byte fp[FingerprintSize], const NarrowString& purpose,
+                                                const NarrowString& context, unsigned int keySize)
+  {
+    for(size_t i = 0; i < (size_t)SlotsPerShard; i++)
+      {
+        Entry& e = shard.entries[i];
+        if(e.valid && e.keySize == keySize && CryptoPP::VerifyBufsEqual(e.fingerprint, fp, FingerprintSize) &&
+           e.purpose == purpose && e.context == context)
+          return &e;
+      }
+
+    return nullptr;
+  }
+
+  bool DerivedKeyCache::lookup(const byte fp[FingerprintSize], const NarrowString& purpose, const NarrowString& context,
+                               unsigned int keySize, byte key[])
+  {
+    const size_t s = ShardOf(fp);
+    Shard& shard = m_shards[s];
+    MutexLock lock(shard.lock);
+
+    Entry* e = find(shard, fp, purpose, context, keySize);
+    if(!e)
+      return false;
+
+    e->lastUse = ++shard.clock;
+    ::memcpy(key, keyOf(s, e - shard.entries), keySize);
+
+    return true;
+  }
+
+  void DerivedKeyCache::insert(const byte fp[FingerprintSize], const NarrowString& purpose, const NarrowString& context,
+                               unsigned int keySize, const byte key[])
+  {
+    ASSERT(keySize <= (unsigned int)MaxKeySize);
+    if(keySize > (unsigned int)MaxKeySize)
+      return;
+
+    const size_t s = ShardOf(fp);
+    Shard& shard = m_shards[s];
+    MutexLock lock(shard.lock);
+
+    // Another thread may have derived the same key while we were not holding the lock
+    if(find(shard, fp, purpose, context, keySize))
+      return;
+
+    // An empty slot, or else the least recently used one
+    size_t slot = 0;
+    for(size_t i = 0; i < (size_t)SlotsPerShard; i++)
+      {
+        if(!shard.entries[i].valid) { slot = i; break; }
+        if(shard.entries[i].lastUse < shard.entries[slot].lastUse) slot = i;
+      }
+
+    wipe(s, slot);
+
+    Entry& e = shard.entries[slot];
+    ::memcpy(e.fingerprint, fp, FingerprintSize);
+    e.purpose = purpose;
+    e.context = context;
+    e.keySize = keySize;
+    e.lastUse = ++shard.clock;
+    e.valid = true;
+
+    ::memcpy(keyOf(s, slot), key, keySize);
+  }
+
+  void DerivedKeyCache::invalidate(const byte fp[FingerprintSize])
+  {
+    const size_t s = ShardOf(fp);
+    Shard& shard = m_shards[s];
+    MutexLock lock(shard.lock);
+
+    for(size_t i = 0; i < (size_t)SlotsPerShard; i++)
+      {
+        if(shard.entries[i].valid && CryptoPP::VerifyBufsEqual(shard.entries[i].fingerprint, fp, FingerprintSize))
+          wipe(s, i);
+      }
+  }
+
+  void DerivedKeyCache::clear()
+  {
+    for(size_t i = 0; i < (size_t)Shards; i++)
+      {
+        MutexLock lock(m_shards[i].lock);
+        for(size_t j = 0; j < (size_t)SlotsPerShard; j++)
+          wipe(i, j);
+      }
+  }
+
+  // Caller holds the shard's lock
+  void DerivedKeyCache::wipe(size_t shard, size_t slot)
+  {
+    Entry& e = m_shards[shard].entries[slot];
+
+    CryptoPP::SecureWipeBuffer(keyOf(shard, slot), (size_t)MaxKeySize);
+    CryptoPP::SecureWipeBuffer(e.fingerprint, sizeof(e.fingerprint));
+
+    e.purpose.clear();
+    e.context.clear();
+    e.keySize = 0;
+    e.lastUse = 0;
+    e.valid = false;
+  }
+
+  /**
+   * The counter loop of computeDerivedKey, under an HMAC which is already keyed with
+   * the KDK. Shared by the single and batch derivations so they cannot drift apart.
+   *
+   * Block i is HMAC(KDK, [i]_2 || Label || 0x00 || Context || [L]_2), the counter
+   * mode KDF of NIST SP 800-108, 5.1, with 32-bit big-endian i and L (the key size
+   * in bits). The output is not byte-compatible with Java ESAPI's KDF, which feeds
+   * each block back in place of the label.
+   */
+  static void DeriveCounterMode(CryptoPP::MessageAuthenticationCode& hmac, const SecureByteArray& la,
+                                const SecureByteArray& ca, byte derived[], unsigned int keySize)
+  {
+    // Counter
+    unsigned int ctr = 1;
+    size_t idx = 0;
+
+    const unsigned int bits = keySize * 8;
+    const byte l[4] = { (byte)(bits >> 24 & 0xff), (byte)(bits >> 16 & 0xff),
+      (byte)(bits >> 8 & 0xff), (byte)(bits & 0xff) };
+
+    while(keySize)
+      {
+        const unsigned int req = std::min((unsigned int)hmac.DigestSize(), keySize);
+        const byte i[4] = { (byte)(ctr >> 24 & 0xff), (byte)(ctr >> 16 & 0xff),
+          (byte)(ctr >> 8 & 0xff), (byte)(ctr & 0xff) };
+        const byte nil = '\0';
+
+        hmac.Update(i, sizeof(i));
+        hmac.Update(la.data(), la.size());
+        hmac.Update(&nil, sizeof(nil));
+        hmac.Update(ca.data(), ca.size());
+        hmac.Update(l, sizeof(l));
+
+        // Though we continually call TruncatedFinal, we are retrieving a
+        // full block except for possibly the last block
+        hmac.TruncatedFinal(derived+idx, req);
+
+        idx += req;
+        keySize -= req;
+        ctr++;
+      }
+  }
+
+  /**
+   * HKDF-Expand (RFC 5869, section 2.3) under an HMAC which is already keyed with
+   * the PRK.
+   */
+  static void DeriveHkdfExpand(CryptoPP::MessageAuthenticationCode& hmac, const byte info[], size_t isize,
+                               byte okm[], size_t size)
+  {
+    CryptoPP::FixedSizeSecBlock<byte, CryptoPP::SHA512::DIGESTSIZE> t;
+    const size_t hlen = hmac.DigestSize();
+    size_t tlen = 0, idx = 0;
+
+    for(unsigned int i = 1; idx < size; i++)
+      {
+        const byte ctr = (byte)i;
+
+        hmac.Update(t.data(), tlen);
+        hmac.Update(info, isize);
+        hmac.Update(&ctr, sizeof(ctr));
+        hmac.Final(t.data());
+        tlen = hlen;
+
+        const size_t req = std::min(hlen, size - idx);
+        ::memcpy(okm + idx, t.data(), req);
+        idx += req;
+      }
+  }
 
-    if(!(keySize >= 56))
+  /**
+   * Checks a key size in bits for computeDerivedKey and returns the size in bytes.
+   */
+  static unsigned int CheckDerivedKeySize(unsigned int keyBits)
+  {
+    if(!(keyBits >= 56))
       {
         std::ostringstream oss;
-        oss << "KeyDerivationFunction: key has size of " << keySize << ", which is less than minimum of 56-bits.";
+        oss << "KeyDerivationFunction: key has size of " << keyBits << ", which is less than minimum of 56-bits.";
         throw IllegalArgumentException(oss.str());
       }
 
-    if(!((keySize % 8) == 0))
+    if(!((keyBits % 8) == 0))
       {
         std::ostringstream oss;
-        oss << "KeyDerivationFunction: key size (" << keySize << ") must be a even multiple of 8-bits.";
+        oss << "KeyDerivationFunction: key size (" << keyBits << ") must be a even multiple of 8-bits.";
         throw IllegalArgumentException(oss.str());
       }
 
+    return KeyDerivationFunction::calcKeySize(keyBits);
+  }
+
+  /**
+   * Derives a batch of keys under one keyed HMAC. The requests are handed out to
+   * the threads a few at a time, and each thread clones the keyed HMAC once, so
+   * the HMAC key schedule (the inner and outer pads) is computed a single time.
+   */
+  class KdfJob : public ParallelJob
+  {
+  public:
+    // Requests handed out at a time, so the lock is not taken per key
+    enum { BatchSize = 64 };
+
+    KdfJob(const CryptoPP::MessageAuthenticationCode& keyed, bool hkdf,
+           const std::vector<KeyDerivationFunction::DerivationRequest>& requests,
+           const std::vector<size_t>& offsets, byte output[])
+      : ParallelJob((requests.size() + BatchSize - 1) / BatchSize, "Internal error: "),
+        m_keyed(keyed), m_hkdf(hkdf), m_requests(requests), m_offsets(offsets), m_output(output)
+    {
+    }
+
+  protected:
+    void run()
+    {
+      shared_ptr<CryptoPP::MessageAuthenticationCode> hmac(static_cast<CryptoPP::MessageAuthenticationCode*>(m_keyed.Clone()));
+      size_t batch;
+
+      while(nextItem(batch))
+        {
+          const size_t first = batch * BatchSize;
+          const size_t last = std::min(first + (size_t)BatchSize, m_requests.size());
+
+          for(size_t i = first; i < last; i++)
+            {
+              const KeyDerivationFunction::DerivationRequest& req = m_requests[i];
+              byte* out = m_output + m_offsets[i];
+              const size_t size = m_offsets[i+1] - m_offsets[i];
+
+              const SecureByteArray la = TextConvert::GetBytes(req.purpose, "UTF-8");
+              const SecureByteArray ca = TextConvert::GetBytes(req.context, "UTF-8");
+
+              if(m_hkdf)
+                {
+                  // info = label || 0x00 || context, as the counter mode KDF
+                  SecureByteArray info(la.size() + 1 + ca.size());
+                  if(la.size()) ::memcpy(info.data(), la.data(), la.size());
+                  info[la.size()] = 0x00;
+                  if(ca.size()) ::memcpy(info.data() + la.size() + 1, ca.data(), ca.size());
+
+                  DeriveHkdfExpand(*hmac, info.data(), info.size(), out, size);
+                }
+              else
+                {
+                  DeriveCounterMode(*hmac, la, ca, out, (unsigned int)size);
+                }
+            }
+        }
+    }
+
+  private:
+    const CryptoPP::MessageAuthenticationCode& m_keyed;
+    bool m_hkdf;
+    const std::vector<KeyDerivationFunction::DerivationRequest>& m_requests;
+    const std::vector<size_t>& m_offsets;
+    byte* m_output;
+  };
+
+  /**
+   * Sizes the output of a batch, checking each request. offsets[i] is where key i
+   * starts, and offsets[count] is the total.
+   */
+  static void LayoutBatch(const std::vector<KeyDerivationFunction::DerivationRequest>& requests, bool hkdf,
+                          std::vector<size_t>& offsets)
+  {
+    offsets.resize(requests.size() + 1);
+    offsets[0] = 0;
+
+    try
+      {
+        SafeInt<size_t> total(0);
+        for(size_t i = 0; i < requests.size(); i++)
+          {
+            const KeyDerivationFunction::DerivationRequest& req = requests[i];
+
+            if(req.purpose.empty())
+              throw IllegalArgumentException("KeyDerivationFunction: purpose is empty or not valid.");
+
+            unsigned int size;
+            if(hkdf)
+              {
+                if(req.keyBits == 0 || (req.keyBits % 8) != 0 || req.keyBits / 8 > HkdfMaxBlocks * CryptoPP::SHA256::DIGESTSIZE)
+                  throw IllegalArgumentException("KeyDerivationFunction: HKDF key size is not valid.");
+                size = req.keyBits / 8;
+              }
+            else
+              {
+                size = CheckDerivedKeySize(req.keyBits);
+              }
+
+            total += size;
+            offsets[i+1] = total;
+          }
+      }
+    catch(const SafeIntException&)
+      {
+        throw IllegalArgumentException("KeyDerivationFunction: integer overflow detected.");
+      }
+  }
+
+  /**
+   * HKDF-Extract (RFC 5869, section 2.2). An empty salt is a string of zeros.
+   */
+  static void HkdfExtract(const SecretKey& ikm, const SecureByteArray& salt, byte prk[CryptoPP::SHA256::DIGESTSIZE])
+  {
+    const byte zeros[CryptoPP::SHA256::DIGESTSIZE] = { 0 };
+    const byte* sptr = salt.size() ? salt.data() : zeros;
+    const size_t ssize = salt.size() ? salt.size() : sizeof(zeros);
+
+    CryptoPP::HMAC<CryptoPP::SHA256> hmac(sptr, ssize);
+    const SecureByteArray bytes = ikm.getEncoded();
+    hmac.CalculateDigest(prk, bytes.data(), bytes.size());
+  }
+
+  SecretKey KeyDerivationFunction::computeDerivedKey(const SecretKey& keyDerivationKey, unsigned int keySize, const NarrowString& purpose)
+  {
+    // Consistency with Java implementation. This class needs to wire-up a context.
+    return computeDerivedKey(keyDerivationKey, keySize, purpose, NarrowString());
+  }
+
+  // Keep behavior consistent with the existing Java implementation
+  // http://code.google.com/p/owasp-esapi-java/source/browse/trunk/src/main/java/org/owasp/esapi/crypto/KeyDerivationFunction.java
+  SecretKey KeyDerivationFunction::computeDerivedKey(const SecretKey& keyDerivationKey, unsigned int keySize, const NarrowString& purpose,
+                                                     const NarrowString& context)
+  {
+    // We would choose a larger minimum key size, but we want to be
+    // able to accept DES for legacy encryption needs.
+    ASSERT( keyDerivationKey.getEncoded().length() > 0 );
+    ASSERT( keySize >= 56 );
+    ASSERT( (keySize % 8) == 0 );
+    ASSERT( !purpose.empty());
+    ASSERT( purpose == "authenticity" || purpose == "encryption" );
+
+    keySize = CheckDerivedKeySize( keySize );
+    ASSERT(keySize);
+
     if(purpose.empty())
       {
         std::ostringstream oss;
@@ -78,9 +531,6 @@ namespace esapi
         throw IllegalArgumentException(oss.str());
       }
 
-    keySize = calcKeySize( keySize );
-    ASSERT(keySize);
-
     /**
       byte[] derivedKey = new byte[ keySize ];
       byte[] label;              // Same purpose as NIST SP 800-108's "labe" in section 5.1.
@@ -94,9 +544,7 @@ namespace esapi
       }
     */
 
-    // Consistency with Java implementation. This class needs to wire-up a context.
     const NarrowString& label = purpose;
-    const NarrowString context;
 
     // Note that keyDerivationKey is going to be some SecretKey like an AES or
     // DESede key, but not an HmacSHA1 key. That means it is not likely
@@ -191,35 +639,25 @@ namespace esapi
     // Returned to caller
     CryptoPP::SecByteBlock derived(keySize);
 
-    // Counter
-    unsigned int ctr = 1;
-    size_t idx = 0;
+    DerivedKeyCache& cache = DerivedKeyCache::GetSharedInstance();
+
+    // Wiped on every return, including the cache hit
+    CryptoPP::FixedSizeSecBlock<byte, DerivedKeyCache::FingerprintSize> fp;
+
+    // Computed before any lock is taken; lookup and insert lock only the KDK's shard
+    cache.fingerprint(keyDerivationKey.BytePtr(), keyDerivationKey.sizeInBytes(), fp.data());
+    if(cache.lookup(fp.data(), label, context, keySize, derived.data()))
+      return SecretKey("HMACSha1", derived);
 
     // Our string classes do not have a getBytes() method
     SecureByteArray la = TextConvert::GetBytes(label, "UTF-8");
     SecureByteArray ca = TextConvert::GetBytes(context, "UTF-8");
 
-    while(keySize)
-      {
-        const unsigned int req = std::min((unsigned int)CryptoPP::SHA1::DIGESTSIZE, keySize);
-        const byte i[4] = { (byte)(ctr >> 24 & 0xff), (byte)(ctr >> 16 & 0xff),
-          (byte)(ctr >> 8 & 0xff), (byte)(ctr & 0xff) };
-        const byte nil = '\0';
+    // Keyed once. TruncatedFinal restarts the HMAC under the same key.
+    CryptoPP::HMAC<CryptoPP::SHA1> hmac(keyDerivationKey.BytePtr(), keyDerivationKey.sizeInBytes());
+    DeriveCounterMode(hmac, la, ca, derived.data(), keySize);
 
-        CryptoPP::HMAC<CryptoPP::SHA1> hmac(keyDerivationKey.BytePtr(), keyDerivationKey.sizeInBytes());
-
-        hmac.Update(i, sizeof(i));
-        hmac.Update(la.data(), la.size());
-        hmac.Update(&nil, sizeof(nil));
-        hmac.Update(ca.data(), ca.size());
-
-        // Though we continually call TruncatedFinal, we are retrieving a
-        // full block except for possibly the last block
-        hmac.TruncatedFinal(derived+idx, req);
-
-        idx += req;
-        keySize -= req;        
-      }
+    cache.insert(fp.data(), label, context, keySize, derived.data());
 
     // Convert it back into a SecretKey of the appropriate type.
     // return new SecretKeySpec(derivedKey, keyDerivationKey.getAlgorithm());
@@ -263,6 +701,120 @@ namespace esapi
     }
   */
 
+  std::vector<SecretKey> KeyDerivationFunction::computeDerivedKeys(const SecretKey& keyDerivationKey,
+                                                                   const std::vector<DerivationRequest>& requests,
+                                                                   unsigned int threads)
+  {
+    ASSERT( keyDerivationKey.getEncoded().length() > 0 );
+
+    std::vector<size_t> offsets;
+    LayoutBatch(requests, false, offsets);
+
+    CryptoPP::SecByteBlock derived(offsets.back());
+    try
+      {
+        const CryptoPP::HMAC<CryptoPP::SHA1> hmac(keyDerivationKey.BytePtr(), keyDerivationKey.sizeInBytes());
+        KdfJob job(hmac, false, requests, offsets, derived.data());
+        job.execute(threads);
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    std::vector<SecretKey> keys;
+    keys.reserve(requests.size());
+
+    for(size_t i = 0; i < requests.size(); i++)
+      keys.push_back(SecretKey("HMACSha1", CryptoPP::SecByteBlock(derived.data() + offsets[i], offsets[i+1] - offsets[i])));
+
+    return keys;
+  }
+
+  SecretKey KeyDerivationFunction::computeHkdfKey(const SecretKey& inputKey, const SecureByteArray& salt,
+                                                  unsigned int keyBits, const SecureByteArray& info)
+  {
+    ASSERT( inputKey.getEncoded().length() > 0 );
+
+    if(keyBits == 0 || (keyBits % 8) != 0 || keyBits / 8 > HkdfMaxBlocks * CryptoPP::SHA256::DIGESTSIZE)
+      throw IllegalArgumentException("KeyDerivationFunction: HKDF key size is not valid.");
+
+    CryptoPP::SecByteBlock okm(keyBits / 8);
+    try
+      {
+        CryptoPP::FixedSizeSecBlock<byte, CryptoPP::SHA256::DIGESTSIZE> prk;
+        HkdfExtract(inputKey, salt, prk.data());
+
+        CryptoPP::HMAC<CryptoPP::SHA256> hmac(prk.data(), prk.size());
+        DeriveHkdfExpand(hmac, info.data(), info.size(), okm.data(), okm.size());
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    return SecretKey(inputKey.getAlgorithm(), okm);
+  }
+
+  std::vector<SecretKey> KeyDerivationFunction::computeHkdfKeys(const SecretKey& inputKey, const SecureByteArray& salt,
+                                                                const std::vector<DerivationRequest>& requests,
+                                                                unsigned int threads)
+  {
+    ASSERT( inputKey.getEncoded().length() > 0 );
+
+    std::vector<size_t> offsets;
+    LayoutBatch(requests, true, offsets);
+
+    CryptoPP::SecByteBlock okm(offsets.back());
+    try
+      {
+        // One extract for the whole batch, then one keyed HMAC for every expand
+        CryptoPP::FixedSizeSecBlock<byte, CryptoPP::SHA256::DIGESTSIZE> prk;
+        HkdfExtract(inputKey, salt, prk.data());
+
+        const CryptoPP::HMAC<CryptoPP::SHA256> hmac(prk.data(), prk.size());
+        KdfJob job(hmac, true, requests, offsets, okm.data());
+        job.execute(threads);
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    std::vector<SecretKey> keys;
+    keys.reserve(requests.size());
+
+    for(size_t i = 0; i < requests.size(); i++)
+      keys.push_back(SecretKey(inputKey.getAlgorithm(), CryptoPP::SecByteBlock(okm.data() + offsets[i], offsets[i+1] - offsets[i])));
+
+    return keys;
+  }
+
+  void KeyDerivationFunction::invalidateDerivedKeys(const SecretKey& keyDerivationKey)
+  {
+    DerivedKeyCache& cache = DerivedKeyCache::GetSharedInstance();
+    CryptoPP::FixedSizeSecBlock<byte, DerivedKeyCache::FingerprintSize> fp;
+
+    cache.fingerprint(keyDerivationKey.BytePtr(), keyDerivationKey.sizeInBytes(), fp.data());
+    cache.invalidate(fp.data());
+
+    // The MAC cache is filed under the same fingerprint
+    EncryptThenMac::invalidate(keyDerivationKey);
+  }
+
+  void KeyDerivationFunction::clearDerivedKeyCache()
+  {
+    DerivedKeyCache::GetSharedInstance().clear();
+
+    EncryptThenMac::clearCache();
+  }
+
+  void KeyDerivationFunction::fingerprintKey(const SecretKey& keyDerivationKey, byte fp[FingerprintSize])
+  {
+    ASSERT(fp);
+    DerivedKeyCache::GetSharedInstance().fingerprint(keyDerivationKey.BytePtr(), keyDerivationKey.sizeInBytes(), fp);
+  }
+
   /**
    * Calculate the size of a key.
    */
@@ -16,6 +16,7 @@
 #include "crypto/SecretKey.h"
 #include "crypto/KeyGenerator.h"
 #include "crypto/SecureRandom.h"
+#include "util/ParallelJob.h"
 #include "util/TextConvert.h"
 #include "errors/EncryptionException.h"
 
@@ -25,6 +26,7 @@
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
+#include <vector>
 
 /**
 * This class implements functionality similar to Java's KeyGenerator for consistency
@@ -76,13 +78,10 @@ namespace esapi
 
     // http://download.oracle.com/javase/6/docs/api/javax/crypto/KeyGenerator.html
     // "This class provides the functionality of a secret (symmetric) key generator."
-    NarrowString cipher = kgen.getAlgorithm();
-    if(cipher != "DES" && cipher != "DES_ede" && cipher != "Blowfish" && cipher != "AES" &&
-      cipher != "Camellia" && cipher != "HmacSHA1" && cipher != "HmacSHA224" &&
-      cipher != "HmacSHA256" && cipher != "HmacSHA384"&& cipher != "HmacSHA512" &&
-      cipher != "HmacWhirlpoo" )
+    const AlgorithmName::AlgorithmFamily family = kgen.m_algorithm.getFamily();
+    if(family != AlgorithmName::FamilyCipher && family != AlgorithmName::FamilyHmac)
     {
-      throw NoSuchAlgorithmException(cipher + " KeyGenerator not available");
+      throw NoSuchAlgorithmException(kgen.getAlgorithm() + " KeyGenerator not available");
     }
 
     return kgen;
@@ -216,5 +215,102 @@ namespace esapi
     return SecretKey(algorithm, key);
   }
 
+  // The most a DRBG produces per request (SP 800-90A). See SecureRandomImpl's MaxRequest.
+  static const size_t MaxDrbgRequest = 1 << 16;
+
+  // Below this much key material a batch is generated on the calling thread
+  static const size_t MinParallelBytes = 4 * 1024 * 1024;
+
+  /**
+   * Fills a buffer with random bytes in MaxDrbgRequest pieces. The calling thread
+   * draws from the KeyGenerator's SecureRandom, and each worker from a SecureRandom
+   * of its own, so the workers never contend on a generator lock.
+   */
+  class KeyBatchJob : public ParallelJob
+  {
+  public:
+    KeyBatchJob(SecureRandom& random, byte* output, size_t size)
+      : ParallelJob((size + MaxDrbgRequest - 1) / MaxDrbgRequest, "Key generation failed: "),
+        m_random(random), m_algorithm(random.getAlgorithm()), m_output(output), m_size(size)
+    {
+    }
+
+  protected:
+    void run()
+    {
+      fill(m_random);
+    }
+
+    void runWorker()
+    {
+      SecureRandom random = SecureRandom::getInstance(m_algorithm);
+      fill(random);
+    }
+
+  private:
+    void fill(SecureRandom& random)
+    {
+      size_t piece;
+      while(nextItem(piece))
+        {
+          const size_t offset = piece * MaxDrbgRequest;
+          random.nextBytes(m_output + offset, std::min(MaxDrbgRequest, m_size - offset));
+        }
+    }
+
+    SecureRandom& m_random;
+    NarrowString m_algorithm;
+    byte* m_output;
+    size_t m_size;
+  };
+
+  /**
+  * Generates count secret keys.
+  */
+  std::vector<SecretKey> KeyGenerator::generateKeys(size_t count, unsigned int threads)
+  {
+    ASSERT(m_keyBytes != (unsigned int)InvalidKeyBytes);
+    if(m_keyBytes == (unsigned int)InvalidKeyBytes)
+      throw EncryptionException("The key size is not valid");
+
+    ESAPI_ASSERT2(m_keyBytes <= m_random.getSecurityLevel(),
+      "The requested number of key bits exceeds the generator's security leve");
+
+    size_t total = 0;
+    try
+    {
+      SafeInt<size_t> si(count);
+      si *= m_keyBytes;
+      total = si;
+    }
+    catch(SafeIntException&)
+    {
+      throw EncryptionException("The number of keys requested is not valid");
+    }
+
+    std::vector<SecretKey> keys;
+    if(!count)
+      return keys;
+
+    // All of the key material, wiped when it goes out of scope
+    CryptoPP::SecByteBlock material(total);
+
+    // Small batches are not worth the threads
+    if(material.size() < MinParallelBytes)
+      threads = 1;
+
+    KeyBatchJob job(m_random, material.data(), material.size());
+    job.execute(threads);
+
+    NarrowString algorithm;
+    m_algorithm.getAlgorithm(algorithm);
+
+    keys.reserve(count);
+    for(size_t i = 0; i < count; i++)
+      keys.push_back(SecretKey(algorithm, CryptoPP::SecByteBlock(material.data() + i * m_keyBytes, m_keyBytes)));
+
+    return keys;
+  }
+
 } // NAMESPACE esapi
 
@@ -38,7 +38,7 @@ namespace esapi
    */
   MessageDigest::MessageDigest(const NarrowString& algorithm)   
     : m_lock(new Mutex),
-      m_impl(MessageDigestBase::createInstance(AlgorithmName::normalizeAlgorithm(algorithm)))
+      m_impl(MessageDigestBase::createInstance(AlgorithmName(algorithm)))
   {
     ASSERT( !algorithm.empty() );
     ASSERT(m_lock.get() != nullptr);
@@ -50,7 +50,7 @@ namespace esapi
    */
   MessageDigest::MessageDigest(const WideString& algorithm)   
     : m_lock(new Mutex),
-    m_impl(MessageDigestBase::createInstance(TextConvert::WideToNarrow(AlgorithmName::normalizeAlgorithm(algorithm))))
+    m_impl(MessageDigestBase::createInstance(AlgorithmName(algorithm)))
   {
     ASSERT( !algorithm.empty() );
     ASSERT(m_lock.get() != nullptr);
@@ -104,8 +104,7 @@ namespace esapi
   {
     ASSERT(!algorithm.empty());
 
-    const NarrowString alg(AlgorithmName::normalizeAlgorithm(algorithm));
-    MessageDigestBase* impl = MessageDigestBase::createInstance(alg);
+    MessageDigestBase* impl = MessageDigestBase::createInstance(AlgorithmName(algorithm));
     MEMORY_BARRIER();
 
     ASSERT(impl != nullptr);
@@ -146,6 +145,18 @@ namespace esapi
     return m_impl->getDigestLengthImpl();
   }
 
+  /**
+   * Returns the name of the compression function selected for this digest.
+   */
+  NarrowString MessageDigest::getBackend() const
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->getBackendImpl();
+  }
+
   /**
    * Resets the digest for further use.
    */
@@ -366,6 +377,63 @@ namespace esapi
     return m_impl->digestImpl(buf, offset, len);
   }
 
+  /**
+   * Computes the digests of a batch of independent messages. Each message is hashed
+   * from a fresh state, so the digest's in-progress state (from update) is not disturbed.
+   *
+   * @param inputs the messages to digest.
+   * @param outputs receives one digest per message, in the same order.
+   */
+  void MessageDigest::digestMany(const std::vector<SecureByteArray>& inputs, std::vector<SecureByteArray>& outputs)
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    const size_t count = inputs.size();
+    const size_t length = m_impl->getDigestLengthImpl();
+
+    // Built aside and swapped in, so outputs is untouched if a digest fails
+    std::vector<SecureByteArray> temp;
+    temp.reserve(count);
+
+    std::vector<const byte*> ptrs(count);
+    std::vector<size_t> sizes(count);
+    std::vector<byte*> outs(count);
+
+    for(size_t i = 0; i < count; i++)
+    {
+      temp.push_back(SecureByteArray(length));
+
+      ptrs[i] = inputs[i].data();
+      sizes[i] = inputs[i].size();
+      outs[i] = temp[i].data();
+    }
+
+    if(count)
+      m_impl->digestManyImpl(&ptrs[0], &sizes[0], &outs[0], count);
+
+    outputs.swap(temp);
+  }
+
+  /**
+   * Computes the digests of a batch of independent messages. Each message is hashed
+   * from a fresh state, so the digest's in-progress state (from update) is not disturbed.
+   *
+   * @param inputs array of count message pointers.
+   * @param sizes array of count message sizes.
+   * @param outputs array of count output buffers, each at least getDigestLength() bytes.
+   * @param count the number of messages.
+   */
+  void MessageDigest::digestMany(const byte* const inputs[], const size_t sizes[], byte* const outputs[], size_t count)
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    m_impl->digestManyImpl(inputs, sizes, outputs, count);
+  }
+
   Mutex& MessageDigest::getObjectLock() const
   {
     ASSERT(m_lock.get() != nullptr);
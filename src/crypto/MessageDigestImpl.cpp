@@ -23,31 +23,40 @@
 
 namespace esapi
 {
-  MessageDigestBase* MessageDigestBase::createInstance(const NarrowString& algorithm)
+  MessageDigestBase* MessageDigestBase::createInstance(const AlgorithmName& algorithm)
   {
     // http://download.oracle.com/javase/6/docs/technotes/guides/security/SunProviders.html
-    ASSERT( !algorithm.empty() );
+    // The name was parsed and validated by AlgorithmName. Dispatch on the interned id.
 
-    if(algorithm == "MD5")
-      return new MessageDigestImpl<CryptoPP::Weak::MD5>(algorithm);
+    if(algorithm.getModeId() == AlgorithmName::ModeAbsent)
+    {
+      switch(algorithm.getAlgorithmId())
+      {
+      case AlgorithmName::AlgMD5:
+        return new MessageDigestImpl<CryptoPP::Weak::MD5>(algorithm);
+
+      case AlgorithmName::AlgSHA1:
+        return new MessageDigestImpl<CryptoPP::SHA1>(algorithm);
 
-    else if(algorithm == "SHA-1")
-      return new MessageDigestImpl<CryptoPP::SHA1>(algorithm);
+      case AlgorithmName::AlgSHA224:
+        return new MessageDigestImpl<AcceleratedSHA224>(algorithm);
 
-    else if(algorithm == "SHA-224")
-      return new MessageDigestImpl<CryptoPP::SHA224>(algorithm);
+      case AlgorithmName::AlgSHA256:
+        return new MessageDigestImpl<AcceleratedSHA256>(algorithm);
 
-    else if(algorithm == "SHA-256")
-      return new MessageDigestImpl<CryptoPP::SHA256>(algorithm);
+      case AlgorithmName::AlgSHA384:
+        return new MessageDigestImpl<CryptoPP::SHA384>(algorithm);
 
-    else if(algorithm == "SHA-384")
-      return new MessageDigestImpl<CryptoPP::SHA384>(algorithm);
+      case AlgorithmName::AlgSHA512:
+        return new MessageDigestImpl<CryptoPP::SHA512>(algorithm);
 
-    else if(algorithm == "SHA-512")
-      return new MessageDigestImpl<CryptoPP::SHA512>(algorithm);
+      case AlgorithmName::AlgWhirlpoo:
+        return new MessageDigestImpl<CryptoPP::Whirlpool>(algorithm);
 
-    else if(algorithm == "Whirlpoo")
-      return new MessageDigestImpl<CryptoPP::Whirlpool>(algorithm);
+      default:
+        break;
+      }
+    }
 
     ///////////////////////////////// Catch All /////////////////////////////////
 
@@ -57,15 +66,14 @@ namespace esapi
     // md.update(scratch);
 
     std::ostringstream oss;
-    oss << "Algorithm \'" << algorithm << "\' is not supported";
+    oss << "Algorithm \'" << algorithm.algorithm() << "\' is not supported";
     throw NoSuchAlgorithmException(oss.str());
   }
 
   template <class HASH>
-  MessageDigestImpl<HASH>::MessageDigestImpl(const NarrowString& algorithm)
+  MessageDigestImpl<HASH>::MessageDigestImpl(const AlgorithmName& algorithm)
     : MessageDigestBase(algorithm), m_hash()
   {
-    ASSERT( !algorithm.empty() );
   }
 
   /**
@@ -77,6 +85,27 @@ namespace esapi
     return MessageDigestBase::getAlgorithmImpl();
   }
 
+  /**
+   * Returns the name of the compression function backing this digest.
+   */
+  template <class HASH>
+  NarrowString MessageDigestImpl<HASH>::getBackendImpl() const
+  {
+    return NarrowString("Portable");
+  }
+
+  template <>
+  NarrowString MessageDigestImpl<AcceleratedSHA224>::getBackendImpl() const
+  {
+    return NarrowString(AcceleratedSHA224::Backend());
+  }
+
+  template <>
+  NarrowString MessageDigestImpl<AcceleratedSHA256>::getBackendImpl() const
+  {
+    return NarrowString(AcceleratedSHA256::Backend());
+  }
+
   /**
    * Returns a string that identifies the algorithm, independent of implementation details.
    */
@@ -396,6 +425,49 @@ namespace esapi
     return (size_t)req;
   }
 
+  /**
+   * Computes the digests of a batch of independent messages. This is the scalar path;
+   * a multi-lane backend would replace the loop for the hashes which have one.
+   */
+  template <class HASH>
+  void MessageDigestImpl<HASH>::digestManyImpl(const byte* const inputs[], const size_t sizes[], byte* const outputs[], size_t count)
+  {
+    ESAPI_ASSERT2(!count || (inputs && sizes && outputs), "The input, size or output array is not valid");
+    if(!count)
+      return;
+
+    if(!inputs || !sizes || !outputs)
+      throw IllegalArgumentException("The input, size or output array is not valid");
+
+    try
+      {
+        // A separate hash object, so an in-progress update() on m_hash is not disturbed.
+        // It is reused for every message since CalculateDigest restarts the hash.
+        HASH hash;
+
+        for(size_t i = 0; i < count; i++)
+          {
+            // A null input is OK for an empty message (see updateImpl)
+            if((!inputs[i] && sizes[i]) || !outputs[i])
+              throw IllegalArgumentException("The input or output buffer is not valid");
+
+            // Pointer wrap?
+            SafeInt<size_t> safe1((size_t)inputs[i]);
+            safe1 += sizes[i];
+
+            hash.CalculateDigest(outputs[i], inputs[i], sizes[i]);
+          }
+      }
+    catch(const SafeIntException&)
+      {
+        throw IllegalArgumentException("The input buffer is not valid");
+      }
+    catch(const CryptoPP::Exception& ex)
+      {
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+  }
+
   // Explicit instantiations
   // TODO: Figure out a better way to do this to bring in the correct namespace'd MD5
   using namespace CryptoPP;
@@ -403,8 +475,8 @@ namespace esapi
 
   template class MessageDigestImpl<MD5>;
   template class MessageDigestImpl<CryptoPP::SHA1>;
-  template class MessageDigestImpl<CryptoPP::SHA224>;
-  template class MessageDigestImpl<CryptoPP::SHA256>;
+  template class MessageDigestImpl<AcceleratedSHA224>;
+  template class MessageDigestImpl<AcceleratedSHA256>;
   template class MessageDigestImpl<CryptoPP::SHA384>;
   template class MessageDigestImpl<CryptoPP::SHA512>;
   template class MessageDigestImpl<CryptoPP::Whirlpool>;
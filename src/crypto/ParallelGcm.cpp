@@ -0,0 +1,404 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/ParallelJob.h"
+#include "crypto/ParallelGcm.h"
+#include "crypto/CryptoppCommon.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+// GCM arrived in Crypto++ 5.6
+#if CRYPTOPP_VERSION >= 560
+# include <cryptopp/gcm.h>
+# define ESAPI_GCM_AVAILABLE 1
+#endif
+
+namespace esapi
+{
+  // Workers hash what they just encrypted in pieces of this size, while it is in cache
+  static const size_t PieceSize = 64 * 1024;
+
+  // SP 800-38D, 5.2.1.1: the plain text is at most 2^39 - 256 bits
+  static const unsigned long long MaxMessageSize = (1ULL << 36) - 32;
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////// GF(2^128) //////////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * An element of GF(2^128) in the GCM bit order: hi holds bytes 0-7 of the block
+   * and lo holds bytes 8-15, both big endian. Only a handful of multiplications are
+   * needed to combine the chunks, so the bitwise algorithm of SP 800-38D, 6.3 is
+   * plenty. The bulk GHASH is done by Crypto++.
+   */
+  struct Gf128
+  {
+    CryptoPP::word64 hi, lo;
+  };
+
+  static Gf128 GfLoad(const byte* block)
+  {
+    Gf128 x = { 0, 0 };
+    for(unsigned int i = 0; i < 8; i++)
+      {
+        x.hi = (x.hi << 8) | block[i];
+        x.lo = (x.lo << 8) | block[i + 8];
+      }
+    return x;
+  }
+
+  static void GfStore(const Gf128& x, byte* block)
+  {
+    for(unsigned int i = 0; i < 8; i++)
+      {
+        block[i] = (byte)(x.hi >> (56 - 8 * i));
+        block[i + 8] = (byte)(x.lo >> (56 - 8 * i));
+      }
+  }
+
+  static Gf128 GfXor(const Gf128& x, const Gf128& y)
+  {
+    Gf128 z = { x.hi ^ y.hi, x.lo ^ y.lo };
+    return z;
+  }
+
+  static Gf128 GfMul(const Gf128& x, const Gf128& y)
+  {
+    Gf128 z = { 0, 0 };
+    Gf128 v = y;
+
+    for(unsigned int i = 0; i < 128; i++)
+      {
+        const CryptoPP::word64 bit = (i < 64) ? (x.hi >> (63 - i)) & 1 : (x.lo >> (127 - i)) & 1;
+        const CryptoPP::word64 mask = 0 - bit;
+
+        z.hi ^= v.hi & mask;
+        z.lo ^= v.lo & mask;
+
+        // v = v * x, with the reduction polynomial R = 11100001 || 0^120
+        const CryptoPP::word64 carry = 0 - (v.lo & 1);
+        v.lo = (v.lo >> 1) | (v.hi << 63);
+        v.hi = (v.hi >> 1) ^ (W64LIT(0xE100000000000000) & carry);
+      }
+
+    return z;
+  }
+
+  static Gf128 GfPow(const Gf128& h, unsigned long long n)
+  {
+    Gf128 result = { W64LIT(0x8000000000000000), 0 };   // The multiplicative identity
+    Gf128 base = h;
+
+    while(n)
+      {
+        if(n & 1)
+          result = GfMul(result, base);
+        base = GfMul(base, base);
+        n >>= 1;
+      }
+
+    return result;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////// Chunk Jobs /////////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+#if defined(ESAPI_GCM_AVAILABLE)
+
+  /**
+   * One message being processed. Workers take chunks in order until none are left
+   * and leave each chunk's GHASH tag in m_tags.
+   */
+  class GcmJob : public ParallelJob
+  {
+  public:
+    GcmJob(const byte* key, size_t ksize, const byte* nonce, bool encrypting,
+           const byte* input, size_t size, byte* output, size_t chunkSize)
+      : ParallelJob((size + chunkSize - 1) / chunkSize, "Internal error: "),
+        m_key(key), m_ksize(ksize), m_nonce(nonce), m_encrypting(encrypting),
+        m_input(input), m_size(size), m_output(output), m_chunkSize(chunkSize),
+        m_chunks((size + chunkSize - 1) / chunkSize), m_tags(m_chunks * ParallelGcm::TagSize)
+    {
+    }
+
+    size_t chunkCount() const
+    {
+      return m_chunks;
+    }
+
+    const byte* chunkTag(size_t chunk) const
+    {
+      return m_tags.BytePtr() + chunk * ParallelGcm::TagSize;
+    }
+
+  protected:
+    /**
+     * Processes chunks until there are none left. Each thread keys its own objects
+     * once and only re-IVs them per chunk.
+     */
+    void run()
+    {
+      CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption ctr;
+      CryptoPP::GCM<CryptoPP::AES>::Encryption ghash;
+      byte counter[CryptoPP::AES::BLOCKSIZE];
+
+      bool keyed = false;
+      size_t chunk;
+
+      while(nextItem(chunk))
+        {
+          const size_t offset = chunk * m_chunkSize;
+          const size_t length = std::min(m_chunkSize, m_size - offset);
+
+          // Counter block for the chunk: nonce || (2 + blocks before it). The
+          // 32-bit counter cannot wrap since the message size is bounded.
+          ::memcpy(counter, m_nonce, ParallelGcm::NonceSize);
+          const CryptoPP::word32 ctrValue = (CryptoPP::word32)(2 + offset / CryptoPP::AES::BLOCKSIZE);
+          counter[12] = (byte)(ctrValue >> 24);
+          counter[13] = (byte)(ctrValue >> 16);
+          counter[14] = (byte)(ctrValue >> 8);
+          counter[15] = (byte)(ctrValue);
+
+          if(!keyed)
+            {
+              ctr.SetKeyWithIV(m_key, m_ksize, counter, sizeof(counter));
+              ghash.SetKeyWithIV(m_key, m_ksize, m_nonce, ParallelGcm::NonceSize);
+              keyed = true;
+            }
+          else
+            {
+              ctr.Resynchronize(counter, sizeof(counter));
+              ghash.Resynchronize(m_nonce, ParallelGcm::NonceSize);
+            }
+
+          // The ciphertext of the chunk goes through GHASH as additional data
+          // with an empty message. See ParallelGcm::combine for the algebra.
+          for(size_t done = 0; done < length; )
+            {
+              const size_t n = std::min(PieceSize, length - done);
+              const byte* in = m_input + offset + done;
+              byte* out = m_output + offset + done;
+
+              if(m_encrypting)
+                {
+                  ctr.ProcessData(out, in, n);
+                  ghash.Update(out, n);
+                }
+              else
+                {
+                  ghash.Update(in, n);
+                  ctr.ProcessData(out, in, n);
+                }
+
+              done += n;
+            }
+
+          ghash.TruncatedFinal(m_tags.BytePtr() + chunk * ParallelGcm::TagSize, ParallelGcm::TagSize);
+        }
+
+      CryptoPP::SecureWipeArray(counter, COUNTOF(counter));
+    }
+
+  private:
+    const byte* m_key;
+    size_t m_ksize;
+    const byte* m_nonce;
+    bool m_encrypting;
+
+    const byte* m_input;
+    size_t m_size;
+    byte* m_output;
+    size_t m_chunkSize;
+
+    size_t m_chunks;
+    CryptoPP::SecByteBlock m_tags;
+  };
+
+  /**
+   * Combines the chunk tags into the message tag.
+   *
+   * Chunk j was authenticated as additional data, so its tag is
+   *   T_j = E(J0) + GHASH(C_j || L_j) = E(J0) + P_j*H + L_j*H
+   * where L_j = [len(C_j)]_64 || 0^64 and P_j = sum C_i * H^(end_j - i) over its blocks.
+   * The message GHASH is sum_j P_j*H * H^(n - end_j) + L*H for n blocks in total and
+   * L = 0^64 || [len(C)]_64. Each chunk is a whole number of blocks (only the last
+   * may be short), so the zero padding matches the serial computation.
+   */
+  static void CombineTags(const GcmJob& job, const byte* key, size_t ksize, const byte* nonce,
+                          size_t size, size_t chunkSize, byte* tag)
+  {
+    CryptoPP::AES::Encryption aes(key, ksize);
+
+    byte block[CryptoPP::AES::BLOCKSIZE];
+
+    // H = E(0^128)
+    ::memset(block, 0x00, sizeof(block));
+    aes.ProcessBlock(block);
+    const Gf128 h = GfLoad(block);
+
+    // E(J0), J0 = nonce || 0^31 || 1
+    ::memcpy(block, nonce, ParallelGcm::NonceSize);
+    block[12] = block[13] = block[14] = 0;
+    block[15] = 1;
+    aes.ProcessBlock(block);
+    const Gf128 ej0 = GfLoad(block);
+
+    const unsigned long long blockSize = CryptoPP::AES::BLOCKSIZE;
+    const unsigned long long totalBlocks = (size + blockSize - 1) / blockSize;
+
+    Gf128 y = { 0, 0 };
+    for(size_t j = 0; j < job.chunkCount(); j++)
+      {
+        const unsigned long long offset = (unsigned long long)j * chunkSize;
+        const unsigned long long length = std::min((unsigned long long)chunkSize, size - offset);
+        const unsigned long long endBlock = (offset + length + blockSize - 1) / blockSize;
+
+        Gf128 lj = { length * 8, 0 };
+        Gf128 pj = GfXor(GfXor(GfLoad(job.chunkTag(j)), ej0), GfMul(lj, h));
+
+        y = GfXor(y, GfMul(pj, GfPow(h, totalBlocks - endBlock)));
+      }
+
+    Gf128 l = { 0, (CryptoPP::word64)size * 8 };
+    y = GfXor(y, GfMul(l, h));
+
+    GfStore(GfXor(y, ej0), tag);
+    CryptoPP::SecureWipeArray(block, COUNTOF(block));
+  }
+
+#endif
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////// ParallelGcm ////////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  ParallelGcm::ParallelGcm(const SecretKey& key, unsigned int threads, size_t chunkSize)
+    : m_key(key.getEncoded()), m_threads(threads), m_chunkSize(chunkSize)
+  {
+    const size_t ksize = m_key.size();
+
+    ESAPI_ASSERT2(ksize == 16 || ksize == 24 || ksize == 32, "Key size is not valid");
+    if(!(ksize == 16 || ksize == 24 || ksize == 32))
+      throw IllegalArgumentException("AES key size is not valid");
+
+    ESAPI_ASSERT2(chunkSize && chunkSize % CryptoPP::AES::BLOCKSIZE == 0, "Chunk size is not valid");
+    if(!chunkSize || chunkSize % CryptoPP::AES::BLOCKSIZE != 0)
+      throw IllegalArgumentException("Chunk size must be a multiple of the block size");
+
+    m_threads = ParallelJob::ThreadCount(m_threads);
+  }
+
+  unsigned int ParallelGcm::getThreadCount() const
+  {
+    return m_threads;
+  }
+
+  void ParallelGcm::encrypt(const byte nonce[], size_t nsize, const byte input[], size_t size, byte output[], byte tag[]) const
+  {
+    ESAPI_ASSERT2(nonce && nsize == NonceSize, "Nonce is not valid");
+    if(!nonce || nsize != NonceSize)
+      throw IllegalArgumentException("Nonce must be 96 bits");
+
+    ESAPI_ASSERT2((input && output) || !size, "Buffer is not valid");
+    if(size && (!input || !output))
+      throw IllegalArgumentException("Buffer is not valid");
+
+    ESAPI_ASSERT2(tag, "Tag buffer is not valid");
+    if(!tag)
+      throw IllegalArgumentException("Tag buffer is not valid");
+
+    if((unsigned long long)size > MaxMessageSize)
+      throw IllegalArgumentException("Message is too long for GCM");
+
+#if defined(ESAPI_GCM_AVAILABLE)
+    try
+      {
+        if(m_threads == 1 || size < 2 * m_chunkSize)
+          {
+            CryptoPP::GCM<CryptoPP::AES>::Encryption gcm;
+            gcm.SetKeyWithIV(m_key.data(), m_key.size(), nonce, (int)nsize);
+            gcm.EncryptAndAuthenticate(output, tag, TagSize, nonce, (int)nsize, nullptr, 0, input, size);
+            return;
+          }
+
+        GcmJob job(m_key.data(), m_key.size(), nonce, true, input, size, output, m_chunkSize);
+        job.execute(m_threads);
+
+        CombineTags(job, m_key.data(), m_key.size(), nonce, size, m_chunkSize, tag);
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+#else
+    throw EncryptionException("Encryption failed", "AES/GCM requires Crypto++ 5.6 or above");
+#endif
+  }
+
+  bool ParallelGcm::decrypt(const byte nonce[], size_t nsize, const byte input[], size_t size, const byte tag[], byte output[]) const
+  {
+    ESAPI_ASSERT2(nonce && nsize == NonceSize, "Nonce is not valid");
+    if(!nonce || nsize != NonceSize)
+      throw IllegalArgumentException("Nonce must be 96 bits");
+
+    ESAPI_ASSERT2((input && output) || !size, "Buffer is not valid");
+    if(size && (!input || !output))
+      throw IllegalArgumentException("Buffer is not valid");
+
+    ESAPI_ASSERT2(tag, "Tag buffer is not valid");
+    if(!tag)
+      throw IllegalArgumentException("Tag buffer is not valid");
+
+    if((unsigned long long)size > MaxMessageSize)
+      return false;
+
+#if defined(ESAPI_GCM_AVAILABLE)
+    try
+      {
+        if(m_threads == 1 || size < 2 * m_chunkSize)
+          {
+            CryptoPP::GCM<CryptoPP::AES>::Decryption gcm;
+            gcm.SetKeyWithIV(m_key.data(), m_key.size(), nonce, (int)nsize);
+            return gcm.DecryptAndVerify(output, tag, TagSize, nonce, (int)nsize, nullptr, 0, input, size);
+          }
+
+        GcmJob job(m_key.data(), m_key.size(), nonce, false, input, size, output, m_chunkSize);
+        job.execute(m_threads);
+
+        byte computed[TagSize];
+        CombineTags(job, m_key.data(), m_key.size(), nonce, size, m_chunkSize, computed);
+
+        const bool verified = CryptoPP::VerifyBufsEqual(computed, tag, TagSize);
+        CryptoPP::SecureWipeArray(computed, COUNTOF(computed));
+
+        // Never release unauthenticated plain text
+        if(!verified && size)
+          CryptoPP::SecureWipeArray(output, size);
+
+        return verified;
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+#else
+    throw EncryptionException("Decryption failed", "AES/GCM requires Crypto++ 5.6 or above");
+#endif
+  }
+
+} // NAMESPACE esapi
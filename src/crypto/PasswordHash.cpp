@@ -0,0 +1,338 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/AlgorithmName.h"
+#include "crypto/PasswordHash.h"
+#include "crypto/CryptoppCommon.h"
+#include "crypto/AcceleratedHash.h"
+
+#include <cryptopp/pwdbased.h>
+
+#include <string.h>
+
+namespace esapi
+{
+  ///////////////////////////////////////////////////////////////////////////////////
+  ///////////////////////////////// SHA Family Engine ////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * The SHA family uses Merkle-Damgard strengthening with a big-endian bit length in the
+   * last two words of the final block. When the message is a single digest (optionally
+   * preceded by one full block, as in HMAC), the padding and length words never change,
+   * so the final block is built once and each round only overwrites the digest words
+   * and calls the static Transform. Words stay in native order between rounds.
+   */
+  template <class HASH>
+  class ShaEngine
+  {
+  public:
+    typedef typename HASH::HashWordType Word;
+
+    // The largest SHA state is 8 words (SHA-1 uses 5). The buffers below hold a full
+    // block, so copying 8 words of state is always in bounds.
+    enum { BlockWords = HASH::BLOCKSIZE / sizeof(Word), DigestWords = HASH::DIGESTSIZE / sizeof(Word), StateWords = 8 };
+    // 16-byte aligned, so the SSE/SHA-NI transforms load the state and block directly
+    typedef CryptoPP::FixedSizeAlignedSecBlock<Word, BlockWords, true> WordBlock;
+
+    /**
+     * Prepares the final block for a message of one digest, which follows 'prefix'
+     * bytes already run through the compression function.
+     */
+    static void PadBlock(WordBlock& block, size_t prefix)
+    {
+      ::memset(block.data(), 0x00, block.SizeInBytes());
+      block[DigestWords] = Word(1) << (8 * sizeof(Word) - 1);
+      block[BlockWords - 1] = Word((prefix + HASH::DIGESTSIZE) * 8);
+    }
+
+    static void Load(Word words[], const byte bytes[], size_t count)
+    {
+      for(size_t i = 0; i < count; i++)
+        words[i] = CryptoPP::GetWord<Word>(false, CryptoPP::BIG_ENDIAN_ORDER, bytes + i * sizeof(Word));
+    }
+
+    static void Store(byte bytes[], const Word words[], size_t count)
+    {
+      for(size_t i = 0; i < count; i++)
+        CryptoPP::PutWord<Word>(false, CryptoPP::BIG_ENDIAN_ORDER, bytes + i * sizeof(Word), words[i]);
+    }
+
+    /**
+     * digest = HASH(digest), iterations times. One transform per round.
+     */
+    static void Iterate(byte digest[], unsigned int iterations)
+    {
+      WordBlock state, block;
+      PadBlock(block, 0);
+      Load(state.data(), digest, DigestWords);
+
+      for(unsigned int i = 0; i < iterations; i++)
+        {
+          ::memcpy(block.data(), state.data(), DigestWords * sizeof(Word));
+          HASH::InitState(state.data());
+          HASH::Transform(state.data(), block.data());
+        }
+
+      Store(digest, state.data(), DigestWords);
+    }
+
+    /**
+     * PBKDF2-HMAC. The first round of each output block runs through CryptoPP::HMAC
+     * since salt || INT(i) has an arbitrary length. The remaining rounds start from
+     * the precomputed ipad and opad states and cost exactly two transforms.
+     */
+    static void Pbkdf2(const byte password[], size_t psize, const byte salt[], size_t ssize,
+                       unsigned int iterations, byte derived[], size_t dsize)
+    {
+      static const byte empty = 0;
+      if(!password) password = &empty;
+      if(!salt) salt = &empty;
+
+      // The HMAC key is the password, hashed first if longer than a block
+      CryptoPP::FixedSizeSecBlock<byte, HASH::BLOCKSIZE> key;
+      ::memset(key.data(), 0x00, key.size());
+      if(psize > HASH::BLOCKSIZE)
+        HASH().CalculateDigest(key.data(), password, psize);
+      else if(psize)
+        ::memcpy(key.data(), password, psize);
+
+      WordBlock inner, outer, state, block, sum;
+      ::memset(inner.data(), 0x00, inner.SizeInBytes());
+      ::memset(outer.data(), 0x00, outer.SizeInBytes());
+
+      for(size_t i = 0; i < key.size(); i++)
+        key[i] ^= 0x36;
+      Load(block.data(), key.data(), BlockWords);
+      HASH::InitState(inner.data());
+      HASH::Transform(inner.data(), block.data());
+
+      for(size_t i = 0; i < key.size(); i++)
+        key[i] ^= (0x36 ^ 0x5c);
+      Load(block.data(), key.data(), BlockWords);
+      HASH::InitState(outer.data());
+      HASH::Transform(outer.data(), block.data());
+
+      CryptoPP::HMAC<HASH> hmac(password, psize);
+      CryptoPP::FixedSizeSecBlock<byte, HASH::DIGESTSIZE> u;
+
+      size_t done = 0;
+      for(CryptoPP::word32 idx = 1; done < dsize; idx++)
+        {
+          byte ctr[4];
+          CryptoPP::PutWord<CryptoPP::word32>(false, CryptoPP::BIG_ENDIAN_ORDER, ctr, idx);
+
+          hmac.Update(salt, ssize);
+          hmac.Update(ctr, sizeof(ctr));
+          hmac.Final(u.data());
+
+          Load(state.data(), u.data(), DigestWords);
+          ::memcpy(sum.data(), state.data(), DigestWords * sizeof(Word));
+
+          // Both the inner and outer messages are one digest after one block
+          PadBlock(block, HASH::BLOCKSIZE);
+
+          for(unsigned int j = 1; j < iterations; j++)
+            {
+              ::memcpy(block.data(), state.data(), DigestWords * sizeof(Word));
+              ::memcpy(state.data(), inner.data(), StateWords * sizeof(Word));
+              HASH::Transform(state.data(), block.data());
+
+              ::memcpy(block.data(), state.data(), DigestWords * sizeof(Word));
+              ::memcpy(state.data(), outer.data(), StateWords * sizeof(Word));
+              HASH::Transform(state.data(), block.data());
+
+              for(size_t k = 0; k < DigestWords; k++)
+                sum[k] ^= state[k];
+            }
+
+          Store(u.data(), sum.data(), DigestWords);
+
+          const size_t req = std::min(dsize - done, (size_t)HASH::DIGESTSIZE);
+          ::memcpy(derived + done, u.data(), req);
+          done += req;
+        }
+    }
+  };
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  /////////////////////////////////// Generic Engine /////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * MD5 and Whirlpool, through the Crypto++ objects. Still no MessageDigest pimpl or
+   * allocation per round.
+   */
+  template <class HASH>
+  class GenericEngine
+  {
+  public:
+    static void Iterate(byte digest[], unsigned int iterations)
+    {
+      HASH hash;
+      for(unsigned int i = 0; i < iterations; i++)
+        hash.CalculateDigest(digest, digest, HASH::DIGESTSIZE);
+    }
+
+    static void Pbkdf2(const byte password[], size_t psize, const byte salt[], size_t ssize,
+                       unsigned int iterations, byte derived[], size_t dsize)
+    {
+      static const byte empty = 0;
+
+      CryptoPP::PKCS5_PBKDF2_HMAC<HASH> kdf;
+      kdf.DeriveKey(derived, dsize, 0, password ? password : &empty, psize,
+                    salt ? salt : &empty, ssize, iterations);
+    }
+  };
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ///////////////////////////////////// Dispatch /////////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  template <class HASH, class ENGINE>
+  static SecureByteArray IteratedDigest(const byte* const parts[], const size_t sizes[], size_t count, unsigned int iterations)
+  {
+    SecureByteArray digest(HASH::DIGESTSIZE);
+
+    HASH hash;
+    for(size_t i = 0; i < count; i++)
+      {
+        if(sizes[i])
+          hash.Update(parts[i], sizes[i]);
+      }
+    hash.Final(digest.data());
+
+    ENGINE::Iterate(digest.data(), iterations);
+    return digest;
+  }
+
+  static void ThrowNotSupported(const AlgorithmName& alg)
+  {
+    std::ostringstream oss;
+    oss << "Algorithm \'" << alg.algorithm() << "\' is not supported";
+    throw NoSuchAlgorithmException(oss.str());
+  }
+
+  SecureByteArray PasswordHash::iteratedDigest(const NarrowString& algorithm, const byte* const parts[],
+                                               const size_t sizes[], size_t count, unsigned int iterations)
+  {
+    ASSERT(count == 0 || (parts && sizes));
+    if(count && !(parts && sizes))
+      throw IllegalArgumentException("The parts or sizes are not valid");
+
+    for(size_t i = 0; i < count; i++)
+      {
+        ASSERT(parts[i] || !sizes[i]);
+        if(!parts[i] && sizes[i])
+          throw IllegalArgumentException("The part is not valid");
+      }
+
+    const AlgorithmName alg(algorithm);
+    if(alg.getModeId() != AlgorithmName::ModeAbsent)
+      ThrowNotSupported(alg);
+
+    try
+      {
+        switch(alg.getAlgorithmId())
+          {
+          case AlgorithmName::AlgMD5:
+            return IteratedDigest<CryptoPP::Weak::MD5, GenericEngine<CryptoPP::Weak::MD5> >(parts, sizes, count, iterations);
+          case AlgorithmName::AlgSHA1:
+            return IteratedDigest<CryptoPP::SHA1, ShaEngine<CryptoPP::SHA1> >(parts, sizes, count, iterations);
+          case AlgorithmName::AlgSHA224:
+            return IteratedDigest<AcceleratedSHA224, ShaEngine<AcceleratedSHA224> >(parts, sizes, count, iterations);
+          case AlgorithmName::AlgSHA256:
+            return IteratedDigest<AcceleratedSHA256, ShaEngine<AcceleratedSHA256> >(parts, sizes, count, iterations);
+          case AlgorithmName::AlgSHA384:
+            return IteratedDigest<CryptoPP::SHA384, ShaEngine<CryptoPP::SHA384> >(parts, sizes, count, iterations);
+          case AlgorithmName::AlgSHA512:
+            return IteratedDigest<CryptoPP::SHA512, ShaEngine<CryptoPP::SHA512> >(parts, sizes, count, iterations);
+          case AlgorithmName::AlgWhirlpoo:
+            return IteratedDigest<CryptoPP::Whirlpool, GenericEngine<CryptoPP::Whirlpool> >(parts, sizes, count, iterations);
+          default:
+            break;
+          }
+      }
+    catch(const CryptoPP::Exception& ex)
+      {
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    ThrowNotSupported(alg);
+    return SecureByteArray();
+  }
+
+  void PasswordHash::pbkdf2(const NarrowString& algorithm, const byte password[], size_t psize,
+                            const byte salt[], size_t ssize, unsigned int iterations,
+                            byte derived[], size_t dsize)
+  {
+    ASSERT(password || !psize);
+    if(!password && psize)
+      throw IllegalArgumentException("The password buffer is not valid");
+
+    ASSERT(salt || !ssize);
+    if(!salt && ssize)
+      throw IllegalArgumentException("The salt buffer is not valid");
+
+    ASSERT(derived && dsize);
+    if(!(derived && dsize))
+      throw IllegalArgumentException("The derived key buffer or size is not valid");
+
+    ASSERT(iterations);
+    if(!iterations)
+      throw IllegalArgumentException("The iteration count is not valid");
+
+    const AlgorithmName alg(algorithm);
+    if(alg.getModeId() != AlgorithmName::ModeAbsent)
+      ThrowNotSupported(alg);
+
+    try
+      {
+        switch(alg.getAlgorithmId())
+          {
+          case AlgorithmName::AlgMD5:
+            GenericEngine<CryptoPP::Weak::MD5>::Pbkdf2(password, psize, salt, ssize, iterations, derived, dsize);
+            return;
+          case AlgorithmName::AlgSHA1:
+            ShaEngine<CryptoPP::SHA1>::Pbkdf2(password, psize, salt, ssize, iterations, derived, dsize);
+            return;
+          case AlgorithmName::AlgSHA224:
+            ShaEngine<AcceleratedSHA224>::Pbkdf2(password, psize, salt, ssize, iterations, derived, dsize);
+            return;
+          case AlgorithmName::AlgSHA256:
+            ShaEngine<AcceleratedSHA256>::Pbkdf2(password, psize, salt, ssize, iterations, derived, dsize);
+            return;
+          case AlgorithmName::AlgSHA384:
+            ShaEngine<CryptoPP::SHA384>::Pbkdf2(password, psize, salt, ssize, iterations, derived, dsize);
+            return;
+          case AlgorithmName::AlgSHA512:
+            ShaEngine<CryptoPP::SHA512>::Pbkdf2(password, psize, salt, ssize, iterations, derived, dsize);
+            return;
+          case AlgorithmName::AlgWhirlpoo:
+            GenericEngine<CryptoPP::Whirlpool>::Pbkdf2(password, psize, salt, ssize, iterations, derived, dsize);
+            return;
+          default:
+            break;
+          }
+      }
+    catch(const CryptoPP::Exception& ex)
+      {
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    ThrowNotSupported(alg);
+  }
+
+} // NAMESPACE esapi
@@ -52,6 +52,11 @@ namespace esapi
     return SecureByteArray(rawBytes);
   }
 
+  const SecureByteArray& PlainText::getBytes() const
+  {
+    return rawBytes;
+  }
+
   bool PlainText::equals(const PlainText& obj) const
   {
     // Check this!!!
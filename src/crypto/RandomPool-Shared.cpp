@@ -15,11 +15,37 @@
 #include "crypto/RandomPool.h"
 #include "util/TextConvert.h"
 #include "util/ArrayZeroizer.h"
+#include "util/CpuFeatures.h"
+#include "util/NotCopyable.h"
 #include "errors/EncryptionException.h"
 #include "errors/IllegalArgumentException.h"
 
+#include <algorithm>
+
+#if (defined(ESAPI_ARCH_X86) || defined(ESAPI_ARCH_X64)) && (defined(ESAPI_CXX_GCC) || defined(ESAPI_CXX_CLANG))
+# define ESAPI_HARDWARE_RNG_ASM 1
+#elif (defined(ESAPI_ARCH_X86) || defined(ESAPI_ARCH_X64)) && defined(ESAPI_CXX_MSVC) && (_MSC_VER >= 1800)
+# define ESAPI_HARDWARE_RNG_INTRIN 1
+# include <immintrin.h>
+#endif
+
 namespace esapi
 {
+  // Attempts per word. RDSEED fails transiently when its entropy source is drained;
+  // Intel recommends 10 attempts for RDRAND.
+  static const unsigned int RdSeedRetries = 64;
+  static const unsigned int RdRandRetries = 10;
+
+  // Private to this module
+  static Mutex& GetHardwareLock();
+  static bool RdSeed32(CryptoPP::word32& value);
+  static bool RdRand32(CryptoPP::word32& value);
+
+  // Hardware entropy settings and health, guarded by GetHardwareLock()
+  static bool g_hardwareEnabled = true;
+  static unsigned int g_hardwareFailures = 0;
+  static unsigned int g_hardwareConsecutive = 0;
+
   /**
    * A lock for the internal operations. Its static because GetSharedIntstance()
    * serves up a single static object. Before the first construction of the static
@@ -31,11 +57,44 @@ namespace esapi
     return s_lock;
   }
 
+  /**
+   * One shard of the pool: an independently keyed AES-256/OFB cipher and its lock.
+   */
+  class RandomPoolShard : private NotCopyable
+  {
+  public:
+    RandomPoolShard()
+      : lock(), keyed(false), epoch(0), fork(0), generated(0), cipher()
+    {
+    }
+
+    Mutex lock;
+
+    /**
+     * Keying status, the pool epoch and fork generation the shard was keyed under,
+     * and the number of bytes generated since.
+     */
+    bool keyed;
+    unsigned int epoch;
+    unsigned int fork;
+    size_t generated;
+
+    /**
+     * Crypto++ cipher.
+     */
+    CryptoPP::OFB_Mode<CryptoPP::AES>::Encryption cipher;
+
+    /**
+     * Keeps the next allocation off the cache line holding the cipher's state.
+     */
+    byte pad[64];
+  };
+
   /**
    * Create a random pool. Users must call GetSharedInstance().
    */
   RandomPool::RandomPool( )
-    : m_keyed(false), m_cipher()
+    : m_shards(), m_epoch(0)
   {
   }
 
@@ -48,7 +107,19 @@ namespace esapi
     // a private function and only called by GetSharedInstance(). GetSharedInstance()
     // will acquire the the lock during double check initialization.
 
-    bool result = Rekey();
+    if(m_shards.empty())
+      {
+        const size_t count = std::min((size_t)CpuFeatures::ProcessorCount(), (size_t)MaxShards);
+        for(size_t i = 0; i < count; i++)
+          m_shards.push_back(shared_ptr<RandomPoolShard>(new RandomPoolShard));
+      }
+
+    // The remaining shards are keyed on first use. Keying one now reports a
+    // broken entropy source at startup.
+    RandomPoolShard& shard = *m_shards[0];
+    MutexLock lock(shard.lock);
+
+    bool result = Rekey(shard);
     ASSERT(result);
     if(!result)
       throw EncryptionException("Failed to initialize the random poo");
@@ -62,50 +133,92 @@ namespace esapi
   }
 
   /**
-   * Reseed the random pool. The pool will re-key and re-sync itself using bits acquired
-   * from the Operating System provided pool. Internally, Reseed() calls Rekey().
-   * As an external function, Reseed() grabs the lock.
+   * Reseed the random pool. The shard serving the caller re-keys and re-syncs itself
+   * using bits acquired from the Operating System provided pool; the other shards
+   * follow on their next request. Internally, Reseed() calls Rekey().
    */
   void RandomPool::Reseed()
   {
-    // Forward facing function. Lock the object to ensure state integrity.
-    MutexLock lock(RandomPool::GetSharedLock());
+    {
+      MutexLock lock(RandomPool::GetSharedLock());
+      m_epoch = m_epoch + 1;
+      MEMORY_BARRIER();
+    }
+
+    // Forward facing function. Lock the shard to ensure state integrity.
+    RandomPoolShard& shard = SelectShard();
+    MutexLock lock(shard.lock);
 
-    bool result = Rekey();
+    bool result = Rekey(shard);
     ASSERT(result);
     if(!result)
       throw EncryptionException("Failed to reseed the random poo");
   }
 
   /**
-   * Rekey the random pool. The pool will re-key and re-sync itself using bits
-   * acquired from the Operating System provided pool. As an internal function,
-   * the lock *is not* acquired.
+   * Returns the number of shards.
+   */
+  size_t RandomPool::GetShardCount() const
+  {
+    return m_shards.size();
+  }
+
+  /**
+   * Returns the shard serving the calling thread.
+   */
+  RandomPoolShard& RandomPool::SelectShard() const
+  {
+    ASSERT(!m_shards.empty());
+    return *m_shards[GetShardHint() % m_shards.size()];
+  }
+
+  /**
+   * Rekey a shard. The shard will re-key and re-sync itself using bits acquired
+   * from the Operating System provided pool. As an internal function, the lock
+   * *is not* acquired.
    */
-  bool RandomPool::Rekey()
+  bool RandomPool::Rekey(RandomPoolShard& shard)
   {
     try
       {
-        m_keyed = false;
+        shard.keyed = false;
+
+        // Read the epoch before the OS bits, so a Reseed() racing with this rekey
+        // causes another one.
+        const unsigned int epoch = m_epoch;
+        const unsigned int fork = GetForkGeneration();
+        MEMORY_BARRIER();
 
         // Key and IV
         byte key[32 /*AES256 key*/ + 16 /*IV, AES Blocksize*/];
-        ByteArrayZeroizer(key, sizeof(key));
+        ByteArrayZeroizer z1(key, sizeof(key));
 
         if(GenerateKeyAndIv(key, sizeof(key)))
           {      
             CryptoPP::SHA512 hash;
 
+            // Hardware output is only ever an additional input to the hash
+            byte extra[sizeof(key)];
+            ByteArrayZeroizer z2(extra, sizeof(extra));
+            const bool hardware = GetHardwareEntropy(extra, sizeof(extra));
+
             // Hash key in place
             hash.Update(key, 32);
+            if(hardware)
+              hash.Update(extra, 32);
             hash.TruncatedFinal(key, 32);
 
             // Hash iv in place
             hash.Update(key+32, 16);
+            if(hardware)
+              hash.Update(extra+32, 16);
             hash.TruncatedFinal(key+32, 16);
 
-            m_cipher.SetKeyWithIV(key, 32, key+32);
-            m_keyed = true;
+            shard.cipher.SetKeyWithIV(key, 32, key+32);
+            shard.keyed = true;
+            shard.epoch = epoch;
+            shard.fork = fork;
+            shard.generated = 0;
           }
       }
     catch(const CryptoPP::Exception& ex)
@@ -113,27 +226,31 @@ namespace esapi
         throw EncryptionException(NarrowString("Internal error: ") + ex.what());
       }
 
-    return m_keyed;
+    return shard.keyed;
   }
 
   RandomPool& RandomPool::GetSharedInstance()
   {
-    // Forward facing function. Lock the object to ensure state integrity.
-    MutexLock lock(RandomPool::GetSharedLock());
-
-    static volatile bool init = false;
-    static RandomPool s_pool;
+    // Only the first call takes the lock. The pool is constructed and initialized
+    // under the lock, and published after a barrier.
+    static RandomPool* volatile s_instance = nullptr;
 
     MEMORY_BARRIER();
-    if(!init)
+    if(!s_instance)
       {
-        s_pool.Init();
+        MutexLock lock(RandomPool::GetSharedLock());
 
-        init = true;
-        MEMORY_BARRIER();
+        if(!s_instance)
+          {
+            static RandomPool s_pool;
+            s_pool.Init();
+
+            MEMORY_BARRIER();
+            s_instance = &s_pool;
+          }
       }
 
-    return s_pool;
+    return *s_instance;
   }
 
   /**
@@ -141,14 +258,21 @@ namespace esapi
    */
   void RandomPool::GenerateBlock(byte* bytes, size_t size)
   {
-    // Forward facing function. Lock the object to ensure state integrity.
-    MutexLock lock(RandomPool::GetSharedLock());
-
     ASSERT(bytes && size);
     if( !(bytes && size) )
       throw IllegalArgumentException("The buffer or size is not valid");
 
-    if(!m_keyed)
+    // Forward facing function. Lock the shard to ensure state integrity.
+    RandomPoolShard& shard = SelectShard();
+    MutexLock lock(shard.lock);
+
+    // A shard inherited across a fork() is rekeyed before the child uses it
+    MEMORY_BARRIER();
+    if(!shard.keyed || shard.epoch != m_epoch || shard.fork != GetForkGeneration() ||
+       shard.generated >= (size_t)ShardRekeyBytes)
+      Rekey(shard);
+
+    if(!shard.keyed)
       throw EncryptionException("Failed to generate a block in the random pool (1)");
 
     try
@@ -159,11 +283,13 @@ namespace esapi
         if(!GetTimeData(data, sizeof(data)))
           throw EncryptionException("Failed to generate a block in the random pool (2)");
 
+        shard.generated += size;
+
         size_t idx = 0;
         while(size)
           {
             // Always process a full block.
-            m_cipher.ProcessData(data, data, sizeof(data));
+            shard.cipher.ProcessData(data, data, sizeof(data));
 
             const size_t req = std::min(size, (size_t)CryptoPP::AES::BLOCKSIZE);
             ::memcpy(bytes+idx, data, req);
@@ -177,5 +303,149 @@ namespace esapi
         throw EncryptionException(NarrowString("Internal error: ") + ex.what());
       }
   }
-}
 
+  void RandomPool::SetHardwareEntropy(bool enable)
+  {
+    MutexLock lock(GetHardwareLock());
+    g_hardwareEnabled = enable;
+  }
+
+  bool RandomPool::UsesHardwareEntropy()
+  {
+#if defined(ESAPI_HARDWARE_RNG_ASM) || defined(ESAPI_HARDWARE_RNG_INTRIN)
+    if(!CpuFeatures::HasRDSEED() && !CpuFeatures::HasRDRAND())
+      return false;
+
+    MutexLock lock(GetHardwareLock());
+    return g_hardwareEnabled && g_hardwareConsecutive < (unsigned int)MaxHardwareFailures;
+#else
+    return false;
+#endif
+  }
+
+  unsigned int RandomPool::GetHardwareEntropyFailures()
+  {
+    MutexLock lock(GetHardwareLock());
+    return g_hardwareFailures;
+  }
+
+  /**
+   * Fills data with RDSEED (preferred) or RDRAND output. A draw fails if a word
+   * cannot be had within the retry bound, or if a word repeats the one before it
+   * (a continuous test in the spirit of FIPS 140-2, 4.9.2). Failures are counted,
+   * and the source is retired after MaxHardwareFailures in a row.
+   */
+  bool RandomPool::GetHardwareEntropy(byte* data, size_t dsize)
+  {
+    ASSERT(data && dsize);
+    if(!data || !dsize) return false;
+
+    if(!UsesHardwareEntropy())
+      return false;
+
+    const bool seed = CpuFeatures::HasRDSEED();
+    bool ok = true;
+
+    CryptoPP::word32 last = 0, value = 0;
+    for(size_t idx = 0; ok && idx < dsize; idx += sizeof(value))
+      {
+        ok = seed ? RdSeed32(value) : RdRand32(value);
+        if(ok && idx && value == last)
+          ok = false;
+
+        last = value;
+        ::memcpy(data+idx, &value, std::min(sizeof(value), dsize-idx));
+      }
+
+    value = last = 0;
+
+    MutexLock lock(GetHardwareLock());
+    if(ok)
+      {
+        g_hardwareConsecutive = 0;
+        return true;
+      }
+
+    ::memset(data, 0x00, dsize);
+
+    g_hardwareFailures++;
+    g_hardwareConsecutive++;
+    ESAPI_ASSERT2(g_hardwareConsecutive < (unsigned int)MaxHardwareFailures, "Hardware entropy source failed its health check");
+
+    return false;
+  }
+
+  static Mutex& GetHardwareLock()
+  {
+    static Mutex s_lock;
+    return s_lock;
+  }
+
+#if defined(ESAPI_HARDWARE_RNG_ASM)
+
+  // The instructions are spelled out for assemblers which pre-date the mnemonics
+  static bool RdSeed32(CryptoPP::word32& value)
+  {
+    for(unsigned int i = 0; i < RdSeedRetries; i++)
+      {
+        unsigned char ok = 0;
+        __asm__ __volatile__ (".byte 0x0f, 0xc7, 0xf8\n\t" "setc %1" : "=a" (value), "=qm" (ok) : : "cc");
+        if(ok) return true;
+      }
+
+    return false;
+  }
+
+  static bool RdRand32(CryptoPP::word32& value)
+  {
+    for(unsigned int i = 0; i < RdRandRetries; i++)
+      {
+        unsigned char ok = 0;
+        __asm__ __volatile__ (".byte 0x0f, 0xc7, 0xf0\n\t" "setc %1" : "=a" (value), "=qm" (ok) : : "cc");
+        if(ok) return true;
+      }
+
+    return false;
+  }
+
+#elif defined(ESAPI_HARDWARE_RNG_INTRIN)
+
+  static bool RdSeed32(CryptoPP::word32& value)
+  {
+    for(unsigned int i = 0; i < RdSeedRetries; i++)
+      {
+        unsigned int v = 0;
+        if(_rdseed32_step(&v)) { value = v; return true; }
+      }
+
+    return false;
+  }
+
+  static bool RdRand32(CryptoPP::word32& value)
+  {
+    for(unsigned int i = 0; i < RdRandRetries; i++)
+      {
+        unsigned int v = 0;
+        if(_rdrand32_step(&v)) { value = v; return true; }
+      }
+
+    return false;
+  }
+
+#else
+
+  // No way to issue the instructions with this compiler; UsesHardwareEntropy() is false
+  static bool RdSeed32(CryptoPP::word32& value)
+  {
+    value = 0;
+    return false;
+  }
+
+  static bool RdRand32(CryptoPP::word32& value)
+  {
+    value = 0;
+    return false;
+  }
+
+#endif
+}
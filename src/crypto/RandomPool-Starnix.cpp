@@ -26,8 +26,31 @@
 # include <linux/random.h>
 #endif
 
+#if defined(ESAPI_OS_LINUX) && defined(__GLIBC__)
+# include <sched.h>
+#endif
+
+#include <pthread.h>
+
 namespace esapi
 {
+  // Incremented in the child by the pthread_atfork() handler
+  static volatile unsigned int g_forkGeneration = 0;
+  static pthread_once_t g_forkOnce = PTHREAD_ONCE_INIT;
+
+  static void OnForkChild()
+  {
+    // The child is single threaded here, so a plain increment is safe
+    g_forkGeneration = g_forkGeneration + 1;
+  }
+
+  static void RegisterForkHandler()
+  {
+    int ret = pthread_atfork(nullptr, nullptr, OnForkChild);
+    ESAPI_ASSERT2(ret == 0, "Failed to register the fork handler");
+    UNUSED_VARIABLE(ret);
+  }
+
   // Helper to automatically close a file descriptor
   class AutoFileDesc
   {
@@ -149,5 +172,41 @@ namespace esapi
 
     return true;
   }
-}
 
+  /**
+   * Returns a hint for the calling thread's shard. On Linux this is the processor
+   * the thread is running on, so threads on one core share a shard and threads on
+   * different cores do not. Elsewhere the hint is a hash of the thread id.
+   */
+  unsigned int RandomPool::GetShardHint()
+  {
+#if defined(ESAPI_OS_LINUX) && defined(__GLIBC__)
+    const int cpu = sched_getcpu();
+    if(cpu >= 0)
+      return (unsigned int)cpu;
+#endif
+
+    // pthread_t is opaque, so hash its bytes (FNV-1a)
+    const pthread_t self = pthread_self();
+    const byte* ptr = (const byte*)&self;
+
+    unsigned int hash = 2166136261u;
+    for(size_t i = 0; i < sizeof(self); i++)
+      hash = (hash ^ ptr[i]) * 16777619u;
+
+    return hash;
+  }
+
+  /**
+   * Returns the number of fork()s between the first call and the calling process.
+   * The first call registers the pthread_atfork() handler, so the pool and each
+   * SecureRandom call this when they are created.
+   */
+  unsigned int RandomPool::GetForkGeneration()
+  {
+    pthread_once(&g_forkOnce, RegisterForkHandler);
+
+    MEMORY_BARRIER();
+    return g_forkGeneration;
+  }
+}
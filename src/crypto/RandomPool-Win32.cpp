@@ -144,5 +144,22 @@ namespace esapi
 
     return true;
   }
-}
 
+  /**
+   * Returns a hint for the calling thread's shard. GetCurrentProcessorNumber()
+   * needs Vista and ESAPI targets Windows 2000, so the hint is the thread id.
+   */
+  unsigned int RandomPool::GetShardHint()
+  {
+    // Thread ids are multiples of 4
+    return (unsigned int)(::GetCurrentThreadId() >> 2);
+  }
+
+  /**
+   * Windows has no fork(), so the generation never changes.
+   */
+  unsigned int RandomPool::GetForkGeneration()
+  {
+    return 0;
+  }
+}
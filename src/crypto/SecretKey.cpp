@@ -21,36 +21,36 @@ namespace esapi
   SecretKey::SecretKey(const NarrowString& alg,
     const size_t sizeInBytes,
     const NarrowString& format)
-    : m_algorithm(alg), m_secBlock(sizeInBytes), m_format(format)
+    : m_algorithm(alg), m_key(sizeInBytes), m_format(format)
   {
     ASSERT( !m_algorithm.empty() );
-    ASSERT( m_secBlock.size() );
+    ASSERT( m_key.size() );
     ASSERT( !m_format.empty() );
 
     if(sizeInBytes)
     {
       SecureRandom prng = SecureRandom::getInstance(alg);
-      prng.nextBytes(m_secBlock.data(), m_secBlock.size());
+      prng.nextBytes(m_key.data(), m_key.size());
     }
   }
 
   SecretKey::SecretKey(const NarrowString& alg,
     const CryptoPP::SecByteBlock& bytes,
     const NarrowString& format)
-    : m_algorithm(alg), m_secBlock(bytes), m_format(format)
+    : m_algorithm(alg), m_key(bytes.begin(), bytes.end()), m_format(format)
   {
     ASSERT( !m_algorithm.empty() );
-    ASSERT( m_secBlock.size() );
+    ASSERT( m_key.size() );
     ASSERT( !m_format.empty() );
   }
 
   SecretKey::SecretKey(const NarrowString& alg,
     const SecureByteArray& bytes,
     const NarrowString& format)
-    : m_algorithm(alg), m_secBlock(bytes.data(), bytes.size()), m_format(format)
+    : m_algorithm(alg), m_key(bytes), m_format(format)
   {
     ASSERT( !m_algorithm.empty() );
-    ASSERT( m_secBlock.size() );
+    ASSERT( m_key.size() );
     ASSERT( !m_format.empty() );
   }
 
@@ -59,7 +59,7 @@ namespace esapi
   }
 
   SecretKey::SecretKey(const SecretKey& rhs)
-    : Key(rhs), m_algorithm(rhs.m_algorithm), m_secBlock(rhs.m_secBlock), m_format(rhs.m_format)
+    : Key(rhs), m_algorithm(rhs.m_algorithm), m_key(rhs.m_key), m_format(rhs.m_format)
   {
   }
 
@@ -71,7 +71,7 @@ namespace esapi
       Key::operator =(rhs);
 
       m_algorithm = rhs.m_algorithm;
-      m_secBlock = rhs.m_secBlock;
+      m_key = rhs.m_key;
       m_format = rhs.m_format;
     }
 
@@ -84,7 +84,7 @@ namespace esapi
   SecretKey& SecretKey::operator=(const SecureByteArray& rhs)
   {
       m_algorithm = "Unknown";
-      m_secBlock = CryptoPP::SecByteBlock(rhs.data(), rhs.size());
+      m_key = rhs;
       m_format = "RAW";
 
       return *this;
@@ -92,9 +92,9 @@ namespace esapi
 
   SecureByteArray SecretKey::getEncoded() const
   {
-    ASSERT(m_secBlock.data());
-    ASSERT(m_secBlock.size());
-    return SecureByteArray(m_secBlock.data(), m_secBlock.size());
+    ASSERT(m_key.data());
+    ASSERT(m_key.size());
+    return m_key.clone();
   }
 
   // The return value is a bit confusing. If the key supports encoding, return
@@ -114,18 +114,24 @@ namespace esapi
 
   const byte* SecretKey::BytePtr() const
   {
-      ASSERT(m_secBlock.data());
-      return m_secBlock.data();
+      ASSERT(m_key.data());
+      return m_key.data();
   }
 
   size_t SecretKey::sizeInBytes() const
   {
-    ASSERT(m_secBlock.size());
-    return m_secBlock.size();
+    ASSERT(m_key.size());
+    return m_key.size();
   }
 
-  bool operator==(const SecretKey& lhs, const SecretKey& rhs) { return lhs.m_secBlock == rhs.m_secBlock; }
-  bool operator!=(const SecretKey& lhs, const SecretKey& rhs)  { return lhs.m_secBlock != rhs.m_secBlock; }
+  // Constant time, like SecByteBlock's comparison
+  bool operator==(const SecretKey& lhs, const SecretKey& rhs)
+  {
+    return lhs.m_key.size() == rhs.m_key.size() &&
+      (lhs.m_key.empty() || CryptoPP::VerifyBufsEqual(lhs.m_key.data(), rhs.m_key.data(), lhs.m_key.size()));
+  }
+
+  bool operator!=(const SecretKey& lhs, const SecretKey& rhs) { return !(lhs == rhs); }
 
   std::ostream& operator<<(std::ostream& os, const SecretKey& rhs)
   {
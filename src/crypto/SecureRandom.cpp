@@ -34,6 +34,15 @@ namespace esapi
         return NarrowString("SHA-256");
     }
 
+    /**
+     * The default percentage of the reseed interval after which a generator
+     * automatically reseeds itself. Currently returns 75.
+     */
+    unsigned int SecureRandom::DefaultAutoReseed()
+    {
+        return 75;
+    }
+
     /**
      * Returns a SecureRandom object that implements the specified Random Number Generator (RNG) algorithm.
      */
@@ -41,8 +50,7 @@ namespace esapi
     {
         ASSERT( !algorithm.empty() );
 
-        const NarrowString alg(AlgorithmName::normalizeAlgorithm(algorithm));
-        SecureRandomBase* impl = SecureRandomBase::createInstance(alg, nullptr, 0);
+        SecureRandomBase* impl = SecureRandomBase::createInstance(AlgorithmName(algorithm), nullptr, 0);
         MEMORY_BARRIER();
 
         ASSERT(impl != nullptr);
@@ -64,7 +72,7 @@ namespace esapi
      */
     SecureRandom::SecureRandom(const NarrowString& algorithm)   
         : m_lock(new Mutex),
-          m_impl(SecureRandomBase::createInstance(AlgorithmName::normalizeAlgorithm(algorithm), nullptr, 0))    
+          m_impl(SecureRandomBase::createInstance(AlgorithmName(algorithm), nullptr, 0))    
     {
         ASSERT( !algorithm.empty() );
         ASSERT(m_lock.get() != nullptr);
@@ -77,7 +85,7 @@ namespace esapi
      */
     SecureRandom::SecureRandom(const WideString& algorithm)   
         : m_lock(new Mutex),
-          m_impl(SecureRandomBase::createInstance(TextConvert::WideToNarrow(AlgorithmName::normalizeAlgorithm(algorithm)), nullptr, 0))
+          m_impl(SecureRandomBase::createInstance(AlgorithmName(algorithm), nullptr, 0))
     {
         ASSERT( !algorithm.empty() );
         ASSERT(m_lock.get() != nullptr);
@@ -88,7 +96,7 @@ namespace esapi
      * Constructs a secure random number generator (RNG) implementing the default random number algorithm.
      */
     SecureRandom::SecureRandom(const byte seed[], size_t size)  
-        : m_lock(new Mutex), m_impl(SecureRandomBase::createInstance(DefaultAlgorithm(), seed, size))
+        : m_lock(new Mutex), m_impl(SecureRandomBase::createInstance(AlgorithmName(DefaultAlgorithm()), seed, size))
     {
         ASSERT(m_lock.get() != nullptr);
         ASSERT(m_impl.get() != nullptr);
@@ -159,6 +167,7 @@ namespace esapi
         MutexLock lock(getObjectLock());
 
         ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
         return m_impl->generateSeedImpl(numBytes);
     }
 
@@ -196,9 +205,119 @@ namespace esapi
         MutexLock lock(getObjectLock());
 
         ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
         m_impl->nextBytesImpl(bytes, size);
     }
 
+    /**
+     * Returns a uniformly distributed int.
+     */
+    int SecureRandom::nextInt()
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
+        return (int)m_impl->nextWord32Impl();
+    }
+
+    /**
+     * Returns a uniformly distributed int in [0, bound).
+     */
+    int SecureRandom::nextInt(int bound)
+    {
+        ASSERT(bound > 0);
+        if(!(bound > 0))
+            throw IllegalArgumentException("The bound must be positive");
+
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
+        return (int)m_impl->nextBoundedImpl((CryptoPP::word32)bound);
+    }
+
+    /**
+     * Fills values with uniformly distributed ints in [0, bound).
+     */
+    void SecureRandom::nextInts(int values[], size_t count, int bound)
+    {
+        ASSERT(values || !count);
+        if(!values && count)
+            throw IllegalArgumentException("The values array is not valid");
+
+        ASSERT(bound > 0);
+        if(!(bound > 0))
+            throw IllegalArgumentException("The bound must be positive");
+
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
+        for(size_t i = 0; i < count; i++)
+            values[i] = (int)m_impl->nextBoundedImpl((CryptoPP::word32)bound);
+    }
+
+    /**
+     * Returns a uniformly distributed long long.
+     */
+    long long SecureRandom::nextLong()
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
+        return (long long)m_impl->nextWord64Impl();
+    }
+
+    /**
+     * Returns a uniformly distributed double in [0.0, 1.0).
+     */
+    double SecureRandom::nextDouble()
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
+
+        // Top 53 bits, scaled by 2^-53
+        return (double)(m_impl->nextWord64Impl() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /**
+     * Returns a uniformly distributed bool.
+     */
+    bool SecureRandom::nextBoolean()
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
+        return (m_impl->nextWord32Impl() & 1) != 0;
+    }
+
+    /**
+     * Fills indices[i] with a uniformly distributed value in [0, bound - i).
+     */
+    void SecureRandom::nextShuffleIndices(size_t bound, size_t indices[], size_t count)
+    {
+        ASSERT(indices && count && count < bound);
+
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
+        for(size_t i = 0; i < count; i++)
+            indices[i] = (size_t)m_impl->nextBounded64Impl((CryptoPP::word64)(bound - i));
+    }
+
     /**
      * Reseeds this random object.
      */
@@ -207,12 +326,17 @@ namespace esapi
         // All forward facing gear which manipulates internal state acquires the object lock
         MutexLock lock(getObjectLock());
 
+        // Drop state inherited across a fork() before it feeds the reseed
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
+
         // No need to lock RandomPool - it provides its own
         RandomPool::GetSharedInstance().Reseed();
 
         // Reseed the SecureRandom object
         ASSERT(m_impl.get() != nullptr);
         m_impl->setSeedImpl(seed, size);
+        m_impl->discardBlockImpl();
     }
 
     /**
@@ -223,8 +347,39 @@ namespace esapi
         // All forward facing gear which manipulates internal state acquires the object lock
         MutexLock lock(getObjectLock());
 
+        // Drop state inherited across a fork() before it feeds the reseed
         ASSERT(m_impl.get() != nullptr);
+        m_impl->checkForkImpl();
+
         m_impl->setSeedImpl((const byte*)&seed, sizeof(seed));
+        m_impl->discardBlockImpl();
+    }
+
+    /**
+     * Sets the percentage of the reseed interval after which this random object
+     * automatically reseeds itself from the RandomPool. A value of 0 disables
+     * automatic reseeding, and nextBytes() throws once a reseed is required.
+     */
+    void SecureRandom::setAutoReseed(unsigned int percent)
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        m_impl->setAutoReseedImpl(percent);
+    }
+
+    /**
+     * Returns the percentage of the reseed interval after which this random
+     * object automatically reseeds itself.
+     */
+    unsigned int SecureRandom::getAutoReseed() const
+    {
+        // All forward facing gear which manipulates internal state acquires the object lock
+        MutexLock lock(getObjectLock());
+
+        ASSERT(m_impl.get() != nullptr);
+        return m_impl->getAutoReseedImpl();
     }
 
 } // esapi
@@ -17,6 +17,8 @@
 #include "util/AlgorithmName.h"
 #include "util/ArrayZeroizer.h"
 #include "crypto/RandomPool.h"
+#include "crypto/AcceleratedHash.h"
+#include "crypto/SecureRandom.h"
 #include "crypto/SecureRandomImpl.h"
 #include "errors/EncryptionException.h"
 #include "errors/IllegalArgumentException.h"
@@ -101,9 +103,13 @@
  * the Random Pool.
  *
  * Finally, a generator has a finite lifetime. At end of life, the PRNG must
- * be reseeded. The standard does not discuss Auto Seeding, so it is not performed.
- * Instead an exception is thrown after ~2^12 invocations (not bytes). A comment
- * was filed with NIST asking for guidance on Auto Seeding.
+ * be reseeded. The standard does not discuss Auto Seeding, so a comment was
+ * filed with NIST asking for guidance. In the meantime, the generators reseed
+ * themselves from the Random Pool once a percentage of the ~2^12 invocation (not
+ * bytes) interval has been used (see SecureRandom::DefaultAutoReseed()). Entropy
+ * for the reseed is drawn ahead of time so the generate call does not contend on
+ * the pool's lock at the reseed point. If Auto Seeding is disabled, an exception
+ * is thrown at the end of the interval and the user must call setSeed().
  */
 namespace esapi
 {
@@ -118,152 +124,302 @@ namespace esapi
      * Factory method to cough up an implementation.
      * Used by getInstance and most stack based SecureRandoms
      */
-    SecureRandomBase* SecureRandomBase::createInstance(const NarrowString& algorithm, const byte* seed, size_t size)
+    SecureRandomBase* SecureRandomBase::createInstance(const AlgorithmName& algorithm, const byte* seed, size_t size)
     {
         // http://download.oracle.com/javase/6/docs/technotes/guides/security/SunProviders.html
-        ASSERT( !algorithm.empty() );
-        AlgorithmName name(algorithm);
+        // The name was parsed and validated by AlgorithmName. Dispatch on the interned id.
 
         //ASSERT(seed);
         //ASSERT(size);
 
-        ////////////////////////////////// Hashes //////////////////////////////////
+        // A generator is named by its primitive alone (ie, SHA-256 or HmacSHA256)
+        if(algorithm.getModeId() == AlgorithmName::ModeAbsent)
+        {
+            switch(algorithm.getAlgorithmId())
+            {
+            ////////////////////////////////// Hashes //////////////////////////////////
 
-        if(algorithm == "SHA1PRNG")
-            return new HashImpl<CryptoPP::SHA1, DrbgInfo<10/*80*/, 55/*440*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgSHA1PRNG:
+            case AlgorithmName::AlgSHA1:
+                return new HashImpl<CryptoPP::SHA1, DrbgInfo<10/*80*/, 55/*440*/> >(algorithm, seed, size);
 
-        else if(algorithm == "SHA")
-            return new HashImpl<CryptoPP::SHA1, DrbgInfo<10/*80*/, 55/*440*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgSHA224:
+                return new HashImpl<AcceleratedSHA224, DrbgInfo<14/*112*/, 55/*440*/> >(algorithm, seed, size);
 
-        else if(algorithm == "SHA-1")
-            return new HashImpl<CryptoPP::SHA1, DrbgInfo<10/*80*/, 55/*440*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgSHA256:
+                return new HashImpl<AcceleratedSHA256, DrbgInfo<16/*128*/, 55/*440*/> >(algorithm, seed, size);
 
-        else if(algorithm == "SHA-224")
-            return new HashImpl<CryptoPP::SHA224, DrbgInfo<14/*112*/, 55/*440*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgSHA384:
+                return new HashImpl<CryptoPP::SHA384, DrbgInfo<24/*192*/, 111/*888*/> >(algorithm, seed, size);
 
-        else if(algorithm == "SHA-256")
-            return new HashImpl<CryptoPP::SHA256, DrbgInfo<16/*128*/, 55/*440*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgSHA512:
+                return new HashImpl<CryptoPP::SHA512, DrbgInfo<32/*256*/, 111/*888*/> >(algorithm, seed, size);
 
-        else if(algorithm == "SHA-384")
-            return new HashImpl<CryptoPP::SHA384, DrbgInfo<24/*192*/, 111/*888*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgWhirlpoo:
+                return new HashImpl<CryptoPP::Whirlpool, DrbgInfo<32/*256*/, 111/*888*/> >(algorithm, seed, size);
 
-        else if(algorithm == "SHA-512")
-            return new HashImpl<CryptoPP::SHA512, DrbgInfo<32/*256*/, 111/*888*/> >(algorithm, seed, size);
+            ////////////////////////////////// Block Ciphers //////////////////////////////////
 
-        else if(algorithm == "Whirlpoo")
-            return new HashImpl<CryptoPP::Whirlpool, DrbgInfo<32/*256*/, 111/*888*/> >(algorithm, seed, size);
+            // AlgorithmName does not carry a key size or a generator mode, so block cipher
+            // generators are 128-bit (112-bit for DES_ede) in CTR mode.
 
-        ////////////////////////////////// Block Ciphers //////////////////////////////////
+            case AlgorithmName::AlgAES:
+                return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CTR_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES" || algorithm == "AES128")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CTR_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgCamellia:
+                return new BlockCipherImpl<CryptoPP::Camellia, CryptoPP::CTR_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES/CFB" || algorithm == "AES128/CFB")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CFB_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgBlowfish:
+                return new BlockCipherImpl<CryptoPP::Blowfish, CryptoPP::CTR_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES/OFB" || algorithm == "AES128/OFB")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::OFB_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgDES_ede:
+                return new BlockCipherImpl<CryptoPP::DES_EDE3, CryptoPP::CTR_Mode, DrbgInfo<14/*112*/, 29/*232*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES/CTR" || algorithm == "AES128/CTR")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CTR_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+            ////////////////////////////////// Hmacs //////////////////////////////////
 
-        else if(algorithm == "AES192")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CTR_Mode, DrbgInfo<24/*192*/, 40/*320*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgHmacSHA1:
+                return new HmacImpl<CryptoPP::SHA1, DrbgInfo<10/*80*/, 55/*440*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES192/CFB")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CFB_Mode, DrbgInfo<24/*192*/, 40/*320*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgHmacSHA224:
+                return new HmacImpl<AcceleratedSHA224, DrbgInfo<14/*112*/, 55/*440*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES192/OFB")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::OFB_Mode, DrbgInfo<24/*192*/, 40/*320*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgHmacSHA256:
+                return new HmacImpl<AcceleratedSHA256, DrbgInfo<16/*128*/, 55/*440*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES192/CTR")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CTR_Mode, DrbgInfo<24/*192*/, 40/*320*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgHmacSHA384:
+                return new HmacImpl<CryptoPP::SHA384, DrbgInfo<24/*192*/, 111/*888*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES256")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CTR_Mode, DrbgInfo<32/*256*/, 48/*384*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgHmacSHA512:
+                return new HmacImpl<CryptoPP::SHA512, DrbgInfo<32/*256*/, 111/*888*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES256/CFB")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CFB_Mode, DrbgInfo<32/*256*/, 48/*384*/> >(algorithm, seed, size);
+            case AlgorithmName::AlgHmacWhirlpoo:
+                return new HmacImpl<CryptoPP::Whirlpool, DrbgInfo<32/*256*/, 111/*888*/> >(algorithm, seed, size);
 
-        else if(algorithm == "AES256/OFB")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::OFB_Mode, DrbgInfo<32/*256*/, 48/*384*/> >(algorithm, seed, size);
+            default:
+                break;
+            }
+        }
 
-        else if(algorithm == "AES256/CTR")
-            return new BlockCipherImpl<CryptoPP::AES, CryptoPP::CTR_Mode, DrbgInfo<32/*256*/, 48/*384*/> >(algorithm, seed, size);
+        ///////////////////////////////// Catch All /////////////////////////////////
 
-        else if(algorithm == "Camellia" || algorithm == "Camellia128")
-            return new BlockCipherImpl<CryptoPP::Camellia, CryptoPP::CTR_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+        std::ostringstream oss;
+        oss << "Algorithm \'" << algorithm.algorithm() << "\' is not supported.";
+        throw NoSuchAlgorithmException(oss.str());
+    }
 
-        else if(algorithm == "Camellia/CFB" || algorithm == "Camellia128/CFB")
-            return new BlockCipherImpl<CryptoPP::Camellia, CryptoPP::CFB_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+    /**
+     * Constructs a secure random number generator (RNG) implementing the named
+     * random number algorithm.
+     */
+    SecureRandomBase::SecureRandomBase(const AlgorithmName& algorithm, const byte*, size_t)
+        : m_catastrophic(false), m_algorithm(algorithm),
+          m_reseedPercent(SecureRandom::DefaultAutoReseed()), m_pending(),
+          m_block(), m_blockUsed(0), m_forkGeneration(RandomPool::GetForkGeneration())
+    {
+        //ASSERT(seed);
+        //ASSERT(size); 
+    }
 
-        if(algorithm == "Camellia/OFB" || algorithm == "Camellia128/OFB")
-            return new BlockCipherImpl<CryptoPP::Camellia, CryptoPP::OFB_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+    /**
+     * Sets the percentage of the reseed interval after which the generator
+     * reseeds itself. A value of 0 disables automatic reseeding.
+     */
+    void SecureRandomBase::setAutoReseedImpl(unsigned int percent)
+    {
+        ASSERT(percent <= 100);
+        if(percent > 100)
+            throw IllegalArgumentException("The automatic reseed percentage is not valid");
 
-        else if(algorithm == "Camellia/CTR" || algorithm == "Camellia128/CTR")
-            return new BlockCipherImpl<CryptoPP::Camellia, CryptoPP::CTR_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+        m_reseedPercent = percent;
+    }
 
-        else if(algorithm == "Blowfish" || algorithm == "Blowfish128")
-            return new BlockCipherImpl<CryptoPP::Blowfish, CryptoPP::CTR_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+    /**
+     * Returns the percentage of the reseed interval after which the generator
+     * reseeds itself.
+     */
+    unsigned int SecureRandomBase::getAutoReseedImpl() const
+    {
+        return m_reseedPercent;
+    }
 
-        else if(algorithm == "Blowfish/CFB" || algorithm == "Blowfish128/CFB")
-            return new BlockCipherImpl<CryptoPP::Blowfish, CryptoPP::CFB_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+    /**
+     * Determines if an automatic reseed is due. Entropy for the reseed is drawn from
+     * the RandomPool ahead of time (once half the threshold is reached), so the
+     * reseed itself does not wait on the shared pool.
+     */
+    bool SecureRandomBase::autoReseedDue(size_t rctr, size_t maxReseed, size_t seedLength)
+    {
+        if(!m_reseedPercent)
+            return false;
 
-        else if(algorithm == "Blowfish/OFB" || algorithm == "Blowfish128/OFB")
-            return new BlockCipherImpl<CryptoPP::Blowfish, CryptoPP::OFB_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+        // maxReseed is 2^12, so this does not overflow
+        const size_t threshold = std::max((size_t)1, maxReseed * m_reseedPercent / 100);
 
-        else if(algorithm == "Blowfish/CTR" || algorithm == "Blowfish128/CTR")
-            return new BlockCipherImpl<CryptoPP::Blowfish, CryptoPP::CTR_Mode, DrbgInfo<16/*128*/, 32/*256*/> >(algorithm, seed, size);
+        try
+        {
+            if(m_pending.empty() && rctr >= threshold / 2)
+            {
+                m_pending.New(seedLength);
+                RandomPool::GetSharedInstance().GenerateBlock(m_pending.data(), m_pending.size());
+            }
+        }
+        catch(CryptoPP::Exception& ex)
+        {
+            m_catastrophic = true;
+            throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+        }
 
-        else if(algorithm == "DES_ede" || algorithm == "DES_ede112")
-            return new BlockCipherImpl<CryptoPP::DES_EDE3, CryptoPP::CTR_Mode, DrbgInfo<14/*112*/, 29/*232*/> >(algorithm, seed, size);
+        return rctr >= threshold;
+    }
 
-        else if(algorithm == "DES_ede/CFB" || algorithm == "DES_ede112/CFB")
-            return new BlockCipherImpl<CryptoPP::DES_EDE3, CryptoPP::CFB_Mode, DrbgInfo<14/*112*/, 29/*232*/> >(algorithm, seed, size);
+    /**
+     * Retrieves entropy for a reseed. Material drawn ahead of time by autoReseedDue()
+     * is used if available, otherwise the bytes come from the RandomPool.
+     */
+    void SecureRandomBase::fetchEntropy(byte* entropy, size_t size)
+    {
+        ASSERT(entropy && size);
 
-        else if(algorithm == "DES_ede/OFB" || algorithm == "DES_ede112/OFB")
-            return new BlockCipherImpl<CryptoPP::DES_EDE3, CryptoPP::OFB_Mode, DrbgInfo<14/*112*/, 29/*232*/> >(algorithm, seed, size);
+        if(m_pending.size() == size)
+        {
+            ::memcpy(entropy, m_pending.data(), size);
 
-        else if(algorithm == "DES_ede/CTR" || algorithm == "DES_ede112/CTR")
-            return new BlockCipherImpl<CryptoPP::DES_EDE3, CryptoPP::CTR_Mode, DrbgInfo<14/*112*/, 29/*232*/> >(algorithm, seed, size);
+            ::memset(m_pending.data(), 0x00, m_pending.size());
+            m_pending.resize(0);
+            return;
+        }
 
-        ////////////////////////////////// Hmacs //////////////////////////////////
+        RandomPool::GetSharedInstance().GenerateBlock(entropy, size);
+    }
 
-        else if(algorithm == "HmacSHA1")
-            return new HmacImpl<CryptoPP::SHA1, DrbgInfo<10/*80*/, 55/*440*/> >(algorithm, seed, size);
+    /**
+     * Serves bytes for the typed values from a block of generator output, so one
+     * generate call covers many values. nextBytesImpl() does not use the block.
+     */
+    void SecureRandomBase::nextBlockBytesImpl(byte bytes[], size_t size)
+    {
+        ASSERT(bytes && size && size <= TypedBlockSize);
 
-        else if(algorithm == "HmacSHA224")
-            return new HmacImpl<CryptoPP::SHA224, DrbgInfo<14/*112*/, 55/*440*/> >(algorithm, seed, size);
+        if(m_block.size() - m_blockUsed < size)
+        {
+            if(m_block.size() != TypedBlockSize)
+                m_block.New(TypedBlockSize);
 
-        else if(algorithm == "HmacSHA256")
-            return new HmacImpl<CryptoPP::SHA256, DrbgInfo<16/*128*/, 55/*440*/> >(algorithm, seed, size);
+            nextBytesImpl(m_block.data(), m_block.size());
+            m_blockUsed = 0;
+        }
 
-        else if(algorithm == "HmacSHA384")
-            return new HmacImpl<CryptoPP::SHA384, DrbgInfo<24/*192*/, 111/*888*/> >(algorithm, seed, size);
+        // Bytes are wiped as they are handed out
+        ::memcpy(bytes, m_block.data() + m_blockUsed, size);
+        ::memset(m_block.data() + m_blockUsed, 0x00, size);
+        m_blockUsed += size;
+    }
 
-        else if(algorithm == "HmacSHA512")
-            return new HmacImpl<CryptoPP::SHA512, DrbgInfo<32/*256*/, 111/*888*/> >(algorithm, seed, size);
+    /**
+     * Zeroizes and discards the unused bytes of the block that serves the typed
+     * values. Called on reseed so no value predates the new seed.
+     */
+    void SecureRandomBase::discardBlockImpl()
+    {
+        if(m_block.size())
+            ::memset(m_block.data(), 0x00, m_block.size());
 
-        else if(algorithm == "HmacWhirlpoo")
-            return new HmacImpl<CryptoPP::Whirlpool, DrbgInfo<32/*256*/, 111/*888*/> >(algorithm, seed, size);
+        m_blockUsed = m_block.size();
+    }
 
-        ///////////////////////////////// Catch All /////////////////////////////////
+    /**
+     * If the process forked since the generator was last used, discards the state
+     * shared with the parent and reseeds from the child's RandomPool.
+     */
+    void SecureRandomBase::checkForkImpl()
+    {
+        const unsigned int generation = RandomPool::GetForkGeneration();
+        if(generation == m_forkGeneration)
+            return;
 
-        std::ostringstream oss;
-        oss << "Algorithm \'" << algorithm << "\' is not supported.";
-        throw NoSuchAlgorithmException(oss.str());
+        // The parent and every sibling hold the same block and pending entropy
+        discardBlockImpl();
+        if(m_pending.size())
+        {
+            ::memset(m_pending.data(), 0x00, m_pending.size());
+            m_pending.resize(0);
+        }
+
+        // The reseed draws from a pool shard which rekeys itself from the OS in the
+        // child. The generation is additional input.
+        setSeedImpl((const byte*)&generation, sizeof(generation));
+        m_forkGeneration = generation;
     }
 
     /**
-     * Constructs a secure random number generator (RNG) implementing the named
-     * random number algorithm.
+     * Returns a uniformly distributed 32-bit value.
      */
-    SecureRandomBase::SecureRandomBase(const NarrowString& algorithm, const byte*, size_t)
-        : m_catastrophic(false), m_algorithm(algorithm)
+    CryptoPP::word32 SecureRandomBase::nextWord32Impl()
     {
-        ASSERT( !algorithm.empty() );
-        //ASSERT(seed);
-        //ASSERT(size); 
+        CryptoPP::word32 value;
+        nextBlockBytesImpl((byte*)&value, sizeof(value));
+        return value;
+    }
+
+    /**
+     * Returns a uniformly distributed 64-bit value.
+     */
+    CryptoPP::word64 SecureRandomBase::nextWord64Impl()
+    {
+        CryptoPP::word64 value;
+        nextBlockBytesImpl((byte*)&value, sizeof(value));
+        return value;
+    }
+
+    /**
+     * Returns a uniformly distributed value in [0, bound). Uses Lemire's
+     * multiply-shift with rejection, so there is no modulo bias and a division
+     * is only needed on the rare path where a rejection is possible.
+     */
+    CryptoPP::word32 SecureRandomBase::nextBoundedImpl(CryptoPP::word32 bound)
+    {
+        ASSERT(bound);
+
+        CryptoPP::word64 m = (CryptoPP::word64)nextWord32Impl() * bound;
+        CryptoPP::word32 low = (CryptoPP::word32)m;
+
+        if(low < bound)
+        {
+            // 2^32 mod bound
+            const CryptoPP::word32 threshold = (CryptoPP::word32)(0 - bound) % bound;
+            while(low < threshold)
+            {
+                m = (CryptoPP::word64)nextWord32Impl() * bound;
+                low = (CryptoPP::word32)m;
+            }
+        }
+
+        return (CryptoPP::word32)(m >> 32);
+    }
+
+    /**
+     * Returns a uniformly distributed value in [0, bound) for bounds beyond 32 bits.
+     */
+    CryptoPP::word64 SecureRandomBase::nextBounded64Impl(CryptoPP::word64 bound)
+    {
+        ASSERT(bound);
+
+        if(bound <= 0xffffffff)
+            return nextBoundedImpl((CryptoPP::word32)bound);
+
+        // No portable 128-bit product, so mask to the next power of two and reject.
+        // Fewer than half the draws are rejected.
+        CryptoPP::word64 mask = bound - 1;
+        mask |= mask >> 1; mask |= mask >> 2; mask |= mask >> 4;
+        mask |= mask >> 8; mask |= mask >> 16; mask |= mask >> 32;
+
+        CryptoPP::word64 value;
+        do
+        {
+            value = nextWord64Impl() & mask;
+        } while(value >= bound);
+
+        return value;
     }
 
     /**
@@ -336,7 +492,7 @@ namespace esapi
      * Create a SecureRandom implementation based on a hash
      */
     template <class HASH, class DRBGINFO>
-    HashImpl<HASH, DRBGINFO>::HashImpl(const NarrowString& algorithm, const byte* seed, size_t ssize)
+    HashImpl<HASH, DRBGINFO>::HashImpl(const AlgorithmName& algorithm, const byte* seed, size_t ssize)
         : SecureRandomBase(algorithm, nullptr, 0), m_hash(), m_v(SeedLength), m_c(SeedLength), m_rctr(1)
     {
         // seed and size are thinly veiled as "Personalization", and it is optional.
@@ -432,6 +588,10 @@ namespace esapi
         if( !(bytes && size) )
             throw IllegalArgumentException("Unable to generate bytes from hmac drbg. The buffer or size is not valid");
 
+        // Reseed ahead of the end of the interval rather than throwing at it
+        if(autoReseedDue(m_rctr, MaxReseed, SeedLength))
+            HashReseed(nullptr, 0);
+
         ASSERT(m_rctr <= MaxReseed);
         if( !(m_rctr <= MaxReseed) )
             throw IllegalArgumentException("Unable to generate bytes from hmac drbg. A reseed is required");
@@ -708,8 +868,10 @@ namespace esapi
         ASSERT(SeedLength == m_v.size());
         ASSERT(SeedLength == m_c.size());
 
-        ASSERT(seed && ssize);
-        if(!seed || !ssize)
+        // seed and size are optional (an automatic reseed has no additional input).
+        // If size is non-zero, seed must be valid.
+        ASSERT( (!seed && !ssize) || (seed && ssize) );
+        if(!seed && ssize)
             throw IllegalArgumentException("Unable to reseed hash drbg. The seed buffer or size is not valid");
 
         try
@@ -723,7 +885,7 @@ namespace esapi
             ::memcpy(material.data()+idx, m_v.data(), m_v.size());
             idx += m_v.size();
 
-            RandomPool::GetSharedInstance().GenerateBlock(material.data()+idx, SeedLength);
+            fetchEntropy(material.data()+idx, SeedLength);
             idx += SeedLength;
 
             if(seed)
@@ -754,7 +916,7 @@ namespace esapi
      * Create a SecureRandom implementation based on a block cipher
      */
     template <class HASH, class DRBGINFO>
-    HmacImpl<HASH, DRBGINFO>::HmacImpl(const NarrowString& algorithm, const byte* seed, size_t ssize)
+    HmacImpl<HASH, DRBGINFO>::HmacImpl(const AlgorithmName& algorithm, const byte* seed, size_t ssize)
         : SecureRandomBase(algorithm, nullptr, 0), m_hmac(), m_v(DigestLength), m_k(DigestLength), m_rctr(1)
     {
         // seed and size are optional. If size is non-zero, seed must be valid
@@ -840,6 +1002,10 @@ namespace esapi
         if( !(bytes && size) )
             throw IllegalArgumentException("Unable to generate bytes from hash drbg. The buffer or size is not valid");
 
+        // Reseed ahead of the end of the interval rather than throwing at it
+        if(autoReseedDue(m_rctr, MaxReseed, SeedLength))
+            HmacReseed(nullptr, 0);
+
         ASSERT(m_rctr <= MaxReseed);
         if( !(m_rctr <= MaxReseed) )
             throw IllegalArgumentException("Unable to generate bytes from hash drbg. A reseed is required");
@@ -1083,8 +1249,10 @@ namespace esapi
         ASSERT(DigestLength == m_v.size());
         ASSERT(DigestLength == m_k.size());
 
-        ASSERT(seed && ssize);
-        if(!seed || !ssize)
+        // seed and size are optional (an automatic reseed has no additional input).
+        // If size is non-zero, seed must be valid.
+        ASSERT( (!seed && !ssize) || (seed && ssize) );
+        if(!seed && ssize)
             throw IllegalArgumentException("Unable to reseed hmac drbg. The seed buffer or size is not valid");
 
         try
@@ -1096,13 +1264,18 @@ namespace esapi
             const size_t msize /*seed material size*/ = SeedLength;
             CryptoPP::SecByteBlock material(msize + ssize);
 
-            RandomPool::GetSharedInstance().GenerateBlock(material.data(), msize);
+            fetchEntropy(material.data(), msize);
 
             // Copy in the user provided "personalization"
             if(seed && ssize)
                 ::memcpy(material.data()+msize, seed, ssize);
 
             HmacUpdate(material.data(), material.size());
+
+            /////////////////////////////////////////////////////////
+            // Reset the reseed counter, Section 10.1.2.4, Step 3
+            /////////////////////////////////////////////////////////
+            m_rctr = 1;
         }
         catch(CryptoPP::Exception& ex)
         {
@@ -1119,7 +1292,7 @@ namespace esapi
      * Constructs a secure random number generator (RNG).
      */
     template <class CIPHER, template <class CPHR> class MODE, class DRBGINFO>
-    BlockCipherImpl<CIPHER, MODE, DRBGINFO>::BlockCipherImpl(const NarrowString& algorithm, const byte* /*seed*/, size_t /*size*/)
+    BlockCipherImpl<CIPHER, MODE, DRBGINFO>::BlockCipherImpl(const AlgorithmName& algorithm, const byte* /*seed*/, size_t /*size*/)
         : SecureRandomBase(algorithm, nullptr, 0), m_v(), m_c(), m_rctr(1)
     {
     }
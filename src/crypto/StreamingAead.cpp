@@ -0,0 +1,617 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/NotCopyable.h"
+#include "crypto/StreamingAead.h"
+#include "crypto/SecureRandom.h"
+#include "crypto/CryptoppCommon.h"
+
+#include "safeint/SafeInt3.hpp"
+
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <algorithm>
+
+#include <string.h>
+
+// GCM arrived in Crypto++ 5.6
+#if CRYPTOPP_VERSION >= 560
+# include <cryptopp/gcm.h>
+# define ESAPI_GCM_AVAILABLE 1
+#endif
+
+namespace esapi
+{
+  static const byte StreamVersion = 1;
+  static const byte StreamAlgorithmAesGcm = 1;
+
+  static const size_t SaltSize = 16;
+  static const size_t NoncePrefixSize = 7;
+  static const size_t NonceSize = 12;
+
+  // Offsets into the header
+  static const size_t VersionOffset = 0;
+  static const size_t AlgorithmOffset = 1;
+  static const size_t SegmentSizeOffset = 2;
+  static const size_t SaltOffset = 6;
+  static const size_t NoncePrefixOffset = 22;
+
+  // The segment counter is 32 bits
+  static const unsigned long long MaxSegments = 0x100000000ULL;
+
+  static const char StreamInfo[] = "ESAPI AES-GCM stream";
+
+  static void PutBigEndian32(byte* ptr, CryptoPP::word32 value)
+  {
+    ptr[0] = (byte)(value >> 24);
+    ptr[1] = (byte)(value >> 16);
+    ptr[2] = (byte)(value >> 8);
+    ptr[3] = (byte)(value);
+  }
+
+  static CryptoPP::word32 GetBigEndian32(const byte* ptr)
+  {
+    return ((CryptoPP::word32)ptr[0] << 24) | ((CryptoPP::word32)ptr[1] << 16) |
+           ((CryptoPP::word32)ptr[2] << 8) | (CryptoPP::word32)ptr[3];
+  }
+
+  static void CheckSegmentSize(size_t segmentSize)
+  {
+    ESAPI_ASSERT2(segmentSize >= StreamingAead::MinSegmentSize, "Segment size is too small");
+    ESAPI_ASSERT2(segmentSize <= StreamingAead::MaxSegmentSize, "Segment size is too large");
+
+    if(segmentSize < StreamingAead::MinSegmentSize || segmentSize > StreamingAead::MaxSegmentSize)
+      {
+        std::ostringstream oss;
+        oss << "Segment size " << segmentSize << " is not valid";
+        throw IllegalArgumentException(oss.str());
+      }
+  }
+
+  /**
+   * The state shared by both directions: the header, the stream key and the nonce
+   * under construction. The GCM object is keyed once per stream; each segment only
+   * resynchronizes it.
+   */
+  class StreamCipherState : private NotCopyable
+  {
+  public:
+    StreamCipherState()
+      : m_header(StreamingAead::HeaderSize), m_segmentSize(0)
+    {
+      ::memset(m_nonce, 0x00, sizeof(m_nonce));
+    }
+
+    ~StreamCipherState()
+    {
+      CryptoPP::SecureWipeArray(m_nonce, COUNTOF(m_nonce));
+    }
+
+    size_t segmentSize() const
+    {
+      return m_segmentSize;
+    }
+
+    const SecureByteArray& header() const
+    {
+      return m_header;
+    }
+
+  protected:
+    /**
+     * Derives the stream key from the key and the salt in the header.
+     */
+    void deriveKey(const SecretKey& key, CryptoPP::SecByteBlock& streamKey)
+    {
+      const SecureByteArray bytes = key.getEncoded();
+      const size_t ksize = bytes.size();
+
+      ESAPI_ASSERT2(ksize == 16 || ksize == 24 || ksize == 32, "Key size is not valid");
+      if(!(ksize == 16 || ksize == 24 || ksize == 32))
+        throw IllegalArgumentException("AES key size is not valid");
+
+      try
+        {
+          CryptoPP::HMAC<CryptoPP::SHA256> hmac(bytes.data(), bytes.size());
+          CryptoPP::SecByteBlock prk(hmac.DigestSize());
+
+          hmac.Update(m_header.data() + SaltOffset, SaltSize);
+          hmac.Update((const byte*)StreamInfo, sizeof(StreamInfo) - 1);
+          hmac.Final(prk.BytePtr());
+
+          streamKey.Assign(prk.BytePtr(), ksize);
+        }
+      catch(CryptoPP::Exception& ex)
+        {
+          throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+        }
+    }
+
+    /**
+     * Builds the nonce for a segment: prefix || index || last.
+     */
+    const byte* nonce(size_t index, bool last)
+    {
+      PutBigEndian32(m_nonce + NoncePrefixSize, (CryptoPP::word32)index);
+      m_nonce[NonceSize - 1] = (byte)(last ? 1 : 0);
+
+      return m_nonce;
+    }
+
+    void setNoncePrefix()
+    {
+      ::memcpy(m_nonce, m_header.data() + NoncePrefixOffset, NoncePrefixSize);
+    }
+
+    SecureByteArray m_header;
+    size_t m_segmentSize;
+
+  private:
+    byte m_nonce[NonceSize];
+  };
+
+  class StreamEncryptorImpl : public StreamCipherState
+  {
+  public:
+    StreamEncryptorImpl(const SecretKey& key, size_t segmentSize)
+      : m_next(0), m_finished(false)
+    {
+      CheckSegmentSize(segmentSize);
+      m_segmentSize = segmentSize;
+
+      m_header[VersionOffset] = StreamVersion;
+      m_header[AlgorithmOffset] = StreamAlgorithmAesGcm;
+      PutBigEndian32(m_header.data() + SegmentSizeOffset, (CryptoPP::word32)segmentSize);
+
+      // Salt and nonce prefix are adjacent, draw them together
+      SecureRandom prng = SecureRandom::getInstance();
+      prng.nextBytes(m_header.data() + SaltOffset, SaltSize + NoncePrefixSize);
+
+      setNoncePrefix();
+
+#if defined(ESAPI_GCM_AVAILABLE)
+      CryptoPP::SecByteBlock streamKey;
+      deriveKey(key, streamKey);
+
+      try
+        {
+          m_gcm.SetKeyWithIV(streamKey.BytePtr(), streamKey.size(), nonce(0, false), NonceSize);
+        }
+      catch(CryptoPP::Exception& ex)
+        {
+          throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+        }
+#else
+      (void)key;
+      throw EncryptionException("Encryption failed", "AES/GCM requires Crypto++ 5.6 or above");
+#endif
+    }
+
+    size_t encryptSegment(const byte input[], size_t size, bool last, byte output[], size_t outSize)
+    {
+      ESAPI_ASSERT2(!m_finished, "The stream is finished");
+      if(m_finished)
+        throw EncryptionException("Encryption failed", "The stream is finished");
+
+      ESAPI_ASSERT2(size == m_segmentSize || (last && size <= m_segmentSize), "Segment size is not valid");
+      if(!(size == m_segmentSize || (last && size <= m_segmentSize)))
+        throw IllegalArgumentException("Only the last segment may be shorter than the segment size");
+
+      ESAPI_ASSERT2(input || !size, "Input buffer is not valid");
+      if(!input && size)
+        throw IllegalArgumentException("Input buffer is not valid");
+
+      ESAPI_ASSERT2(output, "Output buffer is not valid");
+      ESAPI_ASSERT2(outSize >= size + StreamingAead::TagSize, "Output buffer is too small");
+      if(!output || outSize < size + StreamingAead::TagSize)
+        throw IllegalArgumentException("Output buffer is too small");
+
+      if(m_next >= MaxSegments)
+        throw EncryptionException("Encryption failed", "The stream has too many segments");
+
+#if defined(ESAPI_GCM_AVAILABLE)
+      try
+        {
+          m_gcm.EncryptAndAuthenticate(output, output + size, StreamingAead::TagSize,
+                                       nonce((size_t)m_next, last), (int)NonceSize,
+                                       m_header.data(), m_header.size(), input, size);
+        }
+      catch(CryptoPP::Exception& ex)
+        {
+          throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+        }
+#endif
+
+      m_next++;
+      m_finished = last;
+
+      return size + StreamingAead::TagSize;
+    }
+
+  private:
+    unsigned long long m_next;
+    bool m_finished;
+
+#if defined(ESAPI_GCM_AVAILABLE)
+    CryptoPP::GCM<CryptoPP::AES>::Encryption m_gcm;
+#endif
+  };
+
+  class StreamDecryptorImpl : public StreamCipherState
+  {
+  public:
+    StreamDecryptorImpl(const SecretKey& key, const byte header[], size_t size)
+    {
+      ESAPI_ASSERT2(header, "Header is not valid");
+      if(!header)
+        throw IllegalArgumentException("Header is not valid");
+
+      if(size < StreamingAead::HeaderSize)
+        throw EncryptionException("Decryption failed", "Stream header is truncated");
+
+      if(header[VersionOffset] != StreamVersion)
+        throw EncryptionException("Decryption failed", "Stream version is not supported");
+
+      if(header[AlgorithmOffset] != StreamAlgorithmAesGcm)
+        throw EncryptionException("Decryption failed", "Stream algorithm is not supported");
+
+      const size_t segmentSize = GetBigEndian32(header + SegmentSizeOffset);
+      if(segmentSize < StreamingAead::MinSegmentSize || segmentSize > StreamingAead::MaxSegmentSize)
+        throw EncryptionException("Decryption failed", "Stream segment size is not valid");
+
+      m_segmentSize = segmentSize;
+      ::memcpy(m_header.data(), header, StreamingAead::HeaderSize);
+
+      setNoncePrefix();
+
+#if defined(ESAPI_GCM_AVAILABLE)
+      CryptoPP::SecByteBlock streamKey;
+      deriveKey(key, streamKey);
+
+      try
+        {
+          m_gcm.SetKeyWithIV(streamKey.BytePtr(), streamKey.size(), nonce(0, false), NonceSize);
+        }
+      catch(CryptoPP::Exception& ex)
+        {
+          throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+        }
+#else
+      (void)key;
+      throw EncryptionException("Decryption failed", "AES/GCM requires Crypto++ 5.6 or above");
+#endif
+    }
+
+    size_t segmentCount(size_t streamSize) const
+    {
+      const size_t full = m_segmentSize + StreamingAead::TagSize;
+
+      // Every stream has at least one segment, and no segment is shorter than a tag
+      if(streamSize < StreamingAead::HeaderSize + StreamingAead::TagSize)
+        throw EncryptionException("Decryption failed", "Stream is truncated");
+
+      const size_t body = streamSize - StreamingAead::HeaderSize;
+      const size_t count = (body + full - 1) / full;
+
+      if(body - (count - 1) * full < StreamingAead::TagSize)
+        throw EncryptionException("Decryption failed", "Stream is truncated");
+
+      if(count > MaxSegments)
+        throw EncryptionException("Decryption failed", "Stream has too many segments");
+
+      return count;
+    }
+
+    size_t decryptSegment(size_t index, bool last, const byte input[], size_t size, byte output[], size_t outSize)
+    {
+      ESAPI_ASSERT2(input, "Input buffer is not valid");
+      if(!input)
+        throw IllegalArgumentException("Input buffer is not valid");
+
+      if(size < StreamingAead::TagSize || size > m_segmentSize + StreamingAead::TagSize)
+        throw EncryptionException("Decryption failed", "Segment size is not valid");
+
+      // Only the last segment may be short
+      const size_t psize = size - StreamingAead::TagSize;
+      if(!last && psize != m_segmentSize)
+        throw EncryptionException("Decryption failed", "Segment size is not valid");
+
+      ESAPI_ASSERT2(output || !psize, "Output buffer is not valid");
+      ESAPI_ASSERT2(outSize >= psize, "Output buffer is too small");
+      if((!output && psize) || outSize < psize)
+        throw IllegalArgumentException("Output buffer is too small");
+
+      if((unsigned long long)index >= MaxSegments)
+        throw EncryptionException("Decryption failed", "Segment index is not valid");
+
+      bool verified = false;
+
+#if defined(ESAPI_GCM_AVAILABLE)
+      try
+        {
+          verified = m_gcm.DecryptAndVerify(output, input + psize, StreamingAead::TagSize,
+                                            nonce(index, last), (int)NonceSize,
+                                            m_header.data(), m_header.size(), input, psize);
+        }
+      catch(CryptoPP::Exception& ex)
+        {
+          throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+        }
+#endif
+
+      if(!verified)
+        {
+          // Do not leave unauthenticated plain text behind
+          if(psize)
+            CryptoPP::SecureWipeArray(output, psize);
+
+          std::ostringstream oss;
+          oss << "Segment " << index << " failed authentication";
+          throw EncryptionException("Decryption failed", oss.str());
+        }
+
+      return psize;
+    }
+
+  private:
+#if defined(ESAPI_GCM_AVAILABLE)
+    CryptoPP::GCM<CryptoPP::AES>::Decryption m_gcm;
+#endif
+  };
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////// StreamingAead //////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  size_t StreamingAead::getCipherTextSize(size_t plainTextSize, size_t segmentSize)
+  {
+    CheckSegmentSize(segmentSize);
+
+    try
+      {
+        // An empty stream still has one (empty) final segment
+        size_t segments = plainTextSize / segmentSize + (plainTextSize % segmentSize ? 1 : 0);
+        if(segments == 0)
+          segments = 1;
+
+        SafeInt<size_t> total(segments);
+        total *= (size_t)TagSize;
+        total += plainTextSize;
+        total += (size_t)HeaderSize;
+
+        return total;
+      }
+    catch(const SafeIntException&)
+      {
+        throw IllegalArgumentException("Integer overflow detected");
+      }
+  }
+
+  void StreamingAead::encrypt(const SecretKey& key, std::istream& in, std::ostream& out, size_t segmentSize)
+  {
+    StreamEncryptor encryptor(key, segmentSize);
+
+    const SecureByteArray header = encryptor.getHeader();
+    out.write((const char*)header.data(), header.size());
+
+    // One segment in, one segment out, regardless of the size of the stream
+    SecureByteArray input(segmentSize);
+    SecureByteArray output(segmentSize + TagSize);
+
+    bool last = false;
+    while(!last)
+      {
+        in.read((char*)input.data(), input.size());
+        const size_t count = (size_t)in.gcount();
+
+        if(in.bad())
+          throw EncryptionException("Encryption failed", "Failed to read the input stream");
+
+        // A full segment is the last if nothing follows it
+        last = (count < segmentSize) || (in.peek() == std::istream::traits_type::eof());
+
+        const size_t written = encryptor.encryptSegment(input.data(), count, last, output.data(), output.size());
+        out.write((const char*)output.data(), written);
+
+        if(!out.good())
+          throw EncryptionException("Encryption failed", "Failed to write the output stream");
+      }
+  }
+
+  void StreamingAead::encrypt(const SecretKey& key, const byte input[], size_t size, std::ostream& out, size_t segmentSize)
+  {
+    ESAPI_ASSERT2(input || !size, "Input buffer is not valid");
+    if(!input && size)
+      throw IllegalArgumentException("Input buffer is not valid");
+
+    StreamEncryptor encryptor(key, segmentSize);
+
+    const SecureByteArray header = encryptor.getHeader();
+    out.write((const char*)header.data(), header.size());
+
+    SecureByteArray output(segmentSize + TagSize);
+
+    size_t offset = 0;
+    bool last = false;
+    while(!last)
+      {
+        const size_t count = std::min(segmentSize, size - offset);
+        last = (offset + count == size);
+
+        const size_t written = encryptor.encryptSegment(input + offset, count, last, output.data(), output.size());
+        out.write((const char*)output.data(), written);
+
+        if(!out.good())
+          throw EncryptionException("Encryption failed", "Failed to write the output stream");
+
+        offset += count;
+      }
+  }
+
+  void StreamingAead::decrypt(const SecretKey& key, std::istream& in, std::ostream& out)
+  {
+    byte header[HeaderSize];
+
+    in.read((char*)header, sizeof(header));
+    if((size_t)in.gcount() != sizeof(header))
+      throw EncryptionException("Decryption failed", "Stream header is truncated");
+
+    StreamDecryptor decryptor(key, header, sizeof(header));
+    const size_t segmentSize = decryptor.getSegmentSize();
+
+    SecureByteArray input(segmentSize + TagSize);
+    SecureByteArray output(segmentSize);
+
+    bool last = false;
+    for(size_t index = 0; !last; index++)
+      {
+        in.read((char*)input.data(), input.size());
+        const size_t count = (size_t)in.gcount();
+
+        if(in.bad())
+          throw EncryptionException("Decryption failed", "Failed to read the input stream");
+
+        // A short segment must be the last one. If the stream was cut, the tag
+        // check fails because the segment was not sealed as the last.
+        last = (count < input.size()) || (in.peek() == std::istream::traits_type::eof());
+
+        if(count < TagSize)
+          throw EncryptionException("Decryption failed", "Stream is truncated");
+
+        const size_t written = decryptor.decryptSegment(index, last, input.data(), count, output.data(), output.size());
+        out.write((const char*)output.data(), written);
+
+        if(!out.good())
+          throw EncryptionException("Decryption failed", "Failed to write the output stream");
+      }
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ///////////////////////////////// StreamEncryptor /////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  StreamEncryptor::StreamEncryptor(const SecretKey& key, size_t segmentSize)
+    : m_lock(new Mutex), m_impl(new StreamEncryptorImpl(key, segmentSize))
+  {
+    ASSERT(m_lock.get() != nullptr);
+    ASSERT(m_impl.get() != nullptr);
+  }
+
+  Mutex& StreamEncryptor::getObjectLock() const
+  {
+    ASSERT(m_lock.get() != nullptr);
+    return *m_lock.get();
+  }
+
+  SecureByteArray StreamEncryptor::getHeader() const
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->header().clone();
+  }
+
+  size_t StreamEncryptor::getSegmentSize() const
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->segmentSize();
+  }
+
+  size_t StreamEncryptor::encryptSegment(const byte input[], size_t size, bool last, byte output[], size_t outSize)
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->encryptSegment(input, size, last, output, outSize);
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ///////////////////////////////// StreamDecryptor /////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  StreamDecryptor::StreamDecryptor(const SecretKey& key, const byte header[], size_t size)
+    : m_lock(new Mutex), m_impl(new StreamDecryptorImpl(key, header, size))
+  {
+    ASSERT(m_lock.get() != nullptr);
+    ASSERT(m_impl.get() != nullptr);
+  }
+
+  Mutex& StreamDecryptor::getObjectLock() const
+  {
+    ASSERT(m_lock.get() != nullptr);
+    return *m_lock.get();
+  }
+
+  size_t StreamDecryptor::getSegmentSize() const
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->segmentSize();
+  }
+
+  size_t StreamDecryptor::getSegmentCount(size_t streamSize) const
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->segmentCount(streamSize);
+  }
+
+  size_t StreamDecryptor::decryptSegment(size_t index, bool last, const byte input[], size_t size, byte output[], size_t outSize)
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->decryptSegment(index, last, input, size, output, outSize);
+  }
+
+  size_t StreamDecryptor::decryptSegment(const byte stream[], size_t streamSize, size_t index, byte output[], size_t outSize)
+  {
+    // All forward facing gear which manipulates internal state acquires the object lock
+    MutexLock lock(getObjectLock());
+
+    ASSERT(m_impl.get() != nullptr);
+
+    ESAPI_ASSERT2(stream, "Stream buffer is not valid");
+    if(!stream)
+      throw IllegalArgumentException("Stream buffer is not valid");
+
+    // The stream must be the one this decryptor was created for
+    const SecureByteArray& header = m_impl->header();
+    if(streamSize < StreamingAead::HeaderSize || ::memcmp(stream, header.data(), header.size()) != 0)
+      throw EncryptionException("Decryption failed", "Stream header does not match");
+
+    const size_t count = m_impl->segmentCount(streamSize);
+    if(index >= count)
+      throw IllegalArgumentException("Segment index is out of range");
+
+    const size_t full = m_impl->segmentSize() + StreamingAead::TagSize;
+    const size_t offset = StreamingAead::HeaderSize + index * full;
+    const size_t size = std::min(full, streamSize - offset);
+
+    return m_impl->decryptSegment(index, index + 1 == count, stream + offset, size, output, outSize);
+  }
+
+} // NAMESPACE esapi
@@ -10,27 +10,251 @@
 
 #include "reference/DefaultEncryptor.h"
 
+#include "util/Mutex.h"
+#include "util/NotCopyable.h"
 #include "util/TextConvert.h"
 #include "util/SecureArray.h"
+#include "util/AlgorithmName.h"
 // #include "crypto/Cipher.h"
 #include "crypto/PlainText.h"
+#include "crypto/Cipher.h"
+#include "crypto/CipherSpec.h"
 #include "crypto/CipherText.h"
 #include "crypto/SecretKey.h"
+#include "crypto/SecureRandom.h"
 #include "crypto/CryptoHelper.h"
+#include "crypto/CryptoPolicy.h"
+#include "crypto/EncryptThenMac.h"
+#include "crypto/IvParameterSpec.h"
+#include "crypto/KeyDerivationFunction.h"
 #include "crypto/MessageDigest.h"
+#include "crypto/PasswordHash.h"
+#include "crypto/ParallelGcm.h"
 #include "errors/IntegrityException.h"
 #include "errors/EncryptionException.h"
 #include "errors/IllegalArgumentException.h"
+#include "errors/NoSuchAlgorithmException.h"
 
-#include "DummyConfiguration.h"
+#include "safeint/SafeInt3.hpp"
+
+#include <list>
+#include <vector>
+
+// GCM arrived in Crypto++ 5.6. Crypto++ selects AES-NI and PCLMULQDQ at runtime.
+#if CRYPTOPP_VERSION >= 560
+# include <cryptopp/gcm.h>
+# define ESAPI_GCM_AVAILABLE 1
+#endif
 
 // Must be consistent with JavaEncryptor.java.
 // http://owasp-esapi-java.googlecode.com/svn/trunk/src/main/java/org/owasp/esapi/reference/crypto/JavaEncryptor.java
 
 namespace esapi
 {
-  // Private to this module (for now)
-  static void split(const NarrowString& str, const NarrowString& delim, StringArray& parts);
+  // 96-bit nonces use the fast path of GCM (no GHASH of the IV), SP 800-38D, 8.2.2.
+  static const size_t GcmNonceSize = 12;
+  static const size_t GcmTagSize = 16;
+  static const size_t AesBlockSize = 16;
+
+  // Private to this module
+  static AlgorithmName checkTransformation(const NarrowString& xform, const CryptoPolicy& policy);
+  static const AlgorithmName& checkTransformation(const AlgorithmName& xform, const CryptoPolicy& policy);
+  static void checkKeySize(size_t keySize);
+
+#if defined(ESAPI_GCM_AVAILABLE)
+
+  typedef CryptoPP::GCM<CryptoPP::AES> AesGcm;
+
+  /**
+   * A keyed pair of GCM objects. Keying expands the AES key schedule and builds the
+   * GHASH table; after that each message only resynchronizes on its nonce.
+   */
+  struct GcmContext : private NotCopyable
+  {
+    GcmContext(const byte* key, size_t ksize)
+    {
+      // Crypto++ insists on an IV when keying a resynchronizable mode. Every
+      // message supplies its own nonce, so this one is never used.
+      static const byte unused[GcmNonceSize] = { 0 };
+
+      encryptor.SetKeyWithIV(key, ksize, unused, sizeof(unused));
+      decryptor.SetKeyWithIV(key, ksize, unused, sizeof(unused));
+    }
+
+    AesGcm::Encryption encryptor;
+    AesGcm::Decryption decryptor;
+  };
+
+#else
+
+  // Placeholder so the cache below still compiles against Crypto++ 5.5 and earlier
+  struct GcmContext : private NotCopyable
+  {
+    GcmContext(const byte*, size_t) { }
+  };
+
+#endif
+
+  /**
+   * Keyed contexts for the most recently used keys. A context is used by one thread
+   * at a time: acquire() hands out an idle context for the key (or keys a new one),
+   * and release() returns it. Threads sharing a key therefore do not serialize on a
+   * single object, and a key is only expanded again once it falls out of the cache.
+   * Evicted contexts are destroyed, and Crypto++ wipes the key schedules.
+   */
+  class DefaultEncryptorImpl : private NotCopyable
+  {
+  public:
+    enum { MaxKeys = 16, MaxIdlePerKey = 8 };
+
+    DefaultEncryptorImpl()
+      : m_lock(), m_entries(), m_random(SecureRandom::getInstance()),
+        m_threads(1), m_parallelMinimum(DefaultEncryptor::DefaultParallelMinimum)
+    {
+    }
+
+    void setParallelism(unsigned int threads, size_t minimumSize)
+    {
+      MutexLock lock(m_lock);
+      m_threads = threads;
+      m_parallelMinimum = minimumSize;
+    }
+
+    /**
+     * Returns the thread count to use for a message of the specified size.
+     */
+    unsigned int threadsFor(size_t size)
+    {
+      MutexLock lock(m_lock);
+      return (m_threads != 1 && size >= m_parallelMinimum) ? m_threads : 1;
+    }
+
+    shared_ptr<GcmContext> acquire(const byte* key, size_t ksize)
+    {
+      {
+        MutexLock lock(m_lock);
+
+        std::list<Entry>::iterator it = find(key, ksize);
+        if(it != m_entries.end())
+          {
+            // Most recently used to the front
+            m_entries.splice(m_entries.begin(), m_entries, it);
+
+            if(!it->idle.empty())
+              {
+                shared_ptr<GcmContext> context = it->idle.back();
+                it->idle.pop_back();
+                return context;
+              }
+          }
+      }
+
+      // Key outside the lock. This is the expensive part.
+      return shared_ptr<GcmContext>(new GcmContext(key, ksize));
+    }
+
+    void release(const byte* key, size_t ksize, const shared_ptr<GcmContext>& context)
+    {
+      MutexLock lock(m_lock);
+
+      std::list<Entry>::iterator it = find(key, ksize);
+      if(it == m_entries.end())
+        {
+          m_entries.push_front(Entry());
+          it = m_entries.begin();
+          it->key.Assign(key, ksize);
+
+          if(m_entries.size() > MaxKeys)
+            m_entries.pop_back();
+        }
+
+      if(it->idle.size() < MaxIdlePerKey)
+        it->idle.push_back(context);
+    }
+
+    void nextNonce(byte* nonce, size_t size)
+    {
+      m_random.nextBytes(nonce, size);
+    }
+
+  private:
+    struct Entry
+    {
+      CryptoPP::SecByteBlock key;
+      std::vector< shared_ptr<GcmContext> > idle;
+    };
+
+    std::list<Entry>::iterator find(const byte* key, size_t ksize)
+    {
+      std::list<Entry>::iterator it = m_entries.begin();
+      for( ; it != m_entries.end(); ++it)
+        {
+          if(it->key.size() == ksize && CryptoPP::VerifyBufsEqual(it->key.BytePtr(), key, ksize))
+            break;
+        }
+
+      return it;
+    }
+
+    Mutex m_lock;
+    std::list<Entry> m_entries;
+    SecureRandom m_random;
+
+    // Guarded by m_lock
+    unsigned int m_threads;
+    size_t m_parallelMinimum;
+  };
+
+  /**
+   * Borrows a keyed context for the duration of one message.
+   */
+  class GcmLease : private NotCopyable
+  {
+  public:
+    GcmLease(DefaultEncryptorImpl& impl, const byte* key, size_t ksize)
+      : m_impl(impl), m_key(key), m_ksize(ksize), m_context(impl.acquire(key, ksize))
+    {
+    }
+
+    ~GcmLease()
+    {
+      // The context is always resynchronized before use, so even one which was
+      // interrupted by an exception can go back into the cache.
+      try
+        {
+          m_impl.release(m_key, m_ksize, m_context);
+        }
+      catch(...)
+        {
+        }
+    }
+
+    GcmContext* operator->() const
+    {
+      return m_context.get();
+    }
+
+  private:
+    DefaultEncryptorImpl& m_impl;
+    const byte* m_key;
+    size_t m_ksize;
+    shared_ptr<GcmContext> m_context;
+  };
+
+  DefaultEncryptor::DefaultEncryptor()
+    : m_impl(new DefaultEncryptorImpl)
+  {
+  }
+
+  DefaultEncryptor::~DefaultEncryptor()
+  {
+  }
+
+  void DefaultEncryptor::setParallelism(unsigned int threads, size_t minimumSize)
+  {
+    ASSERT(m_impl.get());
+    m_impl->setParallelism(threads, minimumSize);
+  }
 
   String DefaultEncryptor::DefaultDigestAlgorithm()
   {
@@ -44,37 +268,21 @@ namespace esapi
 
   String DefaultEncryptor::hash(const NarrowString &message, const NarrowString &salt, unsigned int iterations) const
   { 
-    MessageDigest md(DefaultDigestAlgorithm());
-    const size_t size = md.getDigestLength();
-    SecureByteArray hash(size);
-
-    DummyConfiguration config;
-    const SecureByteArray& msalt = config.getMasterSalt();
-    if( !msalt.empty() )
-      {
-        md.update(msalt.data(), msalt.size());
-      }    
+    const shared_ptr<const CryptoPolicy> policy = CryptoPolicy::getInstance();
+    const SecureByteArray& msalt = policy->getMasterSalt();
 
+    // H = HASH(master salt || salt || message), then H = HASH(H) for each iteration.
+    // PasswordHash runs the iterations on the raw compression function state.
+    SecureByteArray sa, ma;
     if( !salt.empty() )
-      {
-        SecureByteArray sa = TextConvert::GetBytes(salt, "UTF-8");
-        md.update(sa.data(), sa.size());
-      }    
-
+      sa = TextConvert::GetBytes(salt, "UTF-8");
     if( !message.empty() )
-      {
-        SecureByteArray ma = TextConvert::GetBytes(message, "UTF-8");
-        md.update(ma.data(), ma.size());
-      }
+      ma = TextConvert::GetBytes(message, "UTF-8");
 
-    // Fetch the hash (resets the object)
-    md.digest(hash.data(), hash.size(), 0, size);
+    const byte* parts[3] = { msalt.data(), sa.data(), ma.data() };
+    const size_t sizes[3] = { msalt.size(), sa.size(), ma.size() };
 
-    for (unsigned int i = 0; i < iterations; i++)
-      {
-        md.update(hash.data(), hash.size());
-        md.digest(hash.data(), hash.size(), 0, hash.size());
-      }
+    const SecureByteArray hash = PasswordHash::iteratedDigest(DefaultDigestAlgorithm(), parts, sizes, COUNTOF(parts), iterations);
 
     NarrowString encoded;
     try
@@ -93,55 +301,328 @@ namespace esapi
 
   CipherText DefaultEncryptor::encrypt(const PlainText& plainText) const
   {
-    DummyConfiguration config;
-    SecretKey key("Unknown", config.getMasterKey());
-
-    return encrypt(key, plainText);
+    const shared_ptr<const CryptoPolicy> policy = CryptoPolicy::getInstance();
+    return encrypt(policy->getMasterKey(), plainText);
   }
 
   CipherText DefaultEncryptor::encrypt(const SecretKey& secretKey, const PlainText& plainText) const
   {
-    DummyConfiguration config;
+    CipherText cipherText;
+    encrypt(secretKey, plainText, cipherText);
 
-    StringArray parts;
-    String xform = config.getCipherTransformation();    
-    split(xform, "\\/:", parts);
+    return cipherText;
+  }
 
-    ESAPI_ASSERT2(parts.size() == 3, "Malformed cipher transformation: " + c);
-    if(parts.size() != 3)
-      throw EncryptionException("Malformed cipher transformation: " + xform);
+  void DefaultEncryptor::encrypt(const SecretKey& secretKey, const PlainText& plainText, CipherText& cipherText) const
+  {
+    ASSERT(m_impl.get());
 
-    const NarrowString mode = parts[1];
-    bool allowed = CryptoHelper::isAllowedCipherMode(mode);
+    // One snapshot for the whole operation. The transformation was parsed when the
+    // policy was built.
+    const shared_ptr<const CryptoPolicy> policy = CryptoPolicy::getInstance();
+    const AlgorithmName& xform = checkTransformation(policy->getCipherTransformation(), *policy);
+    checkKeySize(secretKey.sizeInBytes());
 
-    ESAPI_ASSERT2(allowed, NarrowString("Cipher mode '") + modes + "' is not allowed");
-    if( !allowed )
-      throw EncryptionException(NarrowString("Cipher mode '") + mode + "' is not allowed");    
+    if(xform.getModeId() != AlgorithmName::ModeGCM)
+      {
+        encryptWithMac(secretKey, xform.algorithm(), policy->useMACforCipherText(), plainText, cipherText);
+        return;
+      }
+
+#if defined(ESAPI_GCM_AVAILABLE)
+    // A reference to the plain text's storage. asBytes() would copy the message.
+    const SecureByteArray& input = plainText.getBytes();
+
+    SecureByteArray nonce(GcmNonceSize);
+    m_impl->nextNonce(nonce.data(), nonce.size());
+
+    try
+      {
+        SafeInt<size_t> total(input.size());
+        total += GcmTagSize;
+
+        // resize() keeps the capacity, so a reused CipherText does not reallocate
+        cipherText.m_raw.resize(total, 0);
+      }
+    catch(const SafeIntException&)
+      {
+        throw EncryptionException("Integer overflow detected");
+      }
+
+    try
+      {
+        // One pass: the ciphertext is written into place and the tag lands after it
+        byte* out = cipherText.m_raw.data();
+
+        const unsigned int threads = m_impl->threadsFor(input.size());
+        if(threads != 1)
+          {
+            ParallelGcm gcm(secretKey, threads);
+            gcm.encrypt(nonce.data(), nonce.size(), input.data(), input.size(), out, out + input.size());
+          }
+        else
+          {
+            GcmLease gcm(*m_impl, secretKey.BytePtr(), secretKey.sizeInBytes());
+            gcm->encryptor.EncryptAndAuthenticate(out, out + input.size(), GcmTagSize,
+                                                  nonce.data(), (int)nonce.size(), nullptr, 0,
+                                                  input.data(), input.size());
+          }
+      }
+    catch(CryptoPP::Exception& ex)
+      {
+        cipherText.m_raw.clear();
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
+      }
+
+    cipherText.m_spec = CipherSpec(xform.algorithm(), (unsigned int)secretKey.sizeInBytes() * 8, AesBlockSize, nonce);
+    cipherText.m_mac.clear();
+    cipherText.setEncryptionTimestamp();
+#else
+    (void)plainText;
+    (void)cipherText;
+    throw EncryptionException("Encryption failed", "AES/GCM requires Crypto++ 5.6 or above");
+#endif
+  }
+
+  PlainText DefaultEncryptor::decrypt(const CipherText& cipherText) const
+  {
+    ASSERT(m_impl.get());
+
+    // One snapshot supplies the master key and the checks on the ciphertext
+    const shared_ptr<const CryptoPolicy> policy = CryptoPolicy::getInstance();
+
+    const SecureByteArray nonce = cipherText.m_spec.getIV();
+    const SecureByteArray& input = cipherText.m_raw;
+
+    return decryptRaw(*policy, policy->getMasterKey(), cipherText.m_spec.getCipherTransformation(), cipherText.m_spec.getKeySize(),
+                      nonce.data(), nonce.size(), input.data(), input.size(),
+                      cipherText.m_mac.data(), cipherText.m_mac.size());
+  }
+
+  PlainText DefaultEncryptor::decrypt(const SecretKey& secretKey, const CipherText& cipherText) const
+  {
+    ASSERT(m_impl.get());
+
+    const shared_ptr<const CryptoPolicy> policy = CryptoPolicy::getInstance();
+
+    const SecureByteArray nonce = cipherText.m_spec.getIV();
+    const SecureByteArray& input = cipherText.m_raw;
+
+    return decryptRaw(*policy, secretKey, cipherText.m_spec.getCipherTransformation(), cipherText.m_spec.getKeySize(),
+                      nonce.data(), nonce.size(), input.data(), input.size(),
+                      cipherText.m_mac.data(), cipherText.m_mac.size());
+  }
 
-    // Cipher encrypter = Cipher::getInstance(xform);
-    // String cipherAlg = encrypter.getAlgorithm();
-    //int keyLen = config.getEncryptionKeyLength();
+  PlainText DefaultEncryptor::decrypt(const SecretKey& secretKey, const CipherTextView& cipherText) const
+  {
+    ASSERT(m_impl.get());
 
-    bool overwrite = config.overwritePlainText();
-    size_t keyBits = secretKey.getEncoded().length() * 8;
+    const shared_ptr<const CryptoPolicy> policy = CryptoPolicy::getInstance();
 
-    return CipherText();
+    return decryptRaw(*policy, secretKey, cipherText.getCipherTransformation(), cipherText.getKeySize(),
+                      cipherText.getIV(), cipherText.getIVLength(),
+                      cipherText.getRawCipherText(), cipherText.getRawCipherTextByteLength(),
+                      cipherText.getSeparateMAC(), cipherText.getSeparateMACLength());
   }
 
-  void split(const NarrowString& str, const NarrowString& delim, StringArray& parts)
+  PlainText DefaultEncryptor::decryptRaw(const CryptoPolicy& policy, const SecretKey& secretKey,
+                                         const NarrowString& transformation, unsigned int keyBits,
+                                         const byte* nonce, size_t nsize, const byte* input, size_t isize,
+                                         const byte* mac, size_t msize) const
   {
-    String s(str);
-    String::size_type pos = 0;
+    ASSERT(m_impl.get());
+    DefaultEncryptorImpl& impl = *m_impl;
+
+    // Decrypt with the transformation the ciphertext was produced under, provided
+    // it is still allowed.
+    const AlgorithmName xform = checkTransformation(transformation, policy);
+    checkKeySize(secretKey.sizeInBytes());
+
+    if(keyBits != secretKey.sizeInBytes() * 8)
+      throw EncryptionException("Decryption failed", "Key size does not match the ciphertext's key size");
+
+    if(xform.getModeId() != AlgorithmName::ModeGCM)
+      return decryptWithMac(secretKey, xform, policy.useMACforCipherText(), nonce, nsize, input, isize, mac, msize);
+
+#if defined(ESAPI_GCM_AVAILABLE)
+    if(!input || isize < GcmTagSize)
+      throw EncryptionException("Decryption failed", "Ciphertext is too short");
 
-    while( (pos = s.find_first_of(delim)) != String::npos )
+    if(!nonce || nsize != GcmNonceSize)
+      throw EncryptionException("Decryption failed", "Nonce size is not valid");
+
+    const size_t size = isize - GcmTagSize;
+    SecureByteArray output(size);
+
+    bool verified = false;
+    try
+      {
+        const unsigned int threads = impl.threadsFor(size);
+        if(threads != 1)
+          {
+            ParallelGcm gcm(secretKey, threads);
+            verified = gcm.decrypt(nonce, nsize, input, size, input + size, output.data());
+          }
+        else
+          {
+            GcmLease gcm(impl, secretKey.BytePtr(), secretKey.sizeInBytes());
+            verified = gcm->decryptor.DecryptAndVerify(output.data(), input + size, GcmTagSize,
+                                                       nonce, (int)nsize, nullptr, 0,
+                                                       input, size);
+          }
+      }
+    catch(CryptoPP::Exception& ex)
       {
-        parts.push_back(s.substr(0, pos));
-        s.erase(0, pos+1);
+        throw EncryptionException(NarrowString("Internal error: ") + ex.what());
       }
 
-    // Catch any tail bytes
-    if( !s.empty() )
-      parts.push_back(s);
+    // Never release unauthenticated plain text. SecureByteArray wipes on destruction.
+    if(!verified)
+      throw EncryptionException("Decryption failed", "Ciphertext failed authentication");
+
+    return PlainText(output);
+#else
+    (void)impl;
+    (void)nonce;
+    (void)nsize;
+    (void)input;
+    (void)isize;
+    throw EncryptionException("Decryption failed", "AES/GCM requires Crypto++ 5.6 or above");
+#endif
   }
-}
 
+  void DefaultEncryptor::encryptWithMac(const SecretKey& secretKey, const NarrowString& transformation, bool useMac,
+                                        const PlainText& plainText, CipherText& cipherText) const
+  {
+    // As JavaEncryptor: the cipher runs under the key derived for "encryption", and
+    // the MAC under the key derived for "authenticity".
+    const unsigned int keyBits = (unsigned int)secretKey.sizeInBytes() * 8;
+    const SecretKey encKey = KeyDerivationFunction::computeDerivedKey(secretKey, keyBits, "encryption");
+
+    // A fresh random IV for each message
+    Cipher cipher = Cipher::getInstance(transformation);
+    cipher.init(Cipher::EncryptMode, encKey);
+
+    const SecureByteArray& input = plainText.getBytes();
+    cipherText.m_raw.resize(cipher.getOutputSize(input.size()), 0);
+
+    CryptoPP::FixedSizeSecBlock<byte, EncryptThenMac::MacSize> mac;
+    size_t written = 0;
+
+    try
+      {
+        if(useMac)
+          {
+            // One pass over the message for both the cipher and the MAC
+            const EncryptThenMac etm(secretKey);
+            written = etm.encrypt(cipher, input.data(), input.size(), cipherText.m_raw.data(), cipherText.m_raw.size(),
+                                  mac.data(), mac.size());
+          }
+        else
+          {
+            written = cipher.doFinal(input.data(), input.size(), 0, input.size(), cipherText.m_raw.data(), cipherText.m_raw.size());
+          }
+      }
+    catch(...)
+      {
+        cipherText.m_raw.clear();
+        throw;
+      }
+
+    cipherText.m_raw.resize(written, 0);
+    cipherText.m_spec = CipherSpec(transformation, keyBits, AesBlockSize, cipher.getIV());
+
+    if(useMac)
+      cipherText.m_mac.assign(mac.data(), mac.size());
+    else
+      cipherText.m_mac.clear();
+
+    cipherText.setEncryptionTimestamp();
+  }
+
+  PlainText DefaultEncryptor::decryptWithMac(const SecretKey& secretKey, const AlgorithmName& xform, bool useMac,
+                                             const byte* iv, size_t ivSize, const byte* input, size_t isize,
+                                             const byte* mac, size_t msize) const
+  {
+    if(!iv || ivSize != AesBlockSize)
+      throw EncryptionException("Decryption failed", "IV size is not valid");
+
+    // The stream modes (CFB, OFB and CTR) encrypt an empty message to an empty
+    // ciphertext. Padded CBC always produces at least one block.
+    if(!input && isize)
+      throw EncryptionException("Decryption failed", "Ciphertext is not valid");
+
+    if(xform.getModeId() == AlgorithmName::ModeCBC && isize < AesBlockSize)
+      throw EncryptionException("Decryption failed", "Ciphertext is too short");
+
+    // A ciphertext without a MAC is not accepted when MACs are in use
+    if(useMac && (!mac || !msize))
+      throw EncryptionException("Decryption failed", "Ciphertext does not have a MAC");
+
+    const unsigned int keyBits = (unsigned int)secretKey.sizeInBytes() * 8;
+    const SecretKey encKey = KeyDerivationFunction::computeDerivedKey(secretKey, keyBits, "encryption");
+
+    Cipher cipher = Cipher::getInstance(xform.algorithm());
+    cipher.init(Cipher::DecryptMode, encKey, IvParameterSpec(iv, ivSize));
+
+    SecureByteArray output(isize);
+    size_t written = 0;
+
+    if(useMac)
+      {
+        // Throws the same exception, with the output wiped, for a bad MAC or bad padding
+        const EncryptThenMac etm(secretKey);
+        written = etm.decrypt(cipher, input, isize, mac, msize, output.data(), output.size());
+      }
+    else
+      {
+        written = cipher.doFinal(input, isize, 0, isize, output.data(), output.size());
+      }
+
+    output.resize(written, 0);
+    return PlainText(output);
+  }
+
+  AlgorithmName checkTransformation(const NarrowString& transformation, const CryptoPolicy& policy)
+  {
+    try
+      {
+        const AlgorithmName xform(transformation);
+        checkTransformation(xform, policy);
+
+        return xform;
+      }
+    catch(const NoSuchAlgorithmException&)
+      {
+        throw EncryptionException("Malformed cipher transformation: " + transformation);
+      }
+  }
+
+  const AlgorithmName& checkTransformation(const AlgorithmName& xform, const CryptoPolicy& policy)
+  {
+    const AlgorithmName::ModeId id = xform.getModeId();
+    if(id == AlgorithmName::ModeAbsent)
+      throw EncryptionException("Malformed cipher transformation: " + xform.algorithm());
+
+    const bool allowed = policy.isAllowedCipherMode(id);
+    ESAPI_ASSERT2(allowed, NarrowString("Cipher mode of '") + xform.algorithm() + "' is not allowed");
+    if( !allowed )
+      throw EncryptionException(NarrowString("Cipher mode of '") + xform.algorithm() + "' is not allowed");
+
+    // GCM authenticates by itself; the other modes are paired with a MAC
+    const bool supported = (id == AlgorithmName::ModeGCM || id == AlgorithmName::ModeCBC || id == AlgorithmName::ModeCFB ||
+                            id == AlgorithmName::ModeOFB || id == AlgorithmName::ModeCTR);
+
+    if(xform.getAlgorithmId() != AlgorithmName::AlgAES || !supported)
+      throw EncryptionException(NarrowString("Cipher transformation '") + xform.algorithm() + "' is not supported");
+
+    return xform;
+  }
+
+  void checkKeySize(size_t keySize)
+  {
+    ESAPI_ASSERT2(keySize == 16 || keySize == 24 || keySize == 32, "Key size is not valid");
+    if(!(keySize == 16 || keySize == 24 || keySize == 32))
+      throw EncryptionException("Encryption failed", "AES key size is not valid");
+  }
+}
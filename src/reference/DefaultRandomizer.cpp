@@ -0,0 +1,321 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/Mutex.h"
+#include "util/SecureArray.h"
+#include "reference/DefaultRandomizer.h"
+#include "errors/IllegalArgumentException.h"
+
+#include "safeint/SafeInt3.hpp"
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace esapi
+{
+  // Largest single draw from the generator, in bytes
+  static const size_t MaxDraw = 64 * 1024;
+
+  // Random bytes in a GUID
+  static const size_t GuidSize = 16;
+
+  static const char g_alphanumerics[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+  static const char g_hex[] = "0123456789abcdef";
+  static const char g_base64url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+  // Private to this module
+  static Mutex& GetRandomizerLock();
+  static size_t DrawEstimate(size_t count, unsigned int threshold);
+  static size_t MapBytes(byte buffer[], size_t size, const byte alphabet[], unsigned int n, unsigned int threshold);
+  static size_t BatchSize(size_t count, size_t size);
+  static NarrowString FormatGuid(const byte bytes[]);
+  static NarrowString EncodeToken(const byte bytes[], size_t size, Randomizer::TokenEncoding encoding);
+
+  Randomizer& randomizer()
+  {
+    // Only the first call takes the lock. The randomizer is constructed under the
+    // lock, and published after a barrier.
+    static DefaultRandomizer* volatile s_instance = nullptr;
+
+    MEMORY_BARRIER();
+    if(!s_instance)
+      {
+        MutexLock lock(GetRandomizerLock());
+
+        if(!s_instance)
+          {
+            static DefaultRandomizer s_randomizer;
+
+            MEMORY_BARRIER();
+            s_instance = &s_randomizer;
+          }
+      }
+
+    return *s_instance;
+  }
+
+  DefaultRandomizer::DefaultRandomizer()
+    : m_random()
+  {
+  }
+
+  DefaultRandomizer::DefaultRandomizer(const BufferedSecureRandom& random)
+    : m_random(random)
+  {
+  }
+
+  NarrowString DefaultRandomizer::getRandomString(size_t length, const NarrowString& characterSet)
+  {
+    NarrowString result(length, Char());
+    if(length)
+      fillFromCharset(&result[0], length, characterSet);
+    else
+      fillFromCharset(nullptr, 0, characterSet);
+
+    return result;
+  }
+
+  StringArray DefaultRandomizer::getRandomStrings(size_t count, size_t length, const NarrowString& characterSet)
+  {
+    const size_t total = BatchSize(count, length);
+
+    NarrowString chars(total, Char());
+    fillFromCharset(total ? &chars[0] : nullptr, total, characterSet);
+
+    StringArray result;
+    result.reserve(count);
+    for(size_t i = 0; i < count; i++)
+      result.push_back(chars.substr(i * length, length));
+
+    return result;
+  }
+
+  NarrowString DefaultRandomizer::getRandomFilename(const NarrowString& extension)
+  {
+    NarrowString name = getRandomString(20, g_alphanumerics);
+    if(!extension.empty())
+      name += "." + extension;
+
+    return name;
+  }
+
+  NarrowString DefaultRandomizer::getRandomGUID()
+  {
+    SecureByteArray bytes(GuidSize);
+    m_random.nextBytes(bytes.data(), bytes.size());
+
+    return FormatGuid(bytes.data());
+  }
+
+  StringArray DefaultRandomizer::getRandomGUIDs(size_t count)
+  {
+    SecureByteArray bytes(BatchSize(count, GuidSize));
+    if(bytes.size())
+      m_random.nextBytes(bytes.data(), bytes.size());
+
+    StringArray result;
+    result.reserve(count);
+    for(size_t i = 0; i < count; i++)
+      result.push_back(FormatGuid(bytes.data() + i * GuidSize));
+
+    return result;
+  }
+
+  NarrowString DefaultRandomizer::getRandomToken(size_t size, TokenEncoding encoding)
+  {
+    SecureByteArray bytes(size);
+    if(size)
+      m_random.nextBytes(bytes.data(), size);
+
+    return EncodeToken(bytes.data(), size, encoding);
+  }
+
+  StringArray DefaultRandomizer::getRandomTokens(size_t count, size_t size, TokenEncoding encoding)
+  {
+    SecureByteArray bytes(BatchSize(count, size));
+    if(bytes.size())
+      m_random.nextBytes(bytes.data(), bytes.size());
+
+    StringArray result;
+    result.reserve(count);
+    for(size_t i = 0; i < count; i++)
+      result.push_back(EncodeToken(bytes.data() + i * size, size, encoding));
+
+    return result;
+  }
+
+  void DefaultRandomizer::fillFromCharset(Char output[], size_t size, const NarrowString& characterSet)
+  {
+    const size_t n = characterSet.size();
+
+    ESAPI_ASSERT2(n && n <= 256, "Character set is not valid");
+    if(!n || n > 256)
+      throw IllegalArgumentException("Character set is not valid");
+
+    if(!size)
+      return;
+
+    if(n == 1)
+      {
+        std::fill(output, output + size, characterSet[0]);
+        return;
+      }
+
+    // Bytes whose low product falls below the threshold are rejected. The threshold
+    // is 0 for a power of two, so nothing is rejected for hex or base64 alphabets.
+    const unsigned int threshold = (unsigned int)(256 % n);
+    const byte* const alphabet = reinterpret_cast<const byte*>(characterSet.data());
+
+    SecureByteArray scratch(DrawEstimate(size, threshold));
+
+    size_t filled = 0;
+    while(filled < size)
+      {
+        const size_t want = std::min(DrawEstimate(size - filled, threshold), scratch.size());
+        m_random.nextBytes(scratch.data(), want);
+
+        const size_t kept = MapBytes(scratch.data(), want, alphabet, (unsigned int)n, threshold);
+        const size_t take = std::min(kept, size - filled);
+
+        ::memcpy(output + filled, scratch.data(), take);
+        filled += take;
+      }
+  }
+
+  /**
+   * The number of bytes expected to yield count characters after rejection, plus a
+   * little slack so a second draw is rarely needed. Capped at MaxDraw.
+   */
+  static size_t DrawEstimate(size_t count, unsigned int threshold)
+  {
+    if(count >= MaxDraw)
+      return MaxDraw;
+
+    const size_t estimate = count + (count * threshold) / (256 - threshold) + 16;
+    return std::min(estimate, MaxDraw);
+  }
+
+  /**
+   * Maps each byte onto the alphabet in place and compacts the accepted characters
+   * to the front of the buffer. The write index never passes the read index, so a
+   * rejected character is simply overwritten by the next one.
+   */
+  static size_t MapBytes(byte buffer[], size_t size, const byte alphabet[], unsigned int n, unsigned int threshold)
+  {
+    size_t kept = 0;
+    for(size_t i = 0; i < size; i++)
+      {
+        const unsigned int m = (unsigned int)buffer[i] * n;
+        buffer[kept] = alphabet[m >> 8];
+        kept += (size_t)((m & 0xff) >= threshold);
+      }
+
+    return kept;
+  }
+
+  static size_t BatchSize(size_t count, size_t size)
+  {
+    try
+      {
+        SafeInt<size_t> total(count);
+        total *= size;
+
+        return (size_t)total;
+      }
+    catch(SafeIntException&)
+      {
+        throw IllegalArgumentException("The batch size is not valid");
+      }
+  }
+
+  static NarrowString FormatGuid(const byte bytes[])
+  {
+    NarrowString guid;
+    guid.reserve(36);
+
+    for(size_t i = 0; i < GuidSize; i++)
+      {
+        byte b = bytes[i];
+
+        // Version 4 (random) and the RFC 4122 variant
+        if(i == 6)
+          b = (byte)((b & 0x0f) | 0x40);
+        else if(i == 8)
+          b = (byte)((b & 0x3f) | 0x80);
+
+        if(i == 4 || i == 6 || i == 8 || i == 10)
+          guid += '-';
+
+        guid += g_hex[b >> 4];
+        guid += g_hex[b & 0x0f];
+      }
+
+    return guid;
+  }
+
+  static NarrowString EncodeToken(const byte bytes[], size_t size, Randomizer::TokenEncoding encoding)
+  {
+    NarrowString token;
+
+    if(encoding == Randomizer::TokenHex)
+      {
+        token.reserve(size * 2);
+        for(size_t i = 0; i < size; i++)
+          {
+            token += g_hex[bytes[i] >> 4];
+            token += g_hex[bytes[i] & 0x0f];
+          }
+
+        return token;
+      }
+
+    // Base64url, without padding
+    token.reserve((size * 4 + 2) / 3);
+
+    size_t i = 0;
+    for(; i + 3 <= size; i += 3)
+      {
+        const unsigned int v = ((unsigned int)bytes[i] << 16) | ((unsigned int)bytes[i+1] << 8) | bytes[i+2];
+        token += g_base64url[(v >> 18) & 0x3f];
+        token += g_base64url[(v >> 12) & 0x3f];
+        token += g_base64url[(v >> 6) & 0x3f];
+        token += g_base64url[v & 0x3f];
+      }
+
+    if(size - i == 1)
+      {
+        const unsigned int v = (unsigned int)bytes[i] << 16;
+        token += g_base64url[(v >> 18) & 0x3f];
+        token += g_base64url[(v >> 12) & 0x3f];
+      }
+    else if(size - i == 2)
+      {
+        const unsigned int v = ((unsigned int)bytes[i] << 16) | ((unsigned int)bytes[i+1] << 8);
+        token += g_base64url[(v >> 18) & 0x3f];
+        token += g_base64url[(v >> 12) & 0x3f];
+        token += g_base64url[(v >> 6) & 0x3f];
+      }
+
+    return token;
+  }
+
+  static Mutex& GetRandomizerLock()
+  {
+    static Mutex s_lock;
+    return s_lock;
+  }
+
+} // NAMESPACE esapi
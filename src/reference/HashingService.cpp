@@ -0,0 +1,540 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/Mutex.h"
+#include "util/ParallelJob.h"
+#include "reference/HashingService.h"
+#include "reference/DefaultEncryptor.h"
+
+#if defined(ESAPI_OS_STARNIX)
+# include <pthread.h>
+# include <unistd.h>
+# include <sys/time.h>
+#endif
+
+#include <deque>
+#include <algorithm>
+
+#include <string.h>
+
+namespace esapi
+{
+  ///////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////// Platform Helpers ///////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  /**
+   * A condition variable used with an esapi::Mutex. On Windows this requires Vista
+   * or above (CONDITION_VARIABLE and SleepConditionVariableCS).
+   */
+  class Condition : private NotCopyable
+  {
+  public:
+    Condition()
+    {
+#if defined(ESAPI_OS_WINDOWS)
+      InitializeConditionVariable(&m_cond);
+#elif defined(ESAPI_OS_STARNIX)
+      int ret = pthread_cond_init(&m_cond, NULL);
+      ASSERT(ret == 0);
+      if(ret != 0)
+        throw IllegalStateException("Failed to initialize condition variable");
+#endif
+    }
+
+    ~Condition()
+    {
+#if defined(ESAPI_OS_STARNIX)
+      int ret = pthread_cond_destroy(&m_cond);
+      ASSERT(ret == 0);
+      UNUSED_VARIABLE(ret);
+#endif
+    }
+
+    /**
+     * Atomically releases the mutex and waits. The mutex is held on return.
+     */
+    void wait(Mutex& mutex)
+    {
+#if defined(ESAPI_OS_WINDOWS)
+      SleepConditionVariableCS(&m_cond, &mutex.getMutex(), INFINITE);
+#elif defined(ESAPI_OS_STARNIX)
+      int ret = pthread_cond_wait(&m_cond, &mutex.getMutex());
+      ASSERT(ret == 0);
+      UNUSED_VARIABLE(ret);
+#endif
+    }
+
+    void signal()
+    {
+#if defined(ESAPI_OS_WINDOWS)
+      WakeConditionVariable(&m_cond);
+#elif defined(ESAPI_OS_STARNIX)
+      pthread_cond_signal(&m_cond);
+#endif
+    }
+
+    void broadcast()
+    {
+#if defined(ESAPI_OS_WINDOWS)
+      WakeAllConditionVariable(&m_cond);
+#elif defined(ESAPI_OS_STARNIX)
+      pthread_cond_broadcast(&m_cond);
+#endif
+    }
+
+  private:
+#if defined(ESAPI_OS_WINDOWS)
+    CONDITION_VARIABLE m_cond;
+#elif defined(ESAPI_OS_STARNIX)
+    pthread_cond_t m_cond;
+#endif
+  };
+
+  /**
+   * A timestamp in microseconds, for the latency counters.
+   */
+  static unsigned long long NowMicros()
+  {
+#if defined(ESAPI_OS_WINDOWS)
+    LARGE_INTEGER freq, count;
+    if(!QueryPerformanceFrequency(&freq) || !QueryPerformanceCounter(&count) || !freq.QuadPart)
+      return 0;
+    return (unsigned long long)(count.QuadPart / freq.QuadPart) * 1000000ULL +
+           (unsigned long long)(count.QuadPart % freq.QuadPart) * 1000000ULL / (unsigned long long)freq.QuadPart;
+#elif defined(ESAPI_OS_STARNIX)
+    struct timeval tv;
+    if(gettimeofday(&tv, NULL) != 0)
+      return 0;
+    return (unsigned long long)tv.tv_sec * 1000000ULL + (unsigned long long)tv.tv_usec;
+#else
+    return 0;
+#endif
+  }
+
+  /**
+   * Compares two strings without an early out on the first difference.
+   */
+  static bool ConstantTimeEquals(const NarrowString& s1, const NarrowString& s2)
+  {
+    const size_t n = std::max(s1.size(), s2.size());
+    unsigned int diff = (unsigned int)(s1.size() ^ s2.size());
+
+    for(size_t i = 0; i < n; i++)
+      {
+        const unsigned char c1 = i < s1.size() ? (unsigned char)s1[i] : 0;
+        const unsigned char c2 = i < s2.size() ? (unsigned char)s2[i] : 0;
+        diff |= (unsigned int)(c1 ^ c2);
+      }
+
+    return diff == 0;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////////// Hash Job ///////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  class HashJob : private NotCopyable
+  {
+  public:
+    HashJob(const NarrowString& plainText, const NarrowString& salt, unsigned int iterations)
+      : m_plainText(plainText), m_salt(salt), m_iterations(iterations), m_result(), m_error(),
+        m_done(false), m_failed(false), m_submitted(NowMicros()), m_mutex(), m_cond()
+    {
+    }
+
+    ~HashJob()
+    {
+      wipePlainText();
+    }
+
+    void complete(const NarrowString& result)
+    {
+      wipePlainText();
+
+      MutexLock lock(m_mutex);
+      m_result = result;
+      m_done = true;
+      m_cond.broadcast();
+    }
+
+    void fail(const NarrowString& error)
+    {
+      wipePlainText();
+
+      MutexLock lock(m_mutex);
+      m_error = error;
+      m_failed = m_done = true;
+      m_cond.broadcast();
+    }
+
+    bool isDone() const
+    {
+      MutexLock lock(m_mutex);
+      return m_done;
+    }
+
+    NarrowString get() const
+    {
+      NarrowString result;
+      if(!tryGet(result))
+        {
+          MutexLock lock(m_mutex);
+          throw EncryptionException(m_error);
+        }
+
+      return result;
+    }
+
+    /**
+     * Waits for the job. Returns false, rather than throwing, if the hash failed.
+     */
+    bool tryGet(NarrowString& result) const
+    {
+      MutexLock lock(m_mutex);
+      while(!m_done)
+        m_cond.wait(m_mutex);
+
+      if(m_failed)
+        return false;
+
+      result = m_result;
+      return true;
+    }
+
+    /**
+     * The password is only needed until the hash runs.
+     */
+    void wipePlainText()
+    {
+      std::fill(m_plainText.begin(), m_plainText.end(), '\0');
+      m_plainText.clear();
+    }
+
+  public:
+    // Written at construction, then read only by the worker which runs the job
+    NarrowString m_plainText;
+    NarrowString m_salt;
+    unsigned int m_iterations;
+
+  private:
+    // Guarded by m_mutex
+    NarrowString m_result;
+    NarrowString m_error;
+    bool m_done;
+    bool m_failed;
+
+  public:
+    const unsigned long long m_submitted;
+
+  private:
+    mutable Mutex m_mutex;
+    mutable Condition m_cond;
+  };
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////// Hashing Service Impl ///////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  class HashingServiceImpl : private NotCopyable
+  {
+  public:
+    explicit HashingServiceImpl(size_t capacity)
+      : m_encryptor(), m_mutex(), m_notEmpty(), m_notFull(), m_queue(), m_capacity(capacity),
+        m_stopping(false), m_threads(), m_metrics(), m_totalLatency(0)
+    {
+      ::memset(&m_metrics, 0x00, sizeof(m_metrics));
+    }
+
+    /**
+     * Starts the workers. If any thread fails to start, the ones already running are
+     * stopped and joined before throwing.
+     */
+    void start(unsigned int workers)
+    {
+      for(unsigned int i = 0; i < workers; i++)
+        {
+          ParallelJob::ThreadHandle handle;
+
+          if(!ParallelJob::StartThread(&HashingServiceImpl::ThreadProc, this, handle))
+            {
+              stop();
+              throw IllegalStateException("Failed to start the hashing worker threads");
+            }
+
+          m_threads.push_back(handle);
+        }
+
+      MutexLock lock(m_mutex);
+      m_metrics.workers = m_threads.size();
+    }
+
+    /**
+     * Stops accepting work, lets the workers drain the queue and joins them.
+     */
+    void stop()
+    {
+      {
+        MutexLock lock(m_mutex);
+        m_stopping = true;
+        m_notEmpty.broadcast();
+        m_notFull.broadcast();
+      }
+
+      for(size_t i = 0; i < m_threads.size(); i++)
+        ParallelJob::JoinThread(m_threads[i]);
+
+      m_threads.clear();
+    }
+
+    /**
+     * Queues a job. If the queue is full, either fails (wait == false) or waits for room.
+     * Returns false if the job was not queued.
+     */
+    bool enqueue(const shared_ptr<HashJob>& job, bool wait)
+    {
+      MutexLock lock(m_mutex);
+
+      while(!m_stopping && m_queue.size() >= m_capacity)
+        {
+          if(!wait)
+            {
+              m_metrics.rejected++;
+              return false;
+            }
+
+          m_notFull.wait(m_mutex);
+        }
+
+      if(m_stopping)
+        {
+          m_metrics.rejected++;
+          return false;
+        }
+
+      m_queue.push_back(job);
+      m_metrics.submitted++;
+      m_metrics.peakQueueDepth = std::max(m_metrics.peakQueueDepth, m_queue.size());
+      m_notEmpty.signal();
+
+      return true;
+    }
+
+    HashingMetrics metrics() const
+    {
+      MutexLock lock(m_mutex);
+
+      HashingMetrics metrics = m_metrics;
+      metrics.queueDepth = m_queue.size();
+
+      const unsigned long long finished = m_metrics.completed + m_metrics.failed;
+      metrics.averageLatency = finished ? m_totalLatency / finished : 0;
+
+      return metrics;
+    }
+
+  private:
+    /**
+     * The worker loop. Runs until the service is stopping and the queue is empty.
+     */
+    void run()
+    {
+      for( ; ; )
+        {
+          shared_ptr<HashJob> job;
+
+          {
+            MutexLock lock(m_mutex);
+            while(m_queue.empty() && !m_stopping)
+              m_notEmpty.wait(m_mutex);
+
+            if(m_queue.empty())
+              return;
+
+            job = m_queue.front();
+            m_queue.pop_front();
+            m_notFull.signal();
+          }
+
+          NarrowString result, error;
+          bool ok = true;
+
+          try
+            {
+              result = m_encryptor.hash(job->m_plainText, job->m_salt, job->m_iterations);
+            }
+          catch(const std::exception& ex)
+            {
+              ok = false;
+              error = ex.what();
+            }
+          catch(...)
+            {
+              ok = false;
+              error = "Failed to compute hash";
+            }
+
+          const unsigned long long now = NowMicros();
+          const unsigned long long latency = now > job->m_submitted ? now - job->m_submitted : 0;
+
+          // Count the job before releasing its waiters so a caller which has the
+          // result never sees stale counters
+          {
+            MutexLock lock(m_mutex);
+            if(ok)
+              m_metrics.completed++;
+            else
+              m_metrics.failed++;
+
+            m_totalLatency += latency;
+            m_metrics.maxLatency = std::max(m_metrics.maxLatency, latency);
+          }
+
+          if(ok)
+            job->complete(result);
+          else
+            job->fail(error);
+        }
+    }
+
+#if defined(ESAPI_OS_WINDOWS)
+    static unsigned __stdcall ThreadProc(void* param)
+    {
+      static_cast<HashingServiceImpl*>(param)->run();
+      return 0;
+    }
+#elif defined(ESAPI_OS_STARNIX)
+    static void* ThreadProc(void* param)
+    {
+      static_cast<HashingServiceImpl*>(param)->run();
+      return NULL;
+    }
+#endif
+
+  private:
+    // DefaultEncryptor::hash() is const and keeps no state, so the workers share it
+    DefaultEncryptor m_encryptor;
+
+    mutable Mutex m_mutex;
+    Condition m_notEmpty;
+    Condition m_notFull;
+
+    // Guarded by m_mutex
+    std::deque<shared_ptr<HashJob> > m_queue;
+    const size_t m_capacity;
+    bool m_stopping;
+
+    std::vector<ParallelJob::ThreadHandle> m_threads;
+
+    // Guarded by m_mutex
+    HashingMetrics m_metrics;
+    unsigned long long m_totalLatency;
+  };
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  //////////////////////////////////// Hash Future ///////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  HashFuture::HashFuture(const shared_ptr<HashJob>& job)
+    : m_job(job)
+  {
+    ASSERT(m_job.get() != nullptr);
+  }
+
+  bool HashFuture::isDone() const
+  {
+    ASSERT(m_job.get() != nullptr);
+    return m_job->isDone();
+  }
+
+  NarrowString HashFuture::get() const
+  {
+    ASSERT(m_job.get() != nullptr);
+    return m_job->get();
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  ////////////////////////////////// Hashing Service /////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  static size_t ValidateQueueCapacity(size_t capacity)
+  {
+    ASSERT(capacity);
+    if(!capacity)
+      throw IllegalArgumentException("The queue capacity is not valid");
+
+    return capacity;
+  }
+
+  HashingService::HashingService(unsigned int workers, size_t queueCapacity)
+    : m_impl(new HashingServiceImpl(ValidateQueueCapacity(queueCapacity)))
+  {
+    ASSERT(m_impl.get() != nullptr);
+
+    // 0 is one worker per processor, and the count is capped as for ParallelJob
+    m_impl->start(ParallelJob::ThreadCount(workers));
+  }
+
+  HashingService::~HashingService()
+  {
+    ASSERT(m_impl.get() != nullptr);
+    m_impl->stop();
+  }
+
+  HashFuture HashingService::submit(const NarrowString& plainText, const NarrowString& salt, unsigned int iterations)
+  {
+    ASSERT(m_impl.get() != nullptr);
+
+    shared_ptr<HashJob> job(new HashJob(plainText, salt, iterations));
+    if(!m_impl->enqueue(job, false))
+      throw IllegalStateException("The hashing service is busy or shutting down");
+
+    return HashFuture(job);
+  }
+
+  void HashingService::verify(const std::vector<PasswordCheck>& checks, std::vector<bool>& results)
+  {
+    ASSERT(m_impl.get() != nullptr);
+
+    std::vector<shared_ptr<HashJob> > jobs;
+    jobs.reserve(checks.size());
+
+    // Queue everything first so the whole pool works on the batch
+    for(size_t i = 0; i < checks.size(); i++)
+      {
+        shared_ptr<HashJob> job(new HashJob(checks[i].plainText, checks[i].salt, checks[i].iterations));
+        if(!m_impl->enqueue(job, true))
+          throw IllegalStateException("The hashing service is shutting down");
+
+        jobs.push_back(job);
+      }
+
+    // A hash which failed (counted in the metrics) is a failed check, not a failed batch
+    results.assign(checks.size(), false);
+    for(size_t i = 0; i < jobs.size(); i++)
+      {
+        NarrowString hash;
+        if(jobs[i]->tryGet(hash))
+          results[i] = ConstantTimeEquals(hash, checks[i].expected);
+      }
+  }
+
+  HashingMetrics HashingService::getMetrics() const
+  {
+    ASSERT(m_impl.get() != nullptr);
+    return m_impl->metrics();
+  }
+
+} // NAMESPACE esapi
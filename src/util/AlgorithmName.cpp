@@ -17,42 +17,224 @@
 #include "util/TextConvert.h"
 #include "errors/NoSuchAlgorithmException.h"
 #include <algorithm>
+#include <cstring>
 
 namespace esapi
 {
   // Private to this module
   static void split(const std::string& str, const std::string& delim, std::vector<std::string>& parts);
 
+  ///////////////////////////////////////////////////////////////////////////////////
+  ///////////////////////////////// Algorithm Registry //////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
+  // The registry is a set of static, immutable tables. Names are resolved once (when an
+  // AlgorithmName is constructed) by a binary search of the alias tables, and the
+  // factories dispatch on the interned identifiers. The alias tables are keyed on the
+  // lowercase name and *must* be kept sorted in strcmp order.
+
+  struct AlgorithmAlias
+  {
+    const char* alias;
+    AlgorithmName::AlgorithmId id;
+  };
+
+  struct AlgorithmInfo
+  {
+    const char* name;
+    AlgorithmName::AlgorithmFamily family;
+  };
+
+  struct ModeAlias
+  {
+    const char* alias;
+    AlgorithmName::ModeId id;
+  };
+
+  struct PaddingAlias
+  {
+    const char* alias;
+    AlgorithmName::PaddingId id;
+  };
+
+  static const AlgorithmAlias g_algorithmAliases[] = {
+    { "aes", AlgorithmName::AlgAES },
+    { "blowfish", AlgorithmName::AlgBlowfish },
+    { "camellia", AlgorithmName::AlgCamellia },
+    { "des", AlgorithmName::AlgDES },
+    { "des_ede", AlgorithmName::AlgDES_ede },
+    { "desede", AlgorithmName::AlgDES_ede },
+    { "diffiehellman", AlgorithmName::AlgDiffieHellman },
+    { "hmacsha", AlgorithmName::AlgHmacSHA1 },
+    { "hmacsha-1", AlgorithmName::AlgHmacSHA1 },
+    { "hmacsha-224", AlgorithmName::AlgHmacSHA224 },
+    { "hmacsha-256", AlgorithmName::AlgHmacSHA256 },
+    { "hmacsha-384", AlgorithmName::AlgHmacSHA384 },
+    { "hmacsha-512", AlgorithmName::AlgHmacSHA512 },
+    { "hmacsha1", AlgorithmName::AlgHmacSHA1 },
+    { "hmacsha224", AlgorithmName::AlgHmacSHA224 },
+    { "hmacsha256", AlgorithmName::AlgHmacSHA256 },
+    { "hmacsha384", AlgorithmName::AlgHmacSHA384 },
+    { "hmacsha512", AlgorithmName::AlgHmacSHA512 },
+    { "hmacwhirlpoo", AlgorithmName::AlgHmacWhirlpoo },
+    { "md-5", AlgorithmName::AlgMD5 },
+    { "md5", AlgorithmName::AlgMD5 },
+    { "pbewithsha1", AlgorithmName::AlgPBEWithSHA1 },
+    { "pbewithsha224", AlgorithmName::AlgPBEWithSHA224 },
+    { "pbewithsha256", AlgorithmName::AlgPBEWithSHA256 },
+    { "pbewithsha384", AlgorithmName::AlgPBEWithSHA384 },
+    { "pbewithsha512", AlgorithmName::AlgPBEWithSHA512 },
+    { "pbewithwhirlpoo", AlgorithmName::AlgPBEWithWhirlpoo },
+    { "sha", AlgorithmName::AlgSHA1 },
+    { "sha-1", AlgorithmName::AlgSHA1 },
+    { "sha-224", AlgorithmName::AlgSHA224 },
+    { "sha-256", AlgorithmName::AlgSHA256 },
+    { "sha-384", AlgorithmName::AlgSHA384 },
+    { "sha-512", AlgorithmName::AlgSHA512 },
+    { "sha1", AlgorithmName::AlgSHA1 },
+    { "sha1prng", AlgorithmName::AlgSHA1PRNG },
+    { "sha224", AlgorithmName::AlgSHA224 },
+    { "sha256", AlgorithmName::AlgSHA256 },
+    { "sha384", AlgorithmName::AlgSHA384 },
+    { "sha512", AlgorithmName::AlgSHA512 },
+    { "whirlpoo", AlgorithmName::AlgWhirlpoo }
+  };
+
+  // Indexed by AlgorithmId
+  static const AlgorithmInfo g_algorithmInfo[AlgorithmName::AlgCount] = {
+    { "", AlgorithmName::FamilyUnknown },
+
+    { "AES", AlgorithmName::FamilyCipher },
+    { "Camellia", AlgorithmName::FamilyCipher },
+    { "Blowfish", AlgorithmName::FamilyCipher },
+    { "DES_ede", AlgorithmName::FamilyCipher },
+    { "DES", AlgorithmName::FamilyCipher },
+
+    { "MD5", AlgorithmName::FamilyHash },
+    { "SHA-1", AlgorithmName::FamilyHash },
+    { "SHA-224", AlgorithmName::FamilyHash },
+    { "SHA-256", AlgorithmName::FamilyHash },
+    { "SHA-384", AlgorithmName::FamilyHash },
+    { "SHA-512", AlgorithmName::FamilyHash },
+    { "Whirlpoo", AlgorithmName::FamilyHash },
+
+    { "HmacSHA1", AlgorithmName::FamilyHmac },
+    { "HmacSHA224", AlgorithmName::FamilyHmac },
+    { "HmacSHA256", AlgorithmName::FamilyHmac },
+    { "HmacSHA384", AlgorithmName::FamilyHmac },
+    { "HmacSHA512", AlgorithmName::FamilyHmac },
+    { "HmacWhirlpoo", AlgorithmName::FamilyHmac },
+
+    { "PBEWithSHA1", AlgorithmName::FamilyPBE },
+    { "PBEWithSHA224", AlgorithmName::FamilyPBE },
+    { "PBEWithSHA256", AlgorithmName::FamilyPBE },
+    { "PBEWithSHA384", AlgorithmName::FamilyPBE },
+    { "PBEWithSHA512", AlgorithmName::FamilyPBE },
+    { "PBEWithWhirlpoo", AlgorithmName::FamilyPBE },
+
+    { "DiffieHellman", AlgorithmName::FamilyKeyAgreement },
+
+    { "SHA1PRNG", AlgorithmName::FamilyRandom }
+  };
+
+  static const ModeAlias g_modeAliases[] = {
+    { "cbc", AlgorithmName::ModeCBC },
+    { "ccm", AlgorithmName::ModeCCM },
+    { "cfb", AlgorithmName::ModeCFB },
+    { "ctr", AlgorithmName::ModeCTR },
+    { "eax", AlgorithmName::ModeEAX },
+    { "ecb", AlgorithmName::ModeECB },
+    { "gcm", AlgorithmName::ModeGCM },
+    { "none", AlgorithmName::ModeNONE },
+    { "ofb", AlgorithmName::ModeOFB }
+  };
+
+  // Indexed by ModeId
+  static const char* const g_modeNames[] = {
+    "", "NONE", "ECB", "CBC", "OFB", "CFB", "CTR", "CCM", "EAX", "GCM"
+  };
+
+  static const PaddingAlias g_paddingAliases[] = {
+    { "none", AlgorithmName::PaddingNone },
+    { "nopadding", AlgorithmName::PaddingNone },
+    { "pkcs5padding", AlgorithmName::PaddingPKCS5 },
+    { "ssl3padding", AlgorithmName::PaddingSSL3 }
+  };
+
+  // Indexed by PaddingId
+  static const char* const g_paddingNames[] = {
+    "", "NoPadding", "PKCS5Padding", "SSL3Padding"
+  };
+
+  // Orders a table entry against a key for the binary search
+  struct AliasLess
+  {
+    template <class ENTRY>
+    bool operator()(const ENTRY& entry, const char* key) const
+    {
+      return ::strcmp(entry.alias, key) < 0;
+    }
+  };
+
+  // Binary search of a sorted alias table. Returns nullptr if the key is not present.
+  template <class ENTRY, size_t N>
+  static const ENTRY* lookup(const ENTRY (&table)[N], const NarrowString& key)
+  {
+    const ENTRY* first = table;
+    const ENTRY* last = table + N;
+
+    const ENTRY* it = std::lower_bound(first, last, key.c_str(), AliasLess());
+    if(it != last && ::strcmp(it->alias, key.c_str()) == 0)
+      return it;
+
+    return nullptr;
+  }
+
+  AlgorithmName::AlgorithmFamily AlgorithmName::getFamily(AlgorithmId id)
+  {
+    ASSERT(id >= AlgUnknown && id < AlgCount);
+    if(!(id >= AlgUnknown && id < AlgCount))
+      return FamilyUnknown;
+
+    return g_algorithmInfo[id].family;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////////
+  /////////////////////////////////// Algorithm Name ////////////////////////////////
+  ///////////////////////////////////////////////////////////////////////////////////
+
   AlgorithmName::AlgorithmName(const NarrowString& algorithm, bool cipherOnly)
-    : m_normal(normalizeAlgorithm(algorithm))
+    : m_normal(), m_id(AlgUnknown), m_mode(ModeAbsent), m_padding(PaddingAbsent)
   {
     ASSERT( !algorithm.empty() );
 
+    // Parse once. The accessors work from the interned identifiers.
+    parse(algorithm, m_id, m_mode, m_padding);
+    m_normal = format(m_id, m_mode, m_padding);
+
     // We'd prefer to throw in the ctor, but its a limitation, not a feature!
     // Actually, we need to narmalize first (in case of throw), so maybe it is a feature.
-    NarrowString cipher;
-    getCipher(cipher);
-
-    if(cipherOnly && m_normal != cipher)
+    if(cipherOnly && m_mode != ModeAbsent)
       throw NoSuchAlgorithmException(m_normal + " not available");
   }
 
   AlgorithmName::AlgorithmName(const WideString& algorithm, bool cipherOnly)
-    : m_normal(TextConvert::WideToNarrow(normalizeAlgorithm(algorithm)))
+    : m_normal(), m_id(AlgUnknown), m_mode(ModeAbsent), m_padding(PaddingAbsent)
   {
     ASSERT( !algorithm.empty() );
 
+    // Parse once. The accessors work from the interned identifiers.
+    parse(TextConvert::WideToNarrow(algorithm), m_id, m_mode, m_padding);
+    m_normal = format(m_id, m_mode, m_padding);
+
     // We'd prefer to throw in the ctor, but its a limitation, not a feature!
     // Actually, we need to narmalize first (in case of throw), so maybe it is a feature.
-    NarrowString cipher;
-    getCipher(cipher);
-
-    if(cipherOnly && m_normal != cipher)
+    if(cipherOnly && m_mode != ModeAbsent)
       throw NoSuchAlgorithmException(m_normal + " not available");
   }
 
   AlgorithmName::AlgorithmName(const AlgorithmName& rhs)
-    : m_normal(rhs.m_normal)
+    : m_normal(rhs.m_normal), m_id(rhs.m_id), m_mode(rhs.m_mode), m_padding(rhs.m_padding)
   {
   }
 
@@ -61,6 +243,9 @@ namespace esapi
     if(this != &rhs)
       {
         m_normal = rhs.m_normal;
+        m_id = rhs.m_id;
+        m_mode = rhs.m_mode;
+        m_padding = rhs.m_padding;
       }
     return *this;
   }
@@ -77,11 +262,8 @@ namespace esapi
 
   bool AlgorithmName::getCipher(NarrowString& cipher) const
   {
-    std::vector<std::string> parts;
-    split(m_normal, "\\/:", parts);
-
-    if(parts.size() >= 1 && parts[0].length()) {
-      cipher = parts[0];
+    if(m_id != AlgUnknown) {
+      cipher = g_algorithmInfo[m_id].name;
       return true;
     }
 
@@ -104,11 +286,8 @@ namespace esapi
 
   bool AlgorithmName::getMode(NarrowString& mode) const
   {
-    std::vector<std::string> parts;
-    split(m_normal, "\\/:", parts);
-
-    if(parts.size() >= 2 && parts[1].length()) {
-      mode = parts[1];
+    if(m_mode != ModeAbsent) {
+      mode = g_modeNames[m_mode];
       return true;
     }
 
@@ -131,11 +310,8 @@ namespace esapi
 
   bool AlgorithmName::getPadding(NarrowString& padding) const
   {
-    std::vector<std::string> parts;
-    split(m_normal, "\\/:", parts);
-
-    if(parts.size() >= 3 && parts[2].length()) {
-      padding = parts[2];
+    if(m_padding != PaddingAbsent) {
+      padding = g_paddingNames[m_padding];
       return true;
     }
 
@@ -183,7 +359,40 @@ namespace esapi
   {
     ASSERT(!algorithm.empty());
 
-    NarrowString alg(algorithm), mode, padding, temp;
+    AlgorithmId id;
+    ModeId mode;
+    PaddingId padding;
+
+    parse(algorithm, id, mode, padding);
+    return format(id, mode, padding);
+  }
+
+  NarrowString AlgorithmName::format(AlgorithmId id, ModeId mode, PaddingId padding)
+  {
+    ASSERT(id > AlgUnknown && id < AlgCount);
+    NarrowString alg(g_algorithmInfo[id].name);
+
+    if(mode == ModeAbsent)
+      return alg;
+
+    // Final return string
+    alg += "/";
+    alg += g_modeNames[mode];
+    alg += "/";
+    alg += g_paddingNames[padding];
+
+    return alg;
+  }
+
+  void AlgorithmName::parse(const NarrowString& algorithm, AlgorithmId& id, ModeId& mode, PaddingId& padding)
+  {
+    ASSERT(!algorithm.empty());
+
+    id = AlgUnknown;
+    mode = ModeAbsent;
+    padding = PaddingAbsent;
+
+    NarrowString alg(algorithm);
 
     // Cut out whitespace
     NarrowString::iterator it = std::remove_if(alg.begin(), alg.end(), ::isspace);
@@ -210,155 +419,48 @@ namespace esapi
         throw NoSuchAlgorithmException(oss.str());
       }
 
-    // Clear algorithm for final processing
-    alg = mode = padding = "";
-
     // We should see a CIPHER (ie, HmacSHA1), or a CIPHER/MODE/PADDING.
-    temp = parts[0];
-
-    //////// Symmetric Ciphers ////////
-
-    if(temp == "aes")
-      alg = "AES";
-    else if(temp == "camellia")
-      alg = "Camellia";
-    else if(temp == "blowfish")
-      alg = "Blowfish";
-    else if(temp == "des_ede" || temp == "desede")
-      alg = "DES_ede";
-    else if(temp == "des")
-      alg = "DES";
-
-    //////// Hashes ////////
-
-    else if(temp == "md-5" || temp == "md5")
-      alg = "MD5";
-    else if(temp == "sha-1" || temp == "sha1" || temp == "sha")
-      alg = "SHA-1";
-    else if(temp == "sha-224" || temp == "sha224")
-      alg = "SHA-224";
-    else if(temp == "sha-256" || temp == "sha256")
-      alg = "SHA-256";
-    else if(temp == "sha-384" || temp == "sha384")
-      alg = "SHA-384";
-    else if(temp == "sha-512" || temp == "sha512")
-      alg = "SHA-512";
-    else if(temp == "whirlpoo")
-      alg = "Whirlpoo";
-
-    //////// HMACs ////////
-
-    else if(temp == "hmacsha-1" || temp == "hmacsha1" || temp == "hmacsha")
-      alg = "HmacSHA1";
-    else if(temp == "hmacsha-224" || temp == "hmacsha224")
-      alg = "HmacSHA224";
-    else if(temp == "hmacsha-256" || temp == "hmacsha256")
-      alg = "HmacSHA256";
-    else if(temp == "hmacsha-384" || temp == "hmacsha384")
-      alg = "HmacSHA384";
-    else if(temp == "hmacsha-512" || temp == "hmacsha512")
-      alg = "HmacSHA512";
-    else if(temp == "hmacwhirlpoo")
-      alg = "HmacWhirlpoo";
-
-    //////// PBE Hmacs ////////
-
-    else if(temp == "pbewithsha1")
-      alg = "PBEWithSHA1";
-    else if(temp == "pbewithsha224")
-      alg = "PBEWithSHA224";
-    else if(temp == "pbewithsha256")
-      alg = "PBEWithSHA256";
-    else if(temp == "pbewithsha384")
-      alg = "PBEWithSHA384";
-    else if(temp == "pbewithsha512")
-      alg = "PBEWithSHA512";
-    else if(temp == "pbewithwhirlpoo")
-      alg = "PBEWithWhirlpoo";
-
-    //////// Key Agreement ////////
-
-    else if(temp == "diffiehellman")
-      alg = "DiffieHellman";
-
-    //////// SecureRandom ////////
-
-    else if(temp == "sha1prng")
-      alg = "SHA1PRNG";
-
-    //////// Oh shit! ////////
-
-    else {
+    const AlgorithmAlias* a = lookup(g_algorithmAliases, parts[0]);
+    if(!a) {
       std::ostringstream oss;
-      oss << "Invalid transformation format: '" << trimmed << "', cipher '" << temp << "'";
+      oss << "Invalid transformation format: '" << trimmed << "', cipher '" << parts[0] << "'";
       ESAPI_ASSERT2(false, oss.str());
       throw NoSuchAlgorithmException(oss.str());
     }
 
-    if(parts.size() == 1)
-      return alg;
+    if(parts.size() == 1) {
+      id = a->id;
+      return;
+    }
 
     // Mode
-    temp = parts[1];
-
-    if(temp == "none")
-      mode = "NONE";
-    else if(temp == "ecb")
-      mode = "ECB";
-    else if(temp == "cbc")
-      mode = "CBC";
-    else if(temp == "ofb")
-      mode = "OFB";
-    else if(temp == "cfb")
-      mode = "CFB";
-    else if(temp == "ctr")
-      mode = "CTR";
-#if 0
-    // Uncomment in the future
-    else if(temp == "ccm")
-      mode = "CCM";
-    else if(temp == "gcm")
-      mode = "GCM";
-    else if(temp == "eax")
-      mode = "EAX";
-#endif
-
-    else {
+    const ModeAlias* m = lookup(g_modeAliases, parts[1]);
+    if(!m) {
       std::ostringstream oss;
-      oss << "Invalid transformation format: '" << trimmed << "', mode '" << temp << "'";
+      oss << "Invalid transformation format: '" << trimmed << "', mode '" << parts[1] << "'";
       ESAPI_ASSERT2(false, oss.str());
       throw NoSuchAlgorithmException(oss.str());
     }
 
     // Padding
-    temp = parts[2];
-
-    if(temp == "nopadding" || temp == "none")
-      padding = "NoPadding";
-    else if(temp == "pkcs5padding")
-      padding = "PKCS5Padding";
-    else if(temp == "ssl3padding")
-      padding = "SSL3Padding";
-
-    else {
+    const PaddingAlias* p = lookup(g_paddingAliases, parts[2]);
+    if(!p) {
       std::ostringstream oss;
-      oss << "Invalid transformation format: '" << trimmed << "', padding '" << temp << "'";
+      oss << "Invalid transformation format: '" << trimmed << "', padding '" << parts[2] << "'";
       ESAPI_ASSERT2(false, oss.str());
       throw NoSuchAlgorithmException(oss.str());
     }
 
     // Remove if we ever get around to adding SSL3 padding.
-    if(padding == "SSL3Padding") {
+    if(p->id == PaddingSSL3) {
       std::ostringstream oss;
-      oss << "Unsupported transformation format: '" << trimmed << "', padding '" << temp << "'";
+      oss << "Unsupported transformation format: '" << trimmed << "', padding '" << parts[2] << "'";
       throw NoSuchAlgorithmException(oss.str());
     }
 
-    // Final return string
-    alg += "/" + mode;
-    alg += "/" + padding;
-
-    return alg;
+    id = a->id;
+    mode = m->id;
+    padding = p->id;
   }
 
 } // NAMESPACE
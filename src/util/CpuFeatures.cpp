@@ -0,0 +1,190 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/CpuFeatures.h"
+
+#if (defined(ESAPI_ARCH_X86) || defined(ESAPI_ARCH_X64)) && defined(ESAPI_CXX_MSVC)
+# include <intrin.h>
+#endif
+
+#if defined(ESAPI_OS_STARNIX)
+# include <unistd.h>
+#endif
+
+#include <string.h>
+
+namespace esapi
+{
+  struct CpuInfo
+  {
+    bool sse2, ssse3, sse41, avx2, aesni, sha, rdrand, rdseed;
+  };
+
+#if defined(ESAPI_ARCH_X86) || defined(ESAPI_ARCH_X64)
+
+  /**
+   * Executes CPUID for the given leaf and subleaf.
+   */
+  static void CpuId(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+  {
+#if defined(ESAPI_CXX_MSVC)
+    int info[4];
+    __cpuidex(info, (int)leaf, (int)subleaf);
+    regs[0] = (unsigned int)info[0]; regs[1] = (unsigned int)info[1];
+    regs[2] = (unsigned int)info[2]; regs[3] = (unsigned int)info[3];
+#elif defined(ESAPI_ARCH_X86) && defined(__PIC__)
+    // EBX is the PIC register on i386, so it must be preserved by hand
+    __asm__ __volatile__ (
+      "xchgl %%ebx, %1\n\t"
+      "cpuid\n\t"
+      "xchgl %%ebx, %1\n\t"
+      : "=a" (regs[0]), "=&r" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+      : "0" (leaf), "2" (subleaf));
+#else
+    __asm__ __volatile__ (
+      "cpuid"
+      : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+      : "0" (leaf), "2" (subleaf));
+#endif
+  }
+
+  /**
+   * Returns the low 32 bits of XCR0. Only call when CPUID reports OSXSAVE.
+   */
+  static unsigned int XGetBv()
+  {
+#if defined(ESAPI_CXX_MSVC) && (_MSC_VER >= 1600)
+    return (unsigned int)_xgetbv(0);
+#elif defined(ESAPI_CXX_MSVC)
+    // No intrinsic before Visual Studio 2010 SP1. Report no OS support for AVX.
+    return 0;
+#else
+    unsigned int eax, edx;
+    // xgetbv, spelled out for assemblers which pre-date the mnemonic
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0));
+    return eax;
+#endif
+  }
+
+  static CpuInfo DetectCpuInfo()
+  {
+    CpuInfo info;
+    ::memset(&info, 0x00, sizeof(info));
+
+    unsigned int regs[4] = {0,0,0,0};
+    CpuId(0, 0, regs);
+    const unsigned int maxLeaf = regs[0];
+    if(maxLeaf < 1)
+      return info;
+
+    CpuId(1, 0, regs);
+    info.sse2   = !!(regs[3] & (1u << 26));
+    info.ssse3  = !!(regs[2] & (1u << 9));
+    info.sse41  = !!(regs[2] & (1u << 19));
+    info.aesni  = !!(regs[2] & (1u << 25));
+    info.rdrand = !!(regs[2] & (1u << 30));
+
+    // The OS must save the XMM and YMM state (XCR0 bits 1 and 2) before AVX is usable
+    const bool osxsave = !!(regs[2] & (1u << 27));
+    const bool avx = !!(regs[2] & (1u << 28));
+    const bool ymm = osxsave && ((XGetBv() & 0x06) == 0x06);
+
+    if(maxLeaf >= 7)
+      {
+        CpuId(7, 0, regs);
+        info.avx2   = avx && ymm && !!(regs[1] & (1u << 5));
+        info.sha    = !!(regs[1] & (1u << 29));
+        info.rdseed = !!(regs[1] & (1u << 18));
+      }
+
+    return info;
+  }
+
+#else
+
+  static CpuInfo DetectCpuInfo()
+  {
+    CpuInfo info;
+    ::memset(&info, 0x00, sizeof(info));
+    return info;
+  }
+
+#endif
+
+  /**
+   * Detection is idempotent, so a race on first use (compilers which do not
+   * guard function statics) stores the same values twice and is benign.
+   */
+  static const CpuInfo& GetCpuInfo()
+  {
+    static const CpuInfo s_info = DetectCpuInfo();
+    return s_info;
+  }
+
+  bool CpuFeatures::HasSSE2()
+  {
+    return GetCpuInfo().sse2;
+  }
+
+  bool CpuFeatures::HasSSSE3()
+  {
+    return GetCpuInfo().ssse3;
+  }
+
+  bool CpuFeatures::HasSSE41()
+  {
+    return GetCpuInfo().sse41;
+  }
+
+  bool CpuFeatures::HasAVX2()
+  {
+    return GetCpuInfo().avx2;
+  }
+
+  bool CpuFeatures::HasAESNI()
+  {
+    return GetCpuInfo().aesni;
+  }
+
+  bool CpuFeatures::HasSHA()
+  {
+    return GetCpuInfo().sha;
+  }
+
+  bool CpuFeatures::HasRDRAND()
+  {
+    return GetCpuInfo().rdrand;
+  }
+
+  bool CpuFeatures::HasRDSEED()
+  {
+    return GetCpuInfo().rdseed;
+  }
+
+  unsigned int CpuFeatures::ProcessorCount()
+  {
+#if defined(ESAPI_OS_WINDOWS)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? (unsigned int)info.dwNumberOfProcessors : 1;
+#elif defined(ESAPI_OS_STARNIX)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+#else
+    return 1;
+#endif
+  }
+
+} // NAMESPACE esapi
@@ -0,0 +1,168 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/Mutex.h"
+#include "util/CpuFeatures.h"
+#include "util/ParallelJob.h"
+#include "errors/EncryptionException.h"
+
+#if defined(ESAPI_OS_WINDOWS)
+# include <process.h>
+#elif defined(ESAPI_OS_STARNIX)
+# include <pthread.h>
+#endif
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace esapi
+{
+  ParallelJob::ParallelJob(size_t items, const NarrowString& failure)
+    : m_items(items), m_failure(failure), m_lock(), m_next(0), m_failed(false), m_error()
+  {
+  }
+
+  ParallelJob::~ParallelJob()
+  {
+  }
+
+  unsigned int ParallelJob::ThreadCount(unsigned int threads)
+  {
+    if(threads == 0)
+      threads = CpuFeatures::ProcessorCount();
+
+    return std::min(std::max(threads, 1u), (unsigned int)MaxThreads);
+  }
+
+  void ParallelJob::execute(unsigned int threads)
+  {
+    threads = ThreadCount(threads);
+
+#if defined(ESAPI_OS_WINDOWS) || defined(ESAPI_OS_STARNIX)
+    std::vector<ThreadHandle> workers;
+    const size_t wanted = std::min((size_t)threads, std::max(m_items, (size_t)1)) - 1;
+
+    for(size_t i = 0; i < wanted; i++)
+      {
+        ThreadHandle handle;
+
+        // Not fatal. The threads which did start (and this one) finish the work.
+        if(!StartThread(&ParallelJob::ThreadProc, this, handle))
+          break;
+
+        workers.push_back(handle);
+      }
+#endif
+
+    try
+      {
+        run();
+      }
+    catch(std::exception& ex)
+      {
+        fail(ex.what());
+      }
+
+#if defined(ESAPI_OS_WINDOWS) || defined(ESAPI_OS_STARNIX)
+    for(size_t i = 0; i < workers.size(); i++)
+      JoinThread(workers[i]);
+#endif
+
+    MutexLock lock(m_lock);
+    if(m_failed)
+      throw EncryptionException(m_failure + m_error);
+  }
+
+#if defined(ESAPI_OS_WINDOWS)
+  bool ParallelJob::StartThread(ThreadFunction proc, void* param, ThreadHandle& handle)
+  {
+    handle = (HANDLE)_beginthreadex(NULL, 0, proc, param, 0, NULL);
+    return handle != 0;
+  }
+
+  void ParallelJob::JoinThread(ThreadHandle handle)
+  {
+    WaitForSingleObject(handle, INFINITE);
+    CloseHandle(handle);
+  }
+#elif defined(ESAPI_OS_STARNIX)
+  bool ParallelJob::StartThread(ThreadFunction proc, void* param, ThreadHandle& handle)
+  {
+    return pthread_create(&handle, NULL, proc, param) == 0;
+  }
+
+  void ParallelJob::JoinThread(ThreadHandle handle)
+  {
+    pthread_join(handle, NULL);
+  }
+#endif
+
+  void ParallelJob::runWorker()
+  {
+    run();
+  }
+
+  bool ParallelJob::nextItem(size_t& item)
+  {
+    MutexLock lock(m_lock);
+    if(m_failed || m_next == m_items)
+      return false;
+
+    item = m_next++;
+    return true;
+  }
+
+  void ParallelJob::fail(const char* what)
+  {
+    MutexLock lock(m_lock);
+    if(!m_failed)
+      {
+        m_failed = true;
+        m_error = what;
+      }
+  }
+
+#if defined(ESAPI_OS_WINDOWS)
+  unsigned __stdcall ParallelJob::ThreadProc(void* param)
+  {
+    ParallelJob* job = static_cast<ParallelJob*>(param);
+    try
+      {
+        job->runWorker();
+      }
+    catch(std::exception& ex)
+      {
+        job->fail(ex.what());
+      }
+    return 0;
+  }
+#elif defined(ESAPI_OS_STARNIX)
+  void* ParallelJob::ThreadProc(void* param)
+  {
+    ParallelJob* job = static_cast<ParallelJob*>(param);
+    try
+      {
+        job->runWorker();
+      }
+    catch(std::exception& ex)
+      {
+        job->fail(ex.what());
+      }
+    return NULL;
+  }
+#endif
+
+} // NAMESPACE esapi
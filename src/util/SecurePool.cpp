@@ -0,0 +1,374 @@
+/**
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+#include "util/Mutex.h"
+#include "util/NotCopyable.h"
+#include "util/CpuFeatures.h"
+#include "util/SecurePool.h"
+
+#if defined(ESAPI_OS_STARNIX)
+# include <unistd.h>
+# include <pthread.h>
+# include <sys/mman.h>
+#endif
+
+#if defined(ESAPI_OS_LINUX) && defined(__GLIBC__)
+# include <sched.h>
+#endif
+
+// 32-bit GCC and Clang only have the intrinsics with -msse2
+#if defined(ESAPI_ARCH_X64) || (defined(ESAPI_ARCH_X86) && (defined(__SSE2__) || defined(ESAPI_CXX_MSVC)))
+# include <emmintrin.h>
+# define ESAPI_NONTEMPORAL_WIPE 1
+#endif
+
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 25))
+# define ESAPI_EXPLICIT_BZERO 1
+#elif defined(__OpenBSD__)
+# define ESAPI_EXPLICIT_BZERO 1
+#endif
+
+#include <new>
+#include <vector>
+#include <algorithm>
+
+#include <string.h>
+
+namespace esapi
+{
+  // Upper bound on the shard count, whatever the processor count says
+  static const size_t MaxPoolShards = 64;
+
+  static const size_t g_classes[] = { 16, 32, 48, 64, 128, 256 };
+  static const size_t ClassCount = COUNTOF(g_classes);
+
+  /**
+   * A free block. The link lives in the block itself.
+   */
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+
+  /**
+   * One free list per size class, and the lock over them.
+   */
+  class SecurePoolShard : private NotCopyable
+  {
+  public:
+    SecurePoolShard()
+      : lock()
+    {
+      for(size_t i = 0; i < ClassCount; i++)
+        free[i] = nullptr;
+    }
+
+    Mutex lock;
+    FreeBlock* free[ClassCount];
+
+    /**
+     * Keeps a neighbouring shard off this shard's cache lines.
+     */
+    byte pad[64];
+  };
+
+  // Private to this module
+  static Mutex& GetPoolLock();
+  static std::vector<SecurePoolShard*>& GetShards();
+  static SecurePoolShard& SelectShard();
+  static size_t ClassIndex(size_t size);
+  static FreeBlock* NewSlab(size_t blockSize);
+  static void WipeBlock(void* ptr, size_t size);
+#if defined(ESAPI_NONTEMPORAL_WIPE)
+  static void StreamWipe(byte* ptr, size_t size);
+#endif
+
+  // Slab accounting, guarded by GetPoolLock()
+  static size_t g_slabBytes = 0;
+  static size_t g_unlockedBytes = 0;
+
+  void* SecurePool::Allocate(size_t size)
+  {
+    if(size > (size_t)MaxPooledSize)
+      return ::operator new(size);
+
+    const size_t idx = ClassIndex(size);
+    SecurePoolShard& shard = SelectShard();
+
+    MutexLock lock(shard.lock);
+
+    if(!shard.free[idx])
+      shard.free[idx] = NewSlab(g_classes[idx]);
+
+    FreeBlock* block = shard.free[idx];
+    shard.free[idx] = block->next;
+    block->next = nullptr;
+
+    return block;
+  }
+
+  void SecurePool::Deallocate(void* ptr, size_t size)
+  {
+    Deallocate(ptr, size, size);
+  }
+
+  void SecurePool::Deallocate(void* ptr, size_t size, size_t used)
+  {
+    if(!ptr)
+      return;
+
+    ASSERT(used <= size);
+    used = std::min(used, size);
+
+    if(size > (size_t)MaxPooledSize)
+      {
+        WipeBlock(ptr, used);
+        ::operator delete(ptr);
+        return;
+      }
+
+    // Bytes past the request (up to the class size) are never handed out, so they
+    // are still zero. A block may go back to a different shard than it came from.
+    // That only moves it between lists.
+    const size_t idx = ClassIndex(size);
+    WipeBlock(ptr, used);
+
+    SecurePoolShard& shard = SelectShard();
+    MutexLock lock(shard.lock);
+
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = shard.free[idx];
+    shard.free[idx] = block;
+  }
+
+  size_t SecurePool::GetSlabBytes()
+  {
+    MutexLock lock(GetPoolLock());
+    return g_slabBytes;
+  }
+
+  size_t SecurePool::GetUnlockedBytes()
+  {
+    MutexLock lock(GetPoolLock());
+    return g_unlockedBytes;
+  }
+
+  /**
+   * Returns the index of the smallest class holding size bytes.
+   */
+  static size_t ClassIndex(size_t size)
+  {
+    for(size_t i = 0; i < ClassCount; i++)
+      {
+        if(size <= g_classes[i])
+          return i;
+      }
+
+    ASSERT(0);
+    return ClassCount - 1;
+  }
+
+  /**
+   * Maps, locks and carves a slab into a chain of blocks. If the pages cannot be
+   * mapped, a single block comes from the heap instead so the request still succeeds.
+   */
+  static FreeBlock* NewSlab(size_t blockSize)
+  {
+    byte* slab = nullptr;
+    bool locked = false;
+
+#if defined(ESAPI_OS_WINDOWS)
+    slab = (byte*)::VirtualAlloc(nullptr, SecurePool::SlabSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if(slab)
+      locked = !!::VirtualLock(slab, SecurePool::SlabSize);
+#elif defined(ESAPI_OS_STARNIX)
+    void* ptr = ::mmap(nullptr, SecurePool::SlabSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if(ptr != MAP_FAILED)
+      {
+        slab = (byte*)ptr;
+        locked = (0 == ::mlock(slab, SecurePool::SlabSize));
+
+# if defined(MADV_DONTDUMP)
+        ::madvise(slab, SecurePool::SlabSize, MADV_DONTDUMP);
+# elif defined(MADV_NOCORE)
+        ::madvise(slab, SecurePool::SlabSize, MADV_NOCORE);
+# endif
+      }
+#endif
+
+    if(!slab)
+      {
+        // Sized to the class so the block can be pooled like any other
+        FreeBlock* block = static_cast<FreeBlock*>(::operator new(blockSize));
+        ::memset(block, 0x00, blockSize);
+        return block;
+      }
+
+    {
+      MutexLock lock(GetPoolLock());
+      g_slabBytes += SecurePool::SlabSize;
+      if(!locked)
+        g_unlockedBytes += SecurePool::SlabSize;
+    }
+
+    // Fresh pages are zero, so only the links are written
+    const size_t count = SecurePool::SlabSize / blockSize;
+    for(size_t i = 0; i < count; i++)
+      {
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + i * blockSize);
+        block->next = (i + 1 < count) ? reinterpret_cast<FreeBlock*>(slab + (i + 1) * blockSize) : nullptr;
+      }
+
+    return reinterpret_cast<FreeBlock*>(slab);
+  }
+
+  void SecurePool::Wipe(void* ptr, size_t size)
+  {
+    ASSERT(ptr || !size);
+    if(!ptr || !size)
+      return;
+
+    WipeBlock(ptr, size);
+  }
+
+  /**
+   * Zeroizes a block. Each path ends in a call the optimizer cannot elide or in a
+   * compiler barrier, so the stores are not treated as dead before the block is
+   * released.
+   */
+  static void WipeBlock(void* ptr, size_t size)
+  {
+#if defined(ESAPI_NONTEMPORAL_WIPE)
+    if(size >= (size_t)SecurePool::NonTemporalSize && CpuFeatures::HasSSE2())
+      {
+        StreamWipe(static_cast<byte*>(ptr), size);
+        return;
+      }
+#endif
+
+#if defined(ESAPI_OS_WINDOWS)
+    ::SecureZeroMemory(ptr, size);
+#elif defined(ESAPI_EXPLICIT_BZERO)
+    ::explicit_bzero(ptr, size);
+#else
+    ::memset(ptr, 0x00, size);
+    MEMORY_BARRIER();
+#endif
+  }
+
+#if defined(ESAPI_NONTEMPORAL_WIPE)
+  /**
+   * Clears a large buffer with 64 bytes of streaming stores per iteration. The
+   * stores bypass the cache, so a wipe of a buffer which has already left the cache
+   * does not read it back in. The fence orders the stores before the memory is
+   * released to another thread.
+   */
+  static void StreamWipe(byte* ptr, size_t size)
+  {
+    // Head, up to 16-byte alignment
+    const size_t head = std::min(size, (size_t)((16 - ((size_t)ptr & 15)) & 15));
+    ::memset(ptr, 0x00, head);
+    ptr += head;
+    size -= head;
+
+    const __m128i zero = _mm_setzero_si128();
+    __m128i* block = reinterpret_cast<__m128i*>(ptr);
+
+    size_t count = size / 64;
+    for(; count; count--, block += 4)
+      {
+        _mm_stream_si128(block + 0, zero);
+        _mm_stream_si128(block + 1, zero);
+        _mm_stream_si128(block + 2, zero);
+        _mm_stream_si128(block + 3, zero);
+      }
+
+    _mm_sfence();
+
+    // Tail
+    const size_t tail = size % 64;
+    ::memset(ptr + (size - tail), 0x00, tail);
+    MEMORY_BARRIER();
+  }
+#endif
+
+  /**
+   * Returns the shard for the processor the caller runs on (Linux), or one picked
+   * from the thread id.
+   */
+  static SecurePoolShard& SelectShard()
+  {
+    std::vector<SecurePoolShard*>& shards = GetShards();
+
+#if defined(ESAPI_OS_LINUX) && defined(__GLIBC__)
+    const int cpu = sched_getcpu();
+    if(cpu >= 0)
+      return *shards[(size_t)cpu % shards.size()];
+#endif
+
+#if defined(ESAPI_OS_WINDOWS)
+    const size_t hint = (size_t)(::GetCurrentThreadId() >> 2);
+#elif defined(ESAPI_OS_STARNIX)
+    const pthread_t self = pthread_self();
+    const byte* ptr = (const byte*)&self;
+
+    // pthread_t is opaque, so hash its bytes (FNV-1a)
+    unsigned int hash = 2166136261u;
+    for(size_t i = 0; i < sizeof(self); i++)
+      hash = (hash ^ ptr[i]) * 16777619u;
+
+    const size_t hint = hash;
+#else
+    const size_t hint = 0;
+#endif
+
+    return *shards[hint % shards.size()];
+  }
+
+  static Mutex& GetPoolLock()
+  {
+    static Mutex s_lock;
+    return s_lock;
+  }
+
+  /**
+   * The shards are created on first use and never destroyed.
+   */
+  static std::vector<SecurePoolShard*>& GetShards()
+  {
+    static std::vector<SecurePoolShard*>* volatile s_shards = nullptr;
+
+    MEMORY_BARRIER();
+    if(!s_shards)
+      {
+        MutexLock lock(GetPoolLock());
+
+        if(!s_shards)
+          {
+            std::vector<SecurePoolShard*>* shards = new std::vector<SecurePoolShard*>;
+
+            const size_t count = std::min((size_t)CpuFeatures::ProcessorCount(), MaxPoolShards);
+            for(size_t i = 0; i < count; i++)
+              shards->push_back(new SecurePoolShard);
+
+            MEMORY_BARRIER();
+            s_shards = shards;
+          }
+      }
+
+    return *s_shards;
+  }
+
+} // NAMESPACE esapi
@@ -0,0 +1,166 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "EsapiCommon.h"
+using esapi::NarrowString;
+
+#include "crypto/SecureRandom.h"
+using esapi::SecureRandom;
+
+#include "crypto/BufferedSecureRandom.h"
+using esapi::BufferedSecureRandom;
+
+#include "errors/IllegalArgumentException.h"
+using esapi::IllegalArgumentException;
+
+#include <string.h>
+
+BOOST_AUTO_TEST_CASE( VerifyBufferedSecureRandom_1P )
+{
+    try
+    {
+        BufferedSecureRandom prng;
+        BOOST_CHECK(prng.getCapacity() == (size_t)BufferedSecureRandom::DefaultCapacity);
+        BOOST_CHECK(prng.getAlgorithm() == SecureRandom::DefaultAlgorithm());
+
+        // Lazily filled
+        BOOST_CHECK(prng.getAvailable() == 0);
+
+        byte b1[16], b2[16];
+        prng.nextBytes(b1, sizeof(b1));
+        prng.nextBytes(b2, sizeof(b2));
+
+        BOOST_CHECK(::memcmp(b1, b2, sizeof(b1)) != 0);
+        BOOST_CHECK(prng.getAvailable() == prng.getCapacity() - 32);
+    }
+    catch(const std::exception& ex)
+    {
+        BOOST_ERROR(ex.what());
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyBufferedSecureRandom_2P )
+{
+    try
+    {
+        // Drain past the low water mark several times
+        BufferedSecureRandom prng("SHA-512", 256);
+        byte b[32];
+
+        for(unsigned int i = 0; i < 64; i++)
+        {
+            prng.nextBytes(b, sizeof(b));
+            BOOST_CHECK(prng.getAvailable() >= prng.getCapacity() / 4);
+        }
+
+        // Large requests bypass the buffer
+        byte large[1024];
+        const size_t avail = prng.getAvailable();
+        prng.nextBytes(large, sizeof(large));
+        BOOST_CHECK(prng.getAvailable() == avail);
+
+        prng.clear();
+        BOOST_CHECK(prng.getAvailable() == 0);
+
+        prng.refill();
+        BOOST_CHECK(prng.getAvailable() == prng.getCapacity());
+    }
+    catch(const std::exception& ex)
+    {
+        BOOST_ERROR(ex.what());
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyBufferedSecureRandom_3P )
+{
+    try
+    {
+        // Copies share the buffer
+        BufferedSecureRandom prng1(SecureRandom::getInstance("HmacSHA256"));
+        BufferedSecureRandom prng2(prng1);
+
+        byte b[8];
+        prng1.nextBytes(b, sizeof(b));
+        BOOST_CHECK(prng1.getAvailable() == prng2.getAvailable());
+        BOOST_CHECK(prng1.getAlgorithm() == prng2.getAlgorithm());
+    }
+    catch(const std::exception& ex)
+    {
+        BOOST_ERROR(ex.what());
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyBufferedSecureRandom_4N )
+{
+    try
+    {
+        BufferedSecureRandom prng(16);
+        BOOST_ERROR("Failed to detect bad capacity");
+    }
+    catch(const IllegalArgumentException& ex)
+    {
+        // Success
+        UNUSED_VARIABLE(ex);
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyBufferedSecureRandom_5N )
+{
+    try
+    {
+        BufferedSecureRandom prng;
+        prng.nextBytes(nullptr, 16);
+        BOOST_ERROR("Failed to detect bad buffer");
+    }
+    catch(const IllegalArgumentException& ex)
+    {
+        // Success
+        UNUSED_VARIABLE(ex);
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
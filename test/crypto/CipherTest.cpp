@@ -0,0 +1,305 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "EsapiCommon.h"
+using esapi::NarrowString;
+#include "util/SecureArray.h"
+using esapi::SecureByteArray;
+
+#include "crypto/Cipher.h"
+using esapi::Cipher;
+
+#include "crypto/SecretKey.h"
+using esapi::SecretKey;
+
+#include "crypto/IvParameterSpec.h"
+using esapi::IvParameterSpec;
+
+#include "errors/EncryptionException.h"
+using esapi::EncryptionException;
+
+#include "errors/IllegalStateException.h"
+using esapi::IllegalStateException;
+
+#include "errors/IllegalArgumentException.h"
+using esapi::IllegalArgumentException;
+
+#include "errors/NoSuchAlgorithmException.h"
+using esapi::NoSuchAlgorithmException;
+
+#include <string.h>
+#include <algorithm>
+
+// NIST SP 800-38A, F.2.1 (CBC-AES128) and F.5.1 (CTR-AES128), first block
+static const byte g_key[] = {
+  0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c };
+static const byte g_cbcIv[] = {
+  0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f };
+static const byte g_ctrIv[] = {
+  0xf0,0xf1,0xf2,0xf3,0xf4,0xf5,0xf6,0xf7,0xf8,0xf9,0xfa,0xfb,0xfc,0xfd,0xfe,0xff };
+static const byte g_plain[] = {
+  0x6b,0xc1,0xbe,0xe2,0x2e,0x40,0x9f,0x96,0xe9,0x3d,0x7e,0x11,0x73,0x93,0x17,0x2a };
+static const byte g_cbcCipher[] = {
+  0x76,0x49,0xab,0xac,0x81,0x19,0xb2,0x46,0xce,0xe9,0x8e,0x9b,0x12,0xe9,0x19,0x7d };
+static const byte g_ctrCipher[] = {
+  0x87,0x4d,0x61,0x91,0xb6,0x20,0xe3,0x26,0x1b,0xef,0x68,0x64,0x99,0x0d,0xb6,0xce };
+
+static SecretKey MakeKey()
+{
+  return SecretKey("AES", SecureByteArray(g_key, sizeof(g_key)));
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCipher_1P )
+{
+  // Known answer, and the same Cipher reused for a second message under the key
+  try
+    {
+      const SecretKey key = MakeKey();
+      Cipher cipher = Cipher::getInstance("AES/CBC/NoPadding");
+
+      cipher.init(Cipher::EncryptMode, key, IvParameterSpec(g_cbcIv, sizeof(g_cbcIv)));
+      SecureByteArray ct = cipher.doFinal(g_plain, sizeof(g_plain));
+      BOOST_CHECK(ct.size() == sizeof(g_cbcCipher));
+      BOOST_CHECK(::memcmp(ct.data(), g_cbcCipher, sizeof(g_cbcCipher)) == 0);
+
+      // doFinal returns to the IV given to init
+      ct = cipher.doFinal(g_plain, sizeof(g_plain));
+      BOOST_CHECK(::memcmp(ct.data(), g_cbcCipher, sizeof(g_cbcCipher)) == 0);
+
+      cipher.init(Cipher::DecryptMode, key, IvParameterSpec(g_cbcIv, sizeof(g_cbcIv)));
+      byte output[sizeof(g_plain)];
+      const size_t n = cipher.doFinal(ct.data(), ct.size(), 0, ct.size(), output, sizeof(output));
+      BOOST_CHECK(n == sizeof(g_plain));
+      BOOST_CHECK(::memcmp(output, g_plain, sizeof(g_plain)) == 0);
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCipher_2P )
+{
+  // Padded CBC in pieces must match a single doFinal, for every length across a few blocks
+  try
+    {
+      const SecretKey key = MakeKey();
+      Cipher cipher = Cipher::getInstance("AES/CBC/PKCS5Padding");
+
+      byte message[48];
+      for(size_t i = 0; i < sizeof(message); i++)
+        message[i] = (byte)i;
+
+      for(size_t len = 0; len <= sizeof(message); len++)
+        {
+          cipher.init(Cipher::EncryptMode, key, IvParameterSpec(g_cbcIv, sizeof(g_cbcIv)));
+          const SecureByteArray whole = cipher.doFinal(message, len);
+          BOOST_CHECK(whole.size() == (len / 16 + 1) * 16);
+
+          byte pieces[64];
+          size_t written = 0, pos = 0;
+          while(pos < len)
+            {
+              const size_t step = std::min((size_t)7, len - pos);
+              written += cipher.update(message, sizeof(message), pos, step, pieces + written, sizeof(pieces) - written);
+              pos += step;
+            }
+          written += cipher.doFinal(pieces, sizeof(pieces), written);
+
+          BOOST_CHECK(written == whole.size());
+          BOOST_CHECK(::memcmp(pieces, whole.data(), written) == 0);
+
+          cipher.init(Cipher::DecryptMode, key, IvParameterSpec(g_cbcIv, sizeof(g_cbcIv)));
+          const SecureByteArray recovered = cipher.doFinal(whole);
+          BOOST_CHECK(recovered.size() == len);
+          BOOST_CHECK(len == 0 || ::memcmp(recovered.data(), message, len) == 0);
+        }
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCipher_3P )
+{
+  // CTR known answer, encrypted in place in the caller's buffer
+  try
+    {
+      Cipher cipher = Cipher::getInstance("AES/CTR/NoPadding");
+      cipher.init(Cipher::EncryptMode, MakeKey(), IvParameterSpec(g_ctrIv, sizeof(g_ctrIv)));
+
+      byte buffer[sizeof(g_plain)];
+      ::memcpy(buffer, g_plain, sizeof(buffer));
+
+      size_t n = cipher.update(buffer, sizeof(buffer), 0, 5, buffer, sizeof(buffer));
+      n += cipher.doFinal(buffer, sizeof(buffer), 5, sizeof(buffer) - 5, buffer + 5, sizeof(buffer) - 5);
+
+      BOOST_CHECK(n == sizeof(g_ctrCipher));
+      BOOST_CHECK(::memcmp(buffer, g_ctrCipher, sizeof(g_ctrCipher)) == 0);
+      BOOST_CHECK(cipher.getIV().size() == sizeof(g_ctrIv));
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCipher_4P )
+{
+  // GCM round trip with a random nonce; the tag is appended and checked
+  try
+    {
+      const SecretKey key = MakeKey();
+      Cipher cipher = Cipher::getInstance("AES/GCM/NoPadding");
+      cipher.init(Cipher::EncryptMode, key);
+
+      const SecureByteArray nonce = cipher.getIV();
+      BOOST_CHECK(nonce.size() == 12);
+
+      const SecureByteArray ct = cipher.doFinal(g_plain, sizeof(g_plain));
+      BOOST_CHECK(ct.size() == sizeof(g_plain) + 16);
+
+      cipher.init(Cipher::DecryptMode, key, IvParameterSpec(nonce));
+      SecureByteArray pt = cipher.update(ct, 0, 10);
+      BOOST_CHECK(pt.size() == 0);
+      pt = cipher.doFinal(ct, 10, ct.size() - 10);
+      BOOST_CHECK(pt.size() == sizeof(g_plain));
+      BOOST_CHECK(::memcmp(pt.data(), g_plain, sizeof(g_plain)) == 0);
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCipher_5N )
+{
+  const SecretKey key = MakeKey();
+
+  // A modified GCM ciphertext is rejected
+  {
+    bool success = false;
+    try
+      {
+        Cipher cipher = Cipher::getInstance("AES/GCM/NoPadding");
+        cipher.init(Cipher::EncryptMode, key);
+        const SecureByteArray nonce = cipher.getIV();
+        SecureByteArray ct = cipher.doFinal(g_plain, sizeof(g_plain));
+        ct[0] ^= 0x01;
+
+        cipher.init(Cipher::DecryptMode, key, IvParameterSpec(nonce));
+        cipher.doFinal(ct);
+      }
+    catch(const EncryptionException&)
+      {
+        success = true;
+      }
+    catch(...)
+      {
+      }
+    BOOST_CHECK_MESSAGE(success, "Failed to catch tampered GCM ciphertext");
+  }
+
+  // GCM encryption needs a new IV for each message
+  {
+    bool success = false;
+    try
+      {
+        Cipher cipher = Cipher::getInstance("AES/GCM/NoPadding");
+        cipher.init(Cipher::EncryptMode, key);
+        cipher.doFinal(g_plain, sizeof(g_plain));
+        cipher.doFinal(g_plain, sizeof(g_plain));
+      }
+    catch(const IllegalStateException&)
+      {
+        success = true;
+      }
+    catch(...)
+      {
+      }
+    BOOST_CHECK_MESSAGE(success, "Failed to catch GCM nonce reuse");
+  }
+
+  // Padding is only for ECB and CBC
+  {
+    bool success = false;
+    try
+      {
+        Cipher::getInstance("AES/CTR/PKCS5Padding");
+      }
+    catch(const NoSuchAlgorithmException&)
+      {
+        success = true;
+      }
+    catch(...)
+      {
+      }
+    BOOST_CHECK_MESSAGE(success, "Failed to catch padding with CTR");
+  }
+
+  // Not initialized
+  {
+    bool success = false;
+    try
+      {
+        Cipher cipher = Cipher::getInstance("AES/CBC/PKCS5Padding");
+        cipher.update(g_plain, sizeof(g_plain));
+      }
+    catch(const IllegalStateException&)
+      {
+        success = true;
+      }
+    catch(...)
+      {
+      }
+    BOOST_CHECK_MESSAGE(success, "Failed to catch an uninitialized Cipher");
+  }
+
+  // Output buffer too small
+  {
+    bool success = false;
+    try
+      {
+        Cipher cipher = Cipher::getInstance("AES/CBC/PKCS5Padding");
+        cipher.init(Cipher::EncryptMode, key, IvParameterSpec(g_cbcIv, sizeof(g_cbcIv)));
+
+        byte output[sizeof(g_plain)];
+        cipher.doFinal(g_plain, sizeof(g_plain), 0, sizeof(g_plain), output, sizeof(output));
+      }
+    catch(const IllegalArgumentException&)
+      {
+        success = true;
+      }
+    catch(...)
+      {
+      }
+    BOOST_CHECK_MESSAGE(success, "Failed to catch a short output buffer");
+  }
+}
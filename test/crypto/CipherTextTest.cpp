@@ -39,8 +39,191 @@ using esapi::String;
 #include <crypto/CipherText.h>
 using esapi::CipherText;
 
+#include <crypto/CipherSpec.h>
+using esapi::CipherSpec;
+
+#include <util/SecureArray.h>
+using esapi::SecureByteArray;
+
+#include <errors/EncryptionException.h>
+using esapi::EncryptionException;
+
+using esapi::CipherTextView;
+
+#include <string.h>
+
+static bool SameBytes(const SecureByteArray& a, const SecureByteArray& b)
+{
+  return a.size() == b.size() && (a.size() == 0 || ::memcmp(a.data(), b.data(), a.size()) == 0);
+}
+
 BOOST_AUTO_TEST_CASE( VerifyCipherText )
 {
   BOOST_MESSAGE( "Verifying CipherText class" );
 }
 
+
+BOOST_AUTO_TEST_CASE( VerifyCipherText1 )
+{
+  SecureByteArray iv(12, (byte)0x01);
+  CipherSpec spec("AES/GCM/NoPadding", 128, 16, iv);
+
+  SecureByteArray raw(20, (byte)0x02);
+  CipherText ct(spec, raw);
+
+  BOOST_CHECK(!ct.empty());
+  BOOST_CHECK(ct.getCipherTransformation() == "AES/GCM/NoPadding");
+  BOOST_CHECK(ct.getCipherAlgorithm() == "AES");
+  BOOST_CHECK(ct.getCipherMode() == "GCM");
+  BOOST_CHECK(ct.getPaddingScheme() == "NoPadding");
+  BOOST_CHECK(ct.getKeySize() == 128);
+  BOOST_CHECK(ct.getBlockSize() == 16);
+  BOOST_CHECK(ct.getIV().size() == 12);
+  BOOST_CHECK(ct.requiresIV());
+  BOOST_CHECK(ct.getRawCipherTextByteLength() == 20);
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCipherText2 )
+{
+  // Copies and accessors must not share the raw ciphertext
+  SecureByteArray raw(4, (byte)0x02);
+  CipherText ct1(CipherSpec("AES/GCM/NoPadding", 128), raw);
+  raw[0] = 0xFF;
+  BOOST_CHECK(ct1.getRawCipherText()[0] == 0x02);
+
+  CipherText ct2(ct1);
+  SecureByteArray other(4, (byte)0x03);
+  ct1.setCiphertext(other);
+
+  BOOST_CHECK(ct1.getRawCipherText()[0] == 0x03);
+  BOOST_CHECK(ct2.getRawCipherText()[0] == 0x02);
+
+  SecureByteArray copy = ct2.getRawCipherText();
+  copy[0] = 0xFF;
+  BOOST_CHECK(ct2.getRawCipherText()[0] == 0x02);
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCipherText3 )
+{
+  // Serialize, parse in place, and rebuild an owning CipherText
+  try
+    {
+      SecureByteArray iv(12, (byte)0x01);
+      SecureByteArray raw(20, (byte)0x02);
+      CipherText ct(CipherSpec("AES/GCM/NoPadding", 128, 16, iv), raw);
+
+      const size_t size = ct.getSerializedSize();
+      BOOST_CHECK(size == 26 + 17 + 12 + 20);
+
+      // Serialize into the middle of a larger buffer, as into a socket buffer
+      byte buffer[128];
+      ::memset(buffer, 0xCC, sizeof(buffer));
+      BOOST_CHECK(ct.serialize(buffer + 8, sizeof(buffer) - 8) == size);
+
+      // KDF version 20110203 with the HmacSHA1 PRF
+      BOOST_CHECK(buffer[8] == 0x01 && buffer[9] == 0x32 && buffer[10] == 0xDB && buffer[11] == 0x7B);
+
+      CipherTextView view(buffer + 8, sizeof(buffer) - 8);
+      BOOST_CHECK(view.getSerializedSize() == size);
+      BOOST_CHECK(view.getKDFVersion() == 20110203);
+      BOOST_CHECK(view.getKDF_PRF() == 0);
+      BOOST_CHECK(view.getEncryptionTimestamp() == ct.getEncryptionTimestamp());
+      BOOST_CHECK(view.getCipherTransformation() == "AES/GCM/NoPadding");
+      BOOST_CHECK(view.getKeySize() == 128);
+      BOOST_CHECK(view.getBlockSize() == 16);
+      BOOST_CHECK(view.getIVLength() == 12);
+      BOOST_CHECK(view.getRawCipherTextByteLength() == 20);
+      BOOST_CHECK(view.getSeparateMACLength() == 0);
+
+      // The view points into the buffer
+      BOOST_CHECK(view.getRawCipherText() > buffer && view.getRawCipherText() < buffer + sizeof(buffer));
+      BOOST_CHECK(::memcmp(view.getRawCipherText(), raw.data(), raw.size()) == 0);
+
+      SecureByteArray bytes = ct.asPortableSerializedByteArray();
+      BOOST_CHECK(bytes.size() == size);
+      BOOST_CHECK(::memcmp(bytes.data(), buffer + 8, size) == 0);
+
+      CipherText copy = CipherText::fromPortableSerializedBytes(bytes.data(), bytes.size());
+      BOOST_CHECK(copy.getCipherTransformation() == ct.getCipherTransformation());
+      BOOST_CHECK(SameBytes(copy.getIV(), ct.getIV()));
+      BOOST_CHECK(SameBytes(copy.getRawCipherText(), ct.getRawCipherText()));
+      BOOST_CHECK(copy.getEncryptionTimestamp() == ct.getEncryptionTimestamp());
+
+      // A separate MAC is carried along
+      SecureByteArray mac(32, (byte)0x03);
+      copy.storeSeparateMAC(mac);
+      bytes = copy.asPortableSerializedByteArray();
+      BOOST_CHECK(bytes.size() == size + 32);
+      BOOST_CHECK(SameBytes(CipherText::fromPortableSerializedBytes(bytes.data(), bytes.size()).getSeparateMAC(), mac));
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCipherText4N )
+{
+  SecureByteArray iv(12, (byte)0x01);
+  SecureByteArray raw(20, (byte)0x02);
+  const SecureByteArray bytes = CipherText(CipherSpec("AES/GCM/NoPadding", 128, 16, iv), raw).asPortableSerializedByteArray();
+
+  // Every truncation is rejected
+  for(size_t i = 0; i < bytes.size(); i++)
+    {
+      bool success = false;
+      try
+        {
+          CipherTextView view(bytes.data(), i);
+        }
+      catch(const EncryptionException&)
+        {
+          success = true;
+        }
+      catch(...)
+        {
+        }
+      BOOST_CHECK_MESSAGE(success, "Failed to catch a truncated serialization");
+    }
+
+  // Unknown KDF version
+  {
+    SecureByteArray bad = bytes.clone();
+    bad[0] = 0x00; bad[1] = 0x00; bad[2] = 0x00; bad[3] = 0x01;
+
+    bool success = false;
+    try
+      {
+        CipherTextView view(bad.data(), bad.size());
+      }
+    catch(const EncryptionException&)
+      {
+        success = true;
+      }
+    catch(...)
+      {
+      }
+    BOOST_CHECK_MESSAGE(success, "Failed to catch an unknown KDF version");
+  }
+
+  // Ciphertext length runs past the end
+  {
+    SecureByteArray bad = bytes.clone();
+    const size_t pos = 4 + 8 + 2 + 17 + 2 + 2 + 2 + 12;
+    bad[pos] = 0x7F;
+
+    bool success = false;
+    try
+      {
+        CipherTextView view(bad.data(), bad.size());
+      }
+    catch(const EncryptionException&)
+      {
+        success = true;
+      }
+    catch(...)
+      {
+      }
+    BOOST_CHECK_MESSAGE(success, "Failed to catch a bad ciphertext length");
+  }
+}
@@ -0,0 +1,128 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "EsapiCommon.h"
+
+#include "EsapiCommon.h"
+using esapi::NarrowString;
+using esapi::StringList;
+
+#include "DummyConfiguration.h"
+using esapi::DummyConfiguration;
+
+#include "util/AlgorithmName.h"
+using esapi::AlgorithmName;
+
+#include "crypto/CryptoPolicy.h"
+using esapi::CryptoPolicy;
+
+#include "crypto/CryptoHelper.h"
+using esapi::CryptoHelper;
+
+#include "errors/EncryptionException.h"
+using esapi::EncryptionException;
+
+// A configuration with CBC as the transformation and a mode AlgorithmName does not know
+class CbcConfiguration : public DummyConfiguration
+{
+public:
+  virtual NarrowString getCipherTransformation() { return m_xform; }
+  virtual const StringList& getAdditionalAllowedCipherModes() { return m_modes; }
+
+  explicit CbcConfiguration(const NarrowString& xform = "AES/CBC/PKCS5Padding")
+    : m_xform(xform), m_modes()
+  {
+    m_modes.push_back("CBC");
+    m_modes.push_back("XTS");
+  }
+
+private:
+  NarrowString m_xform;
+  StringList m_modes;
+};
+
+BOOST_AUTO_TEST_CASE( VerifyCryptoPolicy_1P )
+{
+  // The default policy matches the default configuration
+  const shared_ptr<const CryptoPolicy> policy = CryptoPolicy::getInstance();
+  BOOST_REQUIRE(policy.get());
+
+  BOOST_CHECK(policy->getCipherTransformation().getModeId() == AlgorithmName::ModeGCM);
+  BOOST_CHECK(policy->isCombinedCipherMode(AlgorithmName::ModeGCM));
+  BOOST_CHECK(policy->isAllowedCipherMode(AlgorithmName::ModeGCM));
+  BOOST_CHECK(!policy->isCombinedCipherMode(AlgorithmName::ModeCBC));
+  BOOST_CHECK(policy->isAllowedCipherMode("CBC"));
+  BOOST_CHECK(!policy->isAllowedCipherMode("ECB"));
+  BOOST_CHECK(policy->useMACforCipherText());
+  BOOST_CHECK(policy->getMasterSalt().size() == 16);
+
+  BOOST_CHECK(CryptoHelper::isCombinedCipherMode("EAX"));
+  BOOST_CHECK(!CryptoHelper::isAllowedCipherMode("ECB"));
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCryptoPolicy_2P )
+{
+  // A reload is seen by new callers; a caller holding the old policy keeps it
+  const shared_ptr<const CryptoPolicy> before = CryptoPolicy::getInstance();
+
+  CbcConfiguration config;
+  const shared_ptr<const CryptoPolicy> after = CryptoPolicy::reload(config);
+
+  BOOST_CHECK(CryptoPolicy::getInstance() == after);
+  BOOST_CHECK(after->getCipherTransformation().getModeId() == AlgorithmName::ModeCBC);
+  BOOST_CHECK(after->isAllowedCipherMode("XTS"));
+  BOOST_CHECK(!after->isAllowedCipherMode("OFB"));
+  BOOST_CHECK(CryptoHelper::isAllowedCipherMode("XTS"));
+
+  BOOST_CHECK(before->getCipherTransformation().getModeId() == AlgorithmName::ModeGCM);
+  BOOST_CHECK(before->isAllowedCipherMode("OFB"));
+
+  CryptoPolicy::setInstance(before);
+  BOOST_CHECK(CryptoPolicy::getInstance() == before);
+}
+
+BOOST_AUTO_TEST_CASE( VerifyCryptoPolicy_3N )
+{
+  // A bad transformation fails the reload and leaves the current policy in place
+  const shared_ptr<const CryptoPolicy> current = CryptoPolicy::getInstance();
+  bool success = false;
+
+  try
+    {
+      CbcConfiguration config("AES/XYZ/NoPadding");
+      CryptoPolicy::reload(config);
+    }
+  catch(const EncryptionException&)
+    {
+      success = true;
+    }
+
+  BOOST_CHECK_MESSAGE(success, "Failed to reject a malformed transformation");
+  BOOST_CHECK(CryptoPolicy::getInstance() == current);
+}
@@ -0,0 +1,228 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "EsapiCommon.h"
+
+#include "EsapiCommon.h"
+using esapi::NarrowString;
+#include "util/SecureArray.h"
+using esapi::SecureByteArray;
+
+#include "crypto/Cipher.h"
+using esapi::Cipher;
+
+#include "crypto/SecretKey.h"
+using esapi::SecretKey;
+
+#include "crypto/CryptoHelper.h"
+using esapi::CryptoHelper;
+
+#include "crypto/EncryptThenMac.h"
+using esapi::EncryptThenMac;
+
+#include "crypto/IvParameterSpec.h"
+using esapi::IvParameterSpec;
+
+#include "crypto/KeyDerivationFunction.h"
+using esapi::KeyDerivationFunction;
+
+#include "errors/EncryptionException.h"
+using esapi::EncryptionException;
+
+#include <string.h>
+
+static SecretKey MakeKey(byte b)
+{
+  return SecretKey("AES", SecureByteArray(16, b));
+}
+
+static SecureByteArray MakeMessage(size_t size)
+{
+  SecureByteArray message(size);
+  for(size_t i = 0; i < size; i++)
+    message[i] = (byte)(i * 7 + 3);
+  return message;
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptThenMac_1P )
+{
+  // Several chunks and a partial block. The fused MAC matches one computed over
+  // the finished ciphertext, and the message decrypts.
+  try
+    {
+      const SecretKey key = MakeKey(0x11);
+      const SecureByteArray message = MakeMessage(3 * EncryptThenMac::ChunkSize + 5);
+
+      Cipher cipher = Cipher::getInstance("AES/CBC/PKCS5Padding");
+      cipher.init(Cipher::EncryptMode, key);
+      const SecureByteArray iv = cipher.getIV();
+
+      SecureByteArray ct(cipher.getOutputSize(message.size()));
+      byte mac[EncryptThenMac::MacSize];
+
+      const EncryptThenMac etm(key);
+      const size_t n = etm.encrypt(cipher, message.data(), message.size(), ct.data(), ct.size(), mac, sizeof(mac));
+      BOOST_CHECK(n == (message.size() / 16 + 1) * 16);
+
+      const SecureByteArray expected = etm.computeMAC(iv.data(), iv.size(), ct.data(), n);
+      BOOST_CHECK(expected.size() == sizeof(mac));
+      BOOST_CHECK(::memcmp(expected.data(), mac, sizeof(mac)) == 0);
+      BOOST_CHECK(etm.verifyMAC(iv.data(), iv.size(), ct.data(), n, mac, sizeof(mac)));
+
+      cipher.init(Cipher::DecryptMode, key, IvParameterSpec(iv));
+      SecureByteArray pt(n);
+      const size_t m = etm.decrypt(cipher, ct.data(), n, mac, sizeof(mac), pt.data(), pt.size());
+      BOOST_CHECK(m == message.size());
+      BOOST_CHECK(::memcmp(pt.data(), message.data(), m) == 0);
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptThenMac_2N )
+{
+  // A flipped ciphertext bit or MAC bit fails the same way, with the output wiped
+  for(unsigned int pass = 0; pass < 2; pass++)
+    {
+      const SecretKey key = MakeKey(0x22);
+      const SecureByteArray message = MakeMessage(100);
+
+      Cipher cipher = Cipher::getInstance("AES/CBC/PKCS5Padding");
+      cipher.init(Cipher::EncryptMode, key);
+      const SecureByteArray iv = cipher.getIV();
+
+      SecureByteArray ct(cipher.getOutputSize(message.size()));
+      byte mac[EncryptThenMac::MacSize];
+
+      const EncryptThenMac etm(key);
+      const size_t n = etm.encrypt(cipher, message.data(), message.size(), ct.data(), ct.size(), mac, sizeof(mac));
+
+      if(pass == 0)
+        ct[n - 1] ^= 0x01;
+      else
+        mac[0] ^= 0x80;
+
+      BOOST_CHECK(!etm.verifyMAC(iv.data(), iv.size(), ct.data(), n, mac, sizeof(mac)));
+
+      cipher.init(Cipher::DecryptMode, key, IvParameterSpec(iv));
+      SecureByteArray pt(n, (byte)0xFF);
+
+      bool success = false;
+      try
+        {
+          etm.decrypt(cipher, ct.data(), n, mac, sizeof(mac), pt.data(), pt.size());
+        }
+      catch(const EncryptionException&)
+        {
+          success = true;
+        }
+      BOOST_CHECK_MESSAGE(success, "Failed to detect tampering, pass " << pass);
+
+      bool wiped = true;
+      for(size_t i = 0; i < pt.size(); i++)
+        wiped &= (pt[i] == 0);
+      BOOST_CHECK(wiped);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptThenMac_3N )
+{
+  // The MAC is keyed by the key, so another key (or a cleared cache) gives another result
+  try
+    {
+      const byte iv[16] = { 0 };
+      const byte ct[32] = { 1, 2, 3 };
+
+      const SecureByteArray mac1 = EncryptThenMac(MakeKey(0x33)).computeMAC(iv, sizeof(iv), ct, sizeof(ct));
+      const SecureByteArray mac2 = EncryptThenMac(MakeKey(0x34)).computeMAC(iv, sizeof(iv), ct, sizeof(ct));
+      BOOST_CHECK(!CryptoHelper::arrayCompare(mac1.data(), mac1.size(), mac2.data(), mac2.size()));
+
+      EncryptThenMac::clearCache();
+
+      const SecureByteArray mac3 = EncryptThenMac(MakeKey(0x33)).computeMAC(iv, sizeof(iv), ct, sizeof(ct));
+      BOOST_CHECK(CryptoHelper::arrayCompare(mac1.data(), mac1.size(), mac3.data(), mac3.size()));
+
+      // A truncated MAC never verifies
+      BOOST_CHECK(!EncryptThenMac(MakeKey(0x33)).verifyMAC(iv, sizeof(iv), ct, sizeof(ct), mac1.data(), mac1.size() - 1));
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptThenMac_4N )
+{
+  // The word-at-a-time compare sees a difference in the trailing bytes
+  byte b1[21], b2[21];
+  for(size_t i = 0; i < sizeof(b1); i++)
+    b1[i] = b2[i] = (byte)i;
+
+  BOOST_CHECK(CryptoHelper::arrayCompare(b1, sizeof(b1), b2, sizeof(b2)));
+
+  b2[20] ^= 0x10;
+  BOOST_CHECK(!CryptoHelper::arrayCompare(b1, sizeof(b1), b2, sizeof(b2)));
+
+  b2[20] ^= 0x10;
+  b2[3] ^= 0x01;
+  BOOST_CHECK(!CryptoHelper::arrayCompare(b1, sizeof(b1), b2, sizeof(b2)));
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptThenMac_5P )
+{
+  // Invalidating a KDK drops its cached HMAC. The next use derives it again and
+  // produces the same MAC; other keys are not affected.
+  try
+    {
+      const byte iv[16] = { 0 };
+      const byte ct[48] = { 9, 8, 7 };
+
+      const SecureByteArray mac1 = EncryptThenMac(MakeKey(0x51)).computeMAC(iv, sizeof(iv), ct, sizeof(ct));
+      const SecureByteArray mac2 = EncryptThenMac(MakeKey(0x52)).computeMAC(iv, sizeof(iv), ct, sizeof(ct));
+
+      KeyDerivationFunction::invalidateDerivedKeys(MakeKey(0x51));
+
+      const SecureByteArray mac3 = EncryptThenMac(MakeKey(0x51)).computeMAC(iv, sizeof(iv), ct, sizeof(ct));
+      BOOST_CHECK(CryptoHelper::arrayCompare(mac1.data(), mac1.size(), mac3.data(), mac3.size()));
+
+      const SecureByteArray mac4 = EncryptThenMac(MakeKey(0x52)).computeMAC(iv, sizeof(iv), ct, sizeof(ct));
+      BOOST_CHECK(CryptoHelper::arrayCompare(mac2.data(), mac2.size(), mac4.data(), mac4.size()));
+
+      KeyDerivationFunction::clearDerivedKeyCache();
+
+      const SecureByteArray mac5 = EncryptThenMac(MakeKey(0x51)).computeMAC(iv, sizeof(iv), ct, sizeof(ct));
+      BOOST_CHECK(CryptoHelper::arrayCompare(mac1.data(), mac1.size(), mac5.data(), mac5.size()));
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
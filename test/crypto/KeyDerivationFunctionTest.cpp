@@ -40,6 +40,16 @@ using esapi::String;
 using esapi::KeyDerivationFunction;
 using esapi::SecretKey;
 
+#include "util/SecureArray.h"
+using esapi::SecureByteArray;
+
+#include "errors/IllegalArgumentException.h"
+using esapi::IllegalArgumentException;
+
+#include <vector>
+#include <sstream>
+#include <string.h>
+
 #if !defined(ESAPI_BUILD_RELEASE)
 //BOOST_AUTO_TEST_CASE( VerifyKeyDerivationFunction )
 //{
@@ -171,4 +181,172 @@ BOOST_AUTO_TEST_CASE( VerifyKeyDerivationFunction9 )
 
   BOOST_CHECK_MESSAGE( success, "VerifyKeyDerivationFunction9 failed" );
 }
+
+BOOST_AUTO_TEST_CASE( VerifyKeyDerivationFunction10 )
+{
+  // A cached key matches a fresh derivation, and the context changes the key
+  SecretKey k("SHA-512", 32);
+
+  SecretKey d1 = KeyDerivationFunction::computeDerivedKey(k, 16*8, "encryption");
+  SecretKey d2 = KeyDerivationFunction::computeDerivedKey(k, 16*8, "encryption");
+  BOOST_CHECK_MESSAGE( d1 == d2, "VerifyKeyDerivationFunction10 failed (cached)" );
+
+  KeyDerivationFunction::clearDerivedKeyCache();
+  SecretKey d3 = KeyDerivationFunction::computeDerivedKey(k, 16*8, "encryption");
+  BOOST_CHECK_MESSAGE( d1 == d3, "VerifyKeyDerivationFunction10 failed (cleared)" );
+
+  SecretKey d4 = KeyDerivationFunction::computeDerivedKey(k, 16*8, "encryption", "context");
+  BOOST_CHECK_MESSAGE( d1 != d4, "VerifyKeyDerivationFunction10 failed (context)" );
+
+  SecretKey d5 = KeyDerivationFunction::computeDerivedKey(k, 16*8, "authenticity");
+  BOOST_CHECK_MESSAGE( d1 != d5, "VerifyKeyDerivationFunction10 failed (purpose)" );
+}
+
+BOOST_AUTO_TEST_CASE( VerifyKeyDerivationFunction11 )
+{
+  // Invalidating one KDK leaves the keys of another KDK alone
+  SecretKey k1("SHA-512", 32);
+  SecretKey k2("SHA-512", 32);
+
+  SecretKey d1 = KeyDerivationFunction::computeDerivedKey(k1, 32*8, "authenticity");
+  SecretKey d2 = KeyDerivationFunction::computeDerivedKey(k2, 32*8, "authenticity");
+  BOOST_CHECK_MESSAGE( d1 != d2, "VerifyKeyDerivationFunction11 failed (distinct)" );
+
+  KeyDerivationFunction::invalidateDerivedKeys(k1);
+
+  BOOST_CHECK_MESSAGE( d1 == KeyDerivationFunction::computeDerivedKey(k1, 32*8, "authenticity"),
+                       "VerifyKeyDerivationFunction11 failed (invalidated)" );
+  BOOST_CHECK_MESSAGE( d2 == KeyDerivationFunction::computeDerivedKey(k2, 32*8, "authenticity"),
+                       "VerifyKeyDerivationFunction11 failed (retained)" );
+}
+
+BOOST_AUTO_TEST_CASE( VerifyKeyDerivationFunction12 )
+{
+  // A threaded batch gives the same keys as one at a time
+  SecretKey k("SHA-512", 32);
+  std::vector<KeyDerivationFunction::DerivationRequest> requests;
+
+  for(unsigned int i = 0; i < 300; i++)
+    {
+      std::ostringstream oss;
+      oss << "tenant-" << i;
+      requests.push_back(KeyDerivationFunction::DerivationRequest(i % 2 ? "encryption" : "authenticity", oss.str(), (16 + (i % 3) * 8) * 8));
+    }
+
+  const std::vector<SecretKey> keys = KeyDerivationFunction::computeDerivedKeys(k, requests, 4);
+  BOOST_REQUIRE( keys.size() == requests.size() );
+
+  bool success = true;
+  for(size_t i = 0; i < requests.size(); i++)
+    {
+      const SecretKey d = KeyDerivationFunction::computeDerivedKey(k, requests[i].keyBits, requests[i].purpose, requests[i].context);
+      success &= (d == keys[i]);
+    }
+
+  BOOST_CHECK_MESSAGE( success, "VerifyKeyDerivationFunction12 failed" );
+}
+
+BOOST_AUTO_TEST_CASE( VerifyKeyDerivationFunction13 )
+{
+  // RFC 5869, A.1 (Test Case 1)
+  const byte ikm[22] = { 0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b,0x0b };
+  const byte salt[13] = { 0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c };
+  const byte info[10] = { 0xf0,0xf1,0xf2,0xf3,0xf4,0xf5,0xf6,0xf7,0xf8,0xf9 };
+  const byte okm[42] = {
+    0x3c,0xb2,0x5f,0x25,0xfa,0xac,0xd5,0x7a,0x90,0x43,0x4f,0x64,0xd0,0x36,0x2f,0x2a,
+    0x2d,0x2d,0x0a,0x90,0xcf,0x1a,0x5a,0x4c,0x5d,0xb0,0x2d,0x56,0xec,0xc4,0xc5,0xbf,
+    0x34,0x00,0x72,0x08,0xd5,0xb8,0x87,0x18,0x58,0x65 };
+
+  const SecretKey k("HKDF", SecureByteArray(ikm, sizeof(ikm)));
+  const SecretKey d = KeyDerivationFunction::computeHkdfKey(k, SecureByteArray(salt, sizeof(salt)), sizeof(okm)*8,
+                                                            SecureByteArray(info, sizeof(info)));
+
+  const SecureByteArray bytes = d.getEncoded();
+  BOOST_CHECK_MESSAGE( bytes.size() == sizeof(okm) && ::memcmp(bytes.data(), okm, sizeof(okm)) == 0,
+                       "VerifyKeyDerivationFunction13 failed" );
+}
+
+BOOST_AUTO_TEST_CASE( VerifyKeyDerivationFunction14 )
+{
+  // A HKDF batch uses purpose || 0x00 || context as the info
+  SecretKey k("SHA-512", 32);
+  const SecureByteArray salt(16, (byte)0x5c);
+
+  std::vector<KeyDerivationFunction::DerivationRequest> requests;
+  requests.push_back(KeyDerivationFunction::DerivationRequest("encryption", "tenant-1", 256));
+  requests.push_back(KeyDerivationFunction::DerivationRequest("authenticity", "", 128));
+
+  const std::vector<SecretKey> keys = KeyDerivationFunction::computeHkdfKeys(k, salt, requests);
+  BOOST_REQUIRE( keys.size() == 2 );
+
+  const char info1[] = "encryption\0tenant-1";
+  const char info2[] = "authenticity";
+
+  const SecretKey d1 = KeyDerivationFunction::computeHkdfKey(k, salt, 256, SecureByteArray((const byte*)info1, sizeof(info1) - 1));
+  const SecretKey d2 = KeyDerivationFunction::computeHkdfKey(k, salt, 128, SecureByteArray((const byte*)info2, sizeof(info2)));
+
+  BOOST_CHECK_MESSAGE( d1 == keys[0], "VerifyKeyDerivationFunction14 failed (1)" );
+  BOOST_CHECK_MESSAGE( d2 == keys[1], "VerifyKeyDerivationFunction14 failed (2)" );
+}
+
+BOOST_AUTO_TEST_CASE( VerifyKeyDerivationFunction15 )
+{
+  // One bad request fails the whole batch
+  SecretKey k("SHA-512", 32);
+  bool success = false;
+
+  std::vector<KeyDerivationFunction::DerivationRequest> requests;
+  requests.push_back(KeyDerivationFunction::DerivationRequest("encryption", "", 128));
+  requests.push_back(KeyDerivationFunction::DerivationRequest("encryption", "", 12));
+
+  try
+    {
+      KeyDerivationFunction::computeDerivedKeys(k, requests);
+    }
+  catch(const IllegalArgumentException&)
+    {
+      success = true;
+    }
+
+  BOOST_CHECK_MESSAGE( success, "VerifyKeyDerivationFunction15 failed" );
+}
+BOOST_AUTO_TEST_CASE( VerifyKeyDerivationFunction16 )
+{
+  // Known answers for keys longer than one HmacSHA1 block. KDK is 0x00..0x1f, and
+  // block i is HmacSHA1(KDK, [i]_2 || label || 0x00 || context || [L]_2).
+  byte kdk[32];
+  for(size_t i = 0; i < sizeof(kdk); i++)
+    kdk[i] = (byte)i;
+
+  const byte enc[32] = {
+    0xa9,0x36,0xa1,0xac,0x62,0x70,0x61,0x38,0xa1,0x31,0xb9,0x8a,0x65,0xbf,0x1f,0xf6,
+    0xe0,0x52,0xbf,0x27,0x55,0x5f,0x7f,0xf0,0x74,0xbf,0x8c,0xf7,0x16,0x5b,0x63,0xd1 };
+  const byte auth[32] = {
+    0x20,0xd2,0x58,0x52,0x40,0x9e,0x22,0xc8,0x62,0x96,0x57,0x85,0x8b,0xb1,0x3b,0x2c,
+    0x72,0xaa,0xe2,0x41,0x94,0x03,0xe7,0x31,0xb7,0x1b,0x2c,0x02,0x77,0xaf,0x00,0x48 };
+
+  const SecretKey k("AES", SecureByteArray(kdk, sizeof(kdk)));
+
+  const SecureByteArray d1 = KeyDerivationFunction::computeDerivedKey(k, 256, "encryption").getEncoded();
+  BOOST_CHECK_MESSAGE( d1.size() == sizeof(enc) && ::memcmp(d1.data(), enc, sizeof(enc)) == 0,
+                       "VerifyKeyDerivationFunction16 failed (1)" );
+
+  const SecureByteArray d2 = KeyDerivationFunction::computeDerivedKey(k, 256, "authenticity", "tenant-1").getEncoded();
+  BOOST_CHECK_MESSAGE( d2.size() == sizeof(auth) && ::memcmp(d2.data(), auth, sizeof(auth)) == 0,
+                       "VerifyKeyDerivationFunction16 failed (2)" );
+
+  // The batch path shares the counter loop
+  std::vector<KeyDerivationFunction::DerivationRequest> requests;
+  requests.push_back(KeyDerivationFunction::DerivationRequest("encryption", "", 256));
+  requests.push_back(KeyDerivationFunction::DerivationRequest("authenticity", "tenant-1", 256));
+
+  const std::vector<SecretKey> keys = KeyDerivationFunction::computeDerivedKeys(k, requests);
+  BOOST_REQUIRE( keys.size() == 2 );
+
+  const SecureByteArray b1 = keys[0].getEncoded(), b2 = keys[1].getEncoded();
+  BOOST_CHECK_MESSAGE( b1.size() == sizeof(enc) && ::memcmp(b1.data(), enc, sizeof(enc)) == 0,
+                       "VerifyKeyDerivationFunction16 failed (3)" );
+  BOOST_CHECK_MESSAGE( b2.size() == sizeof(auth) && ::memcmp(b2.data(), auth, sizeof(auth)) == 0,
+                       "VerifyKeyDerivationFunction16 failed (4)" );
+}
 #endif
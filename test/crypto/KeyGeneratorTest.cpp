@@ -45,6 +45,8 @@ using esapi::KeyGenerator;
 #include "util/TextConvert.h"
 using esapi::TextConvert;
 
+#include <vector>
+
 static const unsigned int KEY_SIZES[] = { 1, 7, 8, 9, 63, 64, 65, 80, 112, 128, 192, 256, 384, 512 };
 
 // Block ciphers
@@ -601,3 +603,38 @@ void VerifyHmacWhirlpoolKeyGenerator()
       VerifyKeyGeneration(kg, bytes);
     }
 }
+
+BOOST_AUTO_TEST_CASE( VerifyKeyGeneratorBatch )
+{
+  BOOST_MESSAGE( "Verifying KeyGenerator::generateKeys" );
+
+  KeyGenerator kg(KeyGenerator::getInstance("HmacSHA256"));
+  kg.init(128);
+
+  BOOST_CHECK( kg.generateKeys(0).empty() );
+
+  // Serial: more key material than one DRBG request
+  std::vector<SecretKey> keys = kg.generateKeys(5000);
+  BOOST_REQUIRE( keys.size() == 5000 );
+
+  bool success = true;
+  for(size_t i = 0; i < keys.size(); i++)
+    {
+      success &= (keys[i].getEncoded().length() == 16);
+      success &= (keys[i].getAlgorithm() == kg.getAlgorithm());
+      if(i) success &= !(keys[i] == keys[i-1]);
+    }
+  BOOST_CHECK_MESSAGE( success, "Serial batch failed" );
+
+  // Threaded: large enough to be split between the workers
+  keys = kg.generateKeys(300000, 4);
+  BOOST_REQUIRE( keys.size() == 300000 );
+
+  success = true;
+  for(size_t i = 0; i < keys.size(); i += 997)
+    {
+      success &= (keys[i].getEncoded().length() == 16);
+      if(i) success &= !(keys[i] == keys[i-997]);
+    }
+  BOOST_CHECK_MESSAGE( success, "Threaded batch failed" );
+}
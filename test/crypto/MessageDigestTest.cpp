@@ -35,6 +35,7 @@ using std::endl;
 #include "EsapiCommon.h"
 using esapi::Char;
 using esapi::String;
+using esapi::NarrowString;
 
 #include "util/SecureArray.h"
 using esapi::SecureByteArray;
@@ -51,6 +52,9 @@ using esapi::NoSuchAlgorithmException;
 #include "crypto/MessageDigest.h"
 using esapi::MessageDigest;
 
+#include "util/CpuFeatures.h"
+using esapi::CpuFeatures;
+
 #include "util/TextConvert.h"
 using esapi::TextConvert;
 
@@ -58,6 +62,7 @@ using esapi::TextConvert;
 #include <pthread.h>
 #endif
 #include <errno.h>
+#include <string.h>
 
 static void* WorkerThreadProc(void* param);
 static void DoWorkerThreadStuff();
@@ -562,6 +567,131 @@ BOOST_AUTO_TEST_CASE( VerifyMD5_5P )
   BOOST_CHECK_MESSAGE(success, "Failed to calculate MD5 digest");
 }
 
+BOOST_AUTO_TEST_CASE( VerifyMessageDigestBackend_1P )
+{
+  try
+    {
+      // FIPS 180-2, Appendix B. The second message spans two blocks.
+      const NarrowString msg1("abc");
+      const NarrowString msg2("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+
+      const byte sha256_1[] = {
+        0xba,0x78,0x16,0xbf,0x8f,0x01,0xcf,0xea,0x41,0x41,0x40,0xde,0x5d,0xae,0x22,0x23,
+        0xb0,0x03,0x61,0xa3,0x96,0x17,0x7a,0x9c,0xb4,0x10,0xff,0x61,0xf2,0x00,0x15,0xad };
+      const byte sha256_2[] = {
+        0x24,0x8d,0x6a,0x61,0xd2,0x06,0x38,0xb8,0xe5,0xc0,0x26,0x93,0x0c,0x3e,0x60,0x39,
+        0xa3,0x3c,0xe4,0x59,0x64,0xff,0x21,0x67,0xf6,0xec,0xed,0xd4,0x19,0xdb,0x06,0xc1 };
+      const byte sha224_1[] = {
+        0x23,0x09,0x7d,0x22,0x34,0x05,0xd8,0x22,0x86,0x42,0xa4,0x77,0xbd,0xa2,0x55,0xb3,
+        0x2a,0xad,0xbc,0xe4,0xbd,0xa0,0xb3,0xf7,0xe3,0x6c,0x9d,0xa7 };
+
+      MessageDigest md256(MessageDigest::getInstance("SHA-256"));
+      const NarrowString backend = md256.getBackend();
+      BOOST_CHECK(backend == "SHA-NI" || backend == "Portable");
+      if(backend == "SHA-NI")
+        BOOST_CHECK(CpuFeatures::HasSHA());
+
+      SecureByteArray d1 = md256.digest(msg1);
+      BOOST_CHECK(d1.length() == sizeof(sha256_1) && ::memcmp(d1.data(), sha256_1, sizeof(sha256_1)) == 0);
+
+      SecureByteArray d2 = md256.digest(msg2);
+      BOOST_CHECK(d2.length() == sizeof(sha256_2) && ::memcmp(d2.data(), sha256_2, sizeof(sha256_2)) == 0);
+
+      MessageDigest md224(MessageDigest::getInstance("SHA-224"));
+      BOOST_CHECK(md224.getBackend() == backend);
+
+      SecureByteArray d3 = md224.digest(msg1);
+      BOOST_CHECK(d3.length() == sizeof(sha224_1) && ::memcmp(d3.data(), sha224_1, sizeof(sha224_1)) == 0);
+
+      // No SHA extensions for the 64-bit family
+      MessageDigest md512(MessageDigest::getInstance("SHA-512"));
+      BOOST_CHECK(md512.getBackend() == "Portable");
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyMessageDigestMany_1P )
+{
+  bool success = false;
+
+  try
+    {
+      // SHA-256("abc") and SHA-256("")
+      const byte abc[32] = {0xba,0x78,0x16,0xbf,0x8f,0x01,0xcf,0xea,0x41,0x41,0x40,0xde,0x5d,0xae,0x22,0x23,
+                            0xb0,0x03,0x61,0xa3,0x96,0x17,0x7a,0x9c,0xb4,0x10,0xff,0x61,0xf2,0x00,0x15,0xad};
+      const byte empty[32] = {0xe3,0xb0,0xc4,0x42,0x98,0xfc,0x1c,0x14,0x9a,0xfb,0xf4,0xc8,0x99,0x6f,0xb9,0x24,
+                              0x27,0xae,0x41,0xe4,0x64,0x9b,0x93,0x4c,0xa4,0x95,0x99,0x1b,0x78,0x52,0xb8,0x55};
+
+      MessageDigest md(MessageDigest::getInstance("SHA-256"));
+
+      // An in-progress digest must not be disturbed by the batch
+      md.update((const byte*)"ab", 2);
+
+      std::vector<SecureByteArray> inputs, outputs;
+      inputs.push_back(SecureByteArray((const byte*)"abc", 3));
+      inputs.push_back(SecureByteArray());
+      inputs.push_back(SecureByteArray((const byte*)"abc", 3));
+
+      md.digestMany(inputs, outputs);
+
+      md.update((const byte*)"c", 1);
+      SecureByteArray last = md.digest();
+
+      success = (outputs.size() == 3);
+      success = success && (::memcmp(outputs[0].data(), abc, 32) == 0);
+      success = success && (::memcmp(outputs[1].data(), empty, 32) == 0);
+      success = success && (::memcmp(outputs[2].data(), abc, 32) == 0);
+      success = success && (outputs[0].data() != outputs[2].data());
+      success = success && (::memcmp(last.data(), abc, 32) == 0);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+  BOOST_CHECK_MESSAGE(success, "Failed to calculate batch of digests");
+}
+
+BOOST_AUTO_TEST_CASE( VerifyMessageDigestMany_2N )
+{
+  bool success = false;
+
+  try
+    {
+      MessageDigest md(MessageDigest::getInstance("SHA-512"));
+
+      const byte* inputs[1] = { nullptr };
+      const size_t sizes[1] = { 16 };
+      byte out[64];
+      byte* outputs[1] = { out };
+
+      md.digestMany(inputs, sizes, outputs, 1);
+    }
+  catch(const IllegalArgumentException&)
+    {
+      success = true;
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+  BOOST_CHECK_MESSAGE(success, "Failed to detect bad input buffer");
+}
+
 /*
 BOOST_AUTO_TEST_CASE( VerifyMessageDigestSHA1 )
 {
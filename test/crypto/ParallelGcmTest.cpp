@@ -0,0 +1,166 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "EsapiCommon.h"
+using esapi::NarrowString;
+#include "util/SecureArray.h"
+using esapi::SecureByteArray;
+
+#include "crypto/SecretKey.h"
+using esapi::SecretKey;
+
+#include "crypto/ParallelGcm.h"
+using esapi::ParallelGcm;
+
+#include "errors/IllegalArgumentException.h"
+using esapi::IllegalArgumentException;
+
+#include <string.h>
+
+// NIST GCM specification, test case 3
+static const byte g_key[] = {
+  0xfe,0xff,0xe9,0x92,0x86,0x65,0x73,0x1c,0x6d,0x6a,0x8f,0x94,0x67,0x30,0x83,0x08 };
+static const byte g_nonce[] = {
+  0xca,0xfe,0xba,0xbe,0xfa,0xce,0xdb,0xad,0xde,0xca,0xf8,0x88 };
+static const byte g_plain[] = {
+  0xd9,0x31,0x32,0x25,0xf8,0x84,0x06,0xe5,0xa5,0x59,0x09,0xc5,0xaf,0xf5,0x26,0x9a,
+  0x86,0xa7,0xa9,0x53,0x15,0x34,0xf7,0xda,0x2e,0x4c,0x30,0x3d,0x8a,0x31,0x8a,0x72,
+  0x1c,0x3c,0x0c,0x95,0x95,0x68,0x09,0x53,0x2f,0xcf,0x0e,0x24,0x49,0xa6,0xb5,0x25,
+  0xb1,0x6a,0xed,0xf5,0xaa,0x0d,0xe6,0x57,0xba,0x63,0x7b,0x39,0x1a,0xaf,0xd2,0x55 };
+static const byte g_cipher[] = {
+  0x42,0x83,0x1e,0xc2,0x21,0x77,0x74,0x24,0x4b,0x72,0x21,0xb7,0x84,0xd0,0xd4,0x9c,
+  0xe3,0xaa,0x21,0x2f,0x2c,0x02,0xa4,0xe0,0x35,0xc1,0x7e,0x23,0x29,0xac,0xa1,0x2e,
+  0x21,0xd5,0x14,0xb2,0x54,0x66,0x93,0x1c,0x7d,0x8f,0x6a,0x5a,0xac,0x84,0xaa,0x05,
+  0x1b,0xa3,0x0b,0x39,0x6a,0x0a,0xac,0x97,0x3d,0x58,0xe0,0x91,0x47,0x3f,0x59,0x85 };
+static const byte g_tag[] = {
+  0x4d,0x5c,0x2a,0xf3,0x27,0xcd,0x64,0xa6,0x2c,0xf3,0x5a,0xbd,0x2b,0xa6,0xfa,0xb4 };
+
+static SecretKey MakeKey()
+{
+  return SecretKey("AES", SecureByteArray(g_key, sizeof(g_key)));
+}
+
+BOOST_AUTO_TEST_CASE( VerifyParallelGcm_1P )
+{
+  // Four chunks of one block on four threads must match the known answer
+  try
+    {
+      ParallelGcm gcm(MakeKey(), 4, 16);
+      BOOST_CHECK(gcm.getThreadCount() == 4);
+
+      byte output[sizeof(g_plain)], tag[ParallelGcm::TagSize];
+      gcm.encrypt(g_nonce, sizeof(g_nonce), g_plain, sizeof(g_plain), output, tag);
+
+      BOOST_CHECK(::memcmp(output, g_cipher, sizeof(g_cipher)) == 0);
+      BOOST_CHECK(::memcmp(tag, g_tag, sizeof(g_tag)) == 0);
+
+      byte recovered[sizeof(g_plain)];
+      BOOST_CHECK(gcm.decrypt(g_nonce, sizeof(g_nonce), output, sizeof(output), tag, recovered));
+      BOOST_CHECK(::memcmp(recovered, g_plain, sizeof(g_plain)) == 0);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyParallelGcm_2P )
+{
+  // Parallel and serial output are identical, including a short final chunk
+  const size_t sizes[] = { 0, 1, 100, 4096, 4097, 10000 };
+
+  try
+    {
+      ParallelGcm serial(MakeKey(), 1, 1024);
+      ParallelGcm parallel(MakeKey(), 3, 1024);
+
+      for(size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+      {
+        SecureByteArray input(sizes[i] + 1);
+        for(size_t j = 0; j < input.size(); j++)
+          input[j] = (byte)(j * 7);
+
+        SecureByteArray out1(sizes[i] + 1), out2(sizes[i] + 1);
+        byte tag1[ParallelGcm::TagSize], tag2[ParallelGcm::TagSize];
+
+        serial.encrypt(g_nonce, sizeof(g_nonce), input.data(), sizes[i], out1.data(), tag1);
+        parallel.encrypt(g_nonce, sizeof(g_nonce), input.data(), sizes[i], out2.data(), tag2);
+
+        BOOST_CHECK_MESSAGE(::memcmp(out1.data(), out2.data(), sizes[i]) == 0, sizes[i]);
+        BOOST_CHECK_MESSAGE(::memcmp(tag1, tag2, sizeof(tag1)) == 0, sizes[i]);
+
+        // In place
+        BOOST_CHECK_MESSAGE(parallel.decrypt(g_nonce, sizeof(g_nonce), out2.data(), sizes[i], tag2, out2.data()), sizes[i]);
+        BOOST_CHECK_MESSAGE(::memcmp(out2.data(), input.data(), sizes[i]) == 0, sizes[i]);
+      }
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyParallelGcm_3N )
+{
+  // A bad tag fails and the output is wiped
+  ParallelGcm gcm(MakeKey(), 4, 16);
+
+  byte tag[ParallelGcm::TagSize];
+  ::memcpy(tag, g_tag, sizeof(tag));
+  tag[15] ^= 0x01;
+
+  byte output[sizeof(g_cipher)];
+  BOOST_CHECK(!gcm.decrypt(g_nonce, sizeof(g_nonce), g_cipher, sizeof(g_cipher), tag, output));
+
+  byte zeros[sizeof(output)] = { 0 };
+  BOOST_CHECK(::memcmp(output, zeros, sizeof(output)) == 0);
+}
+
+BOOST_AUTO_TEST_CASE( VerifyParallelGcm_4N )
+{
+  try
+    {
+      ParallelGcm gcm(MakeKey(), 2, 100);
+      BOOST_ERROR("Failed to reject a chunk size which is not a multiple of the block size");
+    }
+  catch(const IllegalArgumentException&)
+    {
+    }
+
+  try
+    {
+      ParallelGcm gcm(MakeKey(), 2, 16);
+      byte output[16], tag[16];
+      gcm.encrypt(g_nonce, 8, g_plain, 16, output, tag);
+      BOOST_ERROR("Failed to reject a short nonce");
+    }
+  catch(const IllegalArgumentException&)
+    {
+    }
+}
@@ -0,0 +1,170 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "EsapiCommon.h"
+using esapi::NarrowString;
+
+#include "util/SecureArray.h"
+using esapi::SecureByteArray;
+
+#include "crypto/PasswordHash.h"
+using esapi::PasswordHash;
+
+#include "errors/IllegalArgumentException.h"
+using esapi::IllegalArgumentException;
+
+#include "errors/NoSuchAlgorithmException.h"
+using esapi::NoSuchAlgorithmException;
+
+#include <string.h>
+
+BOOST_AUTO_TEST_CASE( VerifyPasswordHash_1P )
+{
+  try
+    {
+      // RFC 6070, test vectors 2 and 5
+      const byte expected1[] = {
+        0xea,0x6c,0x01,0x4d,0xc7,0x2d,0x6f,0x8c,0xcd,0x1e,0xd9,0x2a,0xce,0x1d,0x41,0xf0,
+        0xd8,0xde,0x89,0x57 };
+      const byte expected2[] = {
+        0x3d,0x2e,0xec,0x4f,0xe4,0x1c,0x84,0x9b,0x80,0xc8,0xd8,0x36,0x62,0xc0,0xe4,0x4a,
+        0x8b,0x29,0x1a,0x96,0x4c,0xf2,0xf0,0x70,0x38 };
+
+      byte derived[32];
+      PasswordHash::pbkdf2("SHA-1", (const byte*)"password", 8, (const byte*)"salt", 4, 2, derived, sizeof(expected1));
+      BOOST_CHECK(::memcmp(derived, expected1, sizeof(expected1)) == 0);
+
+      const NarrowString password("passwordPASSWORDpassword");
+      const NarrowString salt("saltSALTsaltSALTsaltSALTsaltSALTsalt");
+      PasswordHash::pbkdf2("SHA-1", (const byte*)password.data(), password.size(), (const byte*)salt.data(), salt.size(),
+                           4096, derived, sizeof(expected2));
+      BOOST_CHECK(::memcmp(derived, expected2, sizeof(expected2)) == 0);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyPasswordHash_2P )
+{
+  try
+    {
+      // Cross checked with Python's hashlib.pbkdf2_hmac
+      const byte expected[] = {
+        0xe1,0xd9,0xc1,0x6a,0xa6,0x81,0x70,0x8a,0x45,0xf5,0xc7,0xc4,0xe2,0x15,0xce,0xb6,
+        0x6e,0x01,0x1a,0x2e,0x9f,0x00,0x40,0x71,0x3f,0x18,0xae,0xfd,0xb8,0x66,0xd5,0x3c,
+        0xf7,0x6c,0xab,0x28,0x68,0xa3,0x9b,0x9f,0x78,0x40,0xed,0xce,0x4f,0xef,0x5a,0x82,
+        0xbe,0x67,0x33,0x5c,0x77,0xa6,0x06,0x8e,0x04,0x11,0x27,0x54,0xf2,0x7c,0xcf,0x4e };
+
+      byte derived[64];
+      PasswordHash::pbkdf2("SHA-512", (const byte*)"password", 8, (const byte*)"salt", 4, 2, derived, sizeof(derived));
+      BOOST_CHECK(::memcmp(derived, expected, sizeof(expected)) == 0);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyPasswordHash_3P )
+{
+  try
+    {
+      // SHA-256("abc"), rehashed 1024 times
+      const byte expected[] = {
+        0x33,0xbe,0x42,0xc3,0x57,0x86,0xbb,0x97,0x8d,0x0b,0x98,0x54,0x08,0xea,0x49,0x88,
+        0xf4,0x3d,0x7e,0x3f,0x9e,0x59,0x64,0x15,0xb0,0x8a,0x37,0xe2,0xd4,0x89,0x08,0xfa };
+
+      // Split across parts, with an empty (null) part in the middle
+      const byte* parts[3] = { (const byte*)"a", nullptr, (const byte*)"bc" };
+      const size_t sizes[3] = { 1, 0, 2 };
+
+      SecureByteArray digest = PasswordHash::iteratedDigest("SHA-256", parts, sizes, 3, 1024);
+      BOOST_CHECK(digest.length() == sizeof(expected));
+      BOOST_CHECK(::memcmp(digest.data(), expected, sizeof(expected)) == 0);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyPasswordHash_4N )
+{
+  bool success = false;
+
+  try
+    {
+      byte derived[16];
+      PasswordHash::pbkdf2("SHA-256", (const byte*)"password", 8, (const byte*)"salt", 4, 0, derived, sizeof(derived));
+    }
+  catch(const IllegalArgumentException&)
+    {
+      success = true;
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+  BOOST_CHECK_MESSAGE(success, "Failed to detect bad iteration count");
+}
+
+BOOST_AUTO_TEST_CASE( VerifyPasswordHash_5N )
+{
+  bool success = false;
+
+  try
+    {
+      const byte* parts[1] = { (const byte*)"abc" };
+      const size_t sizes[1] = { 3 };
+      PasswordHash::iteratedDigest("AES", parts, sizes, 1, 16);
+    }
+  catch(const NoSuchAlgorithmException&)
+    {
+      success = true;
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+  BOOST_CHECK_MESSAGE(success, "Failed to detect bad algorithm");
+}
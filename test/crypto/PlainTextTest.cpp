@@ -29,6 +29,7 @@
 using namespace boost::unit_test;
 
 #include <iostream>
+#include <string.h>
 using std::cout;
 using std::cerr;
 using std::endl;
@@ -197,3 +198,18 @@ BOOST_AUTO_TEST_CASE(VerifyPlainText_15) //:Test Overwrite
 }
 #endif
 
+BOOST_AUTO_TEST_CASE(VerifyPlainText_16) //:Test getBytes() returns the stored bytes, not a copy.
+{
+  PlainText pt("secret message");
+  const SecureByteArray& ref1 = pt.getBytes();
+  const SecureByteArray& ref2 = pt.getBytes();
+  BOOST_CHECK(&ref1 == &ref2);
+
+  SecureByteArray copy = pt.asBytes();
+  BOOST_CHECK(copy.size() == ref1.size());
+  BOOST_CHECK(copy.data() != ref1.data());
+  BOOST_CHECK(::memcmp(copy.data(), ref1.data(), copy.size()) == 0);
+
+  pt.overwrite();
+  BOOST_CHECK(ref1[0] == '*');
+}
@@ -39,6 +39,14 @@ using esapi::WideString;
 using esapi::String;
 
 #include <errno.h>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+#if defined(ESAPI_OS_STARNIX)
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #include "crypto/SecureRandom.h"
 using esapi::SecureRandom;
@@ -46,6 +54,9 @@ using esapi::SecureRandom;
 #include "errors/NoSuchAlgorithmException.h"
 using esapi::NoSuchAlgorithmException;
 
+#include "errors/IllegalArgumentException.h"
+using esapi::IllegalArgumentException;
+
 // Some worker thread stuff
 static void DoWorkerThreadStuff();
 static void* WorkerThreadProc(void* param);
@@ -198,6 +209,306 @@ BOOST_AUTO_TEST_CASE( VerifySecureRandom_9N )
     }
 }
 
+BOOST_AUTO_TEST_CASE( VerifySecureRandom_10P )
+{
+    try
+    {
+        // Run well past the reseed interval (2^12 generate calls)
+        SecureRandom prng1 = SecureRandom::getInstance("SHA-256");
+        SecureRandom prng2 = SecureRandom::getInstance("HmacSHA256");
+        BOOST_CHECK(prng1.getAutoReseed() == SecureRandom::DefaultAutoReseed());
+
+        byte random[4];
+        for(unsigned int i = 0; i < 3 * (1 << 12); i++)
+        {
+            prng1.nextBytes(random, sizeof(random));
+            prng2.nextBytes(random, sizeof(random));
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        BOOST_ERROR(ex.what());
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecureRandom_11N )
+{
+    SecureRandom prng = SecureRandom::getInstance("SHA-256");
+    prng.setAutoReseed(0);
+
+    byte random[4];
+    unsigned int i = 0;
+
+    try
+    {
+        for(i = 0; i < 2 * (1 << 12); i++)
+            prng.nextBytes(random, sizeof(random));
+
+        BOOST_ERROR("Failed to detect reseed required");
+    }
+    catch(const IllegalArgumentException& ex)
+    {
+        // Success
+        UNUSED_VARIABLE(ex);
+        BOOST_CHECK(i == (1 << 12));
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecureRandom_12N )
+{
+    try
+    {
+        SecureRandom prng = SecureRandom::getInstance("SHA-256");
+        prng.setAutoReseed(101);
+        BOOST_ERROR("Failed to detect bad reseed percentage");
+    }
+    catch(const IllegalArgumentException& ex)
+    {
+        // Success
+        UNUSED_VARIABLE(ex);
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecureRandom_13P )
+{
+    try
+    {
+        SecureRandom prng = SecureRandom::getInstance("SHA-256");
+
+        // Expected 1000 each; the bounds are many standard deviations wide
+        unsigned int counts[6] = { 0, 0, 0, 0, 0, 0 };
+        for(unsigned int i = 0; i < 6000; i++)
+        {
+            const int value = prng.nextInt(6);
+            BOOST_REQUIRE(value >= 0 && value < 6);
+            counts[value]++;
+        }
+
+        for(unsigned int i = 0; i < 6; i++)
+            BOOST_CHECK(counts[i] > 800 && counts[i] < 1200);
+
+        int values[1000];
+        prng.nextInts(values, 1000, 1000000007);
+        for(unsigned int i = 0; i < 1000; i++)
+            BOOST_CHECK(values[i] >= 0 && values[i] < 1000000007);
+
+        BOOST_CHECK(prng.nextInt(1) == 0);
+
+        for(unsigned int i = 0; i < 1000; i++)
+        {
+            const double d = prng.nextDouble();
+            BOOST_CHECK(d >= 0.0 && d < 1.0);
+        }
+
+        // Two 64-bit values are equal with probability 2^-64
+        BOOST_CHECK(prng.nextLong() != prng.nextLong());
+    }
+    catch(const std::exception& ex)
+    {
+        BOOST_ERROR(ex.what());
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecureRandom_14P )
+{
+    try
+    {
+        SecureRandom prng = SecureRandom::getInstance("HmacSHA256");
+
+        // More than one chunk of swap indices
+        std::vector<int> values(1000);
+        for(unsigned int i = 0; i < values.size(); i++)
+            values[i] = (int)i;
+
+        prng.shuffle(values.begin(), values.end());
+
+        unsigned int moved = 0;
+        for(unsigned int i = 0; i < values.size(); i++)
+            moved += (values[i] != (int)i);
+
+        // Still a permutation
+        std::vector<int> sorted(values);
+        std::sort(sorted.begin(), sorted.end());
+        for(unsigned int i = 0; i < sorted.size(); i++)
+            BOOST_CHECK(sorted[i] == (int)i);
+
+        // About 999 are expected to move
+        BOOST_CHECK(moved > 900);
+
+        // Empty and single element ranges are left alone
+        prng.shuffle(values.begin(), values.begin());
+        prng.shuffle(values.begin(), values.begin() + 1);
+    }
+    catch(const std::exception& ex)
+    {
+        BOOST_ERROR(ex.what());
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecureRandom_15N )
+{
+    try
+    {
+        SecureRandom prng = SecureRandom::getInstance("SHA-256");
+        prng.nextInt(0);
+        BOOST_ERROR("Failed to detect bad bound");
+    }
+    catch(const IllegalArgumentException& ex)
+    {
+        // Success
+        UNUSED_VARIABLE(ex);
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecureRandom_16P )
+{
+    try
+    {
+        esapi::RandomPool& pool = esapi::RandomPool::GetSharedInstance();
+        BOOST_CHECK(pool.GetShardCount() >= 1);
+
+        byte random1[64], random2[64];
+        pool.GenerateBlock(random1, sizeof(random1));
+
+        // Every shard rekeys after a reseed
+        pool.Reseed();
+        pool.GenerateBlock(random2, sizeof(random2));
+
+        BOOST_CHECK(::memcmp(random1, random2, sizeof(random1)) != 0);
+    }
+    catch(const std::exception& ex)
+    {
+        BOOST_ERROR(ex.what());
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecureRandom_18P )
+{
+    try
+    {
+        esapi::RandomPool& pool = esapi::RandomPool::GetSharedInstance();
+        const unsigned int failures = esapi::RandomPool::GetHardwareEntropyFailures();
+
+        // Rekeys work with and without the hardware contribution
+        esapi::RandomPool::SetHardwareEntropy(false);
+        BOOST_CHECK(!esapi::RandomPool::UsesHardwareEntropy());
+        pool.Reseed();
+
+        esapi::RandomPool::SetHardwareEntropy(true);
+        pool.Reseed();
+
+        byte random[64];
+        pool.GenerateBlock(random, sizeof(random));
+
+        // A healthy source does not fail
+        if(esapi::RandomPool::UsesHardwareEntropy())
+            BOOST_CHECK(esapi::RandomPool::GetHardwareEntropyFailures() == failures);
+    }
+    catch(const std::exception& ex)
+    {
+        BOOST_ERROR(ex.what());
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+#if defined(ESAPI_OS_STARNIX)
+BOOST_AUTO_TEST_CASE( VerifySecureRandom_17P )
+{
+    try
+    {
+        SecureRandom prng = SecureRandom::getInstance("HmacSHA256");
+
+        // Leave entropy drawn ahead and a part-used block in the state the child inherits
+        byte random[64], inherited[64];
+        for(unsigned int i = 0; i < (1 << 11); i++)
+            prng.nextBytes(random, 4);
+        (void)prng.nextInt(10);
+
+        int fds[2];
+        BOOST_REQUIRE(pipe(fds) == 0);
+
+        pid_t pid = fork();
+        BOOST_REQUIRE(pid >= 0);
+
+        if(pid == 0)
+        {
+            // Child: report what it draws, and leave without touching the test runner
+            close(fds[0]);
+            ssize_t ret = -1;
+            try
+            {
+                prng.nextBytes(random, sizeof(random));
+                ret = write(fds[1], random, sizeof(random));
+            }
+            catch(...)
+            {
+            }
+            _exit(ret == (ssize_t)sizeof(random) ? 0 : 1);
+        }
+
+        close(fds[1]);
+        prng.nextBytes(random, sizeof(random));
+
+        size_t got = 0;
+        while(got < sizeof(inherited))
+        {
+            ssize_t ret = read(fds[0], inherited + got, sizeof(inherited) - got);
+            if(ret <= 0) break;
+            got += (size_t)ret;
+        }
+        close(fds[0]);
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+
+        BOOST_REQUIRE(got == sizeof(inherited));
+        BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        // Without the fork check both processes produce the same stream
+        BOOST_CHECK(::memcmp(random, inherited, sizeof(random)) != 0);
+    }
+    catch(const std::exception& ex)
+    {
+        BOOST_ERROR(ex.what());
+    }
+    catch(...)
+    {
+        BOOST_ERROR("Caught unknown exception");
+    }
+}
+#endif
+
 struct Args
 {
     Args(unsigned int i, SecureRandom& r)
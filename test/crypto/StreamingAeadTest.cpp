@@ -0,0 +1,296 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "EsapiCommon.h"
+using esapi::NarrowString;
+
+#include "util/SecureArray.h"
+using esapi::SecureByteArray;
+
+#include "crypto/SecretKey.h"
+using esapi::SecretKey;
+
+#include "crypto/StreamingAead.h"
+using esapi::StreamingAead;
+using esapi::StreamEncryptor;
+using esapi::StreamDecryptor;
+
+#include "errors/EncryptionException.h"
+using esapi::EncryptionException;
+
+#include "errors/IllegalArgumentException.h"
+using esapi::IllegalArgumentException;
+
+#include <sstream>
+#include <string>
+
+static const size_t SegmentSize = StreamingAead::MinSegmentSize;
+
+static std::string MakeMessage(size_t size)
+{
+  std::string message(size, '\0');
+  for(size_t i = 0; i < size; i++)
+    message[i] = (char)('a' + (i % 26));
+
+  return message;
+}
+
+static SecretKey MakeKey(size_t size)
+{
+  SecureByteArray bytes(size);
+  for(size_t i = 0; i < size; i++)
+    bytes[i] = (byte)i;
+
+  return SecretKey("AES", bytes);
+}
+
+BOOST_AUTO_TEST_CASE( VerifyStreamingAead_1P )
+{
+  // Round trips around the segment boundaries, through streams and buffers
+  const SecretKey key = MakeKey(16);
+  const size_t sizes[] = { 0, 1, SegmentSize - 1, SegmentSize, SegmentSize + 1, 3 * SegmentSize, 3 * SegmentSize + 7 };
+
+  for(size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+  {
+    try
+      {
+        const std::string message = MakeMessage(sizes[i]);
+
+        std::istringstream in(message);
+        std::ostringstream encrypted;
+        StreamingAead::encrypt(key, in, encrypted, SegmentSize);
+
+        BOOST_CHECK_MESSAGE(encrypted.str().size() == StreamingAead::getCipherTextSize(sizes[i], SegmentSize), sizes[i]);
+
+        std::istringstream ein(encrypted.str());
+        std::ostringstream decrypted;
+        StreamingAead::decrypt(key, ein, decrypted);
+        BOOST_CHECK_MESSAGE(decrypted.str() == message, sizes[i]);
+
+        std::ostringstream encrypted2;
+        StreamingAead::encrypt(key, (const byte*)message.data(), message.size(), encrypted2, SegmentSize);
+        BOOST_CHECK_MESSAGE(encrypted2.str().size() == encrypted.str().size(), sizes[i]);
+
+        // A new salt and nonce prefix for every stream
+        BOOST_CHECK_MESSAGE(encrypted2.str() != encrypted.str(), sizes[i]);
+
+        std::istringstream ein2(encrypted2.str());
+        std::ostringstream decrypted2;
+        StreamingAead::decrypt(key, ein2, decrypted2);
+        BOOST_CHECK_MESSAGE(decrypted2.str() == message, sizes[i]);
+      }
+    catch(const std::exception& ex)
+      {
+        BOOST_ERROR(ex.what());
+      }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyStreamingAead_2P )
+{
+  // Random access decryption of a stream held in memory
+  try
+    {
+      const SecretKey key = MakeKey(32);
+      const std::string message = MakeMessage(4 * SegmentSize + 100);
+
+      std::ostringstream encrypted;
+      StreamingAead::encrypt(key, (const byte*)message.data(), message.size(), encrypted, SegmentSize);
+      const std::string stream = encrypted.str();
+
+      StreamDecryptor decryptor(key, (const byte*)stream.data(), stream.size());
+      BOOST_CHECK(decryptor.getSegmentSize() == SegmentSize);
+
+      const size_t count = decryptor.getSegmentCount(stream.size());
+      BOOST_REQUIRE(count == 5);
+
+      SecureByteArray output(SegmentSize);
+      for(size_t i = count; i-- > 0; )
+      {
+        const size_t size = decryptor.decryptSegment((const byte*)stream.data(), stream.size(), i, output.data(), output.size());
+        BOOST_CHECK_MESSAGE(std::string((const char*)output.data(), size) == message.substr(i * SegmentSize, size), i);
+      }
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyStreamingAead_3P )
+{
+  // Incremental encryption with the caller's buffers
+  try
+    {
+      const SecretKey key = MakeKey(24);
+      const std::string message = MakeMessage(2 * SegmentSize);
+
+      StreamEncryptor encryptor(key, SegmentSize);
+      const SecureByteArray header = encryptor.getHeader();
+      BOOST_REQUIRE(header.size() == StreamingAead::HeaderSize);
+
+      std::string stream((const char*)header.data(), header.size());
+      SecureByteArray output(SegmentSize + StreamingAead::TagSize);
+
+      size_t written = encryptor.encryptSegment((const byte*)message.data(), SegmentSize, false, output.data(), output.size());
+      stream.append((const char*)output.data(), written);
+      written = encryptor.encryptSegment((const byte*)message.data() + SegmentSize, SegmentSize, true, output.data(), output.size());
+      stream.append((const char*)output.data(), written);
+
+      std::istringstream in(stream);
+      std::ostringstream decrypted;
+      StreamingAead::decrypt(key, in, decrypted);
+      BOOST_CHECK(decrypted.str() == message);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyStreamingAead_4N )
+{
+  // Truncated at a segment boundary, reordered, and modified streams are rejected
+  const SecretKey key = MakeKey(16);
+  const std::string message = MakeMessage(3 * SegmentSize);
+  const size_t full = SegmentSize + StreamingAead::TagSize;
+
+  std::ostringstream encrypted;
+  StreamingAead::encrypt(key, (const byte*)message.data(), message.size(), encrypted, SegmentSize);
+  const std::string stream = encrypted.str();
+
+  std::string truncated = stream.substr(0, StreamingAead::HeaderSize + 2 * full);
+
+  std::string reordered = stream;
+  reordered.replace(StreamingAead::HeaderSize, full, stream.substr(StreamingAead::HeaderSize + full, full));
+  reordered.replace(StreamingAead::HeaderSize + full, full, stream.substr(StreamingAead::HeaderSize, full));
+
+  std::string modified = stream;
+  modified[StreamingAead::HeaderSize + full + 5] ^= 0x01;
+
+  std::string header = stream;
+  header[2] ^= 0x01;
+
+  const std::string* bad[] = { &truncated, &reordered, &modified, &header };
+  for(size_t i = 0; i < sizeof(bad)/sizeof(bad[0]); i++)
+  {
+    try
+      {
+        std::istringstream in(*bad[i]);
+        std::ostringstream decrypted;
+        StreamingAead::decrypt(key, in, decrypted);
+
+        BOOST_ERROR("Failed to reject a bad stream: " << i);
+      }
+    catch(const EncryptionException&)
+      {
+      }
+    catch(...)
+      {
+        BOOST_ERROR("Caught unknown exception: " << i);
+      }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyStreamingAead_5N )
+{
+  // Nothing may follow the last segment, and only the last may be short
+  const SecretKey key = MakeKey(16);
+  StreamEncryptor encryptor(key, SegmentSize);
+
+  SecureByteArray input(SegmentSize);
+  SecureByteArray output(SegmentSize + StreamingAead::TagSize);
+
+  try
+    {
+      encryptor.encryptSegment(input.data(), 10, false, output.data(), output.size());
+      BOOST_ERROR("Failed to reject a short segment");
+    }
+  catch(const IllegalArgumentException&)
+    {
+    }
+
+  encryptor.encryptSegment(input.data(), 10, true, output.data(), output.size());
+
+  try
+    {
+      encryptor.encryptSegment(input.data(), 10, true, output.data(), output.size());
+      BOOST_ERROR("Failed to reject a segment after the last");
+    }
+  catch(const EncryptionException&)
+    {
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyStreamingAead_6P )
+{
+  const size_t header = StreamingAead::HeaderSize, tag = StreamingAead::TagSize;
+
+  // An empty stream still carries one (empty) final segment
+  BOOST_CHECK(StreamingAead::getCipherTextSize(0, SegmentSize) == header + tag);
+
+  BOOST_CHECK(StreamingAead::getCipherTextSize(1, SegmentSize) == header + 1 + tag);
+  BOOST_CHECK(StreamingAead::getCipherTextSize(SegmentSize, SegmentSize) == header + SegmentSize + tag);
+  BOOST_CHECK(StreamingAead::getCipherTextSize(SegmentSize + 1, SegmentSize) == header + SegmentSize + 1 + 2 * tag);
+  BOOST_CHECK(StreamingAead::getCipherTextSize(3 * SegmentSize, SegmentSize) == header + 3 * SegmentSize + 3 * tag);
+
+  const size_t def = StreamingAead::DefaultSegmentSize;
+  BOOST_CHECK(StreamingAead::getCipherTextSize(def + 7, def) == header + def + 7 + 2 * tag);
+}
+
+BOOST_AUTO_TEST_CASE( VerifyStreamingAead_7N )
+{
+  bool success = false;
+
+  try
+    {
+      // Segment size below the minimum
+      StreamingAead::getCipherTextSize(1024, StreamingAead::MinSegmentSize - 1);
+    }
+  catch(const IllegalArgumentException&)
+    {
+      success = true;
+    }
+
+  BOOST_CHECK_MESSAGE(success, "Failed to reject a bad segment size");
+
+  success = false;
+
+  try
+    {
+      // The tags push the total past size_t
+      StreamingAead::getCipherTextSize((size_t)-1, SegmentSize);
+    }
+  catch(const IllegalArgumentException&)
+    {
+      success = true;
+    }
+
+  BOOST_CHECK_MESSAGE(success, "Failed to detect integer overflow");
+}
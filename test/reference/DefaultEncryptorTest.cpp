@@ -28,6 +28,7 @@
 using namespace boost::unit_test;
 
 #include <iostream>
+#include <algorithm>
 using std::cout;
 using std::cerr;
 using std::endl;
@@ -49,6 +50,36 @@ using esapi::IllegalArgumentException;
 #include "util/TextConvert.h"
 using esapi::TextConvert;
 
+#include <util/SecureArray.h>
+using esapi::SecureByteArray;
+
+#include <crypto/SecretKey.h>
+using esapi::SecretKey;
+
+#include <crypto/PlainText.h>
+using esapi::PlainText;
+
+#include <crypto/CipherText.h>
+using esapi::CipherText;
+using esapi::CipherTextView;
+
+#include <crypto/CryptoPolicy.h>
+using esapi::CryptoPolicy;
+
+#include "DummyConfiguration.h"
+using esapi::DummyConfiguration;
+
+// A configuration with a transformation other than the default GCM
+class TransformConfiguration : public DummyConfiguration
+{
+public:
+  explicit TransformConfiguration(const esapi::NarrowString& xform) : m_xform(xform) { }
+  virtual esapi::NarrowString getCipherTransformation() { return m_xform; }
+
+private:
+  esapi::NarrowString m_xform;
+};
+
 void VerifyEncrypt1();
 void VerifyEncrypt2();
 void VerifyDecrypt1();
@@ -181,3 +212,217 @@ BOOST_AUTO_TEST_CASE( VerifyHash4 )
   BOOST_CHECK_MESSAGE(success, "Failed to arrive at expected hash (expected): " << expected << ", (calculated): " << encoded);
 }
 
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptDecrypt1 )
+{
+  // Round trip under the master key
+  const String message = "Now is the time for all good men to come to the aide of their country";
+
+  try
+    {
+      DefaultEncryptor encryptor;
+      CipherText cipherText = encryptor.encrypt(PlainText(message));
+
+      BOOST_CHECK(!cipherText.empty());
+      BOOST_CHECK(cipherText.getCipherMode() == "GCM");
+      BOOST_CHECK(cipherText.getIV().size() == 12);
+      // Ciphertext || 16-byte tag
+      BOOST_CHECK(cipherText.getRawCipherTextByteLength() == message.size() + 16);
+
+      PlainText recovered = encryptor.decrypt(cipherText);
+      BOOST_CHECK_MESSAGE(recovered.toString() == message, "Failed to recover the plain text");
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptDecrypt2 )
+{
+  // Reusing a CipherText for the output, with a 256-bit key
+  const SecureByteArray bytes(32);
+  const SecretKey key("AES", bytes);
+
+  try
+    {
+      DefaultEncryptor encryptor;
+      CipherText cipherText;
+
+      encryptor.encrypt(key, PlainText(String("A somewhat longer first record")), cipherText);
+      const SecureByteArray first = cipherText.getRawCipherText();
+      const SecureByteArray firstIV = cipherText.getIV();
+
+      encryptor.encrypt(key, PlainText(String("Second")), cipherText);
+      BOOST_CHECK(cipherText.getKeySize() == 256);
+      BOOST_CHECK(cipherText.getRawCipherTextByteLength() == 6 + 16);
+
+      // Earlier results are copies, and nonces are not repeated
+      BOOST_CHECK(first.size() == 30 + 16);
+      const SecureByteArray secondIV = cipherText.getIV();
+      BOOST_CHECK(!std::equal(firstIV.begin(), firstIV.end(), secondIV.begin()));
+
+      BOOST_CHECK(encryptor.decrypt(key, cipherText).toString() == "Second");
+      BOOST_CHECK(encryptor.decrypt(key, CipherText(cipherText.getCipherSpec(), cipherText.getRawCipherText())).toString() == "Second");
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptDecrypt3N )
+{
+  // A modified ciphertext must not decrypt
+  DefaultEncryptor encryptor;
+  CipherText cipherText = encryptor.encrypt(PlainText(String("Attack at dawn")));
+
+  SecureByteArray raw = cipherText.getRawCipherText();
+  raw[0] ^= 0x01;
+  cipherText.setCiphertext(raw);
+
+  try
+    {
+      PlainText recovered = encryptor.decrypt(cipherText);
+      BOOST_ERROR("Failed to detect a modified ciphertext");
+    }
+  catch(const EncryptionException&)
+    {
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptDecrypt4N )
+{
+  // The wrong key must not decrypt
+  SecureByteArray bytes(16);
+  bytes[0] = 0x01;
+  const SecretKey key("AES", bytes);
+
+  DefaultEncryptor encryptor;
+  CipherText cipherText = encryptor.encrypt(PlainText(String("Attack at dawn")));
+
+  try
+    {
+      PlainText recovered = encryptor.decrypt(key, cipherText);
+      BOOST_ERROR("Failed to detect the wrong key");
+    }
+  catch(const EncryptionException&)
+    {
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptDecrypt5 )
+{
+  // Threaded encryption of a large message decrypts on the single threaded path, and back
+  String message(3 * 1024 * 1024 + 5, 'x');
+  for(size_t i = 0; i < message.size(); i++)
+    message[i] = (char)('a' + (i % 23));
+
+  try
+    {
+      DefaultEncryptor serial, parallel;
+      parallel.setParallelism(4, 1024 * 1024);
+
+      CipherText cipherText = parallel.encrypt(PlainText(message));
+      BOOST_CHECK(serial.decrypt(cipherText).toString() == message);
+
+      cipherText = serial.encrypt(PlainText(message));
+      BOOST_CHECK(parallel.decrypt(cipherText).toString() == message);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptDecrypt6 )
+{
+  // Serialize, then decrypt straight from the received bytes
+  const String message = "Now is the time for all good men to come to the aide of their country";
+
+  try
+    {
+      DefaultEncryptor encryptor;
+      const SecretKey key("AES", SecureByteArray(16, (byte)0x5A));
+
+      const SecureByteArray bytes = encryptor.encrypt(key, PlainText(message)).asPortableSerializedByteArray();
+
+      CipherTextView view(bytes.data(), bytes.size());
+      BOOST_CHECK(view.getSerializedSize() == bytes.size());
+      BOOST_CHECK(view.getCipherTransformation() == "AES/GCM/NoPadding");
+      BOOST_CHECK(view.getEncryptionTimestamp() != 0);
+
+      PlainText recovered = encryptor.decrypt(key, view);
+      BOOST_CHECK_MESSAGE(recovered.toString() == message, "Failed to recover the plain text");
+
+      // And through an owning copy
+      recovered = encryptor.decrypt(key, CipherText::fromPortableSerializedBytes(bytes.data(), bytes.size()));
+      BOOST_CHECK_MESSAGE(recovered.toString() == message, "Failed to recover the plain text");
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyEncryptDecrypt7 )
+{
+  // The stream modes encrypt an empty message to an empty ciphertext, and the
+  // MAC still protects it. CBC pads it to a block.
+  const shared_ptr<const CryptoPolicy> before = CryptoPolicy::getInstance();
+  const SecretKey key("AES", SecureByteArray(16, (byte)0x3C));
+
+  const char* const xforms[] = { "AES/CFB/NoPadding", "AES/OFB/NoPadding", "AES/CBC/PKCS5Padding" };
+  const size_t sizes[] = { 0, 0, 16 };
+
+  for(size_t i = 0; i < COUNTOF(xforms); i++)
+    {
+      try
+        {
+          TransformConfiguration config(xforms[i]);
+          CryptoPolicy::reload(config);
+
+          DefaultEncryptor encryptor;
+          CipherText cipherText = encryptor.encrypt(key, PlainText(String("")));
+          BOOST_CHECK(cipherText.getRawCipherTextByteLength() == sizes[i]);
+          BOOST_CHECK(cipherText.getSeparateMAC().size() != 0);
+
+          PlainText recovered = encryptor.decrypt(key, cipherText);
+          BOOST_CHECK_MESSAGE(recovered.length() == 0, std::string("Failed to recover the empty message under ") + xforms[i]);
+        }
+      catch(const std::exception& ex)
+        {
+          BOOST_ERROR(std::string(xforms[i]) + ": " + ex.what());
+        }
+      catch(...)
+        {
+          BOOST_ERROR("Caught unknown exception");
+        }
+    }
+
+  CryptoPolicy::setInstance(before);
+}
@@ -0,0 +1,150 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "EsapiCommon.h"
+using esapi::NarrowString;
+using esapi::StringArray;
+
+#include "Randomizer.h"
+using esapi::Randomizer;
+
+#include "reference/DefaultRandomizer.h"
+using esapi::DefaultRandomizer;
+
+#include "errors/IllegalArgumentException.h"
+using esapi::IllegalArgumentException;
+
+#include <set>
+
+BOOST_AUTO_TEST_CASE( VerifyDefaultRandomizer_1P )
+{
+  try
+    {
+      DefaultRandomizer randomizer;
+      const NarrowString charset = "ABC";
+
+      // Every character comes from the set, and every character of the set shows up
+      const NarrowString str = randomizer.getRandomString(3000, charset);
+      BOOST_CHECK(str.length() == 3000);
+      BOOST_CHECK(str.find_first_not_of(charset) == NarrowString::npos);
+
+      size_t counts[3] = { 0, 0, 0 };
+      for(size_t i = 0; i < str.length(); i++)
+        counts[str[i] - 'A']++;
+
+      // Expected 1000 each; the bounds are many standard deviations wide
+      for(size_t i = 0; i < 3; i++)
+        BOOST_CHECK(counts[i] > 800 && counts[i] < 1200);
+
+      BOOST_CHECK(randomizer.getRandomString(0, charset).empty());
+      BOOST_CHECK(randomizer.getRandomString(8, "x") == "xxxxxxxx");
+
+      const StringArray batch = randomizer.getRandomStrings(100, 12, charset);
+      BOOST_CHECK(batch.size() == 100);
+      for(size_t i = 0; i < batch.size(); i++)
+        {
+          BOOST_CHECK(batch[i].length() == 12);
+          BOOST_CHECK(batch[i].find_first_not_of(charset) == NarrowString::npos);
+        }
+
+      const NarrowString file = randomizer.getRandomFilename("txt");
+      BOOST_CHECK(file.length() == 24);
+      BOOST_CHECK(file.substr(20) == ".txt");
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyDefaultRandomizer_2P )
+{
+  try
+    {
+      DefaultRandomizer randomizer;
+
+      const NarrowString guid = randomizer.getRandomGUID();
+      BOOST_CHECK(guid.length() == 36);
+      BOOST_CHECK(guid[8] == '-' && guid[13] == '-' && guid[18] == '-' && guid[23] == '-');
+      BOOST_CHECK(guid[14] == '4');
+      BOOST_CHECK(NarrowString("89ab").find(guid[19]) != NarrowString::npos);
+
+      const StringArray guids = randomizer.getRandomGUIDs(64);
+      const std::set<NarrowString> unique(guids.begin(), guids.end());
+      BOOST_CHECK(guids.size() == 64);
+      BOOST_CHECK(unique.size() == 64);
+
+      const NarrowString hex = randomizer.getRandomToken(16, Randomizer::TokenHex);
+      BOOST_CHECK(hex.length() == 32);
+      BOOST_CHECK(hex.find_first_not_of("0123456789abcdef") == NarrowString::npos);
+
+      // 22 characters for 16 bytes, no padding
+      const NarrowString b64 = randomizer.getRandomToken(16, Randomizer::TokenBase64Url);
+      BOOST_CHECK(b64.length() == 22);
+      BOOST_CHECK(b64.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_") == NarrowString::npos);
+
+      const StringArray tokens = randomizer.getRandomTokens(32, 20);
+      BOOST_CHECK(tokens.size() == 32);
+      for(size_t i = 0; i < tokens.size(); i++)
+        BOOST_CHECK(tokens[i].length() == 27);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyDefaultRandomizer_3N )
+{
+  bool success = false;
+
+  try
+    {
+      DefaultRandomizer randomizer;
+      randomizer.getRandomString(8, "");
+    }
+  catch(const IllegalArgumentException&)
+    {
+      success = true;
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+
+  BOOST_CHECK_MESSAGE(success, "Failed to catch empty character set");
+}
@@ -0,0 +1,172 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "EsapiCommon.h"
+using esapi::NarrowString;
+
+#include "reference/DefaultEncryptor.h"
+using esapi::DefaultEncryptor;
+
+#include "reference/HashingService.h"
+using esapi::HashingService;
+using esapi::HashingMetrics;
+using esapi::HashFuture;
+using esapi::PasswordCheck;
+
+#include "errors/IllegalArgumentException.h"
+using esapi::IllegalArgumentException;
+
+#include "errors/IllegalStateException.h"
+using esapi::IllegalStateException;
+
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( VerifyHashingService_1P )
+{
+  try
+    {
+      // Same vector as DefaultEncryptorTest's VerifyHash1
+      const NarrowString expected = "9Lw+bODsCpRW/wNyzapmC5xyOrF7fx/G0C46LKshoByzQ8gqSNlnJ91e+eWR5nsr58GGGLdoYRbgwYRVTrHjLQ==";
+
+      HashingService service(2);
+      HashFuture future = service.submit("password", "salt");
+
+      BOOST_CHECK(future.get() == expected);
+      BOOST_CHECK(future.isDone());
+
+      HashingMetrics metrics = service.getMetrics();
+      BOOST_CHECK(metrics.workers == 2);
+      BOOST_CHECK(metrics.submitted == 1);
+      BOOST_CHECK(metrics.completed == 1);
+      BOOST_CHECK(metrics.failed == 0);
+      BOOST_CHECK(metrics.queueDepth == 0);
+      BOOST_CHECK(metrics.maxLatency >= metrics.averageLatency);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyHashingService_2P )
+{
+  try
+    {
+      DefaultEncryptor encryptor;
+      std::vector<PasswordCheck> checks;
+
+      for(unsigned int i = 0; i < 16; i++)
+        {
+          std::ostringstream password, salt;
+          password << "password" << i;
+          salt << "salt" << i;
+
+          NarrowString expected = encryptor.hash(password.str(), salt.str(), 64);
+
+          // Every third check uses the wrong password
+          if(i % 3 == 0)
+            password << "x";
+
+          checks.push_back(PasswordCheck(password.str(), salt.str(), expected, 64));
+        }
+
+      std::vector<bool> results;
+      HashingService service(4, 4);
+      service.verify(checks, results);
+
+      BOOST_CHECK(results.size() == checks.size());
+      for(size_t i = 0; i < results.size(); i++)
+        BOOST_CHECK(results[i] == (i % 3 != 0));
+
+      HashingMetrics metrics = service.getMetrics();
+      BOOST_CHECK(metrics.completed == checks.size());
+      BOOST_CHECK(metrics.peakQueueDepth <= 4);
+      BOOST_CHECK(metrics.rejected == 0);
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyHashingService_3N )
+{
+  bool success = false;
+
+  try
+    {
+      // One worker and one queue slot. The first job runs (or waits), the second
+      // fills the queue, so a third submission must be turned away.
+      HashingService service(1, 1);
+      std::vector<HashFuture> futures;
+
+      for(unsigned int i = 0; i < 3; i++)
+        futures.push_back(service.submit("password", "salt", 200000));
+    }
+  catch(const IllegalStateException&)
+    {
+      success = true;
+    }
+  catch(const std::exception& ex)
+    {
+      BOOST_ERROR(ex.what());
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+  BOOST_CHECK_MESSAGE(success, "Failed to reject work when the queue was full");
+}
+
+BOOST_AUTO_TEST_CASE( VerifyHashingService_4N )
+{
+  bool success = false;
+
+  try
+    {
+      HashingService service(1, 0);
+    }
+  catch(const IllegalArgumentException&)
+    {
+      success = true;
+    }
+  catch(...)
+    {
+      BOOST_ERROR("Caught unknown exception");
+    }
+  BOOST_CHECK_MESSAGE(success, "Failed to detect bad queue capacity");
+}
@@ -186,6 +186,72 @@ BOOST_AUTO_TEST_CASE( AlgorithmName_16P )
   BOOST_CHECK_MESSAGE(alg == "AES/CBC/PKCS5Padding", "Failed to algorithm (2)");
 }
 
+BOOST_AUTO_TEST_CASE( AlgorithmName_17P )
+{
+  // Interned identifiers
+  AlgorithmName a("aes/cbc/pkcs5padding");
+  BOOST_CHECK(a.getAlgorithmId() == AlgorithmName::AlgAES);
+  BOOST_CHECK(a.getModeId() == AlgorithmName::ModeCBC);
+  BOOST_CHECK(a.getPaddingId() == AlgorithmName::PaddingPKCS5);
+  BOOST_CHECK(a.getFamily() == AlgorithmName::FamilyCipher);
+
+  AlgorithmName b(L"SHA");
+  BOOST_CHECK(b.getAlgorithmId() == AlgorithmName::AlgSHA1);
+  BOOST_CHECK(b.getModeId() == AlgorithmName::ModeAbsent);
+  BOOST_CHECK(b.getPaddingId() == AlgorithmName::PaddingAbsent);
+  BOOST_CHECK(b.getFamily() == AlgorithmName::FamilyHash);
+
+  AlgorithmName c("HmacSHA-256");
+  BOOST_CHECK(c.getAlgorithmId() == AlgorithmName::AlgHmacSHA256);
+  BOOST_CHECK(c.getFamily() == AlgorithmName::FamilyHmac);
+  BOOST_CHECK(c.algorithm() == "HmacSHA256");
+}
+
+BOOST_AUTO_TEST_CASE( AlgorithmName_18P )
+{
+  // Every alias in the registry resolves (the registry is a sorted table)
+  static const char* const aliases[] = {
+    "aes", "blowfish", "camellia", "des", "des_ede", "desede", "diffiehellman",
+    "hmacsha", "hmacsha-1", "hmacsha-224", "hmacsha-256", "hmacsha-384", "hmacsha-512",
+    "hmacsha1", "hmacsha224", "hmacsha256", "hmacsha384", "hmacsha512", "hmacwhirlpoo",
+    "md-5", "md5", "pbewithsha1", "pbewithsha224", "pbewithsha256", "pbewithsha384",
+    "pbewithsha512", "pbewithwhirlpoo", "sha", "sha-1", "sha-224", "sha-256", "sha-384",
+    "sha-512", "sha1", "sha1prng", "sha224", "sha256", "sha384", "sha512", "whirlpoo"
+  };
+
+  for(size_t i = 0; i < sizeof(aliases)/sizeof(aliases[0]); i++)
+  {
+    try
+      {
+        AlgorithmName a(aliases[i]);
+        BOOST_CHECK_MESSAGE(a.getAlgorithmId() != AlgorithmName::AlgUnknown, aliases[i]);
+
+        // Normalized names are stable
+        AlgorithmName b(a.algorithm());
+        BOOST_CHECK_MESSAGE(a.getAlgorithmId() == b.getAlgorithmId(), aliases[i]);
+      }
+    catch(...)
+      {
+        BOOST_ERROR(aliases[i]);
+      }
+  }
+
+  static const char* const modes[] = { "none", "ecb", "cbc", "ofb", "cfb", "ctr", "ccm", "eax", "gcm" };
+  for(size_t i = 0; i < sizeof(modes)/sizeof(modes[0]); i++)
+  {
+    try
+      {
+        AlgorithmName a(NarrowString("AES/") + modes[i] + "/NoPadding");
+        BOOST_CHECK_MESSAGE(a.getModeId() != AlgorithmName::ModeAbsent, modes[i]);
+        BOOST_CHECK_MESSAGE(a.getPaddingId() == AlgorithmName::PaddingNone, modes[i]);
+      }
+    catch(...)
+      {
+        BOOST_ERROR(modes[i]);
+      }
+  }
+}
+
 BOOST_AUTO_TEST_CASE( AlgorithmName_100N )
 {
   try
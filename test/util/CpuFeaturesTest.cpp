@@ -0,0 +1,66 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * <a href="http://www.owasp.org/index.php/ESAPI">http://www.owasp.org/index.php/ESAPI</a>.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "util/CpuFeatures.h"
+using esapi::CpuFeatures;
+
+BOOST_AUTO_TEST_CASE( CpuFeatures_1P )
+{
+  // Detection is cached, so repeated queries must agree
+  BOOST_CHECK(CpuFeatures::HasSSE2() == CpuFeatures::HasSSE2());
+  BOOST_CHECK(CpuFeatures::HasSHA() == CpuFeatures::HasSHA());
+  BOOST_CHECK(CpuFeatures::HasAVX2() == CpuFeatures::HasAVX2());
+  BOOST_CHECK(CpuFeatures::HasRDSEED() == CpuFeatures::HasRDSEED());
+
+#if defined(ESAPI_ARCH_X64)
+  // SSE2 is part of the x86-64 baseline
+  BOOST_CHECK(CpuFeatures::HasSSE2());
+#endif
+
+#if !defined(ESAPI_ARCH_X86) && !defined(ESAPI_ARCH_X64)
+  BOOST_CHECK(!CpuFeatures::HasSSE2());
+  BOOST_CHECK(!CpuFeatures::HasSHA());
+  BOOST_CHECK(!CpuFeatures::HasAVX2());
+  BOOST_CHECK(!CpuFeatures::HasRDRAND());
+#endif
+}
+
+BOOST_AUTO_TEST_CASE( CpuFeatures_2P )
+{
+  // Every part with these extensions also has the baseline they build on
+  if(CpuFeatures::HasAVX2())
+    BOOST_CHECK(CpuFeatures::HasSSE41() && CpuFeatures::HasSSSE3());
+
+  if(CpuFeatures::HasSSE41())
+    BOOST_CHECK(CpuFeatures::HasSSSE3() && CpuFeatures::HasSSE2());
+}
+
+BOOST_AUTO_TEST_CASE( CpuFeatures_3P )
+{
+  BOOST_CHECK(CpuFeatures::ProcessorCount() >= 1);
+}
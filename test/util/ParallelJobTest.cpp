@@ -0,0 +1,154 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "util/ParallelJob.h"
+using esapi::ParallelJob;
+
+#include "errors/EncryptionException.h"
+using esapi::EncryptionException;
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+/**
+ * Counts the visits to each item. Each item is claimed once, so no two threads
+ * write the same counter. fault is the item which throws, if any.
+ */
+class CountingJob : public ParallelJob
+{
+public:
+  CountingJob(size_t items, size_t fault = (size_t)-1)
+    : ParallelJob(items, "Test failed: "), m_visits(items), m_fault(fault)
+  {
+  }
+
+  std::vector<unsigned int> m_visits;
+
+protected:
+  void run()
+  {
+    size_t item;
+    while(nextItem(item))
+      {
+        if(item == m_fault)
+          throw std::runtime_error("fault");
+
+        m_visits[item]++;
+      }
+  }
+
+private:
+  size_t m_fault;
+};
+
+#if defined(ESAPI_OS_WINDOWS)
+static unsigned __stdcall IncrementProc(void* param)
+{
+  ++*static_cast<unsigned int*>(param);
+  return 0;
+}
+#elif defined(ESAPI_OS_STARNIX)
+static void* IncrementProc(void* param)
+{
+  ++*static_cast<unsigned int*>(param);
+  return NULL;
+}
+#endif
+
+BOOST_AUTO_TEST_CASE( VerifyParallelJob_1P )
+{
+  static const size_t items[] = { 0, 1, 2, 63, 1000 };
+  static const unsigned int threads[] = { 0, 1, 2, 8 };
+
+  for(size_t i = 0; i < COUNTOF(items); i++)
+    {
+      for(size_t j = 0; j < COUNTOF(threads); j++)
+        {
+          CountingJob job(items[i]);
+          job.execute(threads[j]);
+
+          bool once = true;
+          for(size_t k = 0; k < items[i]; k++)
+            once &= (job.m_visits[k] == 1);
+
+          BOOST_CHECK_MESSAGE(once, "Failed to visit every item exactly once");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyParallelJob_2N )
+{
+  static const unsigned int threads[] = { 1, 4 };
+
+  for(size_t j = 0; j < COUNTOF(threads); j++)
+    {
+      bool success = false;
+
+      try
+        {
+          CountingJob job(256, 100);
+          job.execute(threads[j]);
+        }
+      catch(const EncryptionException& ex)
+        {
+          success = (std::string(ex.what()).find("Test failed: fault") != std::string::npos);
+        }
+
+      BOOST_CHECK_MESSAGE(success, "Failed to report a failed thread");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifyParallelJob_3P )
+{
+  const unsigned int count = ParallelJob::ThreadCount(0);
+  BOOST_CHECK(count >= 1 && count <= (unsigned int)ParallelJob::MaxThreads);
+
+  BOOST_CHECK(ParallelJob::ThreadCount(1) == 1);
+  BOOST_CHECK(ParallelJob::ThreadCount(3) == 3);
+  BOOST_CHECK(ParallelJob::ThreadCount(100000) == (unsigned int)ParallelJob::MaxThreads);
+}
+
+#if defined(ESAPI_OS_WINDOWS) || defined(ESAPI_OS_STARNIX)
+BOOST_AUTO_TEST_CASE( VerifyParallelJob_4P )
+{
+  // The thread helpers HashingService shares. Each thread has its own counter.
+  unsigned int counters[4] = { 0, 0, 0, 0 };
+  ParallelJob::ThreadHandle handles[4];
+
+  for(size_t i = 0; i < COUNTOF(handles); i++)
+    BOOST_REQUIRE(ParallelJob::StartThread(&IncrementProc, &counters[i], handles[i]));
+
+  for(size_t i = 0; i < COUNTOF(handles); i++)
+    ParallelJob::JoinThread(handles[i]);
+
+  for(size_t i = 0; i < COUNTOF(counters); i++)
+    BOOST_CHECK(counters[i] == 1);
+}
+#endif
@@ -293,3 +293,75 @@ BOOST_AUTO_TEST_CASE( SecureByteArrayTest_17P )
   BOOST_CHECK_MESSAGE(success, "Failed to clone secure array");
 }
 
+BOOST_AUTO_TEST_CASE( SecureByteArrayTest_18P )
+{
+  bool success = false;
+  try
+  {
+    // Small arrays live in the object; growing past InlineBytes moves them to the heap
+    SecureByteArray vv;
+    BOOST_CHECK_MESSAGE(vv.capacity() == SecureByteArray::InlineBytes, "Failed inline capacity (1)");
+
+    for(size_t i = 0; i < 200; i++)
+      vv.push_back((byte)i);
+
+    BOOST_CHECK_MESSAGE(vv.size() == 200 && vv.capacity() >= 200, "Failed to grow secure array (1)");
+
+    bool ok = true;
+    for(size_t i = 0; i < vv.size(); i++)
+      ok &= (vv[i] == (byte)i);
+    BOOST_CHECK_MESSAGE(ok, "Failed to grow secure array (2)");
+
+    // Copies are deep
+    SecureByteArray ww(vv);
+    ww[0] = 0xFF;
+    BOOST_CHECK_MESSAGE(vv[0] == 0 && ww[0] == 0xFF, "Failed to copy secure array");
+
+    // Insert from the array's own storage
+    SecureByteArray xx(vv.data(), 16);
+    xx.insert(xx.begin() + 8, xx.data(), xx.size());
+    BOOST_CHECK_MESSAGE(xx.size() == 32 && xx[8] == 0 && xx[23] == 15 && xx[24] == 8, "Failed self insertion");
+
+    success = true;
+  }
+  catch(std::exception&)
+  {
+  }
+  BOOST_CHECK_MESSAGE(success, "Failed inline and heap storage");
+}
+
+BOOST_AUTO_TEST_CASE( SecureByteArrayTest_19P )
+{
+  bool success = false;
+  try
+  {
+    const byte small[] = { 1, 2, 3, 4 };
+    SecureByteArray vv(small, COUNTOF(small));
+    SecureByteArray ww(1000, (byte)0x5A);
+
+    // Inline and heap
+    vv.swap(ww);
+    BOOST_CHECK_MESSAGE(vv.size() == 1000 && vv[999] == 0x5A, "Failed to swap secure array (1)");
+    BOOST_CHECK_MESSAGE(ww.size() == 4 && ww[0] == 1 && ww[3] == 4, "Failed to swap secure array (2)");
+
+    // Inline and inline
+    SecureByteArray xx(2, (byte)0x33);
+    xx.swap(ww);
+    BOOST_CHECK_MESSAGE(xx.size() == 4 && xx[3] == 4, "Failed to swap secure array (3)");
+    BOOST_CHECK_MESSAGE(ww.size() == 2 && ww[1] == 0x33, "Failed to swap secure array (4)");
+
+    // Shrinking and regrowing within capacity
+    vv.resize(10, 0);
+    vv.resize(20, 0x11);
+    BOOST_CHECK_MESSAGE(vv.size() == 20 && vv[9] == 0x5A && vv[10] == 0x11, "Failed to resize secure array");
+
+    vv.erase(vv.begin(), vv.begin() + 10);
+    BOOST_CHECK_MESSAGE(vv.size() == 10 && vv[0] == 0x11, "Failed to erase secure array");
+
+    success = true;
+  }
+  catch(std::exception&)
+  {
+  }
+  BOOST_CHECK_MESSAGE(success, "Failed to swap secure arrays");
+}
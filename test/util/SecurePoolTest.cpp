@@ -0,0 +1,171 @@
+/*
+ * OWASP Enterprise Security API (ESAPI)
+ *
+ * This file is part of the Open Web Application Security Project (OWASP)
+ * Enterprise Security API (ESAPI) project. For details, please see
+ * http://www.owasp.org/index.php/ESAPI.
+ *
+ * Copyright (c) 2011 - The OWASP Foundation
+ *
+ * @author Kevin Wall, kevin.w.wall@gmail.com
+ * @author Jeffrey Walton, noloader@gmail.com
+ *
+ */
+
+#include "EsapiCommon.h"
+
+#if defined(ESAPI_OS_WINDOWS_STATIC)
+// do not enable BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS_DYNAMIC)
+# define BOOST_TEST_DYN_LINK
+#elif defined(ESAPI_OS_WINDOWS)
+# error "For Windows, ESAPI_OS_WINDOWS_STATIC or ESAPI_OS_WINDOWS_DYNAMIC must be defined"
+#else
+# define BOOST_TEST_DYN_LINK
+#endif
+
+#include <boost/test/unit_test.hpp>
+using namespace boost::unit_test;
+
+#include "util/SecurePool.h"
+using esapi::SecurePool;
+
+#include "util/SecureArray.h"
+using esapi::SecureByteArray;
+
+#include <vector>
+#include <set>
+
+#include <string.h>
+
+BOOST_AUTO_TEST_CASE( VerifySecurePool_1P )
+{
+  // Every pooled size, the class boundaries, and sizes past the largest class
+  static const size_t sizes[] = { 0, 1, 15, 16, 17, 32, 33, 48, 64, 65, 128, 200, 256, 257, 4096 };
+
+  std::vector<void*> blocks;
+  std::set<void*> unique;
+
+  for(size_t i = 0; i < COUNTOF(sizes); i++)
+    {
+      for(size_t j = 0; j < 64; j++)
+        {
+          byte* p = static_cast<byte*>(SecurePool::Allocate(sizes[i]));
+          BOOST_REQUIRE(p != nullptr);
+
+          // Blocks must be writable for the full request, and never handed out twice
+          ::memset(p, 0xA5, sizes[i]);
+          BOOST_CHECK(unique.insert(p).second);
+          blocks.push_back(p);
+        }
+    }
+
+  size_t k = 0;
+  for(size_t i = 0; i < COUNTOF(sizes); i++)
+    {
+      for(size_t j = 0; j < 64; j++, k++)
+        SecurePool::Deallocate(blocks[k], sizes[i]);
+    }
+
+  // A null pointer is ignored
+  SecurePool::Deallocate(nullptr, 16);
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecurePool_2P )
+{
+  // Pooled blocks come back zeroized, including the word which held the free list
+  // link while the block was free.
+  for(size_t round = 0; round < 4; round++)
+    {
+      byte* p = static_cast<byte*>(SecurePool::Allocate(48));
+      BOOST_REQUIRE(p != nullptr);
+
+      ::memset(p, 0xFF, 48);
+      SecurePool::Deallocate(p, 48);
+
+      byte* q = static_cast<byte*>(SecurePool::Allocate(48));
+      BOOST_REQUIRE(q != nullptr);
+
+      bool zero = true;
+      for(size_t i = 0; i < 48; i++)
+        zero &= (q[i] == 0);
+
+      BOOST_CHECK_MESSAGE(zero, "Pooled block was not zeroized");
+      SecurePool::Deallocate(q, 48);
+    }
+
+  // Unlocked bytes are a subset of the slab bytes. RLIMIT_MEMLOCK may leave some
+  // slabs unlocked, which is not an error.
+  BOOST_CHECK(SecurePool::GetUnlockedBytes() <= SecurePool::GetSlabBytes());
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecurePool_3P )
+{
+  // The containers draw from the pool through zallocator
+  for(size_t i = 1; i <= 300; i += 13)
+    {
+      SecureByteArray arr(i);
+      BOOST_CHECK(arr.size() == i);
+
+      ::memset(arr.data(), (int)i, i);
+      SecureByteArray copy(arr);
+      BOOST_CHECK(copy.size() == arr.size());
+      BOOST_CHECK(0 == ::memcmp(copy.data(), arr.data(), i));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecurePool_4P )
+{
+  // Large enough for the streaming path, and misaligned on both ends
+  std::vector<byte> buffer(SecurePool::NonTemporalSize + 1037, 0xCC);
+  SecurePool::Wipe(&buffer[3], buffer.size() - 5);
+
+  size_t dirty = 0;
+  for(size_t i = 3; i < buffer.size() - 2; i++)
+    dirty += (buffer[i] != 0);
+
+  BOOST_CHECK(dirty == 0);
+  BOOST_CHECK(buffer[2] == 0xCC && buffer[buffer.size() - 2] == 0xCC);
+
+  // Small wipes, and a zero size
+  byte small[33];
+  ::memset(small, 0xCC, sizeof(small));
+  SecurePool::Wipe(small, 17);
+  BOOST_CHECK(small[0] == 0 && small[16] == 0 && small[17] == 0xCC);
+  SecurePool::Wipe(small, 0);
+}
+
+BOOST_AUTO_TEST_CASE( VerifySecurePool_5P )
+{
+  // Only the used extent is wiped. The rest of the block was never written, so the
+  // block is still all zeros when it is handed out again.
+  for(size_t round = 0; round < 4; round++)
+    {
+      byte* p = static_cast<byte*>(SecurePool::Allocate(256));
+      BOOST_REQUIRE(p != nullptr);
+
+      ::memset(p, 0xFF, 20);
+      SecurePool::Deallocate(p, 256, 20);
+
+      byte* q = static_cast<byte*>(SecurePool::Allocate(256));
+      BOOST_REQUIRE(q != nullptr);
+
+      bool zero = true;
+      for(size_t i = 0; i < 256; i++)
+        zero &= (q[i] == 0);
+
+      BOOST_CHECK_MESSAGE(zero, "Pooled block was not zeroized");
+      SecurePool::Deallocate(q, 256, 0);
+    }
+
+  // A container which reserved far more than it used
+  SecureByteArray arr;
+  arr.reserve(SecurePool::NonTemporalSize * 2);
+  for(size_t i = 0; i < 64; i++)
+    arr.push_back((byte)i);
+
+  arr.resize(8, 0);
+  arr.resize(4096, 0x5A);
+  BOOST_CHECK(arr.size() == 4096);
+  BOOST_CHECK(arr[7] == 7 && arr[8] == 0x5A && arr[4095] == 0x5A);
+}